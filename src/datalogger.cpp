@@ -17,18 +17,33 @@
  */
 
 #include "datalogger.h"
-#include <Cmd.h>
 #include "system/measurement_components.h"
 #include "system/monitor.h"
 #include "system/watchdog.h"
 #include "system/command.h"
 #include "sensors/sensor_map.h"
+#include "sensors/slot_drivers.h"
 #include "sensors/drivers/registry.h"
 #include "utilities/i2c.h"
 #include "utilities/qos.h"
 #include "utilities/STM32-UID.h"
 #include "scratch/dbgmcu.h"
 #include "system/logs.h"
+#include "system/boot.h"
+#include "system/journal.h"
+#include "system/ble_offload.h"
+#include "system/bluefruit_spi.h"
+#include "version.h"
+
+const char * statusColumnNames[STATUS_COLUMN_COUNT] = {"type", "site", "logger", "deployment", "deployed_at", "uuid", "time.s", "time.h", "battery.V", "suppressed",
+  "power_up.uC", "warm_up.uC", "measure.uC", "sd_flush.uC", "sleep_entry.uC", "cycle.uC", "config_epoch"};
+
+static_assert(sizeof(datalogger_settings_type) <= EEPROM_DATALOGGER_CONFIGURATION_SIZE, "datalogger settings must fit their EEPROM record");
+static_assert(STATUS_HEADER_SIZE + EEPROM_TOTAL_SENSOR_SLOTS * CSV_COLUMN_HEADERS_SIZE + sizeof(USER_COLUMN_HEADERS) <= DATA_FILE_HEADER_SIZE, "data file header must hold every column");
+
+// write cache storage for the logger's lifetime, reused by every data file
+static char summaryCacheStorage[SUMMARY_CACHE_SIZE] __attribute__((aligned(4)));
+static char rawCacheStorage[RAW_CACHE_SIZE] __attribute__((aligned(4)));
 
 void Datalogger::sleepMCU(uint32 milliseconds)
 {
@@ -69,14 +84,12 @@ void Datalogger::sleepMCU(uint32 milliseconds)
 // static method to read configuration from EEPROM
 void Datalogger::readConfiguration(datalogger_settings_type *settings)
 {
-  byte *buffer = (byte *)malloc(sizeof(byte) * sizeof(datalogger_settings_type));
-  for (unsigned short i = 0; i < sizeof(datalogger_settings_type); i++)
-  {
-    short address = EEPROM_DATALOGGER_CONFIGURATION_START + i;
-    buffer[i] = readEEPROM(&Wire, EEPROM_I2C_ADDRESS, address);
-  }
+  readObjectFromEEPROM(EEPROM_DATALOGGER_CONFIGURATION_START, settings, sizeof(datalogger_settings_type));
 
-  memcpy(settings, buffer, sizeof(datalogger_settings_type));
+  // frequently updated state lives in the journal, newer than the settings record
+  replayJournal();
+  readJournalValue(JOURNAL_KEY_MODE, &settings->mode, sizeof(settings->mode));
+  readJournalValue(JOURNAL_KEY_DEPLOYMENT_TIMESTAMP, &settings->deploymentTimestamp, sizeof(settings->deploymentTimestamp));
 
   // apply defaults
   if (settings->burstNumber == 0 || settings->burstNumber > 20)
@@ -103,6 +116,12 @@ Datalogger::Datalogger(datalogger_settings_type *settings)
   }
 
   memcpy(&this->settings, settings, sizeof(datalogger_settings_type));
+  readJournalValue(JOURNAL_KEY_CONFIG_EPOCH, &configEpoch, sizeof(configEpoch));
+  byte energyLevel;
+  if (readJournalValue(JOURNAL_KEY_ENERGY_LEVEL, &energyLevel, sizeof(energyLevel)))
+  {
+    energyGovernor.restoreLevel((energy_level_type) energyLevel);
+  }
 
   switch (settings->mode)
   {
@@ -121,16 +140,29 @@ Datalogger::Datalogger(datalogger_settings_type *settings)
   }
 }
 
-void Datalogger::setup()
+void Datalogger::setup(bool fastBoot)
 {
+  this->fastBoot = fastBoot;
+  energyGovernor.configure(settings.energy_thresholds);
+  if (resetWasStandbyWake())
+  {
+    recheckBatteryAfterStandby(); // returns only if the battery has recovered
+  }
+  schedule.load();
+  if (currentMonitor.begin())
+  {
+    notify(F("current monitor found"));
+    phaseProfiler.setMonitor(&currentMonitor);
+  }
+  if (!setupTriggerInput(settings.triggerPin))
+  {
+    notify(F("trigger pin can't be used"));
+  }
   startCustomWatchDog();
 
   setupHardwarePins();
-  setupSwitchedPower();
-  powerUpSwitchableComponents();
-
-  bool externalADCInstalled = scanIC2(&Wire, 0x2f);
-  settings.externalADCEnabled = externalADCInstalled;
+  powerUpSwitchableComponents(false); // switched power was cycled by main setup()
+  markBootPhase("components");
 
   setupManualWakeInterrupts();
   disableManualWakeInterrupt(); // don't respond to interrupt during setup
@@ -146,172 +178,519 @@ void Datalogger::setup()
   decodeUniqueId(uuid, uuidString, UUID_LENGTH);
 
   checkMemory();
+#ifdef FIXED_SENSOR_PROFILE
+  sensorProfile.registerDriverTypes();
+#else
   buildDriverSensorMap();
+#endif
   debug("Built driver sensor map");
   loadSensorConfigurations();
   debug("Loaded sensor configurations");
+  markBootPhase("sensors");
   initializeFilesystem();
+  markBootPhase("filesystem");
   setUpCLI();
+  setUpTasks();
+}
+
+void Datalogger::setUpTasks()
+{
+  scheduler.addTask(&cliTask);
+  scheduler.addTask(&measurementCycleTask, true);
+  scheduler.addTask(&flushTask, true);
+  scheduler.addTask(&telemetryTask);
+  scheduler.addTask(&powerTask, true);
+}
+
+unsigned long Datalogger::runCLITask()
+{
+  if (inMode(logging) && Serial2.peek() == -1)
+  {
+    // serial is only listened to between sleeps, idle() wakes this task
+    return TASK_SUSPENDED;
+  }
+
+  processCLI();
+  storeSensorConfigurationIfNeedsSave();
+
+  if (measurementCycleState != cycle_idle && measurementCycleMode != mode)
+  {
+    // the user left the mode this cycle was started in
+    notify(F("Measurement cycle cancelled"));
+    measurementCycleState = cycle_idle;
+    scheduler.suspend(&measurementCycleTask);
+    if (measurementCycleToSerial)
+    {
+      summaryWriteCache->setOutputToSerial(false);
+      rawWriteCache->setOutputToSerial(false);
+      measurementCycleToSerial = false;
+    }
+  }
+  return inMode(logging) ? TASK_SUSPENDED : 10;
+}
+
+void Datalogger::startMeasurementCycle(bool toSerial)
+{
+  initializeMeasurementCycle();
+  measurementCycleToSerial = toSerial;
+  measurementCycleMode = mode;
+  summaryWriteCache->setOutputToSerial(toSerial);
+  rawWriteCache->setOutputToSerial(toSerial);
+  measurementCycleState = cycle_start_up_delay;
+  scheduler.wake(&measurementCycleTask);
+  if (phaseProfiler.active())
+  {
+    phaseProfiler.enterPhase(phase_warm_up, scheduler.now());
+    scheduler.wake(&powerTask);
+  }
 }
 
 /*
 *
-* return: continue processing readings cycle bool
+* one step of the measurement cycle, return: milliseconds until the next step
 */
-bool Datalogger::processReadingsCycle()
+unsigned long Datalogger::runMeasurementCycleTask()
 {
-  measureSensorValues();
-  if (settings.log_raw_data) // we are really talking about a burst summary
+  switch (measurementCycleState)
   {
-    writeRawMeasurementToLogFile();
-  }
+  case cycle_start_up_delay:
+    measurementCycleState = cycle_warm_up;
+    if (settings.startUpDelay > 0)
+    {
+      notify(F("wait for start up delay"));
+      int startUpDelay = settings.startUpDelay*60; // convert to seconds and print
+      notify(startUpDelay);
+      return startUpDelay * 1000; // convert seconds to milliseconds
+    }
+    return 0;
 
-  if (shouldContinueBursting())
+  case cycle_warm_up:
+    if (!sensorsWarmedUp())
+    {
+      // TODO: enhancement, ask the sensor driver how long to wait
+      return 100;
+    }
+    measurementCycleState = cycle_reading;
+    return 0;
+
+  case cycle_reading:
   {
-    // sleep for maximum time before next reading
-    // ask all drivers for maximum time until next burst reading
-    // ask all drivers for maximum time until next available reading
-    // sleep for whichever is less
-    notify(minMillisecondsUntilNextReading());
-    sleepMCU(minMillisecondsUntilNextReading());
-    return true;
+      if (completedBursts == 0)
+      {
+        phaseProfiler.enterPhase(phase_measure, scheduler.now());
+      }
+      bool continueBursting = takeBurstReading(settings.log_raw_data && energyGovernor.rawLoggingAllowed()); // we are really talking about a burst summary
+      if (triggerLatencyPending)
+      {
+        triggerLatencyPending = false;
+        lastTriggerLatency = internalRTCEpochMilliseconds() - activeTrigger.epochMilliseconds;
+        if (lastTriggerLatency > maxTriggerLatency)
+        {
+          maxTriggerLatency = lastTriggerLatency;
+        }
+        char comment[50];
+        sprintf(comment, "trigger,%lu.%03u,%lu", (unsigned long) (activeTrigger.epochMilliseconds / 1000), (unsigned int) (activeTrigger.epochMilliseconds % 1000), lastTriggerLatency);
+        writeCommentToLogFile(comment);
+      }
+      if (wakeLatencyPending)
+      {
+        recordWakeLatency();
+      }
+      if (measurementCycleToSerial)
+      {
+        outputLastMeasurement();
+      }
+
+      if (continueBursting)
+      {
+        // wait for the maximum time before next reading
+        return minMillisecondsUntilNextReading();
+      }
+
+      // otherwise burst cycle completed,
+      completedBursts++;
+
+      // so output burst summary, unless nothing moved beyond its deadband
+      if (summaryRowDue())
+      {
+        writeSummaryMeasurementToLogFile();
+        summaryRowWritten();
+      }
+      else
+      {
+        suppressedRows++;
+      }
+
+      if (completedBursts < (energyGovernor.multipleBurstsAllowed() ? cycleParameters.burstNumber : 1))
+      {
+        initializeBurst();
+        if (cycleParameters.interBurstDelay > 0)
+        {
+          notify(F("burst delay"));
+          // todo: we should sleep any sensors that can be slept without re-warming
+          // this could be called 'standby' mode
+          return cycleParameters.interBurstDelay * 60 * 1000; // convert minutes to milliseconds
+        }
+        return 0;
+      }
+
+      measurementCycleState = cycle_complete;
+      phaseProfiler.enterPhase(phase_sd_flush, scheduler.now());
+      scheduler.wake(&flushTask);
+      return TASK_SUSPENDED;
   }
 
-  // otherwise burse cycle completed,
-  completedBursts++;
+  default:
+    return TASK_SUSPENDED;
+  }
+}
 
-  // so output burst summary
-  writeSummaryMeasurementToLogFile();
+unsigned long Datalogger::runFlushTask()
+{
+  // summaries are committed every cycle, raw rows only when their cache fills
+  summaryWriteCache->flushCache();
+  if (measurementCycleState == cycle_complete && measurementCycleToSerial)
+  {
+    rawWriteCache->flushCache(); // show the whole cycle on serial
+    summaryWriteCache->setOutputToSerial(false);
+    rawWriteCache->setOutputToSerial(false);
+    measurementCycleToSerial = false;
+    measurementCycleState = cycle_idle;
+  }
+  return TASK_SUSPENDED;
+}
 
-  if (completedBursts < settings.burstNumber)
+unsigned long Datalogger::runPowerTask()
+{
+  if (!phaseProfiler.active() || measurementCycleState == cycle_idle)
   {
-    // debug(F("do another burst"));
+    return TASK_SUSPENDED; // woken by startMeasurementCycle()
+  }
+  phaseProfiler.sample(scheduler.now());
+  return PHASE_PROFILER_SAMPLE_MILLISECONDS;
+}
 
-    if (settings.interBurstDelay > 0)
+unsigned long Datalogger::runTelemetryTask()
+{
+  if (inMode(interactive) && interactiveModeLogging)
+  {
+    if (!sensorsWarmedUp())
     {
-      notify(F("burst delay"));
-      int interBurstDelay = settings.interBurstDelay * 60; // convert to seconds
-      // todo: we should sleep any sensors that can be slept without re-warming
-      // this could be called 'standby' mode
-      // placeSensorsInStandbyMode();
-      sleepMCU(interBurstDelay * 1000); // convert seconds to milliseconds
-      // wakeSensorsFromStandbyMode();
+      return 100;
     }
-
-    initializeBurst();
-    return true;
+    // notify(F("interactive log"));
+    measureSensorValues(false);
+    outputLastMeasurement();
+    Serial2.print(F("CMD >> "));
+    writeRawMeasurementToLogFile();
+    return 2000;
   }
-
-  return false;
+  else if (inMode(debugging))
+  {
+    measureSensorValues(false);
+    writeRawMeasurementToLogFile();
+    return 5000; // this value could be configurable, also a step / read from CLI is possible
+  }
+  return TASK_SUSPENDED; // woken by changeMode() and startLogging()
 }
 
 void Datalogger::testMeasurementCycle()
 {
-  initializeMeasurementCycle();
-  fileSystemWriteCache->setOutputToSerial(true); // another way to do this would be to set a special write cache
-  while(processReadingsCycle()){
-    fileSystemWriteCache->flushCache();
-    outputLastMeasurement();
-  }      
-  fileSystemWriteCache->flushCache();            // instead of using a boolean in this particular write cache
-  fileSystemWriteCache->setOutputToSerial(false);// and then set it back to the original writecache here
+  // runs as a task so the CLI stays responsive during the cycle
+  startMeasurementCycle(true);
 }
 
-void Datalogger::loop()
+void Datalogger::awaitNextMeasurementCycle()
 {
-  if (inMode(deploy_on_trigger))
+  phaseProfiler.enterPhase(phase_sd_flush, scheduler.now());
+  summaryWriteCache->flushCache();
+  measurementCycleState = cycle_idle;
+  if (!triggerPending())
   {
-    deploy(); // if deploy returns false here, the trigger setup has a fatal coding defect not detecting invalid conditions for deployment
-    goto SLEEP;
-    return;
+    // triggers that arrived during the last cycle are handled without sleeping
+    if (stopAndAwaitTrigger())
+    {
+      offloadData(false); // the wake button opens an offload session
+    }
   }
+  updateEnergyPolicy();
+  startMeasurementCycle(false);
+  takeTrigger();
+}
 
-  if (inMode(logging))
+void Datalogger::takeTrigger()
+{
+  triggeredCycle = nextTrigger(&activeTrigger);
+  triggerLatencyPending = triggeredCycle;
+  if (triggeredCycle)
   {
-
-    if (powerCycle)
+    wakeLatencyPending = false; // off the sampling grid
+    triggeredCycles++;
+    if (settings.triggerBurstNumber != 0 && settings.triggerBurstNumber != 0xFF)
     {
-      debug("Powercycle");
-      bool deployed = enterFieldLoggingMode();
-      if (!deployed)
-      {
-        // what should we do here?
-        // if we are in the field and the manual power cycle got skipped, the battery will quickly drain
-        // perhaps just shut down the unit?
-        powerDownSwitchableComponents();
-        while (1)
-          ;
-      }
-      powerCycle = false; // handled powercycle loop
-      goto SLEEP;
+      cycleParameters.burstNumber = settings.triggerBurstNumber;
     }
+  }
+}
 
-    if (shouldExitLoggingMode())
+bool Datalogger::slotEnabled(unsigned short index)
+{
+  return energyGovernor.nonEssentialSlotsAllowed() || drivers[index]->isEssential();
+}
+
+// bit per driver index, evaluated once per reading for the fixed profile loops
+unsigned long Datalogger::enabledSlotMask()
+{
+  unsigned long mask = 0;
+  for (unsigned short i = 0; i < sensorCount; i++)
+  {
+    if (slotEnabled(i))
     {
-      notify("Should exit logging mode");
-      changeMode(interactive);
-      return;
+      mask |= 1UL << i;
     }
+  }
+  return mask;
+}
 
-    if(processReadingsCycle())
+// empty values keep the columns aligned with the header
+void Datalogger::writeDisabledSlotColumns(WriteCache * cache, unsigned short index)
+{
+  const char * headers = drivers[index]->getCSVColumnHeaders();
+  for (const char * c = headers; *c != '\0'; c++)
+  {
+    if (*c == ',')
     {
-      return;
+      cache->writeString(",");
     }
+  }
+}
 
-    // otherwise go to sleep
-    fileSystemWriteCache->flushCache();
-  SLEEP:
-    stopAndAwaitTrigger();
-    initializeMeasurementCycle();
+void Datalogger::writeCommentToLogFile(const char * comment)
+{
+  summaryWriteCache->writeString("#");
+  summaryWriteCache->writeString(comment);
+  summaryWriteCache->endOfLine();
+}
+
+void Datalogger::updateEnergyPolicy()
+{
+  int battery = energyGovernor.readBattery();
+  if (!energyGovernor.update(battery))
+  {
     return;
   }
+  byte energyLevel = energyGovernor.getLevel();
+  writeJournalValue(JOURNAL_KEY_ENERGY_LEVEL, &energyLevel, sizeof(energyLevel));
 
-  processCLI();
+  char message[100];
+  sprintf(message, "energy,%lld,%s,%s,%d,%d%%",
+          (long long) timestamp(),
+          energyLevelName(energyGovernor.getPreviousLevel()),
+          energyLevelName(energyGovernor.getLevel()),
+          energyGovernor.getSmoothedBattery(),
+          energyGovernor.getRemainingCapacityPercent());
+  notify(message);
+  writeCommentToLogFile(message);
 
-  storeSensorConfigurationIfNeedsSave();
+  if (energyGovernor.inLastGasp())
+  {
+    enterLastGasp();
+  }
+}
+
+void Datalogger::enterLastGasp()
+{
+  notify(F("Last gasp, entering standby"));
+  summaryWriteCache->flushCache();
+  rawWriteCache->flushCache();
+  fileSystem->closeFileSystem();
+
+  for (unsigned int i = 0; i < sensorCount; i++)
+  {
+    drivers[i]->stop();
+  }
+  powerDownSwitchableComponents();
+  standbyUntilBatteryRecheck();
+}
+
+// Woken from last gasp standby, decide on the battery before files are opened or sensors powered
+void Datalogger::recheckBatteryAfterStandby()
+{
+  energyGovernor.update(energyGovernor.readBattery());
+  byte energyLevel = energyGovernor.getLevel();
+  writeJournalValue(JOURNAL_KEY_ENERGY_LEVEL, &energyLevel, sizeof(energyLevel));
+  if (!energyGovernor.inLastGasp())
+  {
+    notify(F("Battery recovered from last gasp"));
+    return;
+  }
+  notify(F("Battery still low, back to standby"));
+  standbyUntilBatteryRecheck();
+}
+
+void Datalogger::standbyUntilBatteryRecheck()
+{
+  disableSwitchedPower();
+  disableCustomWatchDog();
+
+  // wake up later to check if the battery has recovered, waking from standby restarts the MCU
+  setNextAlarmInternalRTCSeconds(ENERGY_LAST_GASP_RECHECK_SECONDS);
+  enterStandbyMode();
+}
+
+void Datalogger::setEnergyThresholds(const int * thresholds)
+{
+  for (short i = 0; i < ENERGY_THRESHOLD_COUNT; i++)
+  {
+    settings.energy_thresholds[i] = constrain(thresholds[i] / ENERGY_THRESHOLD_UNIT, 0, 0xFE);
+  }
+  energyGovernor.configure(settings.energy_thresholds);
+  storeDataloggerConfiguration();
+}
+
+void Datalogger::printEnergyStatus()
+{
+  int battery = energyGovernor.readBattery();
+  char message[100];
+  sprintf(message, "battery: %d smoothed: %d remaining: %d%% level: %s",
+          battery,
+          energyGovernor.getSmoothedBattery(),
+          energyGovernor.getRemainingCapacityPercent(),
+          energyLevelName(energyGovernor.getLevel()));
+  notify(message);
+  for (short i = 0; i < ENERGY_THRESHOLD_COUNT; i++)
+  {
+    byte threshold = settings.energy_thresholds[i];
+    sprintf(message, "%s below %d", energyLevelName((energy_level_type)(i + 1)),
+            (threshold == 0 || threshold == 0xFF) ? 0 : threshold * ENERGY_THRESHOLD_UNIT);
+    notify(message);
+  }
+}
 
-  if (inMode(logging) || inMode(deploy_on_trigger))
+void Datalogger::idle(unsigned long milliseconds)
+{
+  if (inMode(logging))
   {
-    // processCLI may have moved logger into a deployed mode
-    goto SLEEP;
+    // nothing needs the CLI or peripherals until the next task is due
+    sleepMCU(milliseconds);
+    if (milliseconds >= 5)
+    {
+      scheduler.advanceClock(milliseconds); // systick was stopped
+    }
+    scheduler.wake(&cliTask);
   }
-  else if (inMode(interactive))
+  else
   {
-    if (interactiveModeLogging)
+    // wake on systick or serial input, the main loop feeds the watchdog
+    waitForInterrupt();
+  }
+}
+
+void Datalogger::loop()
+{
+  if (inMode(deploy_on_trigger))
+  {
+    if (triggerConfigured())
     {
-      if (timestamp() > lastInteractiveLogTime + 1)
-      {
-        // notify(F("interactive log"));
-        measureSensorValues(false);
-        if(interactiveModeLogging)
-        {
-          outputLastMeasurement();
-          Serial2.print(F("CMD >> "));
-        }
-        writeRawMeasurementToLogFile();
-        lastInteractiveLogTime = timestamp();
-      }
+      // sleep until the external trigger, or the button, starts the deployment
+      while (!triggerPending() && !stopAndAwaitTrigger())
+        ;
+    }
+    deploy(); // if deploy returns false here, the trigger setup has a fatal coding defect not detecting invalid conditions for deployment
+    awaitNextMeasurementCycle();
+    return;
+  }
+
+  if (inMode(logging) && powerCycle && fastBoot)
+  {
+    // unattended reset while deployed, the file system is already open in the site folder
+    setSensorDebugModes(false);
+    powerCycle = false;
+    updateEnergyPolicy();
+    startMeasurementCycle(false);
+    markBootPhase("first cycle");
+    return;
+  }
+
+  if (inMode(logging) && powerCycle)
+  {
+    debug("Powercycle");
+    bool deployed = enterFieldLoggingMode();
+    if (!deployed)
+    {
+      // what should we do here?
+      // if we are in the field and the manual power cycle got skipped, the battery will quickly drain
+      // perhaps just shut down the unit?
+      powerDownSwitchableComponents();
+      while (1)
+        ;
     }
-    
+    powerCycle = false; // handled powercycle loop
+    awaitNextMeasurementCycle();
+    return;
   }
-  else if (inMode(debugging))
+
+  unsigned long wait = scheduler.runDueTasks();
+
+  if (inMode(logging) && (measurementCycleState == cycle_idle || measurementCycleState == cycle_complete))
   {
-    measureSensorValues(false);
-    writeRawMeasurementToLogFile();
-    delay(5000); // this value could be configurable, also a step / read from CLI is possible
+    // cycle finished, or processCLI moved logger into a deployed mode
+    awaitNextMeasurementCycle();
+    return;
   }
-  else
+
+  if (wait > 0)
   {
-    // invalid mode!
-    notify(F("Invalid Mode!"));
-    notify(mode);
-    mode = interactive;
-    delay(1000);
+    idle(wait);
   }
 
   powerCycle = false;
 }
 
+#ifdef FIXED_SENSOR_PROFILE
+void Datalogger::loadSensorConfigurations()
+{
+  // driver types are fixed at build time, only their configurations come from EEPROM
+  sensorCount = FixedSensorProfile::count;
+  if (drivers == NULL)
+  {
+    drivers = (SensorDriver **)malloc(sizeof(SensorDriver *) * sensorCount);
+    sensorProfile.collectDrivers(drivers);
+  }
+
+  const byte * slots = sensorProfile.slots();
+  const unsigned short * typeCodes = sensorProfile.typeCodes();
+  for (unsigned short i = 0; i < sensorCount; i++)
+  {
+    configuration_bytes configuration;
+    readSensorConfigurationFromEEPROM(slots[i], &configuration);
+    common_sensor_driver_config * commonConfiguration = (common_sensor_driver_config *) &configuration.common;
+    bool configured = commonConfiguration->sensor_type == typeCodes[i];
+    if (!configured)
+    {
+      char message[50];
+      sprintf(message, reinterpretCharPtr(F("slot %d not configured, using defaults")), slots[i] + 1);
+      notify(message);
+      memset(&configuration, 0, sizeof(configuration));
+      commonConfiguration->sensor_type = typeCodes[i];
+      sprintf(commonConfiguration->tag, "s%d", slots[i] + 1);
+    }
+    commonConfiguration->slot = slots[i];
+
+    if (drivers[i]->getProtocol() == i2c)
+    {
+      ((I2CProtocolSensorDriver *)drivers[i])->setWire(&WireTwo);
+    }
+    drivers[i]->setup();
+    drivers[i]->configureFromBytes(configuration);
+    if (!configured)
+    {
+      drivers[i]->setDefaults();
+    }
+  }
+  DerivedDriver::setSlotDrivers(drivers, sensorCount);
+}
+#else
 void Datalogger::loadSensorConfigurations()
 {
 
@@ -378,11 +757,22 @@ void Datalogger::loadSensorConfigurations()
     driver->configureFromBytes(sensorConfigs[i]); //pass configuration struct to the driver
     debug("configured sensor driver");
   }
+  DerivedDriver::setSlotDrivers(drivers, sensorCount);
 
 }
+#endif
 
 void Datalogger::reloadSensorConfigurations() // for dev & debug
 {
+#ifdef FIXED_SENSOR_PROFILE
+  // profile drivers are not heap objects, stop and reconfigure them in place
+  for(unsigned short i=0; i<sensorCount; i++)
+  {
+    drivers[i]->stop();
+  }
+  loadSensorConfigurations();
+  return;
+#endif
   // calling this function does not deal with memory fragmentation
   // so it's not part of the main system, only for dev & debug
   notify("FREE MEM reload");
@@ -402,39 +792,23 @@ void Datalogger::startLogging()
 {
   initializeMeasurementCycle();
   interactiveModeLogging = true;
+  scheduler.wake(&telemetryTask);
 }
 
 void Datalogger::stopLogging()
 {
   interactiveModeLogging = false;
-}
-
-bool Datalogger::shouldExitLoggingMode()
-{
-  if (Serial2.peek() != -1)
-  {
-    //attempt to process the command line
-    for (int i = 0; i < 10; i++)
-    {
-      processCLI();
-    }
-    if (inMode(interactive))
-    {
-      return true;
-    }
-    else
-    {
-      return false;
-    }
-  }
-  return false;
+  rawWriteCache->flushCache();
 }
 
 bool Datalogger::shouldContinueBursting()
 {
+#ifdef FIXED_SENSOR_PROFILE
+  return !sensorProfile.burstCompleted(enabledSlotMask());
+#endif
   for (unsigned short i = 0; i < sensorCount; i++)
   {
-    if (!drivers[i]->burstCompleted())
+    if (slotEnabled(i) && !drivers[i]->burstCompleted())
     {
       return true;
     }
@@ -461,42 +835,23 @@ void Datalogger::initializeMeasurementCycle()
   // notify(F("setting base time"));
   currentEpoch = timestamp();
   offsetMillis = millis();
+  cycleParameters = schedule.parametersAt(currentEpoch, defaultSamplingParameters());
 
   initializeBurst();
 
   completedBursts = 0;
+}
 
-  if (settings.startUpDelay > 0)
-  {
-    // notify("current test");
-    // disableCustomWatchDog();
-    // delay(20000);
-    // startCustomWatchDog();
-
-    notify(F("wait for start up delay"));
-    int startUpDelay = settings.startUpDelay*60; // convert to seconds and print
-    // startUpDelay = 2;
-    notify(startUpDelay);
-    sleepMCU(startUpDelay * 1000); // convert seconds to milliseconds
-    notify("sleep done");
-  }
-
-  bool sensorsWarmedUp = false;
-  while(sensorsWarmedUp == false)
+bool Datalogger::sensorsWarmedUp()
+{
+  for (unsigned short i = 0; i < sensorCount; i++)
   {
-    sensorsWarmedUp = true;
-    for (unsigned short i = 0; i < sensorCount; i++)
+    if (!drivers[i]->isWarmedUp())
     {
-      notify("check isWarmed");
-      if (!drivers[i]->isWarmedUp())
-      {
-        // TODO: enhancement, ask the sensor driver if we should sleep MCU for a while
-        // mcuSleep(drivers[i]->warmUpSleep());
-        sensorsWarmedUp = false;
-      }
+      return false;
     }
   }
-
+  return true;
 }
 
 void Datalogger::measureSensorValues(bool performingBurst)
@@ -509,8 +864,16 @@ void Datalogger::measureSensorValues(bool performingBurst)
     debug("converted enabled channels");
   }
 
+#ifdef FIXED_SENSOR_PROFILE
+  sensorProfile.measure(enabledSlotMask(), performingBurst);
+  return;
+#endif
   for (unsigned int i = 0; i < sensorCount; i++)
   {
+    if (!slotEnabled(i))
+    {
+      continue;
+    }
     if (drivers[i]->takeMeasurement())
     {
       if (performingBurst)
@@ -521,29 +884,23 @@ void Datalogger::measureSensorValues(bool performingBurst)
   }
 }
 
-void Datalogger::writeStatusFieldsToLogFile(const char * type)
+bool Datalogger::statusColumnEnabled(status_column_type column)
 {
-  // debug(F("Write status fields"));
-
-  fileSystemWriteCache->writeString(type);
-  fileSystemWriteCache->writeString((char *)",");
-
-  // Fetch and Log time from DS3231 RTC as epoch and human readable timestamps
-  uint32 currentMillis = millis();
-
-  double currentTime = (double) currentEpoch + ( (double) ( currentMillis - offsetMillis) ) / 1000;
-
-  char currentTimeString[20];
-  char humanTimeString[24]; // YYYY-MM-DD HH:MM:SS:sss
-  sprintf(currentTimeString, "%10.3f", currentTime);                  // convert double value into string
-  t_t2ts(currentTime, currentMillis - offsetMillis, humanTimeString); // convert time_t value to human readable timestamp
-
-  fileSystemWriteCache->writeString(settings.siteName);
-  fileSystemWriteCache->writeString((char *)",");
-  fileSystemWriteCache->writeString(settings.loggerName);
-  fileSystemWriteCache->writeString((char *)",");
+  if (column == status_config_epoch)
+  {
+    return true; // past the 16 mask bits
+  }
+  unsigned short mask = settings.statusColumnMask;
+  if (mask == 0 || mask == 0xFFFF)
+  {
+    // the invariant columns are in the #config lines, per row only when selected explicitly
+    return column < status_site || column > status_uuid;
+  }
+  return mask & (1 << column);
+}
 
-  char buffer[100];
+void Datalogger::formatDeployment(char * buffer)
+{
   if(settings.deploymentIdentifier[0] == 0xFF)
   {
     sprintf(buffer, "%s-%lu", uuidString, settings.deploymentTimestamp);
@@ -552,83 +909,239 @@ void Datalogger::writeStatusFieldsToLogFile(const char * type)
   {
     char deploymentIdentifier[16] = {0};
     strncpy(deploymentIdentifier, settings.deploymentIdentifier, 15);
-    debug(deploymentIdentifier[0]);
-    debug(deploymentIdentifier);
-    debug(uuidString);
-    debug(settings.deploymentTimestamp);
     sprintf(buffer, "%s-%s-%lu", deploymentIdentifier, uuidString, settings.deploymentTimestamp);
   }
-  fileSystemWriteCache->writeString(buffer);
-  fileSystemWriteCache->writeString((char *)",");
-  sprintf(buffer, "%ld,", settings.deploymentTimestamp);
-  fileSystemWriteCache->writeString(buffer);
-  fileSystemWriteCache->writeString(uuidString);
-  fileSystemWriteCache->writeString((char *)",");
-  fileSystemWriteCache->writeString(currentTimeString);
-  fileSystemWriteCache->writeString((char *)",");
-  fileSystemWriteCache->writeString(humanTimeString);
-  fileSystemWriteCache->writeString((char *)","); 
+}
+
+void Datalogger::writeStatusFieldsToLogFile(WriteCache * cache, const char * type)
+{
+  // debug(F("Write status fields"));
+  // each enabled field is followed by a comma, disabled fields are never formatted
+  writePendingConfigurationMetadata();
 
-  // write out the raw battery reading
-  sprintf(buffer, "%d,", getBatteryValue());
-  fileSystemWriteCache->writeString(buffer);
+  if (statusColumnEnabled(status_type))
+  {
+    cache->writeString(type);
+    cache->writeString((char *)",");
+  }
+
+  if (statusColumnEnabled(status_site))
+  {
+    cache->writeString(settings.siteName);
+    cache->writeString((char *)",");
+  }
+  if (statusColumnEnabled(status_logger))
+  {
+    cache->writeString(settings.loggerName);
+    cache->writeString((char *)",");
+  }
+
+  char buffer[100];
+  if (statusColumnEnabled(status_deployment))
+  {
+    formatDeployment(buffer);
+    cache->writeString(buffer);
+    cache->writeString((char *)",");
+  }
+  if (statusColumnEnabled(status_deployed_at))
+  {
+    sprintf(buffer, "%ld,", settings.deploymentTimestamp);
+    cache->writeString(buffer);
+  }
+  if (statusColumnEnabled(status_uuid))
+  {
+    cache->writeString(uuidString);
+    cache->writeString((char *)",");
+  }
+
+  // Fetch and Log time from DS3231 RTC as epoch and human readable timestamps
+  uint32 elapsedMillis = millis() - offsetMillis; // integer seconds and milliseconds, no soft float
+
+  if (statusColumnEnabled(status_time_s))
+  {
+    sprintf(buffer, "%10lu.%03u,", (unsigned long) (currentEpoch + elapsedMillis / 1000), (unsigned int) (elapsedMillis % 1000));
+    cache->writeString(buffer);
+  }
+  if (statusColumnEnabled(status_time_h))
+  {
+    char humanTimeString[24]; // YYYY-MM-DD HH:MM:SS:sss
+    t_t2ts(currentEpoch, elapsedMillis, humanTimeString); // convert time_t value to human readable timestamp
+    cache->writeString(humanTimeString);
+    cache->writeString((char *)",");
+  }
+
+  // write out the raw battery reading and the rows suppressed before this one
+  if (statusColumnEnabled(status_battery))
+  {
+    sprintf(buffer, "%d,", getBatteryValue());
+    cache->writeString(buffer);
+  }
+  if (statusColumnEnabled(status_suppressed))
+  {
+    sprintf(buffer, "%u,", suppressedRows);
+    cache->writeString(buffer);
+  }
+
+  // charge per phase and for the whole of the last completed wake cycle, empty without a current monitor
+  for (short column = status_charge_power_up; column <= status_charge_cycle; column++)
+  {
+    if (!statusColumnEnabled((status_column_type) column))
+    {
+      continue;
+    }
+    if (!phaseProfiler.active())
+    {
+      cache->writeString(",");
+      continue;
+    }
+    long long charge = column == status_charge_cycle ? phaseProfiler.getCompletedCycleCharge() : phaseProfiler.getCompletedCharge((power_phase_type) (column - status_charge_power_up));
+    sprintf(buffer, "%ld,", (long) (charge / 1000));
+    cache->writeString(buffer);
+  }
+
+  sprintf(buffer, "%lu,", configEpoch);
+  cache->writeString(buffer);
 }
 
-void Datalogger::writeUserFieldsToLogFile()
+void Datalogger::writeUserFieldsToLogFile(WriteCache * cache)
 {
   char buffer[150];
   sprintf(buffer, ",%s,", userNote);
-  fileSystemWriteCache->writeString(buffer);
+  cache->writeString(buffer);
   if (userValue != INT_MIN)
   {
     sprintf(buffer, "%d", userValue);
-    fileSystemWriteCache->writeString(buffer);
+    cache->writeString(buffer);
   }
 }
 
-bool Datalogger::writeRawMeasurementToLogFile()
+bool Datalogger::writeRawMeasurementToLogFile()
+{
+  writeStatusFieldsToLogFile(rawWriteCache, "raw");
+
+  // and write out the sensor data
+  debug(F("Write sensor data"));
+#ifdef FIXED_SENSOR_PROFILE
+  sensorProfile.writeRow(rawWriteCache, enabledSlotMask(), false);
+#else
+  for (unsigned short i = 0; i < sensorCount; i++)
+  {
+    // get values from the sensors
+    if (!slotEnabled(i))
+    {
+      writeDisabledSlotColumns(rawWriteCache, i);
+    }
+    else
+    {
+      OutputSpan span = rawWriteCache->reserve(MAX_DATA_STRING_LENGTH);
+      drivers[i]->appendRawData(&span);
+      rawWriteCache->commit(span);
+    }
+    if (i < sensorCount - 1)
+    {
+      rawWriteCache->writeString((char *)reinterpretCharPtr(F(",")));
+    }
+  }
+#endif
+
+  writeUserFieldsToLogFile(rawWriteCache);
+  rawWriteCache->endOfLine();
+  return true;
+}
+
+bool Datalogger::writeSummaryMeasurementToLogFile()
 {
-  writeStatusFieldsToLogFile("raw");
+  writeStatusFieldsToLogFile(summaryWriteCache, "summary");
 
   // and write out the sensor data
-  debug(F("Write sensor data"));
+#ifdef FIXED_SENSOR_PROFILE
+  sensorProfile.writeRow(summaryWriteCache, enabledSlotMask(), true);
+#else
   for (unsigned short i = 0; i < sensorCount; i++)
   {
     // get values from the sensors
-    const char *dataString = drivers[i]->getRawDataString();
-    fileSystemWriteCache->writeString(dataString);
+    if (!slotEnabled(i))
+    {
+      writeDisabledSlotColumns(summaryWriteCache, i);
+    }
+    else
+    {
+      OutputSpan span = summaryWriteCache->reserve(MAX_DATA_STRING_LENGTH);
+      drivers[i]->appendSummaryData(&span);
+      summaryWriteCache->commit(span);
+    }
     if (i < sensorCount - 1)
     {
-      fileSystemWriteCache->writeString((char *)reinterpretCharPtr(F(",")));
+      summaryWriteCache->writeString((char *)reinterpretCharPtr(F(",")));
     }
   }
+#endif
 
-  writeUserFieldsToLogFile();
-  fileSystemWriteCache->endOfLine();
+  writeUserFieldsToLogFile(summaryWriteCache);
+  summaryWriteCache->endOfLine();
   return true;
 }
 
-bool Datalogger::writeSummaryMeasurementToLogFile()
+// one reading of the burst, with the raw row if writeRaw
+bool Datalogger::takeBurstReading(bool writeRaw)
+{
+#ifdef FIXED_SENSOR_PROFILE
+  if (settings.externalADCEnabled)
+  {
+    externalADC->convertEnabledChannels();
+  }
+  if (writeRaw)
+  {
+    writeStatusFieldsToLogFile(rawWriteCache, "raw");
+  }
+  bool continueBursting = sensorProfile.measureBurst(enabledSlotMask(), writeRaw ? rawWriteCache : NULL);
+  if (writeRaw)
+  {
+    writeUserFieldsToLogFile(rawWriteCache);
+    rawWriteCache->endOfLine();
+  }
+  return continueBursting;
+#else
+  measureSensorValues();
+  if (writeRaw)
+  {
+    writeRawMeasurementToLogFile();
+  }
+  return shouldContinueBursting();
+#endif
+}
+
+bool Datalogger::summaryRowDue()
 {
-  writeStatusFieldsToLogFile("summary");
+  unsigned short heartbeat = settings.heartbeatInterval;
+  if (heartbeat == 0 || heartbeat == 0xFFFF)
+  {
+    heartbeat = DEFAULT_HEARTBEAT_INTERVAL;
+  }
+  if (lastSummaryRowTime == 0 || timestamp() - lastSummaryRowTime >= (time_t) heartbeat * 60)
+  {
+    return true;
+  }
 
-  // and write out the sensor data
   for (unsigned short i = 0; i < sensorCount; i++)
   {
-    // get values from the sensors
-    const char *dataString = drivers[i]->getSummaryDataString();
-    fileSystemWriteCache->writeString(dataString);
-    if (i < sensorCount - 1)
+    if (slotEnabled(i) && drivers[i]->summaryMovedBeyondDeadband())
     {
-      fileSystemWriteCache->writeString((char *)reinterpretCharPtr(F(",")));
+      return true;
     }
   }
-
-  writeUserFieldsToLogFile();
-  fileSystemWriteCache->endOfLine();
-  return true;
+  return false;
 }
 
+void Datalogger::summaryRowWritten()
+{
+  for (unsigned short i = 0; i < sensorCount; i++)
+  {
+    drivers[i]->markSummaryWritten();
+  }
+  suppressedRows = 0;
+  lastSummaryRowTime = timestamp();
+}
 
 void Datalogger::setUpCLI()
 {
@@ -712,6 +1225,24 @@ void Datalogger::setConfiguration(cJSON *config)
     notify("Invalid inter burst delay");
   }
 
+  const cJSON * heartbeatJson = cJSON_GetObjectItemCaseSensitive(config, "heartbeat");
+  if(heartbeatJson != NULL && cJSON_IsNumber(heartbeatJson) && heartbeatJson->valueint > 0 && heartbeatJson->valueint < 0xFFFF)
+  {
+    settings.heartbeatInterval = heartbeatJson->valueint;
+  }
+
+  const cJSON * statusColumnsJson = cJSON_GetObjectItemCaseSensitive(config, "statusColumnMask");
+  if(statusColumnsJson != NULL && cJSON_IsNumber(statusColumnsJson) && statusColumnsJson->valueint >= 0 && statusColumnsJson->valueint <= 0xFFFF)
+  {
+    settings.statusColumnMask = statusColumnsJson->valueint;
+  }
+
+  const cJSON * circularSegmentsJson = cJSON_GetObjectItemCaseSensitive(config, "circularSegments");
+  if(circularSegmentsJson != NULL && cJSON_IsNumber(circularSegmentsJson) && circularSegmentsJson->valueint >= 0 && circularSegmentsJson->valueint <= MAX_CIRCULAR_SEGMENTS)
+  {
+    settings.circularSegments = circularSegmentsJson->valueint;
+  }
+
   storeDataloggerConfiguration();
 }
 
@@ -732,6 +1263,32 @@ void Datalogger::getConfiguration(datalogger_settings_type *dataloggerSettings)
   // return(json)
 }
 
+#ifdef FIXED_SENSOR_PROFILE
+void Datalogger::setSensorConfiguration(char *type, cJSON *json)
+{
+  // reconfigure the profile driver in the slot, its type can't change
+  const cJSON * slotJSON = cJSON_GetObjectItemCaseSensitive(json, "slot");
+  SensorDriver * driver = NULL;
+  if (slotJSON != NULL && cJSON_IsNumber(slotJSON))
+  {
+    driver = getDriver(slotJSON->valueint - 1);
+  }
+  if (driver == NULL || strcmp(driver->getSensorTypeString(), type) != 0)
+  {
+    notify(F("slot and type must match the sensor profile"));
+    return;
+  }
+  driver->stop(); // release the pins of the current configuration before it changes
+  if (driver->configureFromJSON(json) == false)
+  {
+    loadSensorConfigurations(); // restore the stored configuration
+    return;
+  }
+  driver->setup();
+  storeSensorConfiguration(driver);
+  DerivedDriver::setSlotDrivers(drivers, sensorCount);
+}
+#else
 void Datalogger::setSensorConfiguration(char *type, cJSON *json)
 {
 
@@ -741,8 +1298,10 @@ void Datalogger::setSensorConfiguration(char *type, cJSON *json)
 
   if (driver != NULL)
   {
+    DerivedDriver::setSlotDrivers(drivers, sensorCount); // derived columns resolve references while configuring
     if (driver->configureFromJSON(json) == false)
     {
+      delete (driver);
       return;
     }
     if (driver->getProtocol() == i2c)
@@ -751,59 +1310,23 @@ void Datalogger::setSensorConfiguration(char *type, cJSON *json)
     }
     driver->setup();
     storeSensorConfiguration(driver);
-
-    bool slotReplacement = false;
-    for (unsigned short i = 0; i < sensorCount; i++)
-    {
-      if (drivers[i]->getCommonConfigurations()->slot == driver->getCommonConfigurations()->slot)
-      {
-        slotReplacement = true;
-        SensorDriver *replacedDriver = drivers[i];
-        drivers[i] = driver;
-        delete (replacedDriver);
-        break;
-      }
-    }
-    if (!slotReplacement)
-    {
-      sensorCount = sensorCount + 1;
-      SensorDriver **updatedDrivers = (SensorDriver **)malloc(sizeof(SensorDriver *) * sensorCount);
-      unsigned short i = 0;
-      // printFreeMemory();
-      // if(sensorCount > 1)
-      // {
-      //   notify(drivers[i]->getCommonConfigurations()->slot);
-      //   notify(driver->getCommonConfigurations()->slot);
-      // }
-      for (; i < sensorCount-1 && drivers[i]->getCommonConfigurations()->slot < driver->getCommonConfigurations()->slot ; i++)
-      {
-        updatedDrivers[i] = drivers[i];
-      }
-
-      updatedDrivers[i] = driver;
-      i++;
-      for (; i < sensorCount; i++)
-      {
-        updatedDrivers[i] = drivers[i-1];
-      }
-      free(drivers);
-      drivers = updatedDrivers;
-    }
+    putSlotDriver(&drivers, &sensorCount, driver);
+    DerivedDriver::setSlotDrivers(drivers, sensorCount);
+  }
+  else
+  {
+    notify("Unknown sensor type");
   }
 }
+#endif
 
 void Datalogger::clearSlot(unsigned short slot)
 {
-  bool slotConfigured = false;
-  for (unsigned short i = 0; i < sensorCount; i++)
-  {
-    if (drivers[i]->getCommonConfigurations()->slot == slot)
-    {
-      slotConfigured = true;
-      break;
-    }
-  }
-  if (!slotConfigured)
+#ifdef FIXED_SENSOR_PROFILE
+  notify(F("slots are fixed by the sensor profile"));
+  return;
+#endif
+  if (!removeSlotDriver(&drivers, &sensorCount, slot))
   {
     notify("Slot not configured");
     return;
@@ -815,24 +1338,37 @@ void Datalogger::clearSlot(unsigned short slot)
     empty[i] = 0xFF;
   }
   writeSensorConfigurationToEEPROM(slot, empty);
-  sensorCount--;
+  configurationChanged();
+  DerivedDriver::setSlotDrivers(drivers, sensorCount);
+}
 
-  SensorDriver **updatedDrivers = (SensorDriver **)malloc(sizeof(SensorDriver *) * sensorCount);
-  int j = 0;
-  for (unsigned short i = 0; i < sensorCount + 1; i++)
+cJSON *Datalogger::getConfigurationJSON() // returns unprotected **
+{
+  cJSON* json = cJSON_CreateObject();
+  cJSON_AddStringToObject(json, reinterpretCharPtr(F("device_uuid")), uuidString);
+  cJSON_AddStringToObject(json, reinterpretCharPtr(F("firmware_version")), WATERBEAR_FIRMWARE_VERSION);
+  cJSON_AddStringToObject(json, reinterpretCharPtr(F("site_name")), settings.siteName);
+  cJSON_AddStringToObject(json, reinterpretCharPtr(F("logger_name")), settings.loggerName);
+  char deploymentIdentifier[16] = {0};
+  if (settings.deploymentIdentifier[0] != 0xFF)
   {
-    if (this->drivers[i]->getCommonConfigurations()->slot != slot)
-    {
-      updatedDrivers[j] = this->drivers[i];
-      j++;
-    } 
-    else 
-    {
-      delete(this->drivers[i]);
-    }
+    strncpy(deploymentIdentifier, settings.deploymentIdentifier, 15);
   }
-  free(this->drivers);
-  this->drivers = updatedDrivers;
+  cJSON_AddStringToObject(json, reinterpretCharPtr(F("deployment_identifier")), deploymentIdentifier);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("deployed_at")), settings.deploymentTimestamp);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("interval(min)")), settings.interval);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("burst_number")), settings.burstNumber);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("start_up_delay(min)")), settings.startUpDelay);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("burst_delay(min)")), settings.interBurstDelay);
+  cJSON_AddBoolToObject(json, reinterpretCharPtr(F("fast_boot")), !settings.fast_boot_disabled);
+  unsigned short heartbeat = settings.heartbeatInterval;
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("heartbeat(min)")), heartbeat == 0 || heartbeat == 0xFFFF ? DEFAULT_HEARTBEAT_INTERVAL : heartbeat);
+  unsigned short statusColumns = settings.statusColumnMask;
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("status_column_mask")), statusColumns == 0 ? 0xFFFF : statusColumns);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("trigger_pin")), settings.triggerPin == TRIGGER_DISABLED ? -1 : settings.triggerPin);
+  cJSON_AddNumberToObject(json, reinterpretCharPtr(F("circular_segments")), settings.circularSegments == 0xFF ? 0 : settings.circularSegments);
+  cJSON_AddBoolToObject(json, reinterpretCharPtr(F("current_monitor")), phaseProfiler.active());
+  return json;
 }
 
 cJSON *Datalogger::getSensorConfiguration(short index) // returns unprotected **
@@ -840,6 +1376,53 @@ cJSON *Datalogger::getSensorConfiguration(short index) // returns unprotected **
   return drivers[index]->getConfigurationJSON();
 }
 
+#define CONFIG_LINE_SIZE 480
+
+// #config,<epoch>,logger,<json> for index 0, #config,<epoch>,slot,<json> for each slot after it
+bool Datalogger::formatConfigurationLine(unsigned short index, char * line, unsigned int size)
+{
+  if (index > sensorCount)
+  {
+    return false;
+  }
+  int prefixLength = sprintf(line, "#config,%lu,%s,", configEpoch, index == 0 ? "logger" : "slot");
+  cJSON * json = index == 0 ? getConfigurationJSON() : getSensorConfiguration(index - 1);
+  if (!cJSON_PrintPreallocated(json, &line[prefixLength], size - prefixLength - 1, false)) // room for the newline
+  {
+    notify(F("config line too long"));
+    strcpy(&line[prefixLength], "{}");
+  }
+  cJSON_Delete(json);
+  strcat(line, "\n");
+  return true;
+}
+
+void Datalogger::writeFileMetadata(Print * output)
+{
+  char line[CONFIG_LINE_SIZE];
+  for (unsigned short i = 0; formatConfigurationLine(i, line, CONFIG_LINE_SIZE); i++)
+  {
+    output->print(line);
+  }
+  configMetadataPending = false;
+}
+
+// mid-file, the #config lines go through the caches so they land ahead of the first row of the new epoch
+void Datalogger::writePendingConfigurationMetadata()
+{
+  if (!configMetadataPending || summaryWriteCache == NULL)
+  {
+    return;
+  }
+  configMetadataPending = false;
+  char line[CONFIG_LINE_SIZE];
+  for (unsigned short i = 0; formatConfigurationLine(i, line, CONFIG_LINE_SIZE); i++)
+  {
+    summaryWriteCache->writeString(line);
+    rawWriteCache->writeString(line);
+  }
+}
+
 void Datalogger::setInterval(int interval)
 {
   settings.interval = interval;
@@ -869,6 +1452,193 @@ void Datalogger::setExternalADCEnabled(bool enabled)
   settings.externalADCEnabled = enabled;
 }
 
+void Datalogger::setFastBootEnabled(bool enabled)
+{
+  settings.fast_boot_disabled = !enabled;
+  storeDataloggerConfiguration();
+}
+
+void Datalogger::setHeartbeatInterval(unsigned short minutes)
+{
+  settings.heartbeatInterval = minutes;
+  storeDataloggerConfiguration();
+}
+
+void Datalogger::setStatusColumnMask(unsigned short mask)
+{
+  settings.statusColumnMask = mask;
+  storeDataloggerConfiguration();
+}
+
+sampling_parameters_type Datalogger::defaultSamplingParameters()
+{
+  sampling_parameters_type parameters;
+  parameters.interval = settings.interval;
+  parameters.burstNumber = settings.burstNumber;
+  parameters.interBurstDelay = settings.interBurstDelay;
+  return parameters;
+}
+
+bool Datalogger::setScheduleWindow(byte index, const schedule_window_type * window)
+{
+  return schedule.setWindow(index, window);
+}
+
+void Datalogger::clearScheduleWindow(byte index)
+{
+  schedule.clearWindow(index);
+}
+
+void Datalogger::printSchedule(short wakeCount)
+{
+  char message[100];
+  for (byte i = 0; i < MAX_SCHEDULE_WINDOWS; i++)
+  {
+    const schedule_window_type * window = schedule.getWindow(i);
+    if (window == NULL)
+    {
+      continue;
+    }
+    sprintf(message, reinterpretCharPtr(F("window %d: %02d:%02d-%02d:%02d every %d min, bursts %d, burst delay %d, weekdays 0x%02x, months 0x%04x")),
+            i, window->startMinute / 60, window->startMinute % 60, window->endMinute / 60, window->endMinute % 60,
+            window->interval, window->burstNumber, window->interBurstDelay == SCHEDULE_INHERIT_BURST_DELAY ? -1 : window->interBurstDelay,
+            window->weekdays, window->months);
+    notify(message);
+  }
+
+  // preview ignores the energy governor's interval multiplier
+  time_t wake = timestamp();
+  for (short i = 0; i < wakeCount; i++)
+  {
+    wake = schedule.nextWake(wake, defaultSamplingParameters());
+    sampling_parameters_type parameters = schedule.parametersAt(wake, defaultSamplingParameters());
+    char humanTime[26];
+    t_t2ts(wake, 0, humanTime);
+    sprintf(message, reinterpretCharPtr(F("wake %s window %d bursts %d")), humanTime, schedule.activeWindow(wake), parameters.burstNumber);
+    notify(message);
+  }
+}
+
+bool Datalogger::setTrigger(byte gpioIndex, byte burstNumber)
+{
+  if (!setupTriggerInput(gpioIndex))
+  {
+    return false;
+  }
+  settings.triggerPin = gpioIndex;
+  settings.triggerBurstNumber = burstNumber;
+  storeDataloggerConfiguration();
+  return true;
+}
+
+void Datalogger::printPowerProfile()
+{
+  if (!phaseProfiler.active())
+  {
+    notify(F("no current monitor"));
+    return;
+  }
+  phaseProfiler.sample(scheduler.now());
+  char message[60];
+  sprintf(message, reinterpretCharPtr(F("current %ld uA")), phaseProfiler.getLastMicroamps());
+  notify(message);
+  for (short phase = 0; phase < POWER_PHASE_COUNT; phase++)
+  {
+    sprintf(message, "%-12s %ld uC", powerPhaseName((power_phase_type) phase), (long) (phaseProfiler.getCompletedCharge((power_phase_type) phase) / 1000));
+    notify(message);
+  }
+  sprintf(message, "%-12s %ld uC", "cycle", (long) (phaseProfiler.getCompletedCycleCharge() / 1000));
+  notify(message);
+}
+
+void Datalogger::offloadData(bool overSerial)
+{
+  // the files are closed for the session so their sizes on the card are current
+  if (summaryWriteCache != NULL)
+  {
+    summaryWriteCache->flushCache();
+    rawWriteCache->flushCache();
+  }
+  fileSystem->closeFileSystem();
+
+  BleOffload offload(fileSystem);
+  if (overSerial)
+  {
+    notify(F("offload over serial, bye ends the session"));
+    SerialOffloadLink link(&Serial2);
+    offload.run(&link, BLE_OFFLOAD_IDLE_TIMEOUT_MILLISECONDS);
+  }
+  else
+  {
+    BluefruitSPI bluefruit;
+    if (bluefruit.powerUp())
+    {
+      notify(F("BLE offload session"));
+      offload.run(&bluefruit, BLE_OFFLOAD_CONNECT_TIMEOUT_MILLISECONDS);
+    }
+    else
+    {
+      debug(F("no BLE module"));
+    }
+    bluefruit.powerDown();
+  }
+
+  fileSystem->reopenFileSystem();
+}
+
+void Datalogger::printTriggerStatus()
+{
+  char message[120];
+  sprintf(message, reinterpretCharPtr(F("trigger gpio %d, bursts %d, queued %d, dropped %u, triggered cycles %u, latency last %lu ms max %lu ms")),
+          triggerConfigured() ? settings.triggerPin : -1,
+          settings.triggerBurstNumber == 0 || settings.triggerBurstNumber == 0xFF ? settings.burstNumber : settings.triggerBurstNumber,
+          triggerPending(), droppedTriggerCount(), triggeredCycles, lastTriggerLatency, maxTriggerLatency);
+  notify(message);
+}
+
+// The first reading after a wake lags the alarm by the wake latency, so the alarm
+// is set early by the latency predicted for this configuration and energy level.
+void Datalogger::armWakeAlarm(time_t now, time_t wake)
+{
+  wakeLatency.select(configEpoch * ENERGY_LEVEL_COUNT + energyGovernor.getLevel());
+  nominalWakeMilliseconds = (unsigned long long) wake * 1000;
+
+  unsigned long lead = wakeLatency.predictedLatency();
+  unsigned long longestLead = wake - now > 1 ? (unsigned long) (wake - now - 1) * 1000 : 0; // setting the alarm takes up to a second
+  if (lead > longestLead)
+  {
+    lead = longestLead;
+  }
+  setNextAlarmInternalRTCEpochMilliseconds(nominalWakeMilliseconds - lead);
+}
+
+void Datalogger::recordWakeLatency()
+{
+  wakeLatencyPending = false;
+  unsigned long long firstReading = internalRTCEpochMilliseconds();
+  lastWakeLatency = (unsigned long) (firstReading - alarmWakeMilliseconds);
+  lastWakeResidual = (long) (firstReading - nominalWakeMilliseconds);
+  wakeLatency.addSample(lastWakeLatency);
+
+  char comment[50];
+  sprintf(comment, "wake,%lu,%lu,%ld", (unsigned long) (nominalWakeMilliseconds / 1000), lastWakeLatency, lastWakeResidual);
+  writeCommentToLogFile(comment);
+}
+
+void Datalogger::printWakeLatency()
+{
+  char message[120];
+  sprintf(message, reinterpretCharPtr(F("wake latency predicted %lu ms from %u cycles, last %lu ms, residual %ld ms")),
+          wakeLatency.predictedLatency(), wakeLatency.sampleCount(), lastWakeLatency, lastWakeResidual);
+  notify(message);
+}
+
+void Datalogger::setCircularSegments(byte segments)
+{
+  settings.circularSegments = segments;
+  storeDataloggerConfiguration();
+}
+
 void Datalogger::setUserNote(char *note)
 {
   strcpy(userNote, note);
@@ -936,7 +1706,7 @@ void Datalogger::storeMode(mode_type mode)
     break;
   }
   settings.mode = modeStorage;
-  storeDataloggerConfiguration();
+  writeJournalValue(JOURNAL_KEY_MODE, &settings.mode, sizeof(settings.mode));
 }
 
 void Datalogger::changeMode(mode_type mode)
@@ -945,6 +1715,7 @@ void Datalogger::changeMode(mode_type mode)
   sprintf(message, reinterpret_cast<const char *> F("Moving to mode %d"), mode);
   notify(message);
   this->mode = mode;
+  scheduler.wake(&telemetryTask);
 }
 
 bool Datalogger::inMode(mode_type mode)
@@ -963,7 +1734,8 @@ bool Datalogger::deploy()
     return false;
   }
 
-  setDeploymentTimestamp(timestamp());  // TODO: deployment should span across power cycles
+  setDeploymentTimestamp(timestamp());  // journaled, so the deployment spans power cycles
+  clearTriggers(); // a deployment trigger or edges before deployment don't start cycles
   enterFieldLoggingMode();
   return true;
 }
@@ -971,6 +1743,8 @@ bool Datalogger::deploy()
 bool Datalogger::enterFieldLoggingMode()
 {
   strcpy(loggingFolder, settings.siteName);
+  summaryWriteCache->flushCache();
+  rawWriteCache->flushCache();
   fileSystem->closeFileSystem();
   initializeFilesystem();
   setSensorDebugModes(false);
@@ -983,7 +1757,15 @@ void Datalogger::initializeFilesystem()
 {
   SdFile::dateTimeCallback(dateTime);
 
-  fileSystem = new WaterBear_FileSystem(loggingFolder, SD_ENABLE_PIN);
+  if (fileSystem == NULL)
+  {
+    fileSystem = new WaterBear_FileSystem(loggingFolder, SD_ENABLE_PIN);
+  }
+  else
+  {
+    fileSystem->initializeSDCard();
+    fileSystem->setLoggingFolder(loggingFolder);
+  }
   Monitor::instance()->filesystem = fileSystem;
   debug(F("Filesystem started OK"));
 
@@ -992,40 +1774,78 @@ void Datalogger::initializeFilesystem()
   sprintf(setupTS, "unixtime: %lld", setupTime);
   notify(setupTS);
 
-  char header[200];
-  const char *statusFields = "type,site,logger,deployment,deployed_at,uuid,time.s,time.h,battery.V";
-  strcpy(header, statusFields);
+  char header[DATA_FILE_HEADER_SIZE];
+  OutputSpan span(header, sizeof(header));
+  for (short column = 0; column < STATUS_COLUMN_COUNT; column++)
+  {
+    if (statusColumnEnabled((status_column_type) column))
+    {
+      span.append("%s,", statusColumnNames[column]);
+    }
+  }
   debug(header);
   for (unsigned short i = 0; i < sensorCount; i++)
   {
     debug(i);
     debug(drivers[i]->getCSVColumnHeaders());
-    strcat(header, ",");
-    strcat(header, drivers[i]->getCSVColumnHeaders());
+    if (i > 0)
+    {
+      span.appendString(",");
+    }
+    span.appendString(drivers[i]->getCSVColumnHeaders());
+  }
+  span.appendString(USER_COLUMN_HEADERS);
+  if (span.truncated())
+  {
+    // rows would no longer line up with the header
+    Serial2.print(F("data file header too long"));
+    while(1);
   }
-  strcat(header, ",user_note,user_value");
 
+  fileSystem->setCircularSegments(settings.circularSegments == 0xFF ? 0 : settings.circularSegments);
+  fileSystem->setMetadataSource(this);
   fileSystem->setNewDataFile(setupTime, header); // name file via epoch timestamps
 
-  if (fileSystemWriteCache != NULL)
+  if (summaryWriteCache == NULL)
+  {
+    summaryWriteCache = new WriteCache(fileSystem->getSummaryOutput(), summaryCacheStorage, SUMMARY_CACHE_SIZE);
+    rawWriteCache = new WriteCache(fileSystem->getRawOutput(), rawCacheStorage, RAW_CACHE_SIZE);
+  }
+  else
   {
-    delete (fileSystemWriteCache);
+    summaryWriteCache->reset(fileSystem->getSummaryOutput());
+    rawWriteCache->reset(fileSystem->getRawOutput());
   }
-  fileSystemWriteCache = new WriteCache(fileSystem);
 }
 
-void Datalogger::powerUpSwitchableComponents()
+void Datalogger::powerUpSwitchableComponents(bool cyclePower)
 {
-  cycleSwitchablePower();
-
-  // turn on 5v booster for exADC reference voltage, needs the delay
+  // turn on 5v booster for exADC reference voltage, it settles along with switched power
   // might be possible to turn off after exADC discovered, not certain.
-  gpioPinOn(GPIO_PIN_3);
-  
-  delay(250);
+  enableBoostConverter();
+
+  if (cyclePower)
+  {
+    cycleSwitchablePower();
+  }
+  else
+  {
+    awaitSwitchablePowerSettled();
+  }
+  awaitBoostConverterSettled();
+
   enableI2C1();
   enableI2C2();
 
+  // external ADC presence is cached in settings, fast boot trusts the cache
+  // and skips the reset and start up wait when no ADC was found before
+  if (fastBoot && !settings.externalADCEnabled)
+  {
+    debug(F("extADC not installed (cached)"));
+    debug(F("Switchable components powered up"));
+    return;
+  }
+
   debug("reset exADC");
   // Reset external ADC (if it's installed)
   delay(1); // delay > 50ns before applying ADC reset
@@ -1034,11 +1854,20 @@ void Datalogger::powerUpSwitchableComponents()
   digitalWrite(EXADC_RESET,HIGH);
   delay(100); // Wait for ADC to start up
 
-  bool externalADCInstalled = scanIC2(&Wire, 0x2f); // use datalogger setting once method is moved to instance method
+  bool externalADCInstalled = i2cDevicePresent(&Wire, ADC_I2C_ADDRESS);
+  if (externalADCInstalled != (bool) settings.externalADCEnabled)
+  {
+    settings.externalADCEnabled = externalADCInstalled;
+    storeDataloggerConfiguration();
+  }
+
   if (externalADCInstalled)
   {
     debug(F("Set up extADC"));
-    externalADC = new AD7091R();
+    if(externalADC == NULL)
+    {
+      externalADC = new AD7091R(); // powerUp runs on every wake
+    }
     externalADC->configure();
     externalADC->enableChannel(0);
     externalADC->enableChannel(1);
@@ -1061,6 +1890,10 @@ void Datalogger::powerDownSwitchableComponents() // called in stopAndAwaitTrigge
   gpioPinOff(GPIO_PIN_6); //not in use currently
   i2c_disable(I2C2);
   digitalWrite(EXADC_RESET,LOW);
+  if (externalADC != NULL)
+  {
+    externalADC->invalidateRegisters(); // held in reset until the next power up
+  }
   debug(F("Switchable components powered down"));
 }
 
@@ -1073,7 +1906,6 @@ void Datalogger::prepareForUserInteraction()
   debug(F("Awakened by user"));
   debug(F(humanTime));
 
-  awakenedByUser = false;
   awakeTime = awakenedTime;
 }
 
@@ -1122,19 +1954,31 @@ void Datalogger::prepareForUserInteraction()
 //   return takeMeasurement;
 // }
 
-void Datalogger::stopAndAwaitTrigger()
+bool Datalogger::stopAndAwaitTrigger()
 {
   debug(F("Await measurement trigger"));
 
   // printInterruptStatus(Serial2);
   debug(F("Going to sleep"));
+  fileSystem->closeFileSystem(); // close file, filesystem, the last of the sd_flush phase
+  phaseProfiler.enterPhase(phase_sleep_entry, scheduler.now());
 
   // save enabled interrupts
   int iser1, iser2, iser3;
   storeAllInterrupts(iser1, iser2, iser3);
 
   clearManualWakeInterrupt();
-  setNextAlarmInternalRTC(settings.interval);
+  time_t now = timestamp();
+  time_t wake;
+  if (schedule.empty())
+  {
+    wake = nextIntervalBoundary(now, settings.interval * energyGovernor.getIntervalMultiplier());
+  }
+  else
+  {
+    wake = schedule.nextWake(now, defaultSamplingParameters(), energyGovernor.getIntervalMultiplier());
+  }
+  armWakeAlarm(now, wake);
 
   // power down sensors -> function?
   for (unsigned int i = 0; i < sensorCount; i++)
@@ -1142,11 +1986,13 @@ void Datalogger::stopAndAwaitTrigger()
     drivers[i]->stop();
   }
 
+  // the last monitor read, switched power and the I2C bus go down from here
+  phaseProfiler.endCycle(scheduler.now());
+
   powerDownSwitchableComponents();
-  fileSystem->closeFileSystem(); // close file, filesystem
   disableSwitchedPower();
 
-  awakenedByUser = false; // Don't go into sleep mode with any interrupt state
+  clearWakeEvents(); // Don't go into sleep mode with any interrupt state
 
   componentsStopMode();
 
@@ -1160,6 +2006,7 @@ void Datalogger::stopAndAwaitTrigger()
 
   enableManualWakeInterrupt();    // The button, which is not powered during stop mode on v0.2 hardware
   nvic_irq_enable(NVIC_RTCALARM); // enable our RTC alarm interrupt
+  enableTriggerInterrupt();
 
   enterStopMode();
 
@@ -1183,40 +2030,70 @@ void Datalogger::stopAndAwaitTrigger()
   startCustomWatchDog(); // could go earlier once working reliably
   // delay( (DEFAULT_WATCHDOG_TIMEOUT_SECONDS + 5) * 1000); // to test the watchdog
 
-  if (awakenedByUser == true)
+  // more than one source can fire before the main loop runs, none are lost
+  bool userWake = false;
+  bool alarmWake = false;
+  wake_event_type event;
+  for (short source = 0; source < WAKE_SOURCE_COUNT; source++)
+  {
+    while (wakeEvents[source].pop(&event))
+    {
+      if (event.source == wake_alarm && !alarmWake)
+      {
+        alarmWake = true;
+        alarmWakeMilliseconds = event.epochMilliseconds;
+      }
+      char message[50];
+      sprintf(message, "%s wake at %lu.%03u", event.source == wake_user ? "user" : "alarm",
+              (unsigned long) (event.epochMilliseconds / 1000), (unsigned int) (event.epochMilliseconds % 1000));
+      debug(message);
+      userWake = userWake || event.source == wake_user;
+    }
+  }
+  if (userWake)
   {
     notify(F("User interrupt"));
   }
+  wakeLatencyPending = alarmWake && !userWake;
 
   // We have woken from the interrupt
   // printInterruptStatus(Serial2);
 
   powerUpSwitchableComponents();
+  phaseProfiler.sample(scheduler.now()); // power_up starts from the first read the bus allows after wake
   // turn components back on
   componentsBurstMode();
   fileSystem->reopenFileSystem();
 
-  if (awakenedByUser == true)
-  {
-    awakeTime = timestamp();
-  }
-
-  // We need to check on which interrupt was triggered
-  if (awakenedByUser)
+  if (userWake)
   {
     prepareForUserInteraction();
   }
+  return userWake;
 }
 
 void Datalogger::storeDataloggerConfiguration()
 {
   writeDataloggerSettingsToEEPROM(&this->settings);
+  // keep the journal from overriding the record just written, no page write if unchanged
+  writeJournalValue(JOURNAL_KEY_MODE, &settings.mode, sizeof(settings.mode));
+  writeJournalValue(JOURNAL_KEY_DEPLOYMENT_TIMESTAMP, &settings.deploymentTimestamp, sizeof(settings.deploymentTimestamp));
+  configurationChanged();
 }
 
 void Datalogger::storeSensorConfiguration(SensorDriver * driver)
 {
   const configuration_bytes configurationBytes = driver->getConfigurationBytes();
   writeSensorConfigurationToEEPROM(driver->getSlot(), &configurationBytes);
+  configurationChanged();
+}
+
+// rows written from here on belong to a new epoch, described by the next #config lines
+void Datalogger::configurationChanged()
+{
+  configEpoch++;
+  writeJournalValue(JOURNAL_KEY_CONFIG_EPOCH, &configEpoch, sizeof(configEpoch));
+  configMetadataPending = true;
 }
 
 void Datalogger::setSiteName(char *siteName)
@@ -1240,6 +2117,8 @@ void Datalogger::setLoggerName(char *loggerName)
 void Datalogger::setDeploymentTimestamp(int timestamp)
 {
   this->settings.deploymentTimestamp = timestamp;
+  writeJournalValue(JOURNAL_KEY_DEPLOYMENT_TIMESTAMP, &settings.deploymentTimestamp, sizeof(settings.deploymentTimestamp));
+  configurationChanged();
 }
 
 const char *Datalogger::getUUIDString()
@@ -1293,9 +2172,12 @@ void Datalogger::outputLastMeasurement()
     Serial2.print(i < sensorCount - 1 ? "," : "\n");
   }
 
+  char dataString[MAX_DATA_STRING_LENGTH];
   for (unsigned short i = 0; i < sensorCount; i++)
   {
-    Serial2.print(drivers[i]->getRawDataString());
+    OutputSpan span(dataString, sizeof(dataString));
+    drivers[i]->appendRawData(&span);
+    Serial2.print(dataString);
     Serial2.print(i < sensorCount - 1 ? "," : "\n");
   }
 }
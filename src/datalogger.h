@@ -38,13 +38,20 @@
 #include "system/switched_power.h"
 #include "system/adc.h"
 #include "system/write_cache.h"
+#include "system/scheduler.h"
+#include "system/energy_governor.h"
+#include "system/schedule.h"
+#include "system/trigger.h"
+#include "system/phase_profiler.h"
+#include "system/wake_latency.h"
 
 #include "sensors/sensor.h"
+#include "sensors/profiles.h"
 
 #define DEPLOYMENT_IDENTIFIER_LENGTH 16
 
 // 64 bytes max, one configuration_partition_bytes
-// Currently there are 14 bytes unused
+// Currently there are 5 bytes unused
 typedef struct datalogger_settings { 
     char deploymentIdentifier[16]; // 16 bytes
     char siteName[8]; // 8 bytes
@@ -59,15 +66,35 @@ typedef struct datalogger_settings {
     byte debug_values : 1;
     byte withold_incomplete_readings : 1; // only publish complete readings, default to withold.
     byte log_raw_data : 1;
-    byte reserved2 : 4;
+    byte fast_boot_disabled : 1; // erased EEPROM reads 1, fast boot is opt in
+    byte reserved2 : 3;
+    byte energy_thresholds[ENERGY_THRESHOLD_COUNT]; // 5 bytes battery counts / 16 per energy level, 0 or 0xFF disabled
+    unsigned short heartbeatInterval; // 2 bytes minutes, longest time without a summary row, 0 or 0xFFFF uses the default
+    unsigned short statusColumnMask; // 2 bytes bit per status_column written to the log, 0 or 0xFFFF all columns
+    byte circularSegments; // 1 byte segment files reused in turn, 0 or 0xFF a new file per deployment
+    byte triggerPin; // 1 byte GPIO_PINS index of the external trigger input, 0xFF none
+    byte triggerBurstNumber; // 1 byte bursts per external trigger, 0 or 0xFF uses burstNumber
 } datalogger_settings_type;
  
+#define DEFAULT_HEARTBEAT_INTERVAL 60 // minutes
+
+// status block columns, in log order
+typedef enum status_column { status_type, status_site, status_logger, status_deployment, status_deployed_at, status_uuid, status_time_s, status_time_h, status_battery, status_suppressed,
+  status_charge_power_up, status_charge_warm_up, status_charge_measure, status_charge_sd_flush, status_charge_sleep_entry, status_charge_cycle, // empty without a current monitor
+  status_config_epoch, // always written, past the mask bits
+  STATUS_COLUMN_COUNT } status_column_type;
+
+#define STATUS_HEADER_SIZE 180 // every status column name with its comma
+#define USER_COLUMN_HEADERS ",user_note,user_value"
+
 typedef enum mode { interactive, debugging, logging, deploy_on_trigger } mode_type;
 
+typedef enum measurement_cycle_state { cycle_idle, cycle_start_up_delay, cycle_warm_up, cycle_reading, cycle_complete } measurement_cycle_state_type;
+
 // Forward declaration of class
 class CommandInterface;
 
-class Datalogger
+class Datalogger : public FileMetadataSource
 {
 
 public:
@@ -78,12 +105,15 @@ public:
     short * sensorTypes = NULL;
     void ** sensorConfigurations = NULL;
     SensorDriver ** drivers = NULL;
+#ifdef FIXED_SENSOR_PROFILE
+    FixedSensorProfile sensorProfile; // drivers points into this
+#endif
     datalogger_settings_type settings;
 
     static void readConfiguration(datalogger_settings_type * settings);
     Datalogger(datalogger_settings_type * settings);
 
-    void setup();
+    void setup(bool fastBoot = false);
     void loop();
 
     void changeMode(mode_type mode);
@@ -108,6 +138,7 @@ public:
 
     void setConfiguration(cJSON * config);
     void getConfiguration(datalogger_settings_type * dataloggerSettings);
+    cJSON * getConfigurationJSON(); // returns unprotected **
     cJSON * getSensorConfiguration(short index);
 
     void setSensorConfiguration(char * type, cJSON * json);
@@ -116,6 +147,20 @@ public:
 
     void calibrate(unsigned short slot, char * subcommand, int arg_cnt, char ** args);
     void setExternalADCEnabled(bool enabled);
+    void setFastBootEnabled(bool enabled);
+    void setHeartbeatInterval(unsigned short minutes);
+    void setStatusColumnMask(unsigned short mask); // takes effect with the next data file
+    void setCircularSegments(byte segments); // takes effect with the next data file
+    void setEnergyThresholds(const int * thresholds); // raw battery counts, 0 disables a level
+    bool setScheduleWindow(byte index, const schedule_window_type * window);
+    void clearScheduleWindow(byte index);
+    void printSchedule(short wakeCount); // windows and the next wake times
+    bool setTrigger(byte gpioIndex, byte burstNumber); // TRIGGER_DISABLED turns the trigger input off
+    void printTriggerStatus();
+    void printWakeLatency();
+    void printPowerProfile();
+    void printEnergyStatus();
+    void offloadData(bool overSerial); // BLE offload session, or the same protocol on the console
 
     void setUserNote(char * note);
     void setUserValue(int value);
@@ -128,40 +173,111 @@ public:
     const char * getUUIDString();
 
     void reloadSensorConfigurations(); // for dev & debug
-    void stopAndAwaitTrigger(); // public for dev & debug
+    bool stopAndAwaitTrigger(); // public for dev & debug, true if woken by the user
+
+    void writeFileMetadata(Print * output); // #config lines of the current epoch
 
 private:
     // modules
-    WaterBear_FileSystem *fileSystem;
-    WriteCache * fileSystemWriteCache = NULL;
+    WaterBear_FileSystem *fileSystem = NULL;
+    WriteCache * summaryWriteCache = NULL;
+    WriteCache * rawWriteCache = NULL;
 
     // state
     char uuidString[25]; // 2 * UUID_LENGTH + 1
     mode_type mode = interactive;
     bool powerCycle = true;
+    bool fastBoot = false; // unattended reset, skip interactive windows and sample right away
     bool interactiveModeLogging = false;
     time_t currentEpoch;
     uint32 offsetMillis;
     char loggingFolder[26];
     int completedBursts;
     int awakeTime;
+    measurement_cycle_state_type measurementCycleState = cycle_idle;
+    mode_type measurementCycleMode = interactive;
+    bool measurementCycleToSerial = false;
+
+    EnergyGovernor energyGovernor;
+    SamplingSchedule schedule;
+    sampling_parameters_type cycleParameters; // from the schedule when the measurement cycle started
+
+    // measured charge per phase
+    INA219 currentMonitor;
+    PhaseProfiler phaseProfiler;
+
+    // external trigger
+    trigger_event_type activeTrigger;
+    bool triggeredCycle = false;
+    bool triggerLatencyPending = false; // until the first reading of a triggered cycle
+    unsigned long lastTriggerLatency = 0; // milliseconds from the edge to the first reading
+    unsigned long maxTriggerLatency = 0;
+    unsigned int triggeredCycles = 0;
+
+    // configuration metadata, rows name the #config lines that describe them by epoch
+    unsigned long configEpoch = 0;
+    bool configMetadataPending = false; // changed since the #config lines were last written
+
+    // wake latency compensation
+    WakeLatencyModel wakeLatency;
+    unsigned long long nominalWakeMilliseconds = 0; // sampling grid time of the armed alarm
+    unsigned long long alarmWakeMilliseconds = 0; // when the alarm fired
+    bool wakeLatencyPending = false; // until the first reading after an alarm wake
+    unsigned long lastWakeLatency = 0;
+    long lastWakeResidual = 0; // first reading after the grid time, milliseconds
+
+    // deadband logging
+    unsigned int suppressedRows = 0; // summary rows skipped since the last one written
+    time_t lastSummaryRowTime = 0;
+
+    // tasks
+    Scheduler scheduler;
+    MemberTask<Datalogger> cliTask{"cli", this, &Datalogger::runCLITask};
+    MemberTask<Datalogger> measurementCycleTask{"measure", this, &Datalogger::runMeasurementCycleTask};
+    MemberTask<Datalogger> flushTask{"flush", this, &Datalogger::runFlushTask};
+    MemberTask<Datalogger> telemetryTask{"telemetry", this, &Datalogger::runTelemetryTask};
+    MemberTask<Datalogger> powerTask{"power", this, &Datalogger::runPowerTask};
 
     // user
     char userNote[100] = "\0";
     int userValue = INT_MIN;
-    int lastInteractiveLogTime = 0;
 
     void loadSensorConfigurations();
-    bool shouldExitLoggingMode();
     void measureSensorValues(bool performingBurst = true);
     bool writeRawMeasurementToLogFile();
     bool writeSummaryMeasurementToLogFile();
+    bool summaryRowDue();
+    void summaryRowWritten();
     void writeDebugFieldsToLogFile();
     bool configurationIsDirty();
     void storeConfiguration();
     void initializeBurst();
+    sampling_parameters_type defaultSamplingParameters();
+    void takeTrigger(); // turn the current cycle into a triggered one if a trigger is queued
+    void armWakeAlarm(time_t now, time_t wake);
+    void recordWakeLatency();
     bool shouldContinueBursting();
-    bool processReadingsCycle();
+    bool takeBurstReading(bool writeRaw); // returns true while bursting continues
+    bool sensorsWarmedUp();
+    bool slotEnabled(unsigned short index);
+    unsigned long enabledSlotMask();
+    void writeDisabledSlotColumns(WriteCache * cache, unsigned short index);
+    void updateEnergyPolicy();
+    void enterLastGasp();
+    void recheckBatteryAfterStandby();
+    void standbyUntilBatteryRecheck();
+    void writeCommentToLogFile(const char * comment);
+
+    // tasks
+    void setUpTasks();
+    unsigned long runCLITask();
+    unsigned long runMeasurementCycleTask();
+    unsigned long runFlushTask();
+    unsigned long runTelemetryTask();
+    unsigned long runPowerTask();
+    void startMeasurementCycle(bool toSerial);
+    void awaitNextMeasurementCycle();
+    void idle(unsigned long milliseconds);
 
     // CLI
     CommandInterface * cli;
@@ -169,13 +285,18 @@ private:
     void setUpCLI();
 
     // utility
-    void writeStatusFieldsToLogFile(const char * type);
-    void writeUserFieldsToLogFile();
+    void writeStatusFieldsToLogFile(WriteCache * cache, const char * type);
+    bool statusColumnEnabled(status_column_type column);
+    void formatDeployment(char * buffer); // <identifier>-<uuid>-<deployed at>
+    void writeUserFieldsToLogFile(WriteCache * cache);
     void initializeMeasurementCycle();
     void outputLastMeasurement();
 
     void storeDataloggerConfiguration();
     void storeSensorConfiguration(SensorDriver * driver);
+    void configurationChanged();
+    bool formatConfigurationLine(unsigned short index, char * line, unsigned int size); // false past the last slot
+    void writePendingConfigurationMetadata();
 
     void sleepMCU(uint32 milliseconds);
     int minMillisecondsUntilNextReading();
@@ -185,7 +306,7 @@ private:
     // void stopAndAwaitTrigger();
     void writeStatusFields(const char * type);
     void prepareForUserInteraction();
-    void powerUpSwitchableComponents();
+    void powerUpSwitchableComponents(bool cyclePower = true);
     void powerDownSwitchableComponents();
 
     // utility
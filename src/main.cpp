@@ -28,6 +28,8 @@
 #include "version.h"
 #include "system/eeprom.h"
 #include "system/logs.h"
+#include "system/boot.h"
+#include "system/switched_power.h"
 
 // Setup and Loop
 Datalogger *datalogger;
@@ -36,13 +38,21 @@ void workspace();
 
 void setup(void)
 {
+  paintFreeMemory();
+  markBootPhase("reset");
+  readResetCause();
+
+  // start the switched power cycle first so the rails settle while the MCU is set up
+  setupSwitchedPower();
+  startSwitchablePowerCycle(resetWasPowerOn());
+  enableBoostConverter();
+
   startSerial2();
-  Monitor::instance()->debugToSerial = true;
+  markBootPhase("serial");
 
   workspace();
 
   startCustomWatchDog();
-  printWatchDogStatus();
 
   // disable unused components and hardware pins
   componentsAlwaysOff();
@@ -50,27 +60,46 @@ void setup(void)
 
   setupInternalRTC();
 
-  // turn on switched power to read from EEPROM
-  setupSwitchedPower();
-  cycleSwitchablePower();
+  // switched power is needed to read from EEPROM
+  awaitSwitchablePowerSettled();
+  markBootPhase("power");
   enableI2C1();
-  delay(500);
 
-  debug("creating datalogger");
   datalogger_settings_type *dataloggerSettings = (datalogger_settings_type *)malloc(sizeof(datalogger_settings_type));
   Datalogger::readConfiguration(dataloggerSettings);
+  markBootPhase("eeprom");
+
+  // fast boot: deployed, opted in, and nobody pressed reset
+  bool fastBoot = dataloggerSettings->mode == 'l'
+                  && !dataloggerSettings->fast_boot_disabled
+                  && resetWasUnattended();
+
+  if (!fastBoot)
+  {
+    Monitor::instance()->debugToSerial = true;
+    printWatchDogStatus();
+  }
+
+  debug("creating datalogger");
   datalogger = new Datalogger(dataloggerSettings);
   debug("created datalogger");
-  datalogger->setup();
+  datalogger->setup(fastBoot);
 
   /* We're ready to go! */
   debug(F("done with setup"));
-  notifyDebugStatus();
+  markBootPhase("setup");
 
   startCustomWatchDog(); // printMCUDebugStatus delays with user message, don't want watchdog to trigger
 
   Monitor::instance()->debugToSerial = false;
 
+  if (fastBoot)
+  {
+    notify(F("Fast boot"));
+    return;
+  }
+
+  notifyDebugStatus();
   printWelcomeMessage(dataloggerSettings);
 
   if (datalogger->inMode(logging))
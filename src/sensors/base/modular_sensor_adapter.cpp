@@ -0,0 +1,151 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "modular_sensor_adapter.h"
+#include "system/logs.h"
+#include <SensorBase.h>
+
+void ModularSensorAdapter::begin(Sensor * sensor, const modular_sensor_timing_type * timing, const modular_sensor_variable_type * variables, short variableCount)
+{
+  this->sensor = sensor;
+  this->timing = timing;
+  this->variables = variables;
+  this->variableCount = min(variableCount, (short) MODULAR_SENSOR_MAX_VARIABLES);
+  for (short i = 0; i < this->variableCount; i++)
+  {
+    values[i] = makeSample(SAMPLE_MISSING, variables[i].exponent, variables[i].unit);
+  }
+}
+
+void ModularSensorAdapter::enterState(modular_sensor_state_type state)
+{
+  this->state = state;
+  stateMillis = millis();
+}
+
+void ModularSensorAdapter::powerUp()
+{
+  if (!setUp)
+  {
+    setUp = sensor->setup();
+    if (!setUp)
+    {
+      notify(F("sensor setup failed"));
+    }
+  }
+  sensor->powerUp();
+  enterState(modular_sensor_warming_up);
+}
+
+void ModularSensorAdapter::sleep()
+{
+  if (state != modular_sensor_off && state != modular_sensor_warming_up)
+  {
+    sensor->sleep();
+  }
+  enterState(modular_sensor_off);
+}
+
+bool ModularSensorAdapter::ready()
+{
+  if (state == modular_sensor_warming_up && sensor->isWarmedUp())
+  {
+    if (!sensor->wake())
+    {
+      notify(F("sensor wake failed"));
+    }
+    enterState(modular_sensor_stabilizing);
+  }
+  if (state == modular_sensor_stabilizing && sensor->isStable())
+  {
+    enterState(modular_sensor_ready);
+  }
+  return state >= modular_sensor_ready;
+}
+
+void ModularSensorAdapter::collectValues(bool success)
+{
+  for (short i = 0; i < variableCount; i++)
+  {
+    float value = sensor->sensorValues[i];
+    if (!success || value == MODULAR_SENSOR_INVALID_VALUE)
+    {
+      values[i] = makeSample(SAMPLE_MISSING, variables[i].exponent, variables[i].unit);
+    }
+    else
+    {
+      values[i] = sampleFromFloat(value, variables[i].exponent, variables[i].unit);
+    }
+  }
+  sensor->clearValues();
+}
+
+bool ModularSensorAdapter::poll()
+{
+  if (state == modular_sensor_off || !ready())
+  {
+    return false;
+  }
+
+  if (state == modular_sensor_ready)
+  {
+    if (sensor->startSingleMeasurement())
+    {
+      enterState(modular_sensor_measuring);
+      return false;
+    }
+    collectValues(false); // counted as a failed reading so the burst still completes
+    return true;
+  }
+
+  // measuring
+  if (!sensor->isMeasurementComplete())
+  {
+    return false;
+  }
+  collectValues(sensor->addSingleMeasurementResult());
+  enterState(modular_sensor_ready);
+  return true;
+}
+
+sample_type ModularSensorAdapter::value(short variable)
+{
+  return values[variable];
+}
+
+unsigned int ModularSensorAdapter::millisecondsUntilNextTransition()
+{
+  unsigned long duration;
+  switch (state)
+  {
+  case modular_sensor_warming_up:
+    duration = timing->warmUpMilliseconds;
+    break;
+  case modular_sensor_stabilizing:
+    duration = timing->stabilizationMilliseconds;
+    break;
+  case modular_sensor_measuring:
+    duration = timing->measurementMilliseconds;
+    break;
+  default:
+    return 0;
+  }
+  unsigned long elapsed = millis() - stateMillis; // wraps safely at 2^32
+  return elapsed >= duration ? 0 : duration - elapsed;
+}
@@ -0,0 +1,86 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_MODULAR_SENSOR_ADAPTER
+#define WATERBEAR_MODULAR_SENSOR_ADAPTER
+
+#include "sensors/sample.h"
+
+class Sensor; // ModularSensors
+
+#define MODULAR_SENSOR_MAX_VARIABLES 4
+#define MODULAR_SENSOR_INVALID_VALUE -9999 // ModularSensors' marker for a failed variable
+
+typedef struct
+{
+  unsigned long warmUpMilliseconds;        // power on to wake
+  unsigned long stabilizationMilliseconds; // wake to the first valid measurement
+  unsigned long measurementMilliseconds;   // request to result
+} modular_sensor_timing_type;
+
+typedef struct
+{
+  signed char exponent; // resolution kept when converting the library's floats
+  sample_unit_type unit;
+} modular_sensor_variable_type;
+
+typedef enum modular_sensor_state
+{
+  modular_sensor_off,
+  modular_sensor_warming_up,
+  modular_sensor_stabilizing,
+  modular_sensor_ready,
+  modular_sensor_measuring
+} modular_sensor_state_type;
+
+/*
+ * Runs a ModularSensors sensor without its blocking waitFor... calls.
+ * Power up, wake, stabilization and measurement become states polled from the
+ * driver's isWarmedUp() and takeMeasurement(), and the time until the next
+ * transition is reported so the measurement cycle can sleep or service other
+ * slots meanwhile. startSingleMeasurement() is only called once the sensor is
+ * stable, which keeps the library from waiting for stability itself.
+ */
+class ModularSensorAdapter
+{
+public:
+  void begin(Sensor * sensor, const modular_sensor_timing_type * timing, const modular_sensor_variable_type * variables, short variableCount);
+  void powerUp();  // from the driver's setup(), which runs after every wake
+  void sleep();    // from the driver's stop()
+  bool ready();    // wakes the sensor once warmed up, true once stable
+  bool poll();     // requests or collects a measurement, true when new values are available
+  sample_type value(short variable);
+  unsigned int millisecondsUntilNextTransition();
+
+private:
+  Sensor * sensor = NULL;
+  const modular_sensor_timing_type * timing = NULL;
+  const modular_sensor_variable_type * variables = NULL;
+  short variableCount = 0;
+  bool setUp = false;
+
+  modular_sensor_state_type state = modular_sensor_off;
+  unsigned long stateMillis = 0;
+  sample_type values[MODULAR_SENSOR_MAX_VARIABLES];
+
+  void enterState(modular_sensor_state_type state);
+  void collectValues(bool success);
+};
+
+#endif
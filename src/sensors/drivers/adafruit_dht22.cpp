@@ -17,7 +17,10 @@ AdaDHT22::AdaDHT22()
   //debug("allocating AdaDHT22")
 }
 
-AdaDHT22::~AdaDHT22(){}
+AdaDHT22::~AdaDHT22()
+{
+  delete dht;
+}
 
 const char * AdaDHT22::getSensorTypeString()
 {
@@ -51,6 +54,11 @@ void AdaDHT22::setup()
 {
   // debug("setup AdaDHT22");
   short gpioPin = GPIO_PINS[configuration.sensor_pin];
+  if(dht != NULL)
+  {
+    // set up again after a reconfiguration, the pin may have changed
+    delete dht;
+  }
   dht = new DHT_Unified(gpioPin, DHTTYPE);
   dht->begin();
   // notify("AdaDHT22 Initialized");
@@ -58,7 +66,8 @@ void AdaDHT22::setup()
 
 void AdaDHT22::stop()
 {
-  free(dht);
+  delete dht;
+  dht = NULL;
   pinMode(GPIO_PINS[configuration.sensor_pin], INPUT);
   digitalWrite(GPIO_PINS[configuration.sensor_pin], LOW);
   // notify("AdaDHT22 stopped");
@@ -71,8 +80,8 @@ bool AdaDHT22::takeMeasurement()
   bool measurementTaken = false;
 
   dht->temperature().getEvent(&event);
-  temperature = event.temperature;
-  if(isnan(temperature))
+  temperature = sampleFromFloat(event.temperature, -2, unit_celsius);
+  if(sampleMissing(temperature))
   {
     notify("Error reading temperature)");
   }
@@ -82,8 +91,8 @@ bool AdaDHT22::takeMeasurement()
   }
 
   dht->humidity().getEvent(&event);
-  humidity = event.relative_humidity;
-  if(isnan(humidity))
+  humidity = sampleFromFloat(event.relative_humidity, -2, unit_percent_rh);
+  if(sampleMissing(humidity))
   {
     notify("Error reading humidity");
   }
@@ -94,28 +103,44 @@ bool AdaDHT22::takeMeasurement()
 
   if(measurementTaken)
   {
-    addValueToBurstSummaryMean("temperature", temperature);
-    addValueToBurstSummaryMean("humidity", humidity);
+    addSampleToBurstSummary(0, temperature);
+    addSampleToBurstSummary(1, humidity);
   }
 
   return measurementTaken;
 }
 
-const char *AdaDHT22::getRawDataString()
+unsigned int AdaDHT22::appendRawData(OutputSpan * span)
 {
-  // debug("configuring AdaDHT22 dataString");
   // process data string for .csv
-  sprintf(dataString, "%.2f,%.2f", temperature, humidity);
-  return dataString;
+  appendColumn(span, 0, temperature);
+  appendColumn(span, 1, humidity);
+  return span->length();
 }
 
-const char *AdaDHT22::getSummaryDataString()
+unsigned int AdaDHT22::appendSummaryData(OutputSpan * span)
 {
-  // debug("configuring AdaDHT22 dataString");
   // process data string for .csv
   // TODO: just reporting the last value, not a true summary
-  sprintf(dataString, "%.2f,%.2f", temperature, humidity);
-  return dataString;
+  appendColumn(span, 0, temperature);
+  appendColumn(span, 1, humidity);
+  return span->length();
+}
+
+bool AdaDHT22::getSummaryValue(short column, sample_type * value)
+{
+  // last values, as in the summary row
+  if(column == 0)
+  {
+    *value = temperature;
+    return true;
+  }
+  if(column == 1)
+  {
+    *value = humidity;
+    return true;
+  }
+  return false;
 }
 
 const char *AdaDHT22::getBaseColumnHeaders()
@@ -48,9 +48,10 @@ class AdaDHT22 : public GPIOProtocolSensorDriver
     void setup();
     void stop();
     bool takeMeasurement();
-    const char * getRawDataString();
-    const char * getSummaryDataString();
+    unsigned int appendRawData(OutputSpan * span);
+    unsigned int appendSummaryData(OutputSpan * span);
     const char * getBaseColumnHeaders();
+    bool getSummaryValue(short column, sample_type * value);
     void initCalibration();
     void calibrationStep(char *step, int arg_cnt, char ** args);
 
@@ -64,12 +65,11 @@ class AdaDHT22 : public GPIOProtocolSensorDriver
   private:
     const char *sensorTypeString = "adafruit_dht22";
     driver_configuration configuration;
-    DHT_Unified *dht;
+    DHT_Unified *dht = NULL;
 
-    float temperature;
-    float humidity;
+    sample_type temperature; // converted from the library's floats at 0.01 resolution
+    sample_type humidity;
     const char *baseColumnHeaders = "C,RH"; // will be written to .csv
-    char dataString[16]; // will be written to .csv
 
     void addCalibrationParametersToJSON(cJSON *json);
 };
@@ -1,12 +1,19 @@
 #include "sensors/drivers/atlas_co2_driver.h"
 #include "system/logs.h" // for debug() and notify()
 
+// ModularSensors timing for this sensor, the adapter waits these out without blocking
+static const modular_sensor_timing_type atlasCO2Timing = {ATLAS_CO2_WARM_UP_TIME_MS, ATLAS_CO2_STABILIZATION_TIME_MS, ATLAS_CO2_MEASUREMENT_TIME_MS};
+static const modular_sensor_variable_type atlasCO2Variables[ATLAS_CO2_NUM_VARIABLES] = {{0, unit_ppm}, {-1, unit_celsius}};
+
 AtlasCO2Driver::AtlasCO2Driver()
 {
   // debug("allocating driver template");
 }
 
-AtlasCO2Driver::~AtlasCO2Driver(){}
+AtlasCO2Driver::~AtlasCO2Driver()
+{
+  delete modularSensorDriver;
+}
 
 const char * AtlasCO2Driver::getSensorTypeString()
 {
@@ -36,47 +43,70 @@ void AtlasCO2Driver::appendDriverSpecificConfigurationJSON(cJSON * json)
 void AtlasCO2Driver::setup()
 {
   // debug("setup AtlasCO2Driver");
-  modularSensorDriver = new AtlasScientificCO2(wire,-1);
-  if(!modularSensorDriver->setup()){
-    notify("CO2 setup failed");
+  if(modularSensorDriver == NULL)
+  {
+    modularSensorDriver = new AtlasScientificCO2(wire,-1);
+    adapter.begin(modularSensorDriver, &atlasCO2Timing, atlasCO2Variables, ATLAS_CO2_NUM_VARIABLES);
   }
-  modularSensorDriver->wake();
+  adapter.powerUp(); // wakes once warmed up, see isWarmedUp()
 }
 
 void AtlasCO2Driver::stop()
 {
-  modularSensorDriver->sleep();
+  adapter.sleep();
   // debug("stop/delete AtlasCO2Driver");
 }
 
+bool AtlasCO2Driver::isWarmedUp()
+{
+  return adapter.ready();
+}
+
 bool AtlasCO2Driver::takeMeasurement()
 {
-  // debug("taking measurement from driver template");
   //return true if measurement taken store in class value(s), false if not
-  modularSensorDriver->startSingleMeasurement();
-  modularSensorDriver->waitForMeasurementCompletion();
-  bool measurementTaken = modularSensorDriver->addSingleMeasurementResult();
-  if(measurementTaken)
+  if(!adapter.poll())
   {
-    value = modularSensorDriver->sensorValues[0];
-    modularSensorDriver->clearValues();
-    measurementTaken = true;
+    return false; // not due yet, millisecondsUntilNextReadingAvailable() says when
   }
-  else
+  for(short i = 0; i < ATLAS_CO2_NUM_VARIABLES; i++)
   {
-    value = -1;
+    addSampleToBurstSummary(i, adapter.value(i));
   }
+  return true;
+}
 
+unsigned int AtlasCO2Driver::millisecondsUntilNextReadingAvailable()
+{
+  return adapter.millisecondsUntilNextTransition();
+}
 
-  return measurementTaken;
+unsigned int AtlasCO2Driver::appendRawData(OutputSpan * span)
+{
+  for(short i = 0; i < ATLAS_CO2_NUM_VARIABLES; i++)
+  {
+    appendColumn(span, i, adapter.value(i));
+  }
+  return span->length();
+}
+
+unsigned int AtlasCO2Driver::appendSummaryData(OutputSpan * span)
+{
+  for(short i = 0; i < ATLAS_CO2_NUM_VARIABLES; i++)
+  {
+    appendColumn(span, i, getBurstSummaryMean(i, atlasCO2Variables[i].exponent));
+  }
+  return span->length();
 }
 
-const char *AtlasCO2Driver::getDataString()
+bool AtlasCO2Driver::getSummaryValue(short column, sample_type * value)
 {
-  // debug("configuring driver template dataString");
-  // process data string for .csv
-  sprintf(dataString, "%d,%d",value,0);
-  return dataString;
+  if(column < 0 || column >= ATLAS_CO2_NUM_VARIABLES)
+  {
+    return false;
+  }
+  *value = getBurstSummaryMean(column, atlasCO2Variables[column].exponent);
+  return !sampleMissing(*value);
 }
 
 const char *AtlasCO2Driver::getBaseColumnHeaders()
@@ -19,6 +19,7 @@
 #define WATERBEAR_ATLAS_CO2_DRIVER
 
 #include "sensors/sensor.h"
+#include "sensors/base/modular_sensor_adapter.h"
 #include <sensors/AtlasScientificCO2.h>
 #include <sensors/CampbellOBS3.h>
 
@@ -48,9 +49,13 @@ class AtlasCO2Driver : public I2CProtocolSensorDriver
     void appendDriverSpecificConfigurationJSON(cJSON * json);
     void setup();
     void stop();
+    bool isWarmedUp();
     bool takeMeasurement();
-    const char * getDataString();
+    unsigned int appendRawData(OutputSpan * span);
+    unsigned int appendSummaryData(OutputSpan * span);
     const char * getBaseColumnHeaders();
+    bool getSummaryValue(short column, sample_type * value);
+    unsigned int millisecondsUntilNextReadingAvailable();
     void initCalibration();
     void calibrationStep(char *step, int arg_cnt, char ** args);
 
@@ -60,17 +65,14 @@ class AtlasCO2Driver : public I2CProtocolSensorDriver
 
   private:
     //sensor specific variables, functions, etc.
-    AtlasScientificCO2 *modularSensorDriver;
+    AtlasScientificCO2 *modularSensorDriver = NULL;
+    ModularSensorAdapter adapter;
     CampbellOBS3 * campbell;
     driver_config configuration;
 
     const char * sensorTypeString = ATLAS_CO2_DRIVER_TYPE_STRING;
 
-    /*value(s) to be placed in dataString, should correspond to number of 
-    column headers and entries in dataString*/
-    int value; // sensor raw return(s) to be added to dataString
     const char *baseColumnHeaders = "CO2_ppm,temperature_C"; // will be written to .csv
-    char dataString[30]; // will be written to .csv
 
     void addCalibrationParametersToJSON(cJSON *json);
 };
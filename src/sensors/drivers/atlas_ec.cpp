@@ -27,7 +27,10 @@ AtlasECDriver::AtlasECDriver()
   // debug("allocation AtlasECDriver");
 }
 
-AtlasECDriver::~AtlasECDriver(){}
+AtlasECDriver::~AtlasECDriver()
+{
+  delete oem_ec;
+}
 
 const char * AtlasECDriver::getSensorTypeString()
 {
@@ -49,7 +52,11 @@ void AtlasECDriver::configureSpecificConfigurationsFromBytes(configuration_bytes
 void AtlasECDriver::setup()
 {
   // notify("setup AtlasECDriver");
-  oem_ec = new EC_OEM(wire, NONE_INT, ec_i2c_id);
+  // setup runs on every wake, keep the same I2C driver for the life of the slot
+  if(oem_ec == NULL)
+  {
+    oem_ec = new EC_OEM(wire, NONE_INT, ec_i2c_id);
+  }
 
   if (true)
   {
@@ -110,7 +117,7 @@ bool AtlasECDriver::takeMeasurement()
     if(newDataAvailable)
     {
       value = oem_ec->getConductivity(true);
-      addValueToBurstSummaryMean("ec", value);
+      addSampleToBurstSummary(0, makeSample(value, 0, unit_millisiemens));
       lastSuccessfulReadingMillis = millis();
       return true;
     }
@@ -123,19 +130,29 @@ bool AtlasECDriver::takeMeasurement()
 
 unsigned int AtlasECDriver::millisecondsUntilNextReadingAvailable()
 {
-  return 640 - (millis() - lastSuccessfulReadingMillis);
+  unsigned long elapsed = millis() - lastSuccessfulReadingMillis; // wraps safely at 2^32
+  return elapsed >= 640 ? 0 : 640 - elapsed;
 }
 
-const char * AtlasECDriver::getRawDataString()
+unsigned int AtlasECDriver::appendRawData(OutputSpan * span)
 {
-  sprintf(dataString, "%d", value);
-  return dataString;
+  return span->append("%d", value);
 }
 
-const char * AtlasECDriver::getSummaryDataString()
+unsigned int AtlasECDriver::appendSummaryData(OutputSpan * span)
 {
-  sprintf(dataString, "%0.2f", getBurstSummaryMean("ec"));
-  return dataString;
+  char formatted[16];
+  return span->appendString(formatSample(formatted, getBurstSummaryMean(0, -2)));
+}
+
+bool AtlasECDriver::getSummaryValue(short column, sample_type * value)
+{
+  if(column != 0)
+  {
+    return false;
+  }
+  *value = getBurstSummaryMean(0, -2);
+  return true;
 }
 
 void AtlasECDriver::initCalibration()
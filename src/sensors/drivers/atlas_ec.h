@@ -38,13 +38,12 @@ class AtlasECDriver : public I2CProtocolSensorDriver
   private:
     const char *sensorTypeString = ATLAS_EC_OEM_TYPE_STRING;
     driver_configuration configuration;
-    EC_OEM *oem_ec; // A pointer to the I2C driver for the Atlas EC sensor
+    EC_OEM *oem_ec = NULL; // A pointer to the I2C driver for the Atlas EC sensor
     
     int value;
     const char * baseColumnHeaders = "ec.mS";
-    char dataString[20]; // local storage for data string
 
-    unsigned long long lastSuccessfulReadingMillis = 0;
+    unsigned long lastSuccessfulReadingMillis = 0;
 
   //
   // Interface Implementation
@@ -58,9 +57,10 @@ class AtlasECDriver : public I2CProtocolSensorDriver
     void setDebugMode(bool debug); // for setting internal debug parameters, such as LED on 
 
     bool takeMeasurement();
-    const char * getRawDataString();
-    const char * getSummaryDataString();
+    unsigned int appendRawData(OutputSpan * span);
+    unsigned int appendSummaryData(OutputSpan * span);
     const char * getBaseColumnHeaders();
+    bool getSummaryValue(short column, sample_type * value);
 
     void initCalibration();
     void calibrationStep(char * step, int arg_cnt, char ** args);
@@ -0,0 +1,547 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "derived.h"
+#include "system/logs.h"
+#include <ctype.h>
+
+SensorDriver ** DerivedDriver::slotDrivers = NULL;
+unsigned short DerivedDriver::slotDriverCount = 0;
+
+DerivedDriver::DerivedDriver()
+{
+  // debug("allocation DerivedDriver");
+}
+
+DerivedDriver::~DerivedDriver(){}
+
+void DerivedDriver::setSlotDrivers(SensorDriver ** drivers, unsigned short count)
+{
+  slotDrivers = drivers;
+  slotDriverCount = count;
+}
+
+protocol_type DerivedDriver::getProtocol()
+{
+  return computed;
+}
+
+const char *DerivedDriver::getSensorTypeString()
+{
+  return sensorTypeString;
+}
+
+configuration_bytes_partition DerivedDriver::getDriverSpecificConfigurationBytes()
+{
+  configuration_bytes_partition partition;
+  memcpy(&partition, &configuration, sizeof(driver_configuration));
+  return partition;
+}
+
+void DerivedDriver::configureSpecificConfigurationsFromBytes(configuration_bytes_partition configurationPartition)
+{
+  memcpy(&configuration, &configurationPartition, sizeof(driver_configuration));
+  if(configuration.length > DERIVED_BYTECODE_SIZE)
+  {
+    configuration.length = 0; // evaluates to an empty column
+  }
+}
+
+void DerivedDriver::setDriverDefaults()
+{
+  configuration.length = 0;
+}
+
+bool DerivedDriver::configureDriverFromJSON(cJSON *json)
+{
+  const cJSON * expressionJSON = cJSON_GetObjectItemCaseSensitive(json, "expression");
+  if(expressionJSON == NULL || !cJSON_IsString(expressionJSON))
+  {
+    notify("Invalid expression");
+    return false;
+  }
+  return compile(expressionJSON->valuestring);
+}
+
+void DerivedDriver::appendDriverSpecificConfigurationJSON(cJSON *json)
+{
+  // postfix form of the compiled expression
+  char rpn[120] = "\0";
+  char token[24];
+  byte i = 0;
+  while(i < configuration.length && strlen(rpn) < sizeof(rpn) - sizeof(token))
+  {
+    byte op = configuration.code[i++];
+    switch(op)
+    {
+    case DERIVED_OP_VALUE:
+      if(!columnName(configuration.code[i] >> 4, configuration.code[i] & 0x0F, token))
+      {
+        sprintf(token, "slot%d.%d", (configuration.code[i] >> 4) + 1, configuration.code[i] & 0x0F);
+      }
+      i += 1;
+      break;
+    case DERIVED_OP_INT:
+      sprintf(token, "%d", (signed char) configuration.code[i]);
+      i += 1;
+      break;
+    case DERIVED_OP_MILLI:
+    {
+      short milli;
+      memcpy(&milli, &configuration.code[i], sizeof(short));
+      sprintf(token, "%0.3f", milli / 1000.0);
+      i += sizeof(short);
+      break;
+    }
+    case DERIVED_OP_FLOAT:
+    {
+      float constant;
+      memcpy(&constant, &configuration.code[i], sizeof(float));
+      sprintf(token, "%f", constant);
+      i += sizeof(float);
+      break;
+    }
+    case DERIVED_OP_ADD: strcpy(token, "+"); break;
+    case DERIVED_OP_SUB: strcpy(token, "-"); break;
+    case DERIVED_OP_MUL: strcpy(token, "*"); break;
+    case DERIVED_OP_DIV: strcpy(token, "/"); break;
+    case DERIVED_OP_NEG: strcpy(token, "neg"); break;
+    default: strcpy(token, "?"); break;
+    }
+    if(rpn[0] != '\0')
+    {
+      strcat(rpn, " ");
+    }
+    strcat(rpn, token);
+  }
+  cJSON_AddStringToObject(json, "rpn", rpn);
+  cJSON_AddNumberToObject(json, "bytecode_size", configuration.length);
+}
+
+//
+// compiler
+//
+
+void DerivedDriver::skipSpaces()
+{
+  while(*cursor == ' ')
+  {
+    cursor++;
+  }
+}
+
+bool DerivedDriver::compile(const char * expression)
+{
+  configuration.length = 0;
+  cursor = expression;
+  depth = 0;
+  maxDepth = 0;
+
+  if(!compileSum())
+  {
+    configuration.length = 0;
+    return false;
+  }
+  skipSpaces();
+  if(*cursor != '\0')
+  {
+    notify("Unexpected character in expression");
+    notify(cursor);
+    configuration.length = 0;
+    return false;
+  }
+
+  char message[50];
+  sprintf(message, "Compiled to %d bytes, stack depth %d", configuration.length, maxDepth);
+  notify(message);
+  return true;
+}
+
+bool DerivedDriver::compileSum()
+{
+  if(!compileProduct())
+  {
+    return false;
+  }
+  while(true)
+  {
+    skipSpaces();
+    char op = *cursor;
+    if(op != '+' && op != '-')
+    {
+      return true;
+    }
+    cursor++;
+    if(!compileProduct() || !emit(op == '+' ? DERIVED_OP_ADD : DERIVED_OP_SUB, NULL, 0, -1))
+    {
+      return false;
+    }
+  }
+}
+
+bool DerivedDriver::compileProduct()
+{
+  if(!compileFactor())
+  {
+    return false;
+  }
+  while(true)
+  {
+    skipSpaces();
+    char op = *cursor;
+    if(op != '*' && op != '/')
+    {
+      return true;
+    }
+    cursor++;
+    if(!compileFactor() || !emit(op == '*' ? DERIVED_OP_MUL : DERIVED_OP_DIV, NULL, 0, -1))
+    {
+      return false;
+    }
+  }
+}
+
+bool DerivedDriver::compileFactor()
+{
+  skipSpaces();
+  char c = *cursor;
+  if(c == '(')
+  {
+    cursor++;
+    if(!compileSum())
+    {
+      return false;
+    }
+    skipSpaces();
+    if(*cursor != ')')
+    {
+      notify("Missing ) in expression");
+      return false;
+    }
+    cursor++;
+    return true;
+  }
+  if(c == '-')
+  {
+    cursor++;
+    return compileFactor() && emit(DERIVED_OP_NEG);
+  }
+  if(isdigit(c) || c == '.')
+  {
+    char * end;
+    double value = strtod(cursor, &end);
+    cursor = end;
+    return emitConstant(value);
+  }
+  if(isalpha(c) || c == '_')
+  {
+    const char * name = cursor;
+    while(isalnum(*cursor) || *cursor == '_' || *cursor == '.')
+    {
+      cursor++;
+    }
+    return emitReference(name, cursor - name);
+  }
+
+  notify("Expected a value in expression");
+  return false;
+}
+
+bool DerivedDriver::emit(byte op, const void * operand, short operandSize, short stackChange)
+{
+  if(configuration.length + 1 + operandSize > DERIVED_BYTECODE_SIZE)
+  {
+    notify("Expression too long");
+    return false;
+  }
+  depth += stackChange;
+  if(depth > DERIVED_STACK_DEPTH)
+  {
+    notify("Expression nested too deeply");
+    return false;
+  }
+  if(depth > maxDepth)
+  {
+    maxDepth = depth;
+  }
+
+  configuration.code[configuration.length++] = op;
+  memcpy(&configuration.code[configuration.length], operand, operandSize);
+  configuration.length += operandSize;
+  return true;
+}
+
+bool DerivedDriver::emitConstant(double value)
+{
+  // smallest exact encoding, fixed point where the constant allows it
+  if(value == (int) value && value >= -128 && value <= 127)
+  {
+    signed char integer = value;
+    return emit(DERIVED_OP_INT, &integer, sizeof(integer), 1);
+  }
+  double milli = value * 1000;
+  double rounded = round(milli); // 32.767 * 1000 is just above 32767
+  if(fabs(rounded) <= 32767 && fabs(milli - rounded) < 1e-6)
+  {
+    short fixed = rounded;
+    return emit(DERIVED_OP_MILLI, &fixed, sizeof(fixed), 1);
+  }
+  float constant = value;
+  return emit(DERIVED_OP_FLOAT, &constant, sizeof(constant), 1);
+}
+
+bool DerivedDriver::emitReference(const char * name, short length)
+{
+  // name is <tag>_<column>, as in the log header
+  for(unsigned short i = 0; i < slotDriverCount; i++)
+  {
+    const common_sensor_driver_config * common = slotDrivers[i]->getCommonConfigurations();
+    short tagLength = strlen(common->tag);
+    if(length <= tagLength + 1 || strncmp(name, common->tag, tagLength) != 0 || name[tagLength] != '_')
+    {
+      continue;
+    }
+
+    const char * columnName = name + tagLength + 1;
+    short columnLength = length - tagLength - 1;
+    const char * header = slotDrivers[i]->getBaseColumnHeaders();
+    short column = 0;
+    while(*header != '\0')
+    {
+      const char * end = strchr(header, ',');
+      short headerLength = end == NULL ? strlen(header) : end - header;
+      if(headerLength == columnLength && strncmp(header, columnName, columnLength) == 0)
+      {
+        if(common->slot == commonConfigurations.slot)
+        {
+          notify("Expression cannot reference its own slot");
+          return false;
+        }
+        if(column > 0x0F)
+        {
+          break;
+        }
+        byte reference = common->slot << 4 | column;
+        return emit(DERIVED_OP_VALUE, &reference, sizeof(reference), 1);
+      }
+      if(end == NULL)
+      {
+        break;
+      }
+      header = end + 1;
+      column++;
+    }
+  }
+
+  char message[60];
+  snprintf(message, sizeof(message), "Unknown column %.*s", length, name);
+  notify(message);
+  return false;
+}
+
+//
+// interpreter
+//
+
+SensorDriver * DerivedDriver::driverForSlot(short slot)
+{
+  for(unsigned short i = 0; i < slotDriverCount; i++)
+  {
+    if(slotDrivers[i]->getSlot() == slot)
+    {
+      return slotDrivers[i];
+    }
+  }
+  return NULL;
+}
+
+bool DerivedDriver::columnName(short slot, short column, char * name)
+{
+  SensorDriver * driver = driverForSlot(slot);
+  if(driver == NULL)
+  {
+    return false;
+  }
+  const char * header = driver->getBaseColumnHeaders();
+  for(short i = 0; i < column && header != NULL; i++)
+  {
+    header = strchr(header, ',');
+    if(header != NULL)
+    {
+      header++;
+    }
+  }
+  if(header == NULL)
+  {
+    return false;
+  }
+  const char * end = strchr(header, ',');
+  short headerLength = end == NULL ? strlen(header) : end - header;
+  sprintf(name, "%s_%.*s", driver->getCommonConfigurations()->tag, headerLength, header);
+  return true;
+}
+
+float DerivedDriver::evaluate()
+{
+  if(evaluating || configuration.length == 0)
+  {
+    return NAN;
+  }
+  evaluating = true;
+
+  float stack[DERIVED_STACK_DEPTH];
+  short top = 0;
+  bool valid = true;
+  byte i = 0;
+  while(valid && i < configuration.length)
+  {
+    byte op = configuration.code[i++];
+    if(op < DERIVED_OP_ADD)
+    {
+      // push
+      if(top >= DERIVED_STACK_DEPTH)
+      {
+        valid = false;
+        break;
+      }
+      switch(op)
+      {
+      case DERIVED_OP_VALUE:
+      {
+        SensorDriver * driver = driverForSlot(configuration.code[i] >> 4);
+        sample_type value;
+        valid = driver != NULL && driver->getSummaryValue(configuration.code[i] & 0x0F, &value);
+        stack[top++] = sampleToFloat(value); // expressions stay float, evaluated once per row
+        i += 1;
+        break;
+      }
+      case DERIVED_OP_INT:
+        stack[top++] = (signed char) configuration.code[i];
+        i += 1;
+        break;
+      case DERIVED_OP_MILLI:
+      {
+        short milli;
+        memcpy(&milli, &configuration.code[i], sizeof(short));
+        stack[top++] = milli / 1000.0f;
+        i += sizeof(short);
+        break;
+      }
+      case DERIVED_OP_FLOAT:
+        memcpy(&stack[top++], &configuration.code[i], sizeof(float));
+        i += sizeof(float);
+        break;
+      default:
+        valid = false;
+      }
+    }
+    else if(op == DERIVED_OP_NEG)
+    {
+      valid = top >= 1;
+      if(valid)
+      {
+        stack[top - 1] = -stack[top - 1];
+      }
+    }
+    else
+    {
+      // binary
+      valid = top >= 2;
+      if(!valid)
+      {
+        break;
+      }
+      float b = stack[--top];
+      float & a = stack[top - 1];
+      switch(op)
+      {
+      case DERIVED_OP_ADD: a += b; break;
+      case DERIVED_OP_SUB: a -= b; break;
+      case DERIVED_OP_MUL: a *= b; break;
+      case DERIVED_OP_DIV: a /= b; break;
+      default: valid = false;
+      }
+    }
+  }
+
+  evaluating = false;
+  return valid && top == 1 ? stack[0] : NAN;
+}
+
+bool DerivedDriver::takeMeasurement()
+{
+  // nothing to read, evaluated when a row is written
+  return true;
+}
+
+unsigned int DerivedDriver::appendRawData(OutputSpan * span)
+{
+  // raw rows see the burst summaries so far
+  return appendSummaryData(span);
+}
+
+unsigned int DerivedDriver::appendSummaryData(OutputSpan * span)
+{
+  float value = evaluate();
+  if(!isnan(value))
+  {
+    appendColumn(span, 0, "%0.3f", value);
+  }
+  return span->length();
+}
+
+const char *DerivedDriver::getBaseColumnHeaders()
+{
+  return baseColumnHeaders;
+}
+
+bool DerivedDriver::getSummaryValue(short column, sample_type *value)
+{
+  if(column != 0)
+  {
+    return false;
+  }
+  *value = sampleFromFloat(evaluate(), -3, unit_calibrated);
+  return !sampleMissing(*value);
+}
+
+bool DerivedDriver::summaryMovedBeyondDeadband()
+{
+  float value = evaluate();
+  if(commonConfigurations.deadband <= 0 || isnan(value) != isnan(lastWrittenValue))
+  {
+    return true;
+  }
+  return fabs(value - lastWrittenValue) > commonConfigurations.deadband;
+}
+
+void DerivedDriver::markSummaryWritten()
+{
+  lastWrittenValue = evaluate();
+}
+
+void DerivedDriver::initCalibration()
+{
+  notify(F("Derived columns are not calibrated"));
+}
+
+void DerivedDriver::calibrationStep(char *step, int arg_cnt, char **args)
+{
+  notify(F("Derived columns are not calibrated"));
+}
@@ -0,0 +1,115 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_DERIVED
+#define WATERBEAR_DERIVED
+
+#include "sensors/sensor.h"
+
+#define DERIVED_TYPE_STRING "derived"
+
+#define DERIVED_BYTECODE_SIZE 31
+#define DERIVED_STACK_DEPTH 8
+
+// bytecode, evaluated on a float stack
+#define DERIVED_OP_VALUE 0x01 // + (slot << 4 | column), burst summary value of another slot
+#define DERIVED_OP_INT 0x02   // + int8
+#define DERIVED_OP_MILLI 0x03 // + int16 little endian, value / 1000
+#define DERIVED_OP_FLOAT 0x04 // + float little endian
+#define DERIVED_OP_ADD 0x10
+#define DERIVED_OP_SUB 0x11
+#define DERIVED_OP_MUL 0x12
+#define DERIVED_OP_DIV 0x13
+#define DERIVED_OP_NEG 0x14
+
+/*
+ * Computes one column from the burst summary values of other slots.
+ * The expression, e.g. "ec_cal / (1 + 0.02 * (dht_C - 25))", names columns as they appear
+ * in the log header and is compiled to bytecode when the slot is configured.
+ */
+class DerivedDriver : public SensorDriver
+{
+  typedef struct // 32 bytes
+  {
+    byte length;
+    byte code[DERIVED_BYTECODE_SIZE];
+  } driver_configuration;
+
+public:
+  DerivedDriver();
+  ~DerivedDriver();
+
+  // the datalogger's configured drivers, for resolving and evaluating references
+  static void setSlotDrivers(SensorDriver ** drivers, unsigned short count);
+
+private:
+  const char *sensorTypeString = DERIVED_TYPE_STRING;
+  driver_configuration configuration;
+
+  const char *baseColumnHeaders = "value";
+  float lastWrittenValue = NAN;
+  bool evaluating = false; // guards against reference cycles between derived slots
+
+  static SensorDriver ** slotDrivers;
+  static unsigned short slotDriverCount;
+
+  // compiler, recursive descent straight to bytecode
+  const char * cursor;
+  short depth;
+  short maxDepth;
+  bool compile(const char * expression);
+  bool compileSum();
+  bool compileProduct();
+  bool compileFactor();
+  bool emit(byte op, const void * operand = NULL, short operandSize = 0, short stackChange = 0);
+  bool emitConstant(double value);
+  bool emitReference(const char * name, short length);
+  void skipSpaces();
+
+  float evaluate();
+  static SensorDriver * driverForSlot(short slot);
+  static bool columnName(short slot, short column, char * name);
+
+  //
+  // Interface Implementation
+  //
+public:
+  protocol_type getProtocol();
+  const char *getSensorTypeString();
+  bool takeMeasurement();
+  unsigned int appendRawData(OutputSpan * span);
+  unsigned int appendSummaryData(OutputSpan * span);
+  const char *getBaseColumnHeaders();
+  bool getSummaryValue(short column, sample_type *value);
+
+  bool summaryMovedBeyondDeadband();
+  void markSummaryWritten();
+
+  void initCalibration();
+  void calibrationStep(char *step, int arg_cnt, char **args);
+
+protected:
+  void configureSpecificConfigurationsFromBytes(configuration_bytes_partition configurations);
+  configuration_bytes_partition getDriverSpecificConfigurationBytes();
+  bool configureDriverFromJSON(cJSON *json);
+  void appendDriverSpecificConfigurationJSON(cJSON *json);
+  void setDriverDefaults();
+};
+
+#endif
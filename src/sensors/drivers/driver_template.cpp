@@ -60,23 +60,29 @@ bool DriverTemplate::takeMeasurement()
     value = 42;
     measurementTaken = true;
   }
-  addValueToBurstSummaryMean("var", value); // use the default option for computing the burst summary value
+  addSampleToBurstSummary(0, makeSample(value, 0, unit_none)); // use the default option for computing the burst summary value
   return measurementTaken;
 }
 
-const char *DriverTemplate::getRawDataString()
+unsigned int DriverTemplate::appendRawData(OutputSpan * span)
 {
-  // debug("configuring driver template dataString");
-  // process data string for .csv
-  sprintf(dataString, "%d,%0.3f",value,value*31.83);
-  return dataString;
+  // process data string for .csv, formatted straight into the span
+  appendColumn(span, 0, "%d", value);
+  appendColumn(span, 1, makeSample(value * 31830L, -3, unit_none)); // scale in fixed point, no float math
+  return span->length();
 }
 
-const char *DriverTemplate::getSummaryDataString()
+unsigned int DriverTemplate::appendSummaryData(OutputSpan * span)
 {
-  double burstSummaryMean = getBurstSummaryMean("var");
-  sprintf(dataString, "%0.3f,%0.3f", burstSummaryMean, burstSummaryMean*31.83);
-  return dataString;  
+  sample_type burstSummaryMean = getBurstSummaryMean(0, -3);
+  sample_type scaled = burstSummaryMean;
+  if(!sampleMissing(burstSummaryMean))
+  {
+    scaled = rescaleSample(makeSample(burstSummaryMean.value * 3183L, -5, unit_none), -3); // * 31.83
+  }
+  appendColumn(span, 0, burstSummaryMean);
+  appendColumn(span, 1, scaled);
+  return span->length();
 }
 
 const char *DriverTemplate::getBaseColumnHeaders()
@@ -43,8 +43,8 @@ class DriverTemplate : public DriverTemplateProtocolSensorDriver
     void setup();
     void stop();
     bool takeMeasurement();
-    const char * getRawDataString();
-    const char * getSummaryDataString();
+    unsigned int appendRawData(OutputSpan * span);
+    unsigned int appendSummaryData(OutputSpan * span);
     const char * getBaseColumnHeaders();
     void initCalibration();
     void calibrationStep(char *step, int arg_cnt, char ** args);
@@ -61,11 +61,10 @@ class DriverTemplate : public DriverTemplateProtocolSensorDriver
     const char *sensorTypeString = DRIVER_TEMPLATE_TYPE_STRING;
     driver_configuration configuration;
 
-    /*value(s) to be placed in dataString, should correspond to number of 
-    column headers and entries in dataString*/
-    int value; // sensor raw return(s) to be added to dataString
+    /*value(s) to be written to the output span, should correspond to number of 
+    column headers and entries in the span*/
+    int value; // sensor raw return(s) to be written to the span
     const char *baseColumnHeaders = "raw,cal"; // will be written to .csv
-    char dataString[16]; // will be written to .csv
 
     void addCalibrationParametersToJSON(cJSON *json);
 };
@@ -23,6 +23,7 @@
 #include "system/clock.h"  // TODO: ideally not included in this scope
 #include "sensors/sensor_map.h"
 #include "system/hardware.h"
+#include "system/low_power.h"
 #include "utilities/rrivmath.h"
 
 int ADC_PINS[5] = {
@@ -33,7 +34,8 @@ int ADC_PINS[5] = {
     ANALOG_INPUT_5_PIN
 };
 
-#define GENERIC_ANALOG_VALUE_TAG "value"
+#define GENERIC_ANALOG_VALUE_COLUMN 0
+#define GENERIC_ANALOG_EXPONENT -3 // summaries and calibrated values have 3 decimals
 
 GenericAnalogDriver::GenericAnalogDriver() {}
 
@@ -104,6 +106,7 @@ void GenericAnalogDriver::setDriverDefaults()
   {
     configurations.adc_select = ADC_SELECT_INTERNAL;
   }
+  updateCalibrationTransform();
 }
 
 configuration_bytes_partition GenericAnalogDriver::getDriverSpecificConfigurationBytes()
@@ -116,6 +119,7 @@ configuration_bytes_partition GenericAnalogDriver::getDriverSpecificConfiguratio
 void GenericAnalogDriver::configureSpecificConfigurationsFromBytes(configuration_bytes_partition configurationPartition)
 {
   memcpy(&configurations, &configurationPartition, sizeof(generic_linear_analog_config));
+  updateCalibrationTransform();
 }
 
 
@@ -184,7 +188,7 @@ bool GenericAnalogDriver::takeMeasurement()
 
   // validate the value
   // store this->value for summary calculation
-  addValueToBurstSummaryMean(GENERIC_ANALOG_VALUE_TAG, this->value);
+  addSampleToBurstSummary(GENERIC_ANALOG_VALUE_COLUMN, makeSample(this->value, 0, unit_counts));
 
   return true;
 }
@@ -213,7 +217,7 @@ void GenericAnalogDriver::takeCalibrationBurstMeasurement()
     notify(this->value);
     sum += this->value;
     x[i] = this->value;
-    delay(100);
+    idleDelay(100);
   }
   double average = (double) sum / configurations.calibrationBurstCount;
   this->value = average;
@@ -229,23 +233,47 @@ void GenericAnalogDriver::takeCalibrationBurstMeasurement()
   notify(buffer);
 }
 
-double GenericAnalogDriver::getCalibratedValue(double value)
+// called whenever m, b or order_of_magnitude change
+void GenericAnalogDriver::updateCalibrationTransform()
 {
-  double calibratedValue = (configurations.m * value + configurations.b) * rrivmath::power(10, -getOrderOfMagnitudeToScale());
-  return calibratedValue;
+  float scale = rrivmath::power(10, -getOrderOfMagnitudeToScale());
+  setupLinearTransform(&calibration, configurations.m * scale, configurations.b * scale, GENERIC_ANALOG_EXPONENT, GENERIC_ANALOG_EXPONENT);
 }
 
-const char *GenericAnalogDriver::getRawDataString() //TODO: getRawDataString() ??
+sample_type GenericAnalogDriver::getCalibratedValue(sample_type value)
 {
-  sprintf(dataString, "%d,%0.3f", value, getCalibratedValue(value));
-  return dataString;
+  return applyLinearTransform(&calibration, value, unit_calibrated);
 }
 
-const char *GenericAnalogDriver::getSummaryDataString()
+unsigned int GenericAnalogDriver::appendRawData(OutputSpan * span)
 {
-  double burstSummaryMean = getBurstSummaryMean(GENERIC_ANALOG_VALUE_TAG);
-  sprintf(dataString, "%0.3f,%0.3f", burstSummaryMean, getCalibratedValue(burstSummaryMean));
-  return dataString;  
+  appendColumn(span, 0, "%d", value);
+  appendColumn(span, 1, getCalibratedValue(makeSample(value, 0, unit_counts)));
+  return span->length();
+}
+
+unsigned int GenericAnalogDriver::appendSummaryData(OutputSpan * span)
+{
+  sample_type burstSummaryMean = getBurstSummaryMean(GENERIC_ANALOG_VALUE_COLUMN, GENERIC_ANALOG_EXPONENT);
+  appendColumn(span, 0, burstSummaryMean);
+  appendColumn(span, 1, getCalibratedValue(burstSummaryMean));
+  return span->length();
+}
+
+bool GenericAnalogDriver::getSummaryValue(short column, sample_type *value)
+{
+  sample_type burstSummaryMean = getBurstSummaryMean(GENERIC_ANALOG_VALUE_COLUMN, GENERIC_ANALOG_EXPONENT);
+  switch (column)
+  {
+  case 0:
+    *value = burstSummaryMean;
+    return true;
+  case 1:
+    *value = getCalibratedValue(burstSummaryMean);
+    return true;
+  default:
+    return false;
+  }
 }
 
 void GenericAnalogDriver::initCalibration()
@@ -335,7 +363,8 @@ void GenericAnalogDriver::calibrationStep(char *step, int arg_cnt, char ** args)
       notify("Print json fail");
     }
     notify(string);
-    free(json);
+    cJSON_free(string);
+    cJSON_Delete(json);
   }
   else if(strcmp(step, "set-cal-burst-length") == 0)
   {
@@ -387,6 +416,7 @@ void GenericAnalogDriver::computeCalibratedCurve() // calibrate using linear slo
   configurations.y1 = scaledCalibrateLowValue; // TODO: larger storage for y values probably necessary
   configurations.y2 = scaledCalibrateHighValue;
   configurations.cal_timestamp = timestamp();
+  updateCalibrationTransform();
 }
 
 short GenericAnalogDriver::getOrderOfMagnitudeToScale()
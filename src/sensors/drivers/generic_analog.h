@@ -55,7 +55,7 @@ private:
 
   int value;
   const char *baseColumnHeaders = "raw,cal";
-  char dataString[16];
+  linear_transform_type calibration; // fixed point form of m, b and order_of_magnitude
   float calibrationVariance = -1;
 
   short calibrate_high_reading = 0;
@@ -68,7 +68,8 @@ private:
   void computeCalibratedCurve();
   void printCalibrationStatus();
   void takeCalibrationBurstMeasurement(); // for calibration
-  double getCalibratedValue(double value);
+  sample_type getCalibratedValue(sample_type value);
+  void updateCalibrationTransform();
   short getOrderOfMagnitudeToScale();
 
 
@@ -80,9 +81,10 @@ public:
   void setup();
   void stop();
   bool takeMeasurement();
-  const char *getRawDataString();
-  const char *getSummaryDataString();
+  unsigned int appendRawData(OutputSpan * span);
+  unsigned int appendSummaryData(OutputSpan * span);
   const char *getBaseColumnHeaders();
+  bool getSummaryValue(short column, sample_type *value);
 
   void initCalibration();
   void calibrationStep(char *step, int arg_cnt, char **args);
@@ -0,0 +1,391 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "i2c_register.h"
+#include "system/logs.h"
+#include "utilities/i2c.h"
+
+static_assert(sizeof(i2c_register_map_type) <= 32, "register map must fit the driver configuration partition");
+
+typedef struct
+{
+  const char * name;
+  const char * columns;
+  i2c_register_map_type map;
+} i2c_known_device_type;
+
+// built in maps, in flash
+const i2c_known_device_type knownDevices[] = {
+  // single shot, high repeatability: T = -45 + 175 * raw / 2^16, RH = 100 * raw / 2^16, CRC bytes skipped
+  {"sht31", "C,RH", {0x44, {0x24, 0x00}, 16, I2C_REGISTER_NO_POINTER, 6, 1, 2, 2, 0,
+    {{0, 0x01, 16, -2, 17500, -4500}, {3, 0x01, 16, -2, 10000, 0}, {0, 0, 0, 0, 0, 0}}}},
+  // pointer write to 0x00 starts T and RH: T = -40 + 165 * raw / 2^16, RH = 100 * raw / 2^16
+  {"hdc1080", "C,RH", {0x40, {0x00, 0x00}, 15, I2C_REGISTER_NO_POINTER, 4, 2, 2, 1, 0,
+    {{0, 0x01, 16, -2, 16500, -4000}, {2, 0x01, 16, -2, 10000, 0}, {0, 0, 0, 0, 0, 0}}}},
+  // continuous conversion, 7.8125 mC per bit
+  {"tmp117", "C", {0x48, {0x00, 0x00}, 0, 0x00, 2, 3, 1, 0, 0,
+    {{0, 0x01 | I2C_FIELD_SIGNED, 4, -3, 125, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}}}},
+};
+#define KNOWN_DEVICE_COUNT (sizeof(knownDevices) / sizeof(i2c_known_device_type))
+
+I2CRegisterDriver::I2CRegisterDriver()
+{
+  // debug("allocation I2CRegisterDriver");
+}
+
+I2CRegisterDriver::~I2CRegisterDriver(){}
+
+const char *I2CRegisterDriver::getSensorTypeString()
+{
+  return sensorTypeString;
+}
+
+configuration_bytes_partition I2CRegisterDriver::getDriverSpecificConfigurationBytes()
+{
+  configuration_bytes_partition partition;
+  memcpy(&partition, &map, sizeof(i2c_register_map_type));
+  return partition;
+}
+
+void I2CRegisterDriver::configureSpecificConfigurationsFromBytes(configuration_bytes_partition configurationPartition)
+{
+  memcpy(&map, &configurationPartition, sizeof(i2c_register_map_type));
+  if(!validMap())
+  {
+    setDriverDefaults();
+  }
+}
+
+void I2CRegisterDriver::setDriverDefaults()
+{
+  memset(&map, 0, sizeof(i2c_register_map_type));
+}
+
+bool I2CRegisterDriver::validMap()
+{
+  if(map.address == 0 || map.address > 0x7F || map.blockLength == 0 || map.blockLength > I2C_REGISTER_MAX_BLOCK
+    || map.fieldCount == 0 || map.fieldCount > I2C_REGISTER_MAX_FIELDS || map.triggerLength > 2 || map.knownDevice > KNOWN_DEVICE_COUNT)
+  {
+    return false;
+  }
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    if(map.fields[i].offset + (map.fields[i].format & I2C_FIELD_WIDTH_MASK) + 1 > map.blockLength || map.fields[i].postShift > 31)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool I2CRegisterDriver::configureDriverFromJSON(cJSON *json)
+{
+  const cJSON * deviceJSON = cJSON_GetObjectItemCaseSensitive(json, "device");
+  if(deviceJSON != NULL && cJSON_IsString(deviceJSON))
+  {
+    for(unsigned short i = 0; i < KNOWN_DEVICE_COUNT; i++)
+    {
+      if(strcmp(deviceJSON->valuestring, knownDevices[i].name) == 0)
+      {
+        memcpy(&map, &knownDevices[i].map, sizeof(i2c_register_map_type));
+        const cJSON * addressJSON = cJSON_GetObjectItemCaseSensitive(json, "address"); // alternate address pin
+        if(addressJSON != NULL && cJSON_IsNumber(addressJSON) && addressJSON->valueint > 0 && addressJSON->valueint <= 0x7F)
+        {
+          map.address = addressJSON->valueint;
+        }
+        return true;
+      }
+    }
+    notify("Unknown device");
+    return false;
+  }
+  return configureCustomMapFromJSON(json);
+}
+
+static bool intFromJSON(cJSON *json, const char * name, int minimum, int maximum, int * value)
+{
+  const cJSON * item = cJSON_GetObjectItemCaseSensitive(json, name);
+  if(item == NULL)
+  {
+    return true; // keep the default
+  }
+  if(!cJSON_IsNumber(item) || item->valueint < minimum || item->valueint > maximum)
+  {
+    char message[40];
+    sprintf(message, "Invalid %s", name);
+    notify(message);
+    return false;
+  }
+  *value = item->valueint;
+  return true;
+}
+
+bool I2CRegisterDriver::configureCustomMapFromJSON(cJSON *json)
+{
+  memset(&map, 0, sizeof(i2c_register_map_type));
+  int address = 0, wait = 0, blockRegister = I2C_REGISTER_NO_POINTER, length = 0;
+  if(!intFromJSON(json, "address", 1, 0x7F, &address) || !intFromJSON(json, "wait_ms", 0, 255, &wait)
+    || !intFromJSON(json, "register", 0, 0xFF, &blockRegister) || !intFromJSON(json, "length", 1, I2C_REGISTER_MAX_BLOCK, &length))
+  {
+    return false;
+  }
+  map.address = address;
+  map.waitMilliseconds = wait;
+  map.blockRegister = blockRegister;
+  map.blockLength = length;
+
+  const cJSON * triggerJSON = cJSON_GetObjectItemCaseSensitive(json, "trigger");
+  if(triggerJSON != NULL)
+  {
+    if(!cJSON_IsArray(triggerJSON) || cJSON_GetArraySize(triggerJSON) > 2)
+    {
+      notify("Invalid trigger");
+      return false;
+    }
+    const cJSON * byteJSON;
+    cJSON_ArrayForEach(byteJSON, triggerJSON)
+    {
+      if(!cJSON_IsNumber(byteJSON) || byteJSON->valueint < 0 || byteJSON->valueint > 0xFF)
+      {
+        notify("Invalid trigger");
+        return false;
+      }
+      map.trigger[map.triggerLength++] = byteJSON->valueint;
+    }
+  }
+
+  const cJSON * fieldsJSON = cJSON_GetObjectItemCaseSensitive(json, "fields");
+  if(fieldsJSON == NULL || !cJSON_IsArray(fieldsJSON) || cJSON_GetArraySize(fieldsJSON) < 1 || cJSON_GetArraySize(fieldsJSON) > I2C_REGISTER_MAX_FIELDS)
+  {
+    notify("Invalid fields");
+    return false;
+  }
+  cJSON * fieldJSON;
+  cJSON_ArrayForEach(fieldJSON, fieldsJSON)
+  {
+    i2c_register_field_type * field = &map.fields[map.fieldCount++];
+    int offset = 0, bytes = 2, shift = 0, multiplier = 1, postShift = 0, addend = 0, exponent = 0;
+    if(!intFromJSON(fieldJSON, "offset", 0, I2C_REGISTER_MAX_BLOCK - 1, &offset) || !intFromJSON(fieldJSON, "bytes", 1, 4, &bytes)
+      || !intFromJSON(fieldJSON, "shift", 0, 15, &shift) || !intFromJSON(fieldJSON, "multiplier", -32768, 32767, &multiplier)
+      || !intFromJSON(fieldJSON, "post_shift", 0, 31, &postShift) || !intFromJSON(fieldJSON, "addend", -32768, 32767, &addend)
+      || !intFromJSON(fieldJSON, "exponent", -9, 9, &exponent))
+    {
+      return false;
+    }
+    field->offset = offset;
+    field->format = (bytes - 1) | (shift << I2C_FIELD_SHIFT_BITS);
+    if(cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(fieldJSON, "signed")))
+    {
+      field->format |= I2C_FIELD_SIGNED;
+    }
+    if(cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(fieldJSON, "little_endian")))
+    {
+      field->format |= I2C_FIELD_LITTLE_ENDIAN;
+    }
+    field->postShift = postShift;
+    field->exponent = exponent;
+    field->multiplier = multiplier;
+    field->addend = addend;
+  }
+
+  if(!validMap())
+  {
+    notify("Invalid register map");
+    return false;
+  }
+  return true;
+}
+
+void I2CRegisterDriver::appendDriverSpecificConfigurationJSON(cJSON *json)
+{
+  if(map.knownDevice > 0)
+  {
+    cJSON_AddStringToObject(json, "device", knownDevices[map.knownDevice - 1].name);
+    cJSON_AddNumberToObject(json, "address", map.address);
+    return;
+  }
+  cJSON_AddNumberToObject(json, "address", map.address);
+  if(map.triggerLength > 0)
+  {
+    int trigger[2] = {map.trigger[0], map.trigger[1]};
+    cJSON_AddItemToObject(json, "trigger", cJSON_CreateIntArray(trigger, map.triggerLength));
+  }
+  cJSON_AddNumberToObject(json, "wait_ms", map.waitMilliseconds);
+  if(map.blockRegister != I2C_REGISTER_NO_POINTER)
+  {
+    cJSON_AddNumberToObject(json, "register", map.blockRegister);
+  }
+  cJSON_AddNumberToObject(json, "length", map.blockLength);
+  cJSON * fieldsJSON = cJSON_AddArrayToObject(json, "fields");
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    const i2c_register_field_type * field = &map.fields[i];
+    cJSON * fieldJSON = cJSON_CreateObject();
+    cJSON_AddNumberToObject(fieldJSON, "offset", field->offset);
+    cJSON_AddNumberToObject(fieldJSON, "bytes", (field->format & I2C_FIELD_WIDTH_MASK) + 1);
+    cJSON_AddBoolToObject(fieldJSON, "signed", field->format & I2C_FIELD_SIGNED);
+    cJSON_AddBoolToObject(fieldJSON, "little_endian", field->format & I2C_FIELD_LITTLE_ENDIAN);
+    cJSON_AddNumberToObject(fieldJSON, "shift", field->format >> I2C_FIELD_SHIFT_BITS);
+    cJSON_AddNumberToObject(fieldJSON, "multiplier", field->multiplier);
+    cJSON_AddNumberToObject(fieldJSON, "post_shift", field->postShift);
+    cJSON_AddNumberToObject(fieldJSON, "addend", field->addend);
+    cJSON_AddNumberToObject(fieldJSON, "exponent", field->exponent);
+    cJSON_AddItemToArray(fieldsJSON, fieldJSON);
+  }
+}
+
+const char *I2CRegisterDriver::getBaseColumnHeaders()
+{
+  if(map.knownDevice > 0)
+  {
+    return knownDevices[map.knownDevice - 1].columns;
+  }
+  baseColumnHeaders[0] = '\0';
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    char column[6];
+    sprintf(column, i == 0 ? "v%d" : ",v%d", i + 1);
+    strcat(baseColumnHeaders, column);
+  }
+  return baseColumnHeaders;
+}
+
+sample_type I2CRegisterDriver::extractField(const i2c_register_field_type * field, const byte * block)
+{
+  byte width = (field->format & I2C_FIELD_WIDTH_MASK) + 1;
+  unsigned long raw = 0;
+  for(byte i = 0; i < width; i++)
+  {
+    byte b = (field->format & I2C_FIELD_LITTLE_ENDIAN) ? block[field->offset + width - 1 - i] : block[field->offset + i];
+    raw = (raw << 8) | b;
+  }
+  long value = raw;
+  if((field->format & I2C_FIELD_SIGNED) && width < 4 && (raw & (1UL << (width * 8 - 1))))
+  {
+    value = (long) (raw | (0xFFFFFFFFUL << (width * 8))); // sign extend
+  }
+  value >>= field->format >> I2C_FIELD_SHIFT_BITS;
+
+  long long scaled = (long long) value * field->multiplier;
+  if(field->postShift > 0)
+  {
+    scaled = (scaled + (1LL << (field->postShift - 1))) >> field->postShift;
+  }
+  return makeSample((long) scaled + field->addend, field->exponent, unit_none);
+}
+
+bool I2CRegisterDriver::readBlock()
+{
+  byte block[I2C_REGISTER_MAX_BLOCK];
+  short pointer = map.blockRegister == I2C_REGISTER_NO_POINTER ? -1 : map.blockRegister;
+  if(!i2cReadBlock(wire, map.address, pointer, block, map.blockLength))
+  {
+    return false;
+  }
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    values[i] = extractField(&map.fields[i], block);
+  }
+  return true;
+}
+
+bool I2CRegisterDriver::takeMeasurement()
+{
+  if(map.fieldCount == 0)
+  {
+    return false; // not configured
+  }
+  if(map.triggerLength > 0 && !conversionStarted)
+  {
+    conversionStarted = i2cWriteCommand(wire, map.address, map.trigger, map.triggerLength);
+    conversionStartMillis = millis();
+    if(conversionStarted)
+    {
+      return false; // read after waitMilliseconds
+    }
+  }
+  else if(conversionStarted && millis() - conversionStartMillis < map.waitMilliseconds)
+  {
+    return false;
+  }
+  conversionStarted = false;
+
+  bool read = readBlock();
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    if(!read)
+    {
+      values[i] = makeSample(SAMPLE_MISSING, map.fields[i].exponent, unit_none);
+    }
+    addSampleToBurstSummary(i, values[i]);
+  }
+  if(!read)
+  {
+    notify("i2c read failed");
+  }
+  return true; // a failed read still counts toward the burst, logged as nan
+}
+
+unsigned int I2CRegisterDriver::millisecondsUntilNextReadingAvailable()
+{
+  if(!conversionStarted)
+  {
+    return 0;
+  }
+  unsigned long elapsed = millis() - conversionStartMillis;
+  return elapsed >= map.waitMilliseconds ? 0 : map.waitMilliseconds - elapsed;
+}
+
+unsigned int I2CRegisterDriver::appendRawData(OutputSpan * span)
+{
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    appendColumn(span, i, values[i]);
+  }
+  return span->length();
+}
+
+unsigned int I2CRegisterDriver::appendSummaryData(OutputSpan * span)
+{
+  for(short i = 0; i < map.fieldCount; i++)
+  {
+    appendColumn(span, i, getBurstSummaryMean(i, map.fields[i].exponent));
+  }
+  return span->length();
+}
+
+bool I2CRegisterDriver::getSummaryValue(short column, sample_type *value)
+{
+  if(column < 0 || column >= map.fieldCount)
+  {
+    return false;
+  }
+  *value = getBurstSummaryMean(column, map.fields[column].exponent);
+  return !sampleMissing(*value);
+}
+
+void I2CRegisterDriver::initCalibration()
+{
+  notify(F("Register map scaling is set in the slot configuration"));
+}
+
+void I2CRegisterDriver::calibrationStep(char *step, int arg_cnt, char **args)
+{
+  notify(F("Register map scaling is set in the slot configuration"));
+}
@@ -0,0 +1,112 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_I2C_REGISTER
+#define WATERBEAR_I2C_REGISTER
+
+#include "sensors/sensor.h"
+
+#define I2C_REGISTER_TYPE_STRING "i2c_register"
+
+#define I2C_REGISTER_MAX_BLOCK 16
+#define I2C_REGISTER_MAX_FIELDS 3
+#define I2C_REGISTER_NO_POINTER 0xFF // read the block without writing a register address first
+
+// field format: low 2 bits are the width in bytes - 1, high 4 bits a right shift of the raw value
+#define I2C_FIELD_WIDTH_MASK 0x03
+#define I2C_FIELD_LITTLE_ENDIAN 0x04
+#define I2C_FIELD_SIGNED 0x08
+#define I2C_FIELD_SHIFT_BITS 4
+
+// sample = ((raw * multiplier) >> postShift) + addend, at 10^exponent
+typedef struct // 8 bytes
+{
+  byte offset;           // first byte of the field in the block
+  byte format;
+  byte postShift;
+  signed char exponent;
+  short multiplier;
+  short addend;
+} i2c_register_field_type;
+
+// one trigger write, a wait and one burst read of a contiguous register block per measurement
+typedef struct // 32 bytes
+{
+  byte address;
+  byte trigger[2];         // command starting a conversion
+  byte waitMilliseconds;   // from the trigger to the read
+  byte blockRegister;      // or I2C_REGISTER_NO_POINTER
+  byte blockLength : 5;
+  byte knownDevice : 3;    // 1 based index into the built in maps, 0 for a custom map
+  byte fieldCount : 4;
+  byte triggerLength : 4;  // 0 for free running devices
+  byte reserved;
+  i2c_register_field_type fields[I2C_REGISTER_MAX_FIELDS];
+} i2c_register_map_type;
+
+/*
+ * Generic I2C sensor described by a register map, either one of the built in
+ * maps selected by "device" or a custom map given in the slot configuration.
+ */
+class I2CRegisterDriver : public I2CProtocolSensorDriver
+{
+public:
+  I2CRegisterDriver();
+  ~I2CRegisterDriver();
+
+private:
+  const char *sensorTypeString = I2C_REGISTER_TYPE_STRING;
+  i2c_register_map_type map;
+
+  char baseColumnHeaders[24];
+  sample_type values[I2C_REGISTER_MAX_FIELDS];
+
+  bool conversionStarted = false;
+  unsigned long conversionStartMillis = 0;
+
+  bool readBlock();
+  sample_type extractField(const i2c_register_field_type * field, const byte * block);
+  bool configureCustomMapFromJSON(cJSON *json);
+  bool validMap();
+
+  //
+  // Interface Implementation
+  //
+public:
+  const char *getSensorTypeString();
+  bool takeMeasurement();
+  unsigned int appendRawData(OutputSpan * span);
+  unsigned int appendSummaryData(OutputSpan * span);
+  const char *getBaseColumnHeaders();
+  bool getSummaryValue(short column, sample_type *value);
+
+  void initCalibration();
+  void calibrationStep(char *step, int arg_cnt, char **args);
+
+  unsigned int millisecondsUntilNextReadingAvailable();
+
+protected:
+  void configureSpecificConfigurationsFromBytes(configuration_bytes_partition configurations);
+  configuration_bytes_partition getDriverSpecificConfigurationBytes();
+  bool configureDriverFromJSON(cJSON *json);
+  void appendDriverSpecificConfigurationJSON(cJSON *json);
+  void setDriverDefaults();
+};
+
+#endif
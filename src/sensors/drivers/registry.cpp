@@ -8,14 +8,7 @@
 // Step 1: Include the header for your driver in sensor_map.h
 
 
-#define GENERIC_ANALOG_SENSOR 0x0000
-#define ATLAS_EC_OEM_SENSOR 0x0001
-#define ADAFRUIT_DHT22_SENSOR 0x0002
-#define ATLAS_CO2_SENSOR 0x0003
-// Step 2: Add a #define for the next available integer code
-
-#define DRIVER_TEMPLATE 0xFFFE
-#define NO_SENSOR 0xFFFF
+// Step 2: Add a #define for the next available integer code in registry.h
 
 
 
@@ -30,7 +23,11 @@ void buildDriverSensorMap()
  
   setupSensorMaps<AdaDHT22>(ADAFRUIT_DHT22_SENSOR, F(ADAFRUIT_DHT22_TYPE_STRING));
 
-  // setupSensorMaps<AtlasCO2Driver>(ATLAS_CO2_SENSOR, F(ATLAS_CO2_DRIVER_TYPE_STRING));
+  setupSensorMaps<AtlasCO2Driver>(ATLAS_CO2_SENSOR, F(ATLAS_CO2_DRIVER_TYPE_STRING));
+
+  setupSensorMaps<DerivedDriver>(DERIVED_SENSOR, F(DERIVED_TYPE_STRING));
+
+  setupSensorMaps<I2CRegisterDriver>(I2C_REGISTER_SENSOR, F(I2C_REGISTER_TYPE_STRING));
 
   // Step 3: call setupSensorMaps with the class name, code, and type string for your sensor
 
@@ -5,9 +5,22 @@
 #include "atlas_ec.h"
 #include "driver_template.h"
 #include "adafruit_dht22.h"
+#include "derived.h"
+#include "i2c_register.h"
+#include "atlas_co2_driver.h"
 
 #define MAX_SENSOR_TYPE 0xFFFE
 
+#define GENERIC_ANALOG_SENSOR 0x0000
+#define ATLAS_EC_OEM_SENSOR 0x0001
+#define ADAFRUIT_DHT22_SENSOR 0x0002
+#define ATLAS_CO2_SENSOR 0x0003
+#define DERIVED_SENSOR 0x0004
+#define I2C_REGISTER_SENSOR 0x0005
+
+#define DRIVER_TEMPLATE 0xFFFE
+#define NO_SENSOR 0xFFFF
+
 void buildDriverSensorMap();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_SENSOR_PROFILES
+#define WATERBEAR_SENSOR_PROFILES
+
+#include "sensors/drivers/registry.h"
+#include "sensors/static_profile.h"
+
+//
+// Fixed sensor profiles, selected with a build flag (see platformio.ini).
+// Without one the firmware constructs drivers at runtime from the EEPROM slot configurations.
+//
+// To add a profile: list ProfileSlot<driver class, slot, type code> entries
+// in ascending slot order, typedef them as FixedSensorProfile and define FIXED_SENSOR_PROFILE.
+//
+
+#if defined(SENSOR_PROFILE_ANALOG_DHT22)
+
+// two analog channels and air temperature / humidity
+typedef SensorProfile<
+  ProfileSlot<GenericAnalogDriver, 0, GENERIC_ANALOG_SENSOR>,
+  ProfileSlot<GenericAnalogDriver, 1, GENERIC_ANALOG_SENSOR>,
+  ProfileSlot<AdaDHT22, 2, ADAFRUIT_DHT22_SENSOR>
+> FixedSensorProfile;
+#define FIXED_SENSOR_PROFILE
+
+#elif defined(SENSOR_PROFILE_CONDUCTIVITY)
+
+// analog conductivity, water temperature and a derived specific conductance column
+typedef SensorProfile<
+  ProfileSlot<GenericAnalogDriver, 0, GENERIC_ANALOG_SENSOR>,
+  ProfileSlot<GenericAnalogDriver, 1, GENERIC_ANALOG_SENSOR>,
+  ProfileSlot<DerivedDriver, 2, DERIVED_SENSOR>
+> FixedSensorProfile;
+#define FIXED_SENSOR_PROFILE
+
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "sample.h"
+#include <limits.h>
+#include <math.h>
+
+sample_type makeSample(int32_t value, signed char exponent, sample_unit_type unit)
+{
+  sample_type sample;
+  sample.value = value;
+  sample.exponent = exponent;
+  sample.unit = unit;
+  return sample;
+}
+
+sample_type sampleFromFloat(float value, signed char exponent, sample_unit_type unit)
+{
+  if (isnan(value))
+  {
+    return makeSample(SAMPLE_MISSING, exponent, unit);
+  }
+  float scaled = exponent <= 0 ? value * powerOfTen(-exponent) : value / powerOfTen(exponent);
+  if (scaled >= SAMPLE_VALUE_MAX || scaled <= -SAMPLE_VALUE_MAX)
+  {
+    return makeSample(SAMPLE_MISSING, exponent, unit);
+  }
+  return makeSample(lroundf(scaled), exponent, unit);
+}
+
+bool sampleMissing(sample_type sample)
+{
+  return sample.value == SAMPLE_MISSING;
+}
+
+long long powerOfTen(short exponent)
+{
+  long long result = 1;
+  for (short i = 0; i < exponent; i++)
+  {
+    result *= 10;
+  }
+  return result;
+}
+
+long long roundedDivide(long long numerator, long long denominator)
+{
+  if ((numerator < 0) != (denominator < 0))
+  {
+    return (numerator - denominator / 2) / denominator;
+  }
+  return (numerator + denominator / 2) / denominator;
+}
+
+sample_type rescaleSample(sample_type sample, signed char exponent)
+{
+  if (sampleMissing(sample) || exponent == sample.exponent)
+  {
+    sample.exponent = exponent;
+    return sample;
+  }
+  long long value = sample.value;
+  if (exponent < sample.exponent)
+  {
+    value *= powerOfTen(sample.exponent - exponent);
+  }
+  else
+  {
+    value = roundedDivide(value, powerOfTen(exponent - sample.exponent));
+  }
+  sample.exponent = exponent;
+  sample.value = (value > SAMPLE_VALUE_MAX || value <= SAMPLE_MISSING) ? SAMPLE_MISSING : (int32_t) value;
+  return sample;
+}
+
+float sampleToFloat(sample_type sample)
+{
+  if (sampleMissing(sample))
+  {
+    return NAN;
+  }
+  if (sample.exponent < 0)
+  {
+    return (float) sample.value / powerOfTen(-sample.exponent);
+  }
+  return (float) sample.value * powerOfTen(sample.exponent);
+}
+
+char * formatSample(char * buffer, sample_type sample)
+{
+  if (sampleMissing(sample))
+  {
+    strcpy(buffer, "nan");
+    return buffer;
+  }
+  if (sample.exponent >= 0)
+  {
+    sprintf(buffer, "%ld", (long) sample.value);
+    for (short i = 0; i < sample.exponent; i++)
+    {
+      strcat(buffer, "0");
+    }
+    return buffer;
+  }
+
+  uint32_t divisor = powerOfTen(-sample.exponent);
+  uint32_t magnitude = sample.value < 0 ? - (uint32_t) sample.value : sample.value;
+  char format[12];
+  sprintf(format, "%%s%%lu.%%0%dlu", -sample.exponent);
+  sprintf(buffer, format, sample.value < 0 ? "-" : "", (unsigned long) (magnitude / divisor), (unsigned long) (magnitude % divisor));
+  return buffer;
+}
+
+void setupLinearTransform(linear_transform_type * transform, float slope, float intercept, signed char inputExponent, signed char outputExponent)
+{
+  // configuration time only, so float here is fine
+  float scaledSlope = slope;
+  float scaledIntercept = intercept;
+  for (short i = inputExponent - outputExponent; i > 0; i--)
+  {
+    scaledSlope *= 10;
+  }
+  for (short i = inputExponent - outputExponent; i < 0; i++)
+  {
+    scaledSlope /= 10;
+  }
+  for (short i = -outputExponent; i > 0; i--)
+  {
+    scaledIntercept *= 10;
+  }
+  for (short i = -outputExponent; i < 0; i++)
+  {
+    scaledIntercept /= 10;
+  }
+
+  // as many fraction bits as keep slope * x (x up to 2^31) and the intercept within 63 bits
+  byte shift = 0;
+  while (shift < 31 && fabsf(scaledSlope) * (1UL << shift) < 1073741824.0f && fabsf(scaledIntercept) * (1UL << shift) < 1073741824.0f * 1024)
+  {
+    shift++;
+  }
+  transform->shift = shift;
+  transform->slope = llroundf(scaledSlope * (1UL << shift));
+  transform->intercept = llroundf(scaledIntercept * (1UL << shift));
+  transform->inputExponent = inputExponent;
+  transform->outputExponent = outputExponent;
+}
+
+sample_type applyLinearTransform(const linear_transform_type * transform, sample_type sample, sample_unit_type unit)
+{
+  sample = rescaleSample(sample, transform->inputExponent);
+  if (sampleMissing(sample))
+  {
+    return makeSample(SAMPLE_MISSING, transform->outputExponent, unit);
+  }
+  long long y = transform->slope * sample.value + transform->intercept;
+  if (transform->shift > 0)
+  {
+    y = (y + (1LL << (transform->shift - 1))) >> transform->shift; // round half up
+  }
+  if (y > SAMPLE_VALUE_MAX || y <= SAMPLE_MISSING)
+  {
+    return makeSample(SAMPLE_MISSING, transform->outputExponent, unit);
+  }
+  return makeSample((int32_t) y, transform->outputExponent, unit);
+}
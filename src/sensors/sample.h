@@ -0,0 +1,80 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_SAMPLE
+#define WATERBEAR_SAMPLE
+
+#include <Arduino.h>
+
+//
+// Fixed point samples
+//
+// Values move from acquisition through burst summaries to the log as
+// value * 10^exponent, so the per sample path needs no soft float calls.
+// Drivers whose libraries return floats convert once, at their edge.
+//
+
+typedef enum sample_unit
+{
+  unit_none,
+  unit_counts,       // ADC counts
+  unit_celsius,
+  unit_percent_rh,
+  unit_millisiemens, // per cm
+  unit_ppm,
+  unit_calibrated    // unit given by the slot's calibration
+} sample_unit_type;
+
+typedef struct
+{
+  int32_t value; // long on the target, fixed width so host builds keep its range
+  signed char exponent;
+  byte unit;
+} sample_type;
+
+#define SAMPLE_VALUE_MAX INT32_MAX
+#define SAMPLE_MISSING INT32_MIN // formatted as nan
+
+sample_type makeSample(int32_t value, signed char exponent, sample_unit_type unit);
+sample_type sampleFromFloat(float value, signed char exponent, sample_unit_type unit);
+sample_type rescaleSample(sample_type sample, signed char exponent); // rounds half away from zero
+float sampleToFloat(sample_type sample);
+bool sampleMissing(sample_type sample);
+
+long long powerOfTen(short exponent); // 0 <= exponent <= 18
+long long roundedDivide(long long numerator, long long denominator);
+
+// writes e.g. value 12345 exponent -3 as 12.345
+char * formatSample(char * buffer, sample_type sample);
+
+// y = slope * x + intercept with a binary scaled integer slope,
+// set up from float calibration coefficients when they change
+typedef struct
+{
+  long long slope;
+  long long intercept;
+  byte shift;
+  signed char inputExponent;
+  signed char outputExponent;
+} linear_transform_type;
+
+void setupLinearTransform(linear_transform_type * transform, float slope, float intercept, signed char inputExponent, signed char outputExponent);
+sample_type applyLinearTransform(const linear_transform_type * transform, sample_type sample, sample_unit_type unit);
+
+#endif
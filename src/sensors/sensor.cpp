@@ -20,6 +20,7 @@
 #include "system/logs.h"
 #include "sensors/sensor_map.h"
 #include "system/eeprom.h"
+#include <stdarg.h>
 
 SensorDriver::SensorDriver(){}
 SensorDriver::~SensorDriver(){}
@@ -31,6 +32,12 @@ cJSON *SensorDriver::getConfigurationJSON() // returns unprotected pointer
   cJSON_AddStringToObject(json, "type", getSensorTypeString());
   cJSON_AddStringToObject(json, "tag", commonConfigurations.tag);
   cJSON_AddNumberToObject(json, "burst_size", commonConfigurations.burst_size);
+  cJSON_AddBoolToObject(json, "essential", !commonConfigurations.non_essential);
+  cJSON_AddNumberToObject(json, "deadband", commonConfigurations.deadband);
+  if(commonConfigurations.column_mask != 0 && commonConfigurations.column_mask != 0xFFFF)
+  {
+    cJSON_AddNumberToObject(json, "column_mask", commonConfigurations.column_mask);
+  }
   this->appendDriverSpecificConfigurationJSON(json);
   return json;
 }
@@ -38,7 +45,10 @@ cJSON *SensorDriver::getConfigurationJSON() // returns unprotected pointer
 const configuration_bytes SensorDriver::getConfigurationBytes()
 {
   configuration_bytes configurationBytes;
-  memcpy(&configurationBytes.common, &commonConfigurations, sizeof(configuration_bytes_partition));
+  commonConfigurations.layout = COMMON_CONFIG_LAYOUT;
+  commonConfigurations.layout_check = (byte) ~COMMON_CONFIG_LAYOUT;
+  memset(&configurationBytes.common, EEPROM_RESET_VALUE, sizeof(configuration_bytes_partition));
+  memcpy(&configurationBytes.common, &commonConfigurations, sizeof(commonConfigurations));
   configuration_bytes_partition driverSpecificPartition = getDriverSpecificConfigurationBytes();
   memcpy(&configurationBytes.specific, &driverSpecificPartition, sizeof(configuration_bytes_partition));
   return configurationBytes;
@@ -75,8 +85,11 @@ void SensorDriver::appendDriverSpecificConfigurationJSON(cJSON * json)
 void SensorDriver::initializeBurst()
 {
   burstCount = 0;
-  // burstSummarySumCounts.clear();
-  // burstSummarySums.clear();
+  for(short i = 0; i < MAX_BURST_SUMMARY_COLUMNS; i++)
+  {
+    burstSummaries[i].sum = 0;
+    burstSummaries[i].count = 0;
+  }
 }
 
 void SensorDriver::incrementBurst()
@@ -91,41 +104,126 @@ bool SensorDriver::burstCompleted()
   return burstCount >= commonConfigurations.burst_size;
 }
 
-void SensorDriver::addValueToBurstSummaryMean(std::string tag, double value)
+void SensorDriver::addSampleToBurstSummary(short column, sample_type sample)
+{
+  if(column < 0 || column >= MAX_BURST_SUMMARY_COLUMNS || sampleMissing(sample))
+  {
+    return;
+  }
+  burst_summary_column * summary = &burstSummaries[column];
+  if(!summary->used)
+  {
+    summary->used = true;
+    summary->exponent = sample.exponent;
+    summary->unit = sample.unit;
+  }
+  else if(sample.exponent != summary->exponent)
+  {
+    sample = rescaleSample(sample, summary->exponent);
+    if(sampleMissing(sample))
+    {
+      return; // out of range at the column's exponent
+    }
+  }
+  summary->sum += sample.value;
+  summary->count++;
+}
+
+sample_type SensorDriver::getBurstSummaryMean(short column, signed char exponent)
+{
+  if(column < 0 || column >= MAX_BURST_SUMMARY_COLUMNS || burstSummaries[column].count == 0)
+  {
+    return makeSample(SAMPLE_MISSING, exponent, unit_none);
+  }
+  burst_summary_column * summary = &burstSummaries[column];
+  long long mean;
+  if(exponent <= summary->exponent)
+  {
+    mean = roundedDivide(summary->sum * powerOfTen(summary->exponent - exponent), summary->count);
+  }
+  else
+  {
+    mean = roundedDivide(summary->sum, summary->count * powerOfTen(exponent - summary->exponent));
+  }
+  if(mean > SAMPLE_VALUE_MAX || mean <= SAMPLE_MISSING)
+  {
+    mean = SAMPLE_MISSING;
+  }
+  return makeSample((int32_t) mean, exponent, (sample_unit_type) summary->unit);
+}
+
+bool SensorDriver::summaryMovedBeyondDeadband()
 {
-  if(burstSummarySums.count(tag) == 0)
+  if(commonConfigurations.deadband <= 0)
   {
-    burstSummarySums[tag] = 0;
-    burstSummarySumCounts[tag] = 0;
+    return true;
+  }
+
+  bool anyWritten = false;
+  for(short i = 0; i < MAX_BURST_SUMMARY_COLUMNS; i++)
+  {
+    burst_summary_column * summary = &burstSummaries[i];
+    if(!summary->used || summary->count == 0)
+    {
+      continue;
+    }
+    if(!summary->written)
+    {
+      return true;
+    }
+    anyWritten = true;
+    signed char exponent = summary->exponent - DEADBAND_EXTRA_DIGITS;
+    long mean = getBurstSummaryMean(i, exponent).value;
+    long deadband = sampleFromFloat(commonConfigurations.deadband, exponent, unit_none).value; // once per summary, not per sample
+    if(mean == SAMPLE_MISSING || summary->lastWritten == SAMPLE_MISSING)
+    {
+      return true;
+    }
+    if(deadband != SAMPLE_MISSING && labs(mean - summary->lastWritten) > deadband)
+    {
+      return true;
+    }
   }
-  burstSummarySums[tag] += value;
-  burstSummarySumCounts[tag] += 1;
+  return !anyWritten;
 }
 
-double SensorDriver::getBurstSummaryMean(std::string tag)
+void SensorDriver::markSummaryWritten()
 {
-  return burstSummarySums[tag] / burstSummarySumCounts[tag];
+  for(short i = 0; i < MAX_BURST_SUMMARY_COLUMNS; i++)
+  {
+    burst_summary_column * summary = &burstSummaries[i];
+    if(summary->used && summary->count > 0)
+    {
+      summary->lastWritten = getBurstSummaryMean(i, summary->exponent - DEADBAND_EXTRA_DIGITS).value;
+      summary->written = true;
+    }
+  }
 }
 
 void SensorDriver::configureCSVColumns()
 {
   // notify("config csv columns");
-  char csvColumnHeaders[100] = "\0";
-  char buffer[100];
+  char csvColumnHeaders[CSV_COLUMN_HEADERS_SIZE] = "\0";
+  char buffer[CSV_COLUMN_HEADERS_SIZE];
   strcpy(buffer, this->getBaseColumnHeaders());
   // debug(buffer);
   char * token = strtok(buffer, ",");
+  short column = 0;
   while(token != NULL)
   {
     // debug(token);
-    strcat(csvColumnHeaders, this->commonConfigurations.tag);
-    strcat(csvColumnHeaders, "_");
-    strcat(csvColumnHeaders, token);
-    token = strtok(NULL, ",");
-    if(token != NULL)
+    if(columnEnabled(column))
     {
-      strcat(csvColumnHeaders, ",");
+      if(csvColumnHeaders[0] != '\0')
+      {
+        strcat(csvColumnHeaders, ",");
+      }
+      strcat(csvColumnHeaders, this->commonConfigurations.tag);
+      strcat(csvColumnHeaders, "_");
+      strcat(csvColumnHeaders, token);
     }
+    token = strtok(NULL, ",");
+    column++;
   }
   strcpy(this->csvColumnHeaders, csvColumnHeaders);
   // notify("done");
@@ -136,6 +234,39 @@ char *SensorDriver::getCSVColumnHeaders()
   return csvColumnHeaders;
 }
 
+bool SensorDriver::columnEnabled(short column)
+{
+  unsigned short mask = commonConfigurations.column_mask;
+  if(mask == 0 || mask == 0xFFFF)
+  {
+    return true;
+  }
+  return column < 16 && (mask & (1 << column));
+}
+
+void SensorDriver::appendColumn(OutputSpan * span, short column, const char * format, ...)
+{
+  if(!columnEnabled(column))
+  {
+    return;
+  }
+
+  if(span->length() > 0)
+  {
+    span->appendString(",");
+  }
+  va_list args;
+  va_start(args, format);
+  span->appendv(format, args);
+  va_end(args);
+}
+
+void SensorDriver::appendColumn(OutputSpan * span, short column, sample_type sample)
+{
+  char formatted[16];
+  appendColumn(span, column, "%s", formatSample(formatted, sample));
+}
+
 void SensorDriver::setDefaults()
 {
   if(commonConfigurations.burst_size <= 0 || commonConfigurations.burst_size > 100)
@@ -160,7 +291,7 @@ bool SensorDriver::configureFromJSON(cJSON * json)
   }
 #endif
 
-  memset(&commonConfigurations, 0, SENSOR_CONFIGURATION_SIZE);
+  memset(&commonConfigurations, 0, sizeof(commonConfigurations));
 
   commonConfigurations.sensor_type = typeCodeForSensorTypeString(getSensorTypeString());
 
@@ -197,6 +328,24 @@ bool SensorDriver::configureFromJSON(cJSON * json)
     return false;
   }
 
+  const cJSON * deadbandJSON = cJSON_GetObjectItemCaseSensitive(json, "deadband");
+  if(deadbandJSON != NULL && cJSON_IsNumber(deadbandJSON) && deadbandJSON->valuedouble >= 0)
+  {
+    commonConfigurations.deadband = deadbandJSON->valuedouble;
+  }
+
+  const cJSON * columnMaskJSON = cJSON_GetObjectItemCaseSensitive(json, "column_mask");
+  if(columnMaskJSON != NULL && cJSON_IsNumber(columnMaskJSON) && columnMaskJSON->valueint >= 0 && columnMaskJSON->valueint <= 0xFFFF)
+  {
+    commonConfigurations.column_mask = columnMaskJSON->valueint;
+  }
+
+  const cJSON * essentialJSON = cJSON_GetObjectItemCaseSensitive(json, "essential");
+  if(essentialJSON != NULL && cJSON_IsBool(essentialJSON))
+  {
+    commonConfigurations.non_essential = cJSON_IsFalse(essentialJSON);
+  }
+
   this->setDefaults();
   if (this->configureDriverFromJSON(json) == false)
   {
@@ -211,11 +360,47 @@ void SensorDriver::configureFromBytes(configuration_bytes configurationBytes)
 {
   configuration_bytes_partition partitions[2];
   memcpy(&partitions, &configurationBytes, sizeof(configuration_bytes));
-  memcpy(&commonConfigurations, &partitions[0], sizeof(configuration_bytes_partition));
+  memcpy(&commonConfigurations, &partitions[0], sizeof(commonConfigurations));
+  if(commonConfigurations.non_essential > 1)
+  {
+    commonConfigurations.non_essential = 0; // stored before this field existed
+  }
+  if(commonConfigurations.layout != COMMON_CONFIG_LAYOUT || commonConfigurations.layout_check != (byte) ~COMMON_CONFIG_LAYOUT)
+  {
+    // stored before deadband and column_mask existed, log every row and column as that firmware did
+    commonConfigurations.deadband = 0;
+    commonConfigurations.column_mask = 0;
+  }
+  if(!(commonConfigurations.deadband >= 0 && commonConfigurations.deadband < 1e9))
+  {
+    commonConfigurations.deadband = 0; // also catches NaN
+  }
   this->configureSpecificConfigurationsFromBytes(partitions[1]);
   this->configureCSVColumns();
 }
 
+bool SensorDriver::getSummaryValue(short column, sample_type * value)
+{
+  // by default no values are shared
+  return false;
+}
+
+static char compatibilityDataString[MAX_DATA_STRING_LENGTH];
+
+const char *SensorDriver::getRawDataString()
+{
+  OutputSpan span(compatibilityDataString, sizeof(compatibilityDataString));
+  appendRawData(&span);
+  return compatibilityDataString;
+}
+
+const char *SensorDriver::getSummaryDataString()
+{
+  OutputSpan span(compatibilityDataString, sizeof(compatibilityDataString));
+  appendSummaryData(&span);
+  return compatibilityDataString;
+}
+
 void SensorDriver::setup()
 {
   // by default no setup
@@ -252,6 +437,11 @@ short SensorDriver::getSlot()
   return commonConfigurations.slot;
 }
 
+bool SensorDriver::isEssential()
+{
+  return !commonConfigurations.non_essential;
+}
+
 void SensorDriver::setConfigurationNeedsSave()
 {
   configurationNeedsSave = true;
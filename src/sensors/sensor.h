@@ -22,8 +22,8 @@
 #include <Arduino.h>
 #include <Wire_slave.h>
 #include <cJSON.h>
-#include <map>
-#include <string>
+#include "sensors/sample.h"
+#include "utilities/output_span.h"
 
 #define CALIBRATION_TIME_STRING reinterpret_cast<const char*>(F("calibration_time"))
 
@@ -32,7 +32,8 @@ typedef enum protocol
   analog,
   i2c,
   gpio,
-  drivertemplate
+  drivertemplate,
+  computed
 } protocol_type;
 
 #define SENSOR_CONFIGURATION_SIZE 64
@@ -52,7 +53,7 @@ typedef struct
 // common_sensor_driver_config
 // configurations shared between all drivers
 // needs to be 32 bytes total (one configuration_partition_bytes)
-// 20 bytes currently usused
+// 8 bytes currently usused
 typedef struct
 {
   // arrange from biggest type to smallest type
@@ -61,12 +62,25 @@ typedef struct
   unsigned short int warmup;      // 2 bytes - in seconds (65535 max value/60=1092 min)
   byte slot;                      // 1 byte
   byte burst_size;                // 1 byte
+  byte non_essential;             // 1 byte - skipped by the energy governor when the battery is low
+  byte layout;                    // 1 byte - COMMON_CONFIG_LAYOUT when the fields below were stored by firmware that has them
+  byte layout_check;              // 1 byte - ~layout
+  float deadband;                 // 4 bytes (+1 padding) - summary change that forces a row, 0 writes every row
+  unsigned short column_mask;     // 2 bytes (+2 padding) - bit per base column written to the log, 0 or 0xFFFF all columns
 
 } common_sensor_driver_config;
 
+// older firmware stored whatever followed the struct in memory where deadband and column_mask are now
+#define COMMON_CONFIG_LAYOUT 1
+
 
 #define MAX_REQUESTED_READING_DELAY 3600000;
 
+#define MAX_BURST_SUMMARY_COLUMNS 4
+#define DEADBAND_EXTRA_DIGITS 3 // deadband compares means this many digits finer than the samples
+#define MAX_DATA_STRING_LENGTH 64 // longest row fragment a driver writes
+#define CSV_COLUMN_HEADERS_SIZE 100 // a driver's enabled column headers, tag prefixed
+
 class SensorDriver
 {
 
@@ -84,14 +98,20 @@ public:
   void incrementBurst();
   bool burstCompleted();
 
-  // utility function for providing mean for burst summary value
-  void addValueToBurstSummaryMean(std::string tag, double value);
-  double getBurstSummaryMean(std::string tag);
+  // utility functions for providing the mean of a base column over the burst
+  void addSampleToBurstSummary(short column, sample_type sample);
+  sample_type getBurstSummaryMean(short column, signed char exponent); // rounded to 10^exponent
+
+  // deadband logging
+  virtual bool summaryMovedBeyondDeadband();
+  virtual void markSummaryWritten();
 
   char *getCSVColumnHeaders();
+  bool columnEnabled(short column);
   cJSON *getConfigurationJSON(); // returns unprotected pointer
 
   short getSlot();
+  bool isEssential();
   void setConfigurationNeedsSave();
   void clearConfigurationNeedsSave();
   bool getNeedsSave();
@@ -100,15 +120,27 @@ public:
 protected:
   common_sensor_driver_config commonConfigurations;
   void configureCSVColumns();
+  // skip disabled columns without formatting, separate columns with commas
+  void appendColumn(OutputSpan * span, short column, const char * format, ...);
+  void appendColumn(OutputSpan * span, short column, sample_type sample);
 
 private:
-  char csvColumnHeaders[200] = "column_header";
+  char csvColumnHeaders[CSV_COLUMN_HEADERS_SIZE] = "column_header";
   short burstCount = 0;
   bool configurationNeedsSave = false;
 
-  // Variables for computing burst summary values
-  std::map<std::string, double> burstSummarySums;
-  std::map<std::string, int> burstSummarySumCounts;
+  // Variables for computing burst summary values, fixed point per base column
+  typedef struct
+  {
+    long long sum;        // at the exponent of the column's first sample
+    long lastWritten;     // mean at exponent - DEADBAND_EXTRA_DIGITS
+    unsigned short count;
+    signed char exponent;
+    byte unit;
+    bool used;
+    bool written;
+  } burst_summary_column;
+  burst_summary_column burstSummaries[MAX_BURST_SUMMARY_COLUMNS] = {};
 
   //
   // Subclass Implementation Interface
@@ -157,16 +189,26 @@ public:
 
 
   /*
-   * Returns a comma separated string that contains one or more
-   * measurement values from the last reading the driver successfully
-   * preformed.
+   * Formats the comma separated measurement values from the last reading
+   * the driver successfully preformed directly into the span, which is
+   * usually a region of the log write cache.
    * 
-   * @return comma separate string of measurement values
+   * @return bytes written
    */
-  virtual const char *getRawDataString() = 0;
+  virtual unsigned int appendRawData(OutputSpan * span) = 0;
 
+  // same for the burst summary values
+  virtual unsigned int appendSummaryData(OutputSpan * span) = 0;
 
-  virtual const char *getSummaryDataString() = 0;
+  /*
+   * Compatibility shims for callers that want a string. They format through
+   * the append API into a buffer shared by all drivers, which is overwritten
+   * by the next call.
+   * 
+   * @return comma separate string of measurement values
+   */
+  const char *getRawDataString();
+  const char *getSummaryDataString();
 
   /*
    * Returns a comma separated string that contains header values
@@ -177,6 +219,14 @@ public:
    */
   virtual const char *getBaseColumnHeaders() = 0;
 
+  /*
+   * Numeric burst summary value of one base column, used by derived columns.
+   * This method is optional.
+   *
+   * @return false if the driver does not provide the column
+   */
+  virtual bool getSummaryValue(short column, sample_type * value);
+
 
   virtual bool isWarmedUp();
 
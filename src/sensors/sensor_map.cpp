@@ -27,16 +27,20 @@ bool sensorTypeCodeExists(short type)
   return sensorTypeMap.count(type) > 0;
 }
 
+// lookups don't insert, unknown types from the CLI or a blank slot would otherwise stay in the maps
+
 short typeCodeForSensorTypeString(const char * type)
 {
-  return sensorTypeCodeMap[std::string(type)];
+  std::map<std::string, short>::iterator entry = sensorTypeCodeMap.find(std::string(type));
+  return entry == sensorTypeCodeMap.end() ? -1 : entry->second; // NO_SENSOR
 }
 
 SensorDriver * driverForSensorTypeCode(short type)
 {
-  if(sensorTypeMap[type] == NULL)
+  sensor_type_map_type::iterator entry = sensorTypeMap.find(type);
+  if(entry == sensorTypeMap.end() || entry->second == NULL)
   {
     return NULL;
   }
-  return sensorTypeMap[type]();
+  return entry->second();
 }
@@ -21,6 +21,7 @@
 
 #include "sensor.h"
 #include <map>
+#include <string>
 
 template<typename T> SensorDriver * createInstance() { return new T; }
 
@@ -0,0 +1,82 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "slot_drivers.h"
+
+void putSlotDriver(SensorDriver *** drivers, unsigned short * count, SensorDriver * driver)
+{
+  unsigned short slot = driver->getCommonConfigurations()->slot;
+  for (unsigned short i = 0; i < *count; i++)
+  {
+    if ((*drivers)[i]->getCommonConfigurations()->slot == slot)
+    {
+      SensorDriver * replacedDriver = (*drivers)[i];
+      (*drivers)[i] = driver;
+      delete (replacedDriver);
+      return;
+    }
+  }
+
+  SensorDriver ** updatedDrivers = (SensorDriver **)malloc(sizeof(SensorDriver *) * (*count + 1));
+  unsigned short i = 0;
+  for (; i < *count && (*drivers)[i]->getCommonConfigurations()->slot < slot; i++)
+  {
+    updatedDrivers[i] = (*drivers)[i];
+  }
+  updatedDrivers[i] = driver;
+  for (; i < *count; i++)
+  {
+    updatedDrivers[i + 1] = (*drivers)[i];
+  }
+  free(*drivers);
+  *drivers = updatedDrivers;
+  *count = *count + 1;
+}
+
+bool removeSlotDriver(SensorDriver *** drivers, unsigned short * count, unsigned short slot)
+{
+  short index = -1;
+  for (unsigned short i = 0; i < *count; i++)
+  {
+    if ((*drivers)[i]->getCommonConfigurations()->slot == slot)
+    {
+      index = i;
+      break;
+    }
+  }
+  if (index < 0)
+  {
+    return false;
+  }
+
+  delete ((*drivers)[index]);
+  SensorDriver ** updatedDrivers = (SensorDriver **)malloc(sizeof(SensorDriver *) * (*count - 1));
+  unsigned short j = 0;
+  for (unsigned short i = 0; i < *count; i++)
+  {
+    if (i != index)
+    {
+      updatedDrivers[j++] = (*drivers)[i];
+    }
+  }
+  free(*drivers);
+  *drivers = updatedDrivers;
+  *count = *count - 1;
+  return true;
+}
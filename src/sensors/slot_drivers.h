@@ -0,0 +1,34 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+#ifndef WATERBEAR_SLOT_DRIVERS
+#define WATERBEAR_SLOT_DRIVERS
+
+#include "sensor.h"
+
+// The configured drivers, a heap array in slot order with at most one driver per slot.
+
+// driver replaces the driver in its slot, which is deleted, or is inserted in slot order
+void putSlotDriver(SensorDriver *** drivers, unsigned short * count, SensorDriver * driver);
+
+// deletes the driver in slot, false if the slot isn't configured
+bool removeSlotDriver(SensorDriver *** drivers, unsigned short * count, unsigned short slot);
+
+#endif
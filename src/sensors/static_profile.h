@@ -0,0 +1,192 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_STATIC_PROFILE
+#define WATERBEAR_STATIC_PROFILE
+
+#include "sensors/sensor.h"
+#include "sensors/sensor_map.h"
+#include "system/eeprom.h"
+#include "system/write_cache.h"
+
+//
+// Compile time sensor profiles
+//
+// A profile fixes the driver type of each slot at build time. The drivers are
+// members of the profile instead of heap objects, and the burst loop, summary
+// and row emission below call them by their concrete type, so the compiler
+// can inline the hot path instead of going through the vtable for each slot.
+// Configuration (tag, burst size, calibration...) still comes from EEPROM.
+//
+
+// one driver at a fixed slot, profile entries must be in ascending slot order
+template <class Driver, byte Slot, unsigned short TypeCode>
+struct ProfileSlot
+{
+  typedef Driver driver_type;
+  static const byte slot = Slot;
+  static const unsigned short typeCode = TypeCode;
+};
+
+// empty values keep the columns aligned with the header
+inline void writeProfileDisabledColumns(WriteCache * cache, SensorDriver * driver)
+{
+  for (const char * c = driver->getCSVColumnHeaders(); *c != '\0'; c++)
+  {
+    if (*c == ',')
+    {
+      cache->writeString(",");
+    }
+  }
+}
+
+template <unsigned short Index, class... Slots>
+class ProfileEntries;
+
+template <unsigned short Index>
+class ProfileEntries<Index>
+{
+public:
+  void registerDriverTypes() {}
+  void collectDrivers(SensorDriver ** drivers) {}
+  void measure(unsigned long enabledSlots, bool performingBurst) {}
+  bool measureBurst(unsigned long enabledSlots, WriteCache * rawCache) { return false; }
+  bool burstCompleted(unsigned long enabledSlots) { return true; }
+  void writeRow(WriteCache * cache, unsigned long enabledSlots, bool summary) {}
+};
+
+template <unsigned short Index, class Head, class... Tail>
+class ProfileEntries<Index, Head, Tail...> : public ProfileEntries<Index + 1, Tail...>
+{
+  typedef ProfileEntries<Index + 1, Tail...> Rest;
+  typedef typename Head::driver_type Driver;
+
+  Driver driver;
+
+  bool enabled(unsigned long enabledSlots)
+  {
+    return enabledSlots & (1UL << Index);
+  }
+
+  // qualified calls bind to the concrete driver at compile time
+  bool takeReading(bool performingBurst)
+  {
+    if (driver.Driver::takeMeasurement() && performingBurst)
+    {
+      driver.incrementBurst();
+    }
+    return !driver.burstCompleted();
+  }
+
+  void writeColumns(WriteCache * cache, unsigned long enabledSlots, bool summary)
+  {
+    if (Index > 0)
+    {
+      cache->writeString(",");
+    }
+    if (!enabled(enabledSlots))
+    {
+      writeProfileDisabledColumns(cache, &driver);
+    }
+    else
+    {
+      OutputSpan span = cache->reserve(MAX_DATA_STRING_LENGTH);
+      if (summary)
+      {
+        driver.Driver::appendSummaryData(&span);
+      }
+      else
+      {
+        driver.Driver::appendRawData(&span);
+      }
+      cache->commit(span);
+    }
+  }
+
+public:
+  void registerDriverTypes()
+  {
+    setupSensorMaps<Driver>(Head::typeCode, (const __FlashStringHelper *) driver.Driver::getSensorTypeString());
+    Rest::registerDriverTypes();
+  }
+
+  void collectDrivers(SensorDriver ** drivers)
+  {
+    drivers[Index] = &driver;
+    Rest::collectDrivers(drivers);
+  }
+
+  void measure(unsigned long enabledSlots, bool performingBurst)
+  {
+    if (enabled(enabledSlots))
+    {
+      takeReading(performingBurst);
+    }
+    Rest::measure(enabledSlots, performingBurst);
+  }
+
+  // fused burst step: measure, append the raw columns and check the burst in one pass
+  bool measureBurst(unsigned long enabledSlots, WriteCache * rawCache)
+  {
+    bool continueBursting = false;
+    if (enabled(enabledSlots))
+    {
+      continueBursting = takeReading(true);
+    }
+    if (rawCache != NULL)
+    {
+      writeColumns(rawCache, enabledSlots, false);
+    }
+    return Rest::measureBurst(enabledSlots, rawCache) || continueBursting;
+  }
+
+  bool burstCompleted(unsigned long enabledSlots)
+  {
+    return (!enabled(enabledSlots) || driver.burstCompleted()) && Rest::burstCompleted(enabledSlots);
+  }
+
+  void writeRow(WriteCache * cache, unsigned long enabledSlots, bool summary)
+  {
+    writeColumns(cache, enabledSlots, summary);
+    Rest::writeRow(cache, enabledSlots, summary);
+  }
+};
+
+template <class... Slots>
+class SensorProfile : public ProfileEntries<0, Slots...>
+{
+public:
+  static const unsigned short count = sizeof...(Slots);
+  static_assert(sizeof...(Slots) <= EEPROM_TOTAL_SENSOR_SLOTS, "sensor profile has more entries than EEPROM slots");
+
+  // slot of each entry, in profile order
+  const byte * slots()
+  {
+    static const byte slotList[] = {Slots::slot...};
+    return slotList;
+  }
+
+  const unsigned short * typeCodes()
+  {
+    static const unsigned short typeCodeList[] = {Slots::typeCode...};
+    return typeCodeList;
+  }
+};
+
+#endif
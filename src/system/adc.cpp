@@ -22,32 +22,28 @@
 #include "system/watchdog.h"
 #include "utilities/i2c.h"
 
-AD7091R::AD7091R()
+AD7091R::AD7091R() : registers(&Wire, ADC_I2C_ADDRESS)
 {
   channel0Enabled = 0;
   channel1Enabled = 0;
   channel2Enabled = 0;
   channel3Enabled = 0;
+  registers.addRegister(ADC_CHANNEL_REGISTER_ADDRESS, 1);
+  registers.addRegister(ADC_CONFIGURATION_REGISTER_ADDRESS, 2);
 }
 
 void AD7091R::configure()
 {
-  configuration_register configurationGet = this->readConfigurationRegister();
-  this->printConfigurationRegister(configurationGet);
+  // called right after the reset pulse, the registers hold their defaults
+  this->invalidateRegisters();
 
-  configuration_register configuration; //= this->readConfigurationRegister();
-  // this->printConfigurationRegister(configuration);
+  configuration_register configuration = {};
   configuration.CYCLE_TIMER = 3; // default value
   configuration.CMD = 1;
   configuration.AUTO = 0;
-  // this->printConfigurationRegister(configuration);
   this->writeConfigurationRegister(configuration);
-
-  configuration_register configurationSet = this->readConfigurationRegister();
-  this->printConfigurationRegister(configurationSet);
-
   
-  struct channel_register channelRegister;
+  struct channel_register channelRegister = {};
   channelRegister.CH0 = 0;
   channelRegister.CH1 = 0;
   channelRegister.CH2 = 0;
@@ -55,6 +51,11 @@ void AD7091R::configure()
   this->writeChannelRegister(channelRegister);
 }
 
+void AD7091R::invalidateRegisters()
+{
+  registers.invalidate();
+}
+
 void AD7091R::enableChannel(short channel)
 {
   switch (channel)
@@ -75,15 +76,12 @@ void AD7091R::enableChannel(short channel)
 
   this->updateChannelRegister();
 
-  configuration_register configuration;
+  // skipped by the shadow unless something changed the configuration since configure()
+  configuration_register configuration = {};
   configuration.CYCLE_TIMER = 3; // default value
   configuration.CMD = 1;
   configuration.AUTO = 0;
-  // this->printConfigurationRegister(configuration);
   this->writeConfigurationRegister(configuration);
-  
-  configuration_register configurationSet = this->readConfigurationRegister();
-  this->printConfigurationRegister(configurationSet);
 }
 
 void AD7091R::disableChannel(short channel)
@@ -107,20 +105,16 @@ void AD7091R::disableChannel(short channel)
   this->updateChannelRegister();
 }
 
-void AD7091R::updateChannelRegister()
+void AD7091R::updateChannelRegister(bool restartCycle)
 {
-  debug("update channel register");
-  struct channel_register channelRegister = this->readChannelRegister();
-  channelRegister.CH0 = channel0Enabled;
-  channelRegister.CH1 = channel1Enabled;
-  channelRegister.CH2 = channel2Enabled;
-  channelRegister.CH3 = channel3Enabled;
-  this->writeChannelRegister(channelRegister);
+  // the reserved bits come from the shadow, no read before the write once it is valid
+  byte channels = channel0Enabled | (channel1Enabled << 1) | (channel2Enabled << 2) | (channel3Enabled << 3);
+  registers.update(ADC_CHANNEL_REGISTER_ADDRESS, 0x0F, channels, restartCycle);
 }
 
 void AD7091R::convertEnabledChannels()
 {
-  this->updateChannelRegister(); // writing to the channel register restarts the channel cycle.
+  this->updateChannelRegister(true); // writing to the channel register restarts the channel cycle.
 
   this->_channel0Value = -1;
   this->_channel1Value = -1;
@@ -149,39 +143,37 @@ void AD7091R::convertEnabledChannels()
   }
 }
 
+// the register structs hold the 16 bit register value in their first two bytes
 configuration_register AD7091R::readConfigurationRegister()
 {
-  // debug(F("reading configuration register"));
-  struct configuration_register configurationRegister; // 2 bytes
-  this->sendTransmission(ADC_CONFIGURATION_REGISTER_ADDRESS);
-  this->requestBytes((byte *)&configurationRegister, 2);
+  struct configuration_register configurationRegister = {};
+  unsigned short value = 0;
+  registers.read(ADC_CONFIGURATION_REGISTER_ADDRESS, &value);
+  memcpy(&configurationRegister, &value, 2);
   return configurationRegister;
 }
 
 void AD7091R::writeConfigurationRegister(configuration_register configurationRegister)
 {
-  // debug(F("writing configuration register"));
-  printConfigurationRegister(configurationRegister);
-  Serial2.println(  *((byte *) &configurationRegister+1), BIN);
-  Serial2.println(  *((byte *) &configurationRegister), BIN);
-  this->sendTransmission(ADC_CONFIGURATION_REGISTER_ADDRESS, &configurationRegister, 2);
+  unsigned short value;
+  memcpy(&value, &configurationRegister, 2);
+  registers.write(ADC_CONFIGURATION_REGISTER_ADDRESS, value);
 }
 
 channel_register AD7091R::readChannelRegister()
 {
-  // debug(F("reading channel register"));
-  struct channel_register channelRegister;
-  this->sendTransmission(ADC_CHANNEL_REGISTER_ADDRESS);
-  this->requestBytes((byte *)&channelRegister, 1);
+  struct channel_register channelRegister = {};
+  unsigned short value = 0;
+  registers.read(ADC_CHANNEL_REGISTER_ADDRESS, &value);
+  memcpy(&channelRegister, &value, 1);
   return channelRegister;
 }
 
 void AD7091R::writeChannelRegister(channel_register channelConfiguration)
 {
-  // debug(F("writing channel register"));
-  // debug( *(byte*) &channelConfiguration);
-  // Serial2.println(*(byte*) &channelConfiguration );
-  this->sendTransmission(ADC_CHANNEL_REGISTER_ADDRESS, (byte *)&channelConfiguration, 1);
+  byte value;
+  memcpy(&value, &channelConfiguration, 1);
+  registers.write(ADC_CHANNEL_REGISTER_ADDRESS, value);
 }
 
 conversion_result_register AD7091R::readConversionResultRegister()
@@ -20,6 +20,7 @@
 #define WATERBEAR_EXTERNAL_ADC
 
 #include "Arduino.h"
+#include "utilities/register_shadow.h"
 
 
 #define ADC_I2C_ADDRESS 0x2F
@@ -75,8 +76,10 @@ private:
   short _channel2Value;
   short _channel3Value;
 
+  RegisterShadow registers; // configuration and channel registers
+
   void copyBytesToRegister(byte * registerPtr, byte msb, byte lsb);
-  void updateChannelRegister();
+  void updateChannelRegister(bool restartCycle = false);
   void sendTransmission(byte registerAddress, const void * data, int numBytes);
   void sendTransmission(byte registerAddress);
   void requestBytes(byte * buffer, int length);
@@ -85,6 +88,7 @@ private:
 public:
   AD7091R();
   void configure();
+  void invalidateRegisters(); // the ADC was reset or powered down
   void enableChannel(short channel);
   void disableChannel(short channel);
   void convertEnabledChannels();
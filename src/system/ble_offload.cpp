@@ -0,0 +1,316 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "ble_offload.h"
+#include "system/crc.h"
+#include "system/logs.h"
+#include "system/watchdog.h"
+
+// kept across sessions, so an interrupted download continues where it stopped
+static resume_cursor resumeCursors[BLE_OFFLOAD_RESUME_CURSORS];
+static unsigned char nextResumeCursor = 0;
+
+static byte frame[BLE_OFFLOAD_FRAME_SIZE];
+
+SerialOffloadLink::SerialOffloadLink(Stream * stream)
+{
+  this->stream = stream;
+}
+
+bool SerialOffloadLink::connected()
+{
+  return true;
+}
+
+unsigned int SerialOffloadLink::write(const byte * data, unsigned int length)
+{
+  return stream->write(data, length);
+}
+
+unsigned int SerialOffloadLink::read(byte * buffer, unsigned int length)
+{
+  unsigned int copied = 0;
+  while (copied < length && stream->available() > 0)
+  {
+    buffer[copied++] = stream->read();
+  }
+  return copied;
+}
+
+BleOffload::BleOffload(WaterBear_FileSystem * fileSystem)
+{
+  this->fileSystem = fileSystem;
+}
+
+void BleOffload::run(OffloadLink * link, unsigned long connectTimeout)
+{
+  this->link = link;
+  finished = false;
+  bytesSent = 0;
+  framesResent = 0;
+
+  unsigned long started = millis();
+  unsigned long lastActivity = 0; // 0 until the central connects
+  unsigned long lastWatchdogReload = started;
+  while (!finished)
+  {
+    if (millis() - lastWatchdogReload > 1000)
+    {
+      reloadCustomWatchdog();
+      lastWatchdogReload = millis();
+    }
+
+    if (lastActivity == 0 ? millis() - started > connectTimeout : millis() - lastActivity > BLE_OFFLOAD_IDLE_TIMEOUT_MILLISECONDS)
+    {
+      break;
+    }
+    if (!link->connected())
+    {
+      continue;
+    }
+    if (lastActivity == 0)
+    {
+      lastActivity = millis();
+    }
+
+    if (readCommands())
+    {
+      lastActivity = millis();
+    }
+    if (transferring)
+    {
+      pumpTransfer();
+    }
+  }
+
+  endTransfer();
+  char message[60];
+  sprintf(message, "offload: %lu bytes in %lu ms, %lu frames resent", bytesSent, millis() - started, framesResent);
+  notify(message);
+}
+
+bool BleOffload::readCommands()
+{
+  byte incoming[16];
+  unsigned int count = link->read(incoming, sizeof(incoming));
+  for (unsigned int i = 0; i < count && !finished; i++)
+  {
+    char c = incoming[i];
+    if (c == '\r')
+    {
+      continue;
+    }
+    if (c == '\n')
+    {
+      line[lineLength] = '\0';
+      lineLength = 0;
+      handleCommand(line);
+    }
+    else if (lineLength < sizeof(line) - 1)
+    {
+      line[lineLength++] = c;
+    }
+  }
+  return count > 0;
+}
+
+void BleOffload::handleCommand(char * command)
+{
+  char * argument = strchr(command, ' ');
+  if (argument != NULL)
+  {
+    *argument++ = '\0';
+  }
+
+  if (strcmp(command, "ack") == 0 && argument != NULL)
+  {
+    acknowledge(strtoul(argument, NULL, 10));
+  }
+  else if (strcmp(command, "get") == 0 && argument != NULL)
+  {
+    char * offset = strchr(argument, ' ');
+    if (offset != NULL)
+    {
+      *offset++ = '\0';
+    }
+    startTransfer(argument, offset);
+  }
+  else if (strcmp(command, "list") == 0)
+  {
+    listFiles();
+  }
+  else if (strcmp(command, "bye") == 0)
+  {
+    writeText("bye\n");
+    finished = true;
+  }
+  else
+  {
+    writeText("error,command\n");
+  }
+}
+
+void BleOffload::writeText(const char * text)
+{
+  unsigned int length = strlen(text);
+  unsigned long start = millis();
+  while (link->write((const byte *) text, length) == 0 && millis() - start < BLE_OFFLOAD_ACK_TIMEOUT_MILLISECONDS)
+    ;
+}
+
+void BleOffload::listFiles()
+{
+  endTransfer();
+  FatFile entry;
+  char name[BLE_OFFLOAD_FILENAME_LENGTH];
+  char text[BLE_OFFLOAD_FILENAME_LENGTH + 14];
+  bool first = true;
+  while (fileSystem->openNextDataFile(&entry, first))
+  {
+    first = false;
+    entry.getName(name, sizeof(name));
+    sprintf(text, "%s,%lu\n", name, (unsigned long) entry.fileSize());
+    entry.close();
+    writeText(text);
+  }
+  writeText(".\n");
+}
+
+resume_cursor * BleOffload::findCursor(const char * filename)
+{
+  for (short i = 0; i < BLE_OFFLOAD_RESUME_CURSORS; i++)
+  {
+    if (strcmp(resumeCursors[i].filename, filename) == 0)
+    {
+      return &resumeCursors[i];
+    }
+  }
+  // reuse the oldest cursor
+  resume_cursor * cursor = &resumeCursors[nextResumeCursor];
+  nextResumeCursor = (nextResumeCursor + 1) % BLE_OFFLOAD_RESUME_CURSORS;
+  strncpy(cursor->filename, filename, BLE_OFFLOAD_FILENAME_LENGTH - 1);
+  cursor->filename[BLE_OFFLOAD_FILENAME_LENGTH - 1] = '\0';
+  cursor->offset = 0;
+  return cursor;
+}
+
+void BleOffload::startTransfer(const char * filename, const char * offset)
+{
+  endTransfer();
+  if (strlen(filename) >= BLE_OFFLOAD_FILENAME_LENGTH || !fileSystem->openDataFile(filename, &file))
+  {
+    writeText("error,file\n");
+    return;
+  }
+
+  cursor = findCursor(filename);
+  fileSize = file.size();
+  ackedOffset = offset != NULL ? strtoul(offset, NULL, 10) : cursor->offset;
+  if (ackedOffset > fileSize)
+  {
+    ackedOffset = fileSize;
+  }
+  sendOffset = ackedOffset;
+  lastProgressMillis = millis();
+  transferring = true;
+
+  char text[BLE_OFFLOAD_FILENAME_LENGTH + 30];
+  sprintf(text, "file,%s,%lu,%lu\n", filename, fileSize, ackedOffset);
+  writeText(text);
+}
+
+void BleOffload::acknowledge(unsigned long offset)
+{
+  if (!transferring || offset <= ackedOffset || offset > fileSize)
+  {
+    return; // duplicate or stale
+  }
+  ackedOffset = offset;
+  if (sendOffset < offset)
+  {
+    sendOffset = offset; // frames sent before a resend arrived after all
+  }
+  cursor->offset = offset;
+  lastProgressMillis = millis();
+}
+
+void BleOffload::pumpTransfer()
+{
+  if (ackedOffset == fileSize)
+  {
+    if (sendFrame('E', fileSize, 0)) // retried while the link is backed up
+    {
+      endTransfer();
+    }
+    return;
+  }
+
+  if (millis() - lastProgressMillis > BLE_OFFLOAD_ACK_TIMEOUT_MILLISECONDS)
+  {
+    // go back to the first unacknowledged byte
+    framesResent += (sendOffset - ackedOffset + BLE_OFFLOAD_PAYLOAD_SIZE - 1) / BLE_OFFLOAD_PAYLOAD_SIZE;
+    sendOffset = ackedOffset;
+    lastProgressMillis = millis();
+  }
+
+  // one frame per call, so acknowledgements are read between frames
+  if (sendOffset < fileSize && sendOffset - ackedOffset < (unsigned long) BLE_OFFLOAD_WINDOW * BLE_OFFLOAD_PAYLOAD_SIZE)
+  {
+    unsigned long remaining = fileSize - sendOffset;
+    unsigned int length = remaining < BLE_OFFLOAD_PAYLOAD_SIZE ? remaining : BLE_OFFLOAD_PAYLOAD_SIZE;
+    if (sendFrame('D', sendOffset, length))
+    {
+      sendOffset += length;
+      bytesSent += length;
+    }
+  }
+}
+
+bool BleOffload::sendFrame(char type, unsigned long offset, unsigned int length)
+{
+  frame[0] = BLE_OFFLOAD_FRAME_MARKER;
+  frame[1] = type;
+  frame[2] = length;
+  for (byte i = 0; i < 4; i++)
+  {
+    frame[3 + i] = (offset >> (8 * i)) & 0xFF;
+  }
+  if (length > 0)
+  {
+    if (!file.seek(offset) || file.read(&frame[7], length) != (int) length)
+    {
+      return false;
+    }
+  }
+  uint32 crc = hardwareCRC32(frame, 7 + length);
+  for (byte i = 0; i < 4; i++)
+  {
+    frame[7 + length + i] = (crc >> (8 * i)) & 0xFF;
+  }
+  return link->write(frame, BLE_OFFLOAD_FRAME_OVERHEAD + length) > 0;
+}
+
+void BleOffload::endTransfer()
+{
+  if (transferring)
+  {
+    file.close();
+    transferring = false;
+  }
+}
@@ -0,0 +1,121 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_BLE_OFFLOAD
+#define WATERBEAR_BLE_OFFLOAD
+
+#include <Arduino.h>
+#include "system/filesystem.h"
+
+// Frames are whole numbers of notifications so the module never sends a short one.
+#define BLE_OFFLOAD_NOTIFICATION_SIZE 20 // ATT MTU 23 less the notification header
+#define BLE_OFFLOAD_FRAME_SIZE (12 * BLE_OFFLOAD_NOTIFICATION_SIZE)
+#define BLE_OFFLOAD_FRAME_OVERHEAD 11 // marker, type, length, offset, crc32
+#define BLE_OFFLOAD_PAYLOAD_SIZE (BLE_OFFLOAD_FRAME_SIZE - BLE_OFFLOAD_FRAME_OVERHEAD)
+#define BLE_OFFLOAD_FRAME_MARKER 0xA5
+#define BLE_OFFLOAD_WINDOW 4 // frames in flight, within the module's 1 kB TX FIFO
+
+#define BLE_OFFLOAD_ACK_TIMEOUT_MILLISECONDS 2000 // resend from the last acknowledged offset
+#define BLE_OFFLOAD_CONNECT_TIMEOUT_MILLISECONDS 120000
+#define BLE_OFFLOAD_IDLE_TIMEOUT_MILLISECONDS 60000
+#define BLE_OFFLOAD_RESUME_CURSORS 4
+#define BLE_OFFLOAD_FILENAME_LENGTH 24
+
+// byte stream to the central, the Bluefruit module or the serial stand in
+class OffloadLink
+{
+public:
+  virtual bool connected() = 0;
+  virtual unsigned int write(const byte * data, unsigned int length) = 0; // all or nothing, 0 when the link is backed up
+  virtual unsigned int read(byte * buffer, unsigned int length) = 0;      // doesn't block
+};
+
+// the offload protocol over the serial console, for bench tests and throughput
+// measurement with tools/ble_offload.py without a radio
+class SerialOffloadLink : public OffloadLink
+{
+public:
+  SerialOffloadLink(Stream * stream);
+  bool connected();
+  unsigned int write(const byte * data, unsigned int length);
+  unsigned int read(byte * buffer, unsigned int length);
+
+private:
+  Stream * stream;
+};
+
+typedef struct resume_cursor_type
+{
+  char filename[BLE_OFFLOAD_FILENAME_LENGTH];
+  unsigned long offset; // bytes acknowledged by the central
+} resume_cursor;
+
+/*
+ * Serves the data files of the logging folder to a central.
+ *
+ * The central sends text lines:
+ *   list                      -> <name>,<size> lines, then .
+ *   get <name> [<offset>]     -> file,<name>,<size>,<offset> then data frames, from the
+ *                                resume cursor of the file when the offset is left out
+ *   ack <offset>              -> every byte before offset arrived
+ *   bye                       -> ends the session
+ *
+ * Data frames: A5 <type> <length> <offset, 4 bytes LE> <payload> <crc32, 4 bytes LE>
+ * with type 'D' for data and 'E' (empty) once the whole file is acknowledged.
+ * The crc is the STM32 hardware CRC of the frame up to the crc. Up to
+ * BLE_OFFLOAD_WINDOW frames are sent ahead of the acknowledged offset.
+ */
+class BleOffload
+{
+public:
+  BleOffload(WaterBear_FileSystem * fileSystem);
+  void run(OffloadLink * link, unsigned long connectTimeout);
+
+private:
+  WaterBear_FileSystem * fileSystem;
+  OffloadLink * link;
+
+  char line[48];
+  byte lineLength = 0;
+  bool finished = false;
+
+  File file;
+  bool transferring = false;
+  resume_cursor * cursor = NULL;
+  unsigned long fileSize = 0;
+  unsigned long sendOffset = 0;
+  unsigned long ackedOffset = 0;
+  unsigned long lastProgressMillis = 0;
+
+  unsigned long bytesSent = 0;
+  unsigned long framesResent = 0;
+
+  bool readCommands(); // true when anything arrived
+  void handleCommand(char * command);
+  void listFiles();
+  void startTransfer(const char * filename, const char * offset);
+  void acknowledge(unsigned long offset);
+  void pumpTransfer();
+  bool sendFrame(char type, unsigned long offset, unsigned int length);
+  void endTransfer();
+  void writeText(const char * text);
+  resume_cursor * findCursor(const char * filename);
+};
+
+#endif
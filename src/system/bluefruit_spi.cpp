@@ -0,0 +1,246 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "bluefruit_spi.h"
+#include "system/hardware.h"
+#include "system/logs.h"
+
+BluefruitSPI::BluefruitSPI() : spi(2)
+{
+}
+
+bool BluefruitSPI::powerUp()
+{
+  pinMode(BLUEFRUIT_SPI_CS, OUTPUT);
+  digitalWrite(BLUEFRUIT_SPI_CS, HIGH);
+  pinMode(BLUEFRUIT_SPI_IRQ, INPUT);
+  spi.begin();
+
+  pinMode(BLUEFRUIT_SPI_RST, OUTPUT);
+  digitalWrite(BLUEFRUIT_SPI_RST, LOW);
+  delay(10);
+  digitalWrite(BLUEFRUIT_SPI_RST, HIGH);
+  delay(BLUEFRUIT_BOOT_MILLISECONDS);
+
+  rxLength = 0;
+  rxPosition = 0;
+  lastConnected = false;
+  lastConnectionPoll = 0;
+
+  char reply[16];
+  return sendATCommand("AT", reply, sizeof(reply));
+}
+
+void BluefruitSPI::powerDown()
+{
+  digitalWrite(BLUEFRUIT_SPI_RST, LOW); // same as setupHardwarePins()
+  spi.end();
+  pinMode(BLUEFRUIT_SPI_CS, INPUT); // released for GPIO_PIN_4
+}
+
+bool BluefruitSPI::connected()
+{
+  if (lastConnectionPoll != 0 && millis() - lastConnectionPoll < BLUEFRUIT_CONNECTION_POLL_MILLISECONDS)
+  {
+    return lastConnected;
+  }
+  char reply[16];
+  lastConnected = sendATCommand("AT+GAPGETCONN", reply, sizeof(reply)) && reply[0] == '1';
+  lastConnectionPoll = millis();
+  return lastConnected;
+}
+
+void BluefruitSPI::select()
+{
+  spi.beginTransaction(SPISettings(BLUEFRUIT_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(BLUEFRUIT_SPI_CS, LOW);
+}
+
+void BluefruitSPI::deselect()
+{
+  digitalWrite(BLUEFRUIT_SPI_CS, HIGH);
+  spi.endTransaction();
+}
+
+// header: message type, command id (LE), length with bit 7 set when more packets follow
+bool BluefruitSPI::sendPacket(unsigned short command, const byte * payload, byte length, bool moreData)
+{
+  byte header[4] = {SDEP_MSGTYPE_COMMAND, (byte) (command & 0xFF), (byte) (command >> 8), (byte) (length | (moreData ? 0x80 : 0))};
+
+  unsigned long start = millis();
+  select();
+  while (spi.transfer(header[0]) == SDEP_IGNORED_BYTE)
+  {
+    // busy, e.g. its TX FIFO is full
+    deselect();
+    if (millis() - start > SDEP_TIMEOUT_MILLISECONDS)
+    {
+      return false;
+    }
+    delayMicroseconds(SDEP_RETRY_DELAY_MICROSECONDS);
+    select();
+  }
+  for (byte i = 1; i < 4; i++)
+  {
+    spi.transfer(header[i]);
+  }
+  for (byte i = 0; i < length; i++)
+  {
+    spi.transfer(payload[i]);
+  }
+  deselect();
+  return true;
+}
+
+bool BluefruitSPI::receivePacket(byte * payload, byte * length, bool * moreData)
+{
+  unsigned long start = millis();
+  while (!digitalRead(BLUEFRUIT_SPI_IRQ))
+  {
+    if (millis() - start > SDEP_TIMEOUT_MILLISECONDS)
+    {
+      return false;
+    }
+  }
+
+  select();
+  byte messageType = spi.transfer(0xFF);
+  while (messageType != SDEP_MSGTYPE_RESPONSE && messageType != SDEP_MSGTYPE_ERROR)
+  {
+    if (millis() - start > SDEP_TIMEOUT_MILLISECONDS)
+    {
+      deselect();
+      return false;
+    }
+    if (messageType == SDEP_IGNORED_BYTE || messageType == SDEP_OVERREAD_BYTE)
+    {
+      deselect();
+      delayMicroseconds(SDEP_RETRY_DELAY_MICROSECONDS);
+      select();
+    }
+    messageType = spi.transfer(0xFF);
+  }
+
+  spi.transfer(0xFF); // command id, echoes the request
+  spi.transfer(0xFF);
+  byte lengthByte = spi.transfer(0xFF);
+  *length = lengthByte & 0x7F;
+  *moreData = lengthByte & 0x80;
+  bool valid = messageType == SDEP_MSGTYPE_RESPONSE && *length <= SDEP_MAX_PACKETSIZE;
+  if (valid)
+  {
+    for (byte i = 0; i < *length; i++)
+    {
+      payload[i] = spi.transfer(0xFF);
+    }
+  }
+  deselect();
+  return valid;
+}
+
+bool BluefruitSPI::sendATCommand(const char * command, char * reply, unsigned int replyLength)
+{
+  unsigned int length = strlen(command);
+  unsigned int sent = 0;
+  do
+  {
+    byte packetLength = length - sent > SDEP_MAX_PACKETSIZE ? SDEP_MAX_PACKETSIZE : length - sent;
+    if (!sendPacket(SDEP_CMDTYPE_AT_WRAPPER, (const byte *) &command[sent], packetLength, sent + packetLength < length))
+    {
+      return false;
+    }
+    sent += packetLength;
+  } while (sent < length);
+
+  // the reply ends with OK or ERROR, possibly after a result line
+  unsigned int replyUsed = 0;
+  byte payload[SDEP_MAX_PACKETSIZE];
+  byte payloadLength;
+  bool moreData = true;
+  while (moreData)
+  {
+    if (!receivePacket(payload, &payloadLength, &moreData))
+    {
+      return false;
+    }
+    for (byte i = 0; i < payloadLength && replyUsed < replyLength - 1; i++)
+    {
+      reply[replyUsed++] = payload[i];
+    }
+  }
+  reply[replyUsed] = '\0';
+  return strstr(reply, "OK") != NULL;
+}
+
+unsigned int BluefruitSPI::write(const byte * data, unsigned int length)
+{
+  unsigned int sent = 0;
+  while (sent < length)
+  {
+    byte packetLength = length - sent > SDEP_MAX_PACKETSIZE ? SDEP_MAX_PACKETSIZE : length - sent;
+    if (!sendPacket(SDEP_CMDTYPE_BLE_UARTTX, &data[sent], packetLength, sent + packetLength < length))
+    {
+      // the rest of a partly sent frame is lost, the central never acknowledges it
+      return 0;
+    }
+    sent += packetLength;
+  }
+
+  byte payload[SDEP_MAX_PACKETSIZE];
+  byte payloadLength;
+  bool moreData = true;
+  while (moreData)
+  {
+    if (!receivePacket(payload, &payloadLength, &moreData))
+    {
+      return 0;
+    }
+  }
+  return length;
+}
+
+unsigned int BluefruitSPI::read(byte * buffer, unsigned int length)
+{
+  if (rxPosition == rxLength)
+  {
+    rxPosition = 0;
+    rxLength = 0;
+    if (!sendPacket(SDEP_CMDTYPE_BLE_UARTRX, NULL, 0, false))
+    {
+      return 0;
+    }
+    byte payload[SDEP_MAX_PACKETSIZE];
+    byte payloadLength;
+    bool moreData = true;
+    while (moreData && receivePacket(payload, &payloadLength, &moreData))
+    {
+      for (byte i = 0; i < payloadLength && rxLength < BLUEFRUIT_RX_BUFFER_SIZE; i++)
+      {
+        rxBuffer[rxLength++] = payload[i];
+      }
+    }
+  }
+
+  unsigned int copied = 0;
+  while (copied < length && rxPosition < rxLength)
+  {
+    buffer[copied++] = rxBuffer[rxPosition++];
+  }
+  return copied;
+}
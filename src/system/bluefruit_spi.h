@@ -0,0 +1,73 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_BLUEFRUIT_SPI
+#define WATERBEAR_BLUEFRUIT_SPI
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "system/ble_offload.h"
+
+// Adafruit SDEP, the SPI framing of the Bluefruit LE SPI Friend
+#define SDEP_MSGTYPE_COMMAND 0x10
+#define SDEP_MSGTYPE_RESPONSE 0x20
+#define SDEP_MSGTYPE_ERROR 0x80
+#define SDEP_CMDTYPE_AT_WRAPPER 0x0A00
+#define SDEP_CMDTYPE_BLE_UARTTX 0x0A01
+#define SDEP_CMDTYPE_BLE_UARTRX 0x0A02
+#define SDEP_MAX_PACKETSIZE 16
+#define SDEP_IGNORED_BYTE 0xFE // module not ready, deselect and retry
+#define SDEP_OVERREAD_BYTE 0xFF
+#define SDEP_TIMEOUT_MILLISECONDS 250
+#define SDEP_RETRY_DELAY_MICROSECONDS 50
+
+#define BLUEFRUIT_SPI_CLOCK 4000000
+#define BLUEFRUIT_BOOT_MILLISECONDS 1000
+#define BLUEFRUIT_CONNECTION_POLL_MILLISECONDS 500
+#define BLUEFRUIT_RX_BUFFER_SIZE 64
+
+// The module is held in reset outside offload sessions, so the radio is off
+// except while a session is open. Data goes through the BLE UART service.
+class BluefruitSPI : public OffloadLink
+{
+public:
+  BluefruitSPI();
+  bool powerUp(); // false when no module answers
+  void powerDown();
+
+  bool connected();
+  unsigned int write(const byte * data, unsigned int length);
+  unsigned int read(byte * buffer, unsigned int length);
+  bool sendATCommand(const char * command, char * reply, unsigned int replyLength);
+
+private:
+  SPIClass spi;
+  bool lastConnected = false;
+  unsigned long lastConnectionPoll = 0;
+  byte rxBuffer[BLUEFRUIT_RX_BUFFER_SIZE];
+  unsigned int rxLength = 0;
+  unsigned int rxPosition = 0;
+
+  void select();
+  void deselect();
+  bool sendPacket(unsigned short command, const byte * payload, byte length, bool moreData);
+  bool receivePacket(byte * payload, byte * length, bool * moreData);
+};
+
+#endif
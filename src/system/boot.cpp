@@ -0,0 +1,83 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "boot.h"
+#include "logs.h"
+#include <libmaple/rcc.h>
+#include <libmaple/pwr.h>
+
+static const char * bootPhaseNames[MAX_BOOT_PHASES];
+static uint32 bootPhaseTimes[MAX_BOOT_PHASES];
+static unsigned short bootPhaseCount = 0;
+
+static uint32 resetFlags = 0;
+static bool standbyWake = false;
+
+void markBootPhase(const char * phase)
+{
+  if(bootPhaseCount >= MAX_BOOT_PHASES)
+  {
+    return;
+  }
+  bootPhaseNames[bootPhaseCount] = phase;
+  bootPhaseTimes[bootPhaseCount] = millis();
+  bootPhaseCount++;
+}
+
+void printBootTimeline()
+{
+  char buffer[60];
+  sprintf(buffer, "reset flags: %08lx", resetFlags);
+  notify(buffer);
+
+  uint32 previous = 0;
+  for(unsigned short i = 0; i < bootPhaseCount; i++)
+  {
+    sprintf(buffer, "%-12s %6lu ms (+%lu)", bootPhaseNames[i], bootPhaseTimes[i], bootPhaseTimes[i] - previous);
+    notify(buffer);
+    previous = bootPhaseTimes[i];
+  }
+}
+
+void readResetCause()
+{
+  resetFlags = RCC_BASE->CSR;
+  RCC_BASE->CSR |= RCC_CSR_RMVF;
+
+  // waking from standby restarts the MCU without setting a reset flag
+  rcc_clk_enable(RCC_PWR);
+  standbyWake = PWR_BASE->CSR & PWR_CSR_SBF;
+  PWR_BASE->CR |= PWR_CR_CSBF;
+}
+
+bool resetWasPowerOn()
+{
+  return resetFlags & RCC_CSR_PORRSTF;
+}
+
+bool resetWasUnattended()
+{
+  uint32 unattendedFlags = RCC_CSR_PORRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF | RCC_CSR_SFTRSTF | RCC_CSR_LPWRRSTF;
+  return (resetFlags & unattendedFlags) || standbyWake;
+}
+
+bool resetWasStandbyWake()
+{
+  return standbyWake;
+}
@@ -0,0 +1,38 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_BOOT
+#define WATERBEAR_BOOT
+
+#include <Arduino.h>
+
+#define MAX_BOOT_PHASES 16
+
+// Boot timeline, millis() since reset at the end of each named phase.
+// See BOOT.md for the budget these are checked against.
+void markBootPhase(const char * phase); // phase must be a string literal
+void printBootTimeline();
+
+// Reset cause, read once from RCC_CSR and then cleared so the next reset reports its own cause
+void readResetCause();
+bool resetWasPowerOn(); // power on or brown out, switched rails are already discharged
+bool resetWasUnattended(); // any reset not caused by the reset pin
+bool resetWasStandbyWake(); // woken from standby mode, by the last gasp recheck alarm
+
+#endif
@@ -21,23 +21,138 @@
 #include <RTClock.h>
 #include "filesystem.h"
 #include "logs.h"
+#include "utilities/i2c.h"
+#include "utilities/register_shadow.h"
+#include "interrupts.h"
 
 
 DS3231 Clock;
 
+#define DS3231_I2C_ADDRESS 0x68
+#define DS3231_TIME_REGISTERS 0x00 // seconds to year, 7 bytes
+#define DS3231_CONTROL_REGISTER 0x0E
+#define DS3231_STATUS_REGISTER 0x0F
+#define DS3231_ALARM_BITS 0x03 // A1IE A2IE in the control register, A1F A2F in the status register
+
+// only the control register is shadowed, the time and status registers change on their own
+static RegisterShadow ds3231Registers(&Wire, DS3231_I2C_ADDRESS);
+static bool ds3231RegistersAdded = false;
+
+static RegisterShadow * ds3231Shadow()
+{
+  if (!ds3231RegistersAdded)
+  {
+    ds3231Registers.addRegister(DS3231_CONTROL_REGISTER, 1);
+    ds3231RegistersAdded = true;
+  }
+  return &ds3231Registers;
+}
+
+static int bcdToDecimal(byte value)
+{
+  return (value / 16 * 10) + (value % 16); // same as the DS3231 library, which stores tm_year 100+ this way
+}
+
+// All time registers in one transaction instead of one per field, so no field
+// can roll over between reads. Falls back to the library getters.
+static void readDS3231Time(struct tm * ts)
+{
+  byte registers[7];
+  if (i2cReadBlock(&Wire, DS3231_I2C_ADDRESS, DS3231_TIME_REGISTERS, registers, 7))
+  {
+    ts->tm_sec = bcdToDecimal(registers[0]);
+    ts->tm_min = bcdToDecimal(registers[1]);
+    ts->tm_hour = bcdToDecimal(registers[2] & ((registers[2] & 0x40) ? 0x1F : 0x3F)); // 12 hour mode flag
+    ts->tm_wday = bcdToDecimal(registers[3]);
+    ts->tm_mday = bcdToDecimal(registers[4]);
+    ts->tm_mon = bcdToDecimal(registers[5] & 0x7F); // without the century flag
+    ts->tm_year = bcdToDecimal(registers[6]);
+    return;
+  }
+
+  bool century = false;
+  bool h24Flag;
+  bool pmFlag;
+  ts->tm_year = Clock.getYear();
+  ts->tm_mon = Clock.getMonth(century);
+  ts->tm_mday = Clock.getDate();
+  ts->tm_wday = Clock.getDoW();
+  ts->tm_hour = Clock.getHour(h24Flag, pmFlag);
+  ts->tm_min = Clock.getMinute();
+  ts->tm_sec = Clock.getSecond();
+}
+
+// Time base for interrupt timestamps.  The internal RTC keeps counting in STOP mode,
+// it is restarted from 0 whenever an alarm is set, so the epoch at that moment is kept.
+#define LSE_FREQUENCY 32768
+#define RTC_DEFAULT_PRESCALER 0x7FFF
+#define RTC_FINE_PRESCALER 31 // 1024 Hz, for alarms placed to the millisecond
+static volatile unsigned long long internalRTCBaseMilliseconds = 0;
+static volatile unsigned long internalRTCPrescaler = RTC_DEFAULT_PRESCALER;
+
+static unsigned long long internalRTCElapsedMilliseconds()
+{
+  unsigned long count = rtc_get_count();
+  unsigned long divider = rtc_get_divider(); // counts down from the prescaler to 0 each tick
+  unsigned long long ticks = (unsigned long long) count * (internalRTCPrescaler + 1) + (internalRTCPrescaler - divider);
+  return ticks * 1000 / LSE_FREQUENCY;
+}
+
+unsigned long long internalRTCEpochMilliseconds()
+{
+  return internalRTCBaseMilliseconds + internalRTCElapsedMilliseconds();
+}
+
+// The sub-second phase of the time base is aligned to a DS3231 second edge once and then
+// carried across alarms.  The LSE and DS3231 crystals drift apart by up to ~22 ppm, so it is
+// aligned again every RTC_REALIGN_SECONDS or when the two disagree on the second.
+#define RTC_REALIGN_SECONDS 21600 // up to ~0.5 s of drift
+#define RTC_ALIGNMENT_SLACK_MILLISECONDS 100 // the two clocks are not read at the same instant
+static bool internalRTCAligned = false;
+static time_t internalRTCAlignedSecond = 0;
+
+static bool internalRTCNeedsAlignment()
+{
+  if (!internalRTCAligned)
+  {
+    return true;
+  }
+  time_t second = timestamp();
+  long long offset = (long long) internalRTCEpochMilliseconds() - (long long) second * 1000; // 0 to 999 when aligned
+  if (offset < -RTC_ALIGNMENT_SLACK_MILLISECONDS || offset >= 1000 + RTC_ALIGNMENT_SLACK_MILLISECONDS)
+  {
+    return true;
+  }
+  return second - internalRTCAlignedSecond >= RTC_REALIGN_SECONDS;
+}
+
+// call just before the RTC count is reset, discipline to the DS3231 when it is cheap to read
+static void restartInternalRTCTimeBase(unsigned long prescaler, bool discipline)
+{
+  unsigned long long now = discipline ? (unsigned long long) timestamp() * 1000 : internalRTCEpochMilliseconds();
+  if (discipline)
+  {
+    internalRTCAligned = false; // the sub-second phase is lost
+  }
+  noInterrupts();
+  internalRTCBaseMilliseconds = now;
+  internalRTCPrescaler = prescaler;
+  interrupts();
+}
+
 void handleInterrupt(){
   // just do nothing
   // Serial2.println("RTC interrupt!!");
 }
 
-void setNextAlarmInternalRTC(short interval){
-  short minutes = Clock.getMinute();
-  //Serial2.println("minutes");
-  //Serial2.println(Clock.getMinute(), DEC);
-  //Serial2.println(minutes);
-  short seconds = Clock.getSecond();
-  // Serial2.println("seconds");
-  // Serial2.println(seconds);
+// only the measurement wake alarm is queued, not the idle alarms of sleepMCU
+void handleWakeAlarmInterrupt(){
+  queueWakeEvent(wake_alarm);
+}
+
+// the next whole multiple of interval minutes past the hour
+time_t nextIntervalBoundary(time_t now, short interval)
+{
   // an example of the math
   // time = 10:48:12 (current time)
   // minutes = 48 ( current minutes)
@@ -47,60 +162,92 @@ void setNextAlarmInternalRTC(short interval){
   // minutesDiff = 60 - 48 = 12
   // minutesDiffSeconds = 12 * 60 = 720
   // secondsUntilWake = 720 - 12 = 708
-  // Serial2.println("interval");
-  // Serial2.println(interval);
-  // Serial2.println("minutes");
-  // Serial2.println(minutes);
+  short minutes = (now / 60) % 60;
+  short seconds = now % 60;
   short nextMinutes = (minutes + interval - (minutes % interval));
-  Serial2.println("next minutes");
-  Serial2.println(nextMinutes);
-  short minutesDiff = nextMinutes - minutes;
-  short minutesDiffSeconds = minutesDiff * 60;
-  short secondsUntilWake = minutesDiffSeconds - seconds; // -offset.  Offset would allow for some startup time.
-  // Serial2.println("seconds until wake");
-  // Serial2.println(secondsUntilWake);
+  long secondsUntilWake = (long) (nextMinutes - minutes) * 60 - seconds;
+  return now + secondsUntilWake;
+}
 
-  RTClock * clock = new RTClock(RTCSEL_LSE);
-  Serial2.println("made clock");  Serial2.flush();
+void setNextAlarmInternalRTC(short interval){
+  time_t now = timestamp();
+  time_t wake = nextIntervalBoundary(now, interval);
 
-  char message[100];
-  sprintf(message, "Got clock value (current): %lli", clock->getTime());
-  debug(message);
-    
-  clock->setTime(0);
-  sprintf(message, "Got clock value (reset): %lli", clock->getTime());
+  char message[50];
+  sprintf(message, "set alarm time to wake: %li", (long) (wake - now));
   debug(message);
 
-  clock->removeAlarm();
-  // secondsUntilWake = 10;
-  clock->setAlarmTime(secondsUntilWake);
-  clock->createAlarm(handleInterrupt, secondsUntilWake);
-  delete clock;
+  setNextAlarmInternalRTCEpochMilliseconds((unsigned long long) wake * 1000);
+}
 
-  sprintf(message, "set alarm time to wake: %i", secondsUntilWake);
-  debug(message);
+// The DS3231 only counts whole seconds, wait for the next one to start so the
+// time base can be aligned to it.  Returns that second.  Costs 0.5 s awake on average.
+static time_t awaitDS3231SecondEdge(uint32 * edgeMillis)
+{
+  time_t start = timestamp();
+  time_t now = start;
+  uint32 waitStart = millis();
+  while (now == start && millis() - waitStart < 1100)
+  {
+    delay(2);
+    now = timestamp();
+  }
+  *edgeMillis = millis();
+  return now;
+}
 
+void setNextAlarmInternalRTCEpochMilliseconds(unsigned long long wakeEpochMilliseconds)
+{
+  bool align = internalRTCNeedsAlignment();
+  uint32 edgeMillis = 0;
+  time_t edge = align ? awaitDS3231SecondEdge(&edgeMillis) : 0;
+  unsigned long long now = internalRTCEpochMilliseconds(); // continues the aligned phase
+
+  RTClock clock(RTCSEL_LSE, RTC_FINE_PRESCALER);
+  noInterrupts();
+  clock.setTime(0);
+  if (align)
+  {
+    now = (unsigned long long) edge * 1000 + (millis() - edgeMillis);
+  }
+  internalRTCBaseMilliseconds = now;
+  internalRTCPrescaler = RTC_FINE_PRESCALER;
+  interrupts();
+  if (align)
+  {
+    internalRTCAligned = true;
+    internalRTCAlignedSecond = edge;
+  }
+
+  unsigned long ticks = 1;
+  if (wakeEpochMilliseconds > now)
+  {
+    ticks = (unsigned long) ((wakeEpochMilliseconds - now) * (LSE_FREQUENCY / (RTC_FINE_PRESCALER + 1)) / 1000);
+  }
+  clock.removeAlarm();
+  clock.setAlarmTime(ticks);
+  clock.createAlarm(handleWakeAlarmInterrupt, ticks);
 }
 
 
 void setNextAlarmInternalRTCSeconds(short seconds)
 {
 
-  RTClock * clock = new RTClock(RTCSEL_LSE);
+  restartInternalRTCTimeBase(RTC_DEFAULT_PRESCALER, true);
+  RTClock clock(RTCSEL_LSE);
   // Serial2.println("made clock");  Serial2.flush();
 
   // char message[100];
-  // sprintf(message, "Got clock value (current): %lli", clock->getTime());
+  // sprintf(message, "Got clock value (current): %lli", clock.getTime());
   // debug(message);
   
-  clock->setTime(0);
-  // sprintf(message, "Got clock value (reset): %lli", clock->getTime());
+  clock.setTime(0);
+  // sprintf(message, "Got clock value (reset): %lli", clock.getTime());
   // debug(message);
 
-  clock->removeAlarm();
-  clock->setAlarmTime(seconds);
-  clock->createAlarm(handleInterrupt, seconds);
-  delete clock;
+  clock.removeAlarm();
+  clock.setAlarmTime(seconds);
+  clock.createAlarm(handleInterrupt, seconds);
 
   // sprintf(message, "set alarm seconds until wake: %i", seconds);
   // notify(message);
@@ -110,21 +257,21 @@ void setNextAlarmInternalRTCSeconds(short seconds)
 void setNextAlarmInternalRTCMilliseconds(int milliseconds)
 {
 
-  RTClock * clock = new RTClock(RTCSEL_LSE, 32); //according to sheet clock/(prescaler + 1) = Hz
+  restartInternalRTCTimeBase(32, false);
+  RTClock clock(RTCSEL_LSE, 32); //according to sheet clock/(prescaler + 1) = Hz
   // Serial2.println("made clock");  Serial2.flush();
 
   // char message[100];
-  // sprintf(message, "Got clock value (current): %lli", clock->getTime());
+  // sprintf(message, "Got clock value (current): %lli", clock.getTime());
   // debug(message);
     
-  clock->setTime(0);
-  // sprintf(message, "Got clock value (reset): %lli", clock->getTime());
+  clock.setTime(0);
+  // sprintf(message, "Got clock value (reset): %lli", clock.getTime());
   // debug(message);
 
-  clock->removeAlarm();
-  clock->setAlarmTime(milliseconds);
-  clock->createAlarm(handleInterrupt, milliseconds);
-  delete clock;
+  clock.removeAlarm();
+  clock.setAlarmTime(milliseconds);
+  clock.createAlarm(handleInterrupt, milliseconds);
 
   // sprintf(message, "set alarm milliseconds until wake: %i", milliseconds);
   // notify(message);
@@ -134,10 +281,7 @@ void setNextAlarmInternalRTCMilliseconds(int milliseconds)
 #ifdef USES_DS3231_ALARM
 void setNextAlarm(short interval)
 {
-  Clock.turnOffAlarm(1); // Clear the Control Register
-  Clock.turnOffAlarm(2);
-  Clock.checkIfAlarm(1); // Clear the Status Register
-  Clock.checkIfAlarm(2);
+  clearAllAlarms();
   
   //
   // Alarm every interval minutes
@@ -178,47 +322,43 @@ void setNextAlarm(short interval)
 
 
   Clock.turnOnAlarm(1);
+  ds3231Shadow()->invalidate(DS3231_CONTROL_REGISTER); // written by the library
 }
 #endif
 
 void dateTime(uint16_t* date, uint16_t* time)
 {
   // Fetch time from DS3231 RTC
-  bool century = false;
-	bool h24Flag;
-	bool pmFlag;
+  struct tm ts;
+  readDS3231Time(&ts);
   // return date using FAT_DATE macro to format fields
-  *date = FAT_DATE(Clock.getYear() + 1900, Clock.getMonth(century) + 1, Clock.getDate()); // year is since 1900, months range 0-11
+  *date = FAT_DATE(ts.tm_year + 1900, ts.tm_mon + 1, ts.tm_mday); // year is since 1900, months range 0-11
 
   // return time using FAT_TIME macro to format fields
-  *time = FAT_TIME(Clock.getHour(h24Flag, pmFlag), Clock.getMinute(), Clock.getSecond());
+  *time = FAT_TIME(ts.tm_hour, ts.tm_min, ts.tm_sec);
 }
 
 void clearAllAlarms()
 {
-  Clock.turnOffAlarm(1);
-  Clock.turnOffAlarm(2);
-  Clock.checkIfAlarm(1); // Clear the Status Register
-  Clock.checkIfAlarm(2);
+  // Clear the Control Register, a plain write (or nothing) once the shadow is valid
+  ds3231Shadow()->update(DS3231_CONTROL_REGISTER, DS3231_ALARM_BITS, 0);
+
+  // Clear the Status Register, one read and only written when a flag is set
+  byte status;
+  if (i2cReadBlock(&Wire, DS3231_I2C_ADDRESS, DS3231_STATUS_REGISTER, &status, 1) && (status & DS3231_ALARM_BITS))
+  {
+    byte clear[2] = {DS3231_STATUS_REGISTER, (byte) (status & ~DS3231_ALARM_BITS)};
+    i2cWriteCommand(&Wire, DS3231_I2C_ADDRESS, clear, 2);
+  }
 }
 
 
 time_t timestamp()
 {
   struct tm ts;
-  bool century = false;
-	bool h24Flag;
-	bool pmFlag;
-
-  ts.tm_year = Clock.getYear();
-  ts.tm_mon = Clock.getMonth(century);
-  ts.tm_mday = Clock.getDate();
-  ts.tm_wday = Clock.getDoW();
-  ts.tm_hour = Clock.getHour(h24Flag, pmFlag);
-  ts.tm_min = Clock.getMinute();
+  readDS3231Time(&ts);
   //Serial2.println("timestamp mins");
   //Serial2.println(ts.tm_min);
-  ts.tm_sec = Clock.getSecond();
   ts.tm_isdst = -1; // Is DST on? 1 = yes, 0 = no, -1 = unknown
   return (mktime(&ts)); // turn tm struct into time_t value
 }
@@ -228,6 +368,7 @@ void setTime(time_t toSet)
   struct tm ts;
 
   ts = *gmtime(&toSet); // Convert time_t epoch timestamp to tm as UTC time
+  internalRTCAligned = false;
   Clock.setClockMode(false); //true for 12h false for 24h
   Clock.setYear(ts.tm_year);
   Clock.setMonth(ts.tm_mon);
@@ -39,6 +39,8 @@ extern DS3231 Clock;
 void setNextAlarmInternalRTC(short interval);
 void setNextAlarmInternalRTCSeconds(short seconds);
 void setNextAlarmInternalRTCMilliseconds(int milliseconds);
+void setNextAlarmInternalRTCEpochMilliseconds(unsigned long long wakeEpochMilliseconds); // waits up to 1 s for a DS3231 second edge when the time base needs aligning
+time_t nextIntervalBoundary(time_t now, short interval); // next multiple of interval minutes past the hour
 
 #ifdef USES_DS3231_ALARM
 void setNextAlarm(short interval);
@@ -47,6 +49,7 @@ void setNextAlarm(short interval);
 void dateTime(uint16_t* date, uint16_t* time);
 void clearAllAlarms();
 time_t timestamp();
+unsigned long long internalRTCEpochMilliseconds(); // epoch milliseconds from the internal RTC, safe in an ISR and across STOP mode
 void setTime(time_t toSet);
 void t_t2ts(time_t epochTS, uint32 currentMillis, char *humanTime);
 
@@ -17,15 +17,15 @@
  */
 #include "command.h"
 //#include <re.h>
-#include <Cmd.h>
+#include "system/command_line.h"
 #include <libmaple/libmaple.h>
 #include "version.h"
 #include "system/clock.h"
 #include "utilities/qos.h"
 #include "scratch/dbgmcu.h"
 #include "system/logs.h"
-
-#define MAX_REQUEST_LENGTH 70 // serial commands
+#include "system/boot.h"
+#include "utilities/i2c.h"
 
 CommandInterface * commandInterface;
 
@@ -63,7 +63,7 @@ CommandInterface * CommandInterface::instance()
 CommandInterface::CommandInterface(HardwareSerial &port, Datalogger * datalogger)
 {
   this->datalogger = datalogger;
-  cmdInit(&port);
+  this->port = &port;
 }
 
 
@@ -367,22 +367,10 @@ void getConfig(int arg_cnt, char **args)
   // notify(freeMemory());
 }
 
-#define BUFFER_SIZE 400
+#define BUFFER_SIZE 480
 void CommandInterface::_getConfig()
 {
-  datalogger_settings_type dataloggerSettings = this->datalogger->settings;
-  this->datalogger->getConfiguration(&dataloggerSettings);
- 
-  cJSON* dataloggerConfiguration = cJSON_CreateObject();
-  cJSON_AddStringToObject(dataloggerConfiguration, reinterpretCharPtr(F("device_uuid")), this->datalogger->getUUIDString());
-  // cJSON_AddStringToObject(json, reinterpretCharPtr(F("device_name")), dataloggerSettings.deviceName);
-  cJSON_AddStringToObject(dataloggerConfiguration, reinterpretCharPtr(F("site_name")), dataloggerSettings.siteName);
-  cJSON_AddStringToObject(dataloggerConfiguration, reinterpretCharPtr(F("logger_name")), dataloggerSettings.loggerName);
-  cJSON_AddStringToObject(dataloggerConfiguration, reinterpretCharPtr(F("deployment_identifier")), dataloggerSettings.deploymentIdentifier);
-  cJSON_AddNumberToObject(dataloggerConfiguration, reinterpretCharPtr(F("interval(min)")), dataloggerSettings.interval);
-  cJSON_AddNumberToObject(dataloggerConfiguration, reinterpretCharPtr(F("burst_number")), dataloggerSettings.burstNumber);
-  cJSON_AddNumberToObject(dataloggerConfiguration, reinterpretCharPtr(F("start_up_delay(min)")), dataloggerSettings.startUpDelay);
-  cJSON_AddNumberToObject(dataloggerConfiguration, reinterpretCharPtr(F("burst_delay(min)")), dataloggerSettings.interBurstDelay);
+  cJSON* dataloggerConfiguration = this->datalogger->getConfigurationJSON();
 
   char string[BUFFER_SIZE];
   cJSON_PrintPreallocated(dataloggerConfiguration, string, BUFFER_SIZE, true);
@@ -433,7 +421,7 @@ void CommandInterface::_setConfig(char * config)
 
   char * printString = cJSON_Print(json);
   notify(printString);
-  delete(printString);
+  cJSON_free((void *) printString);
 
   this->datalogger->setConfiguration(json);
 
@@ -464,7 +452,7 @@ void CommandInterface::_setSlotConfig(char * config)
 
   const char * printString = cJSON_Print(json);
   notify(printString);
-  delete(printString);
+  cJSON_free((void *) printString);
 
   const cJSON* slotJSON = cJSON_GetObjectItemCaseSensitive(json, "slot");
   const cJSON* typeJSON = cJSON_GetObjectItemCaseSensitive(json, "type");
@@ -630,13 +618,253 @@ void CommandInterface::_setUserValue(int value)
 
 void checkMemory(int arg_cnt, char **args)
 {
-  printFreeMemory();
+  printMemoryStatus();
 }
 
 void doScanIC2(int arg_cnt, char**args)
 {
-  // scanIC2(&Wire);
-  // scanIC2(&Wire2);
+  // the buses are no longer scanned during boot
+  scanIC2(&Wire);
+  scanIC2(&WireTwo);
+}
+
+void setEnergyThresholds(int arg_cnt, char **args)
+{
+  if(arg_cnt < ENERGY_THRESHOLD_COUNT + 1){
+    invalidArgumentsMessage(F("set-energy-thresholds LONG_INTERVAL NO_RAW SINGLE_BURST ESSENTIAL_ONLY LAST_GASP (battery counts, 0 disables)"));
+    return;
+  }
+
+  int thresholds[ENERGY_THRESHOLD_COUNT];
+  for(short i = 0; i < ENERGY_THRESHOLD_COUNT; i++)
+  {
+    thresholds[i] = atoi(args[i + 1]);
+  }
+  CommandInterface::instance()->_setEnergyThresholds(thresholds);
+}
+
+void CommandInterface::_setEnergyThresholds(const int * thresholds)
+{
+  this->datalogger->setEnergyThresholds(thresholds);
+  ok();
+}
+
+bool parseTimeOfDay(const char * text, unsigned short * minute)
+{
+  unsigned short hours, minutes;
+  if(sscanf(text, "%hu:%hu", &hours, &minutes) != 2 || hours > 23 || minutes > 59)
+  {
+    return false;
+  }
+  *minute = hours * 60 + minutes;
+  return true;
+}
+
+void setScheduleWindow(int arg_cnt, char **args)
+{
+  schedule_window_type window;
+  memset(&window, 0xFF, sizeof(schedule_window_type));
+  if(arg_cnt < 5
+    || !parseTimeOfDay(args[2], &window.startMinute)
+    || !parseTimeOfDay(args[3], &window.endMinute)){
+    invalidArgumentsMessage(F("set-schedule-window INDEX HH:MM HH:MM INTERVAL [BURSTS [BURST_DELAY [WEEKDAY_MASK [MONTH_MASK]]]] (UTC, 0 or -1 use the datalogger setting)"));
+    return;
+  }
+
+  window.interval = atoi(args[4]);
+  window.burstNumber = arg_cnt > 5 ? atoi(args[5]) : 0;
+  window.interBurstDelay = arg_cnt > 6 && atoi(args[6]) >= 0 ? atoi(args[6]) : SCHEDULE_INHERIT_BURST_DELAY;
+  window.weekdays = arg_cnt > 7 ? strtol(args[7], NULL, 0) : 0;
+  window.months = arg_cnt > 8 ? strtol(args[8], NULL, 0) : 0;
+  CommandInterface::instance()->_setScheduleWindow(atoi(args[1]), &window);
+}
+
+void CommandInterface::_setScheduleWindow(int index, const schedule_window_type * window)
+{
+  if(index < 0 || !this->datalogger->setScheduleWindow(index, window))
+  {
+    invalidArgumentsMessage(F("set-schedule-window INDEX (0-7) HH:MM HH:MM INTERVAL (1-540)"));
+    return;
+  }
+  ok();
+}
+
+void clearScheduleWindow(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2 || atoi(args[1]) < 0 || atoi(args[1]) >= MAX_SCHEDULE_WINDOWS){
+    invalidArgumentsMessage(F("clear-schedule-window INDEX"));
+    return;
+  }
+
+  CommandInterface::instance()->_clearScheduleWindow(atoi(args[1]));
+}
+
+void CommandInterface::_clearScheduleWindow(int index)
+{
+  this->datalogger->clearScheduleWindow(index);
+  ok();
+}
+
+void showSchedule(int arg_cnt, char **args)
+{
+  short wakeCount = arg_cnt > 1 ? atoi(args[1]) : 8;
+  CommandInterface::instance()->_showSchedule(wakeCount);
+}
+
+void CommandInterface::_showSchedule(short wakeCount)
+{
+  this->datalogger->printSchedule(wakeCount);
+}
+
+void setTrigger(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2){
+    invalidArgumentsMessage(F("set-trigger GPIO_INDEX|off [BURSTS] (GPIO_INDEX 0-6, 0 bursts uses the burst number)"));
+    return;
+  }
+
+  int gpioIndex = strcmp(args[1], "off") == 0 ? TRIGGER_DISABLED : atoi(args[1]);
+  int burstNumber = arg_cnt > 2 ? atoi(args[2]) : 0;
+  CommandInterface::instance()->_setTrigger(gpioIndex, burstNumber);
+}
+
+void CommandInterface::_setTrigger(int gpioIndex, int burstNumber)
+{
+  if(gpioIndex < 0 || gpioIndex > TRIGGER_DISABLED || burstNumber < 0 || burstNumber > 20
+    || !this->datalogger->setTrigger(gpioIndex, burstNumber))
+  {
+    invalidArgumentsMessage(F("set-trigger: pin can't be used (EXTI 5-9 are shared with the wake button)"));
+    return;
+  }
+  ok();
+}
+
+void bleOffload(int arg_cnt, char **args)
+{
+  bool overSerial = arg_cnt > 1 && strcmp(args[1], "serial") == 0;
+  CommandInterface::instance()->_bleOffload(overSerial);
+}
+
+void CommandInterface::_bleOffload(bool overSerial)
+{
+  this->datalogger->offloadData(overSerial);
+  ok();
+}
+
+void powerProfile(int arg_cnt, char **args)
+{
+  CommandInterface::instance()->_powerProfile();
+}
+
+void CommandInterface::_powerProfile()
+{
+  this->datalogger->printPowerProfile();
+}
+
+void triggerStatus(int arg_cnt, char **args)
+{
+  CommandInterface::instance()->_triggerStatus();
+}
+
+void CommandInterface::_triggerStatus()
+{
+  this->datalogger->printTriggerStatus();
+}
+
+void wakeLatency(int arg_cnt, char **args)
+{
+  CommandInterface::instance()->_wakeLatency();
+}
+
+void CommandInterface::_wakeLatency()
+{
+  this->datalogger->printWakeLatency();
+}
+
+void energyStatus(int arg_cnt, char **args)
+{
+  CommandInterface::instance()->_energyStatus();
+}
+
+void CommandInterface::_energyStatus()
+{
+  this->datalogger->printEnergyStatus();
+}
+
+void bootTimeline(int arg_cnt, char**args)
+{
+  printBootTimeline();
+}
+
+void setFastBoot(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2){
+    invalidArgumentsMessage(F("set-fast-boot 0|1"));
+    return;
+  }
+
+  CommandInterface::instance()->_setFastBoot(atoi(args[1]) != 0);
+}
+
+void CommandInterface::_setFastBoot(bool enabled)
+{
+  this->datalogger->setFastBootEnabled(enabled);
+  ok();
+}
+
+void setHeartbeat(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2 || atoi(args[1]) <= 0 || atoi(args[1]) >= 0xFFFF){
+    invalidArgumentsMessage(F("set-heartbeat minutes"));
+    return;
+  }
+
+  CommandInterface::instance()->_setHeartbeat(atoi(args[1]));
+}
+
+void CommandInterface::_setHeartbeat(int minutes)
+{
+  this->datalogger->setHeartbeatInterval(minutes);
+  ok();
+}
+
+void setStatusColumns(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2){
+    invalidArgumentsMessage(F("set-status-columns MASK (bits: type site logger deployment deployed_at uuid time.s time.h battery.V suppressed power_up.uC warm_up.uC measure.uC sd_flush.uC sleep_entry.uC cycle.uC, 0xFFFF all but site to uuid, 0x03FF the wide row without charges)"));
+    return;
+  }
+
+  CommandInterface::instance()->_setStatusColumns(strtol(args[1], NULL, 0));
+}
+
+void CommandInterface::_setStatusColumns(long mask)
+{
+  if(mask < 0 || mask > 0xFFFF)
+  {
+    invalidArgumentsMessage(F("set-status-columns MASK"));
+    return;
+  }
+  this->datalogger->setStatusColumnMask(mask);
+  notify(F("applies to the next data file"));
+  ok();
+}
+
+void setCircularLog(int arg_cnt, char **args)
+{
+  if(arg_cnt < 2 || atoi(args[1]) < 0 || atoi(args[1]) > MAX_CIRCULAR_SEGMENTS){
+    invalidArgumentsMessage(F("set-circular-log SEGMENTS (0 for a new file per deployment)"));
+    return;
+  }
+
+  CommandInterface::instance()->_setCircularLog(atoi(args[1]));
+}
+
+void CommandInterface::_setCircularLog(int segments)
+{
+  this->datalogger->setCircularSegments(segments);
+  notify(F("applies to the next data file"));
+  ok();
 }
 
 void switchedPowerOff(int arg_cnt, char**args)
@@ -677,41 +905,8 @@ void help(int arg_cnt, char**args)
 
 void CommandInterface::_help()
 {
-  char commands[] = "Command List:\n"
-  "version\n"
-  "show-warranty\n"
-  "show-conditions\n"
-  "get-config\n"
-  "set-config\n"
-  "set-slot-config\n"
-  "clear-slot\n"
-  "set-rtc\n"
-  "get-rtc\n"
-  "restart\n"
-  "set-site-name\n"
-  "set-deployment-identifier\n"
-  "set-logger-name\n"
-  "set-interval\n"
-  "set-burst-number\n"
-  "set-start-up-delay\n"
-  "set-burst-delay\n"
-  "calibrate\n"
-  "set-user-note\n"
-  "set-user-value\n"
-  "start-logging\n"
-  "stop-logging\n"
-  "deploy-now\n"
-  "interactive or i\n"
-  "trace\n"
-  "check-memory\n"
-  "scan-ic2\n"
-  "go\n"
-  "reload-sensors\n"
-  "switched-power-off\n"
-  "enter-stop\n"
-  "mcu-debug-status\n";
-
-  notify(commands);
+  notify(F("Command List:"));
+  cliPrintCommands();
 }
 
 void gpiotest(int arg_cnt, char**args)
@@ -739,56 +934,65 @@ void CommandInterface::_reloadSensorConfigurations()
   this->datalogger->reloadSensorConfigurations();
 }
 
-void CommandInterface::setup(){
-  cmdAdd("version", printVersion);
-  cmdAdd("show-warranty", printWarranty);
-  cmdAdd("show-conditions", printConditions);
-
-  cmdAdd("get-config", getConfig);
-  cmdAdd("set-config", setConfig);
-  cmdAdd("set-slot-config", setSlotConfig);
-  cmdAdd("clear-slot", clearSlot);
-
-  cmdAdd("set-rtc", setRTC);
-  cmdAdd("get-rtc", getRTC);
-
-  cmdAdd("set-site-name", setSiteName);
-  cmdAdd("set-deployment-identifier", setDeploymentIdentifier);
-  cmdAdd("set-logger-name", setLoggerName);
-  cmdAdd("set-interval", setInterval);
-  cmdAdd("set-burst-number", setBurstNumber);
-  cmdAdd("set-start-up-delay", setStartUpDelay);
-  cmdAdd("set-burst-delay", setBurstDelay);
-
-  cmdAdd("calibrate", calibrate);
-  
-  cmdAdd("set-user-note", setUserNote);
-  cmdAdd("set-user-value", setUserValue);
-
-  cmdAdd("trace", toggleTrace);
-  cmdAdd("start-logging", startLogging);
-  cmdAdd("stop-logging", stopLogging);
-  cmdAdd("measurement-cycle", testMeasurementCycle);
-
-  cmdAdd("deploy-now", deployNow);
-  cmdAdd("interactive", switchToInteractiveMode);
-  cmdAdd("i", switchToInteractiveMode);
-
-  // qos commands / debug commands
-  cmdAdd("restart", restart);
-  cmdAdd("check-memory", checkMemory);
-  cmdAdd("scan-ic2", doScanIC2);
-  cmdAdd("go", go);
-  cmdAdd("reload-sensors", reloadSensorConfigurations);
-  cmdAdd("switched-power-off", switchedPowerOff);
-  // cmdAdd("enter-sleep", enterSleep);
-  cmdAdd("enter-stop", enterStop);
-  cmdAdd("mcu-debug-status", mcuDebugStatus);
-
-  cmdAdd("help", help);
-
-  cmdAdd("gpio-test", gpiotest);
+// sorted by name for binary search, checked below
+constexpr cli_command commandTable[] = {
+  {"ble-offload", bleOffload},
+  {"boot-timeline", bootTimeline},
+  {"calibrate", calibrate},
+  {"check-memory", checkMemory},
+  {"clear-schedule-window", clearScheduleWindow},
+  {"clear-slot", clearSlot},
+  {"deploy-now", deployNow},
+  {"energy-status", energyStatus},
+  {"enter-stop", enterStop},
+  {"get-config", getConfig},
+  {"get-rtc", getRTC},
+  {"go", go},
+  {"gpio-test", gpiotest},
+  {"help", help},
+  {"i", switchToInteractiveMode},
+  {"interactive", switchToInteractiveMode},
+  {"mcu-debug-status", mcuDebugStatus},
+  {"measurement-cycle", testMeasurementCycle},
+  {"power-profile", powerProfile},
+  {"reload-sensors", reloadSensorConfigurations},
+  {"restart", restart},
+  {"scan-ic2", doScanIC2},
+  {"set-burst-delay", setBurstDelay},
+  {"set-burst-number", setBurstNumber},
+  {"set-circular-log", setCircularLog},
+  {"set-config", setConfig},
+  {"set-deployment-identifier", setDeploymentIdentifier},
+  {"set-energy-thresholds", setEnergyThresholds},
+  {"set-fast-boot", setFastBoot},
+  {"set-heartbeat", setHeartbeat},
+  {"set-interval", setInterval},
+  {"set-logger-name", setLoggerName},
+  {"set-rtc", setRTC},
+  {"set-schedule-window", setScheduleWindow},
+  {"set-site-name", setSiteName},
+  {"set-slot-config", setSlotConfig},
+  {"set-start-up-delay", setStartUpDelay},
+  {"set-status-columns", setStatusColumns},
+  {"set-trigger", setTrigger},
+  {"set-user-note", setUserNote},
+  {"set-user-value", setUserValue},
+  {"show-conditions", printConditions},
+  {"show-schedule", showSchedule},
+  {"show-warranty", printWarranty},
+  {"start-logging", startLogging},
+  {"stop-logging", stopLogging},
+  {"switched-power-off", switchedPowerOff},
+  {"trace", toggleTrace},
+  {"trigger-status", triggerStatus},
+  {"version", printVersion},
+  {"wake-latency", wakeLatency},
+};
+
+static_assert(cliTableSorted(commandTable, sizeof(commandTable) / sizeof(cli_command)), "commandTable must be sorted by name");
 
+void CommandInterface::setup(){
+  cliBegin(port, commandTable, sizeof(commandTable) / sizeof(cli_command));
 }
 
 
@@ -796,7 +1000,7 @@ void CommandInterface::setup(){
 
 void CommandInterface::poll()
 {
-  cmdPoll();
+  cliPoll();
 }
 
 
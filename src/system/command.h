@@ -25,6 +25,7 @@
 #include "DS3231.h"
 #include "time.h"
 #include "datalogger.h"
+#include "system/schedule.h"
 
 
 // Forward declaration of class
@@ -102,6 +103,20 @@ class CommandInterface
     void _setBurstNumber(int number);
     void _setStartUpDelay(int number);
     void _setBurstDelay(int number);
+    void _setFastBoot(bool enabled);
+    void _setHeartbeat(int minutes);
+    void _setStatusColumns(long mask);
+    void _setCircularLog(int segments);
+    void _setEnergyThresholds(const int * thresholds);
+    void _energyStatus();
+    void _setScheduleWindow(int index, const schedule_window_type * window);
+    void _clearScheduleWindow(int index);
+    void _showSchedule(short wakeCount);
+    void _setTrigger(int gpioIndex, int burstNumber);
+    void _triggerStatus();
+    void _wakeLatency();
+    void _powerProfile();
+    void _bleOffload(bool overSerial);
     
     void _setUserNote(char * note);
     void _setUserValue(int value);
@@ -133,6 +148,7 @@ class CommandInterface
 
   private:
     Datalogger * datalogger;
+    Stream * port;
     void * lastCommandPayload;
     bool lastCommandPayloadAllocated = false;
 };
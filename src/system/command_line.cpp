@@ -0,0 +1,357 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "command_line.h"
+
+#define CLI_PROMPT "CMD >> "
+
+static_assert(USART_RX_BUF_SIZE >= CLI_LINE_BUFFER_SIZE, "the USART receive ring must hold a whole line");
+
+typedef enum cli_state { cli_reading_line, cli_reading_payload, cli_discarding_payload } cli_state_type;
+
+static Stream * stream = NULL;
+static const cli_command * commands = NULL;
+static short commandCount = 0;
+
+static char line[CLI_LINE_BUFFER_SIZE];
+static int lineLength = 0;
+static bool lineOverflowed = false;
+static bool inputOverrun = false; // bytes of this line were lost
+static bool overrunPending = false; // the receive ring filled, bytes after the ones in it were lost
+static int bytesBeforeOverrun = 0;
+static char * args[CLI_MAX_ARGUMENTS + 1];
+static int argc = 0;
+static cli_state_type state = cli_reading_line;
+static int payloadStart = 0;
+static int payloadRemaining = 0;
+static int payloadLength = -1;
+static uint32 lastByteMillis = 0;
+
+void cliBegin(Stream * commandStream, const cli_command * table, short count)
+{
+  stream = commandStream;
+  commands = table;
+  commandCount = count;
+  lineLength = 0;
+  state = cli_reading_line;
+  stream->print(F(CLI_PROMPT));
+}
+
+static const cli_command * findCommand(const char * name)
+{
+  short low = 0;
+  short high = commandCount - 1;
+  while (low <= high)
+  {
+    short middle = (low + high) / 2;
+    int comparison = strcmp(name, commands[middle].name);
+    if (comparison == 0)
+    {
+      return &commands[middle];
+    }
+    if (comparison < 0)
+    {
+      high = middle - 1;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+  return NULL;
+}
+
+static int splitArguments(char * text)
+{
+  // splits in place
+  argc = 0;
+  char * p = text;
+  while (argc < CLI_MAX_ARGUMENTS)
+  {
+    while (*p == ' ' || *p == '\t')
+    {
+      p++;
+    }
+    if (*p == '\0')
+    {
+      break;
+    }
+
+    if (*p == '"')
+    {
+      // quoted, \" and \\ escape
+      args[argc++] = ++p;
+      char * out = p;
+      while (*p != '\0' && *p != '"')
+      {
+        if (*p == '\\' && p[1] != '\0')
+        {
+          p++;
+        }
+        *out++ = *p++;
+      }
+      if (*p == '"')
+      {
+        p++;
+      }
+      *out = '\0';
+      continue;
+    }
+
+    // plain, brackets and strings inside them keep spaces
+    args[argc++] = p;
+    short nesting = 0;
+    bool inString = false;
+    while (*p != '\0' && (nesting > 0 || inString || (*p != ' ' && *p != '\t')))
+    {
+      if (inString)
+      {
+        if (*p == '\\' && p[1] != '\0')
+        {
+          p++;
+        }
+        else if (*p == '"')
+        {
+          inString = false;
+        }
+      }
+      else if (*p == '"')
+      {
+        inString = nesting > 0;
+      }
+      else if (*p == '{' || *p == '[')
+      {
+        nesting++;
+      }
+      else if ((*p == '}' || *p == ']') && nesting > 0)
+      {
+        nesting--;
+      }
+      p++;
+    }
+    if (*p != '\0')
+    {
+      *p++ = '\0';
+    }
+  }
+  return argc;
+}
+
+static void dispatch()
+{
+  const cli_command * command = findCommand(args[0]);
+  if (command == NULL)
+  {
+    stream->println(F("Command not recognized."));
+  }
+  else
+  {
+    command->function(argc, args);
+  }
+}
+
+static void endPayload();
+
+static void endLine()
+{
+  stream->print(F("\r\n"));
+  line[lineLength] = '\0';
+
+  bool binary = line[0] == '!';
+  splitArguments(binary ? &line[1] : line);
+  if (inputOverrun)
+  {
+    stream->println(F("Serial input overrun, line dropped"));
+    inputOverrun = false;
+    lineOverflowed = false;
+    argc = 0;
+  }
+  if (lineOverflowed)
+  {
+    stream->println(F("Line too long"));
+    lineOverflowed = false;
+    argc = 0;
+  }
+  if (argc == 0)
+  {
+    lineLength = 0;
+    stream->print(F(CLI_PROMPT));
+    return;
+  }
+
+  if (!binary)
+  {
+    payloadLength = -1;
+    dispatch();
+    lineLength = 0;
+    stream->print(F(CLI_PROMPT));
+    return;
+  }
+
+  // binary header, the last argument is the payload length
+  long length = argc > 1 ? strtol(args[argc - 1], NULL, 10) : -1;
+  payloadStart = lineLength + 1;
+  if (length < 0 || payloadStart + length + 1 > CLI_LINE_BUFFER_SIZE)
+  {
+    stream->println(F("Invalid binary payload length"));
+    payloadRemaining = length > 0 ? length : 0;
+    state = payloadRemaining > 0 ? cli_discarding_payload : cli_reading_line;
+    lineLength = 0;
+    if (state == cli_reading_line)
+    {
+      stream->print(F(CLI_PROMPT));
+    }
+    return;
+  }
+  payloadLength = length;
+  payloadRemaining = length;
+  lineLength = payloadStart;
+  if (length == 0)
+  {
+    endPayload(); // no payload bytes to wait for
+    return;
+  }
+  state = cli_reading_payload;
+}
+
+static void endPayload()
+{
+  line[lineLength] = '\0';
+
+  // the header arguments still point into the line buffer ahead of the payload
+  args[argc - 1] = &line[payloadStart]; // payload replaces its length
+  dispatch();
+
+  payloadLength = -1;
+  lineLength = 0;
+  state = cli_reading_line;
+  stream->print(F(CLI_PROMPT));
+}
+
+static void overrun()
+{
+  if (state == cli_reading_payload)
+  {
+    stream->println(F("Serial input overrun, payload dropped"));
+    payloadLength = -1;
+    lineLength = 0;
+    state = cli_discarding_payload; // ends on its count, or on the payload timeout
+  }
+  else if (state == cli_reading_line)
+  {
+    inputOverrun = true;
+  }
+}
+
+void cliPoll()
+{
+  if (state != cli_reading_line && payloadRemaining > 0 && millis() - lastByteMillis > CLI_PAYLOAD_TIMEOUT)
+  {
+    stream->println(F("Binary payload timed out"));
+    payloadLength = -1;
+    lineLength = 0;
+    state = cli_reading_line;
+    stream->print(F(CLI_PROMPT));
+  }
+
+  if (!overrunPending && stream->available() >= USART_RX_BUF_SIZE - 1)
+  {
+    overrunPending = true;
+    bytesBeforeOverrun = stream->available();
+  }
+
+  while (stream->available() > 0)
+  {
+    if (overrunPending && bytesBeforeOverrun == 0)
+    {
+      overrunPending = false;
+      overrun(); // the next byte came after the lost ones
+    }
+    char c = stream->read();
+    lastByteMillis = millis();
+    if (bytesBeforeOverrun > 0)
+    {
+      bytesBeforeOverrun--;
+    }
+
+    if (state == cli_reading_payload || state == cli_discarding_payload)
+    {
+      if (state == cli_reading_payload && lineLength < CLI_LINE_BUFFER_SIZE - 1)
+      {
+        line[lineLength++] = c;
+      }
+      if (--payloadRemaining == 0)
+      {
+        if (state == cli_reading_payload)
+        {
+          endPayload();
+        }
+        else
+        {
+          state = cli_reading_line;
+          stream->print(F(CLI_PROMPT));
+        }
+      }
+      continue;
+    }
+
+    switch (c)
+    {
+    case '\r':
+    case '\n':
+      if (lineLength > 0)
+      {
+        endLine();
+      }
+      break;
+    case '\b':
+    case 0x7F:
+      if (lineLength > 0)
+      {
+        lineLength--;
+        stream->print(F("\b \b"));
+      }
+      break;
+    default:
+      if (lineLength < CLI_LINE_BUFFER_SIZE - 1)
+      {
+        line[lineLength++] = c;
+        stream->print(c);
+      }
+      else
+      {
+        lineOverflowed = true;
+      }
+      break;
+    }
+  }
+}
+
+void cliPrintCommands()
+{
+  for (short i = 0; i < commandCount; i++)
+  {
+    stream->println(commands[i].name);
+  }
+}
+
+int cliPayloadLength()
+{
+  return payloadLength;
+}
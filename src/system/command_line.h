@@ -0,0 +1,69 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_COMMAND_LINE
+#define WATERBEAR_COMMAND_LINE
+
+#include <Arduino.h>
+
+// line editing and dispatch for the serial CLI, replaces CmdArduino
+//
+// commands live in a const table sorted by name, checked at compile time with cliTableSorted(),
+// and are found by binary search. The line buffer is static, nothing is allocated per command.
+//
+// arguments are separated by spaces. "quoted arguments" may contain spaces, and an argument that
+// opens with { or [ runs to its balancing bracket, so JSON can be pasted with spaces in it.
+//
+// machine clients can send a length prefixed binary payload as the last argument:
+//   !set-slot-config 312\n<312 bytes>
+// the payload is not echoed and may contain newlines. Handlers get it as a NUL terminated
+// argument and can read its exact size from cliPayloadLength().
+//
+// the core's USART receive ring (USART_RX_BUF_SIZE, platformio.ini) holds a whole line, and
+// keeps its oldest bytes when full (USART_SAFE_INSERT). A full ring means bytes were lost:
+// the line or payload being read is dropped with a message instead of being run truncated.
+
+#define CLI_LINE_BUFFER_SIZE 1024
+#define CLI_MAX_ARGUMENTS 16
+#define CLI_PAYLOAD_TIMEOUT 1000 // ms without a byte before a binary payload is abandoned
+
+typedef void (*cli_command_function)(int arg_cnt, char **args);
+
+typedef struct
+{
+  const char * name;
+  cli_command_function function;
+} cli_command;
+
+constexpr int cliCompareNames(const char * a, const char * b)
+{
+  return *a != *b ? (*a < *b ? -1 : 1) : (*a == '\0' ? 0 : cliCompareNames(a + 1, b + 1));
+}
+
+constexpr bool cliTableSorted(const cli_command * table, int count)
+{
+  return count < 2 || (cliCompareNames(table[0].name, table[1].name) < 0 && cliTableSorted(table + 1, count - 1));
+}
+
+void cliBegin(Stream * stream, const cli_command * table, short count);
+void cliPoll(); // consumes everything available, dispatches complete lines
+void cliPrintCommands();
+int cliPayloadLength(); // size of the binary payload of the command being run, -1 without one
+
+#endif
@@ -0,0 +1,69 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "crc.h"
+#include <libmaple/rcc.h>
+#include "string.h"
+
+typedef struct crc_reg_map
+{
+  volatile uint32 DR;
+  volatile uint32 IDR;
+  volatile uint32 CR;
+} crc_reg_map;
+
+#define CRC_BASE ((crc_reg_map *)0x40023000)
+#define CRC_CR_RESET 0x1
+
+static bool crcClockEnabled = false;
+
+void enableHardwareCRC()
+{
+  rcc_clk_enable(RCC_CRC);
+  crcClockEnabled = true;
+}
+
+uint32 hardwareCRC32(const void * data, unsigned int length)
+{
+  if(!crcClockEnabled)
+  {
+    enableHardwareCRC();
+  }
+
+  CRC_BASE->CR = CRC_CR_RESET;
+
+  const uint8 * bytes = (const uint8 *) data;
+  unsigned int words = length / 4;
+  for(unsigned int i = 0; i < words; i++)
+  {
+    uint32 word;
+    memcpy(&word, &bytes[i * 4], 4); // compiles to a single load, tolerates unaligned buffers
+    CRC_BASE->DR = word;
+  }
+
+  unsigned int remainder = length % 4;
+  if(remainder > 0)
+  {
+    uint32 word = 0;
+    memcpy(&word, &bytes[words * 4], remainder);
+    CRC_BASE->DR = word;
+  }
+
+  return CRC_BASE->DR;
+}
@@ -0,0 +1,34 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_CRC
+#define WATERBEAR_CRC
+
+#include <Arduino.h>
+
+// CRC-32 computed by the STM32F1 hardware CRC unit.
+// The unit consumes 32 bit words (polynomial 0x04C11DB7, init 0xFFFFFFFF,
+// no reflection, no final xor), so data is fed as little endian words and a
+// trailing partial word is padded with zero bytes.
+// tools/verify_log_crc.py implements the same algorithm on the host.
+
+void enableHardwareCRC();
+uint32 hardwareCRC32(const void * data, unsigned int length);
+
+#endif
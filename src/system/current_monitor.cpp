@@ -0,0 +1,51 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "current_monitor.h"
+#include "utilities/i2c.h"
+
+bool INA219::begin()
+{
+  // 0x40 is also the hdc1080 address, only configure a device that reads back an INA219 configuration
+  byte reading[2];
+  if (!i2cReadBlock(&Wire, INA219_I2C_ADDRESS, INA219_CONFIGURATION_REGISTER, reading, 2))
+  {
+    return false;
+  }
+  unsigned short current = (reading[0] << 8) | reading[1];
+  if (current != INA219_CONFIGURATION_RESET && current != INA219_CONFIGURATION) // configured before a restart
+  {
+    return false;
+  }
+  byte configuration[3] = { INA219_CONFIGURATION_REGISTER, INA219_CONFIGURATION >> 8, INA219_CONFIGURATION & 0xFF };
+  return i2cWriteCommand(&Wire, INA219_I2C_ADDRESS, configuration, 3);
+}
+
+bool INA219::readMicroamps(long * microamps)
+{
+  // a single attempt, the profiler skips a failed read rather than retrying on the bus
+  byte reading[2];
+  if (!i2cReadBlock(&Wire, INA219_I2C_ADDRESS, INA219_SHUNT_VOLTAGE_REGISTER, reading, 2))
+  {
+    return false;
+  }
+  short shunt = (reading[0] << 8) | reading[1]; // signed, most significant byte first
+  *microamps = (long) shunt * INA219_SHUNT_MICROVOLTS_PER_BIT * 1000 / INA219_SHUNT_MILLIOHMS;
+  return true;
+}
@@ -0,0 +1,51 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_CURRENT_MONITOR
+#define WATERBEAR_CURRENT_MONITOR
+
+#include <Arduino.h>
+
+// Supply current monitor on the main board I2C bus, used by the phase profiler.
+class CurrentMonitor
+{
+public:
+  virtual bool begin() = 0; // false if no monitor is fitted
+  virtual bool readMicroamps(long * microamps) = 0; // false if the read failed
+};
+
+#define INA219_I2C_ADDRESS 0x40
+#define INA219_CONFIGURATION_REGISTER 0x00
+#define INA219_CONFIGURATION_RESET 0x399F // power on value, identifies the device
+#define INA219_SHUNT_VOLTAGE_REGISTER 0x01
+#define INA219_SHUNT_MILLIOHMS 100 // breakout boards fit a 0.1 ohm shunt
+#define INA219_SHUNT_MICROVOLTS_PER_BIT 10
+
+// 32V bus range, PGA /8 (320 mV shunt range), bus ADC 12 bit,
+// shunt ADC 128 sample average (68 ms per result), shunt and bus continuous
+#define INA219_CONFIGURATION 0x39FF
+
+class INA219 : public CurrentMonitor
+{
+public:
+  bool begin();
+  bool readMicroamps(long * microamps);
+};
+
+#endif
@@ -45,6 +45,45 @@ byte readEEPROM(TwoWire * wire, int deviceaddress, short eeaddress )
   return(rdata);
 }
 
+void readEEPROMBlock(int deviceaddress, short eeaddress, byte * data, int size)
+{
+  // sequential read, the EEPROM auto increments its address pointer
+  while(size > 0)
+  {
+    int chunk = size > EEPROM_READ_CHUNK_SIZE ? EEPROM_READ_CHUNK_SIZE : size;
+    i2cSendTransmission(deviceaddress, eeaddress, 0, 0);
+
+    int received = Wire.requestFrom(deviceaddress, chunk);
+    for(int i = 0; i < chunk; i++)
+    {
+      data[i] = i < received ? Wire.read() : EEPROM_RESET_VALUE;
+    }
+
+    data += chunk;
+    eeaddress += chunk;
+    size -= chunk;
+  }
+}
+
+void writeEEPROMPage(int deviceaddress, short eeaddress, const byte * data, int size)
+{
+  // one write cycle for the whole page, bytes in order (i2cSendTransmission reverses multi byte values)
+  short rval = -1;
+  while (rval != 0)
+  {
+    Wire.beginTransmission(deviceaddress);
+    Wire.write((byte) eeaddress);
+    Wire.write(data, size);
+    rval = Wire.endTransmission();
+    if(rval != 0)
+    {
+      i2cError(rval);
+      delay(5); // still busy with a previous write cycle
+    }
+  }
+  delay(5);
+}
+
 // void readDeploymentIdentifier(char * deploymentIdentifier)
 // {
 //   for(short i=0; i < DEPLOYMENT_IDENTIFIER_LENGTH; i++)
@@ -66,11 +105,7 @@ byte readEEPROM(TwoWire * wire, int deviceaddress, short eeaddress )
 
 void readObjectFromEEPROM(short i2cAddress, short address, void * data, uint8_t size)
 {
-  byte * buffer = (byte *) data;
-  for (uint8_t i = 0; i < size; i++)
-  {
-    buffer[i] = readEEPROM(&Wire, i2cAddress, address+i);
-  }
+  readEEPROMBlock(i2cAddress, address, (byte *) data, size);
 }
 
 
@@ -122,11 +157,7 @@ void readSensorConfigurationFromEEPROM(short slot, void * configuration)
 
 void readUniqueId(unsigned char * uuid)
 {
-  for(int i=0; i < UUID_LENGTH; i++)
-  {
-    unsigned int address = EEPROM_UUID_ADDRESS_START + i;
-    uuid[i] = readEEPROM(&Wire, EEPROM_I2C_ADDRESS, address);
-  }
+  readEEPROMBlock(EEPROM_I2C_ADDRESS, EEPROM_UUID_ADDRESS_START, uuid, UUID_LENGTH);
 
   debug(F("UUID in EEPROM:")); // TODO: need to create another function and read from flash  
 
@@ -184,10 +215,7 @@ void writeEEPROMBytes(short address, unsigned char * data, uint8_t size) // Litt
 
 void readEEPROMBytes(short address, unsigned char * data, uint8_t size) // Little Endian
 {
-  for (uint8_t i = 0; i < size; i++)
-  {
-    data[i] = readEEPROM(&Wire, EEPROM_I2C_ADDRESS, address+i);
-  }
+  readEEPROMBlock(EEPROM_I2C_ADDRESS, address, data, size);
 }
 
 
@@ -33,11 +33,16 @@
 #define EEPROM_DATALOGGER_CONFIGURATION_START 16
 #define EEPROM_DATALOGGER_CONFIGURATION_SIZE 64
 #define EEPROM_DATALOGGER_SENSORS_START 80
+#define EEPROM_SCHEDULE_START 128 // sampling schedule windows, to the end of the first block
 #define EEPROM_DATALOGGER_SENSOR_SIZE 64
 #define EEPROM_TOTAL_SENSOR_SLOTS 4 // can be 12
+#define EEPROM_READ_CHUNK_SIZE 32 // Wire buffer length
+#define EEPROM_PAGE_SIZE 16
 
 void writeEEPROM(TwoWire * wire, int deviceaddress, short eeaddress, byte data );
 byte readEEPROM(TwoWire * wire, int deviceaddress, short eeaddress );
+void readEEPROMBlock(int deviceaddress, short eeaddress, byte * data, int size); // sequential read
+void writeEEPROMPage(int deviceaddress, short eeaddress, const byte * data, int size); // size <= EEPROM_PAGE_SIZE, must not cross a page
 
 void readUniqueId(unsigned char * uuid); // uuid must point to char[UUID_LENGTH]
 
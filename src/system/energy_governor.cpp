@@ -0,0 +1,180 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "energy_governor.h"
+#include "hardware.h"
+
+void EnergyGovernor::configure(const byte * thresholds)
+{
+  memcpy(this->thresholds, thresholds, ENERGY_THRESHOLD_COUNT);
+}
+
+int EnergyGovernor::threshold(short level)
+{
+  if(level < 1 || level > ENERGY_THRESHOLD_COUNT)
+  {
+    return 0;
+  }
+  byte value = thresholds[level - 1];
+  if(value == 0 || value == 0xFF)
+  {
+    return 0;
+  }
+  return value * ENERGY_THRESHOLD_UNIT;
+}
+
+int EnergyGovernor::readBattery()
+{
+  long sum = 0;
+  for(short i = 0; i < ENERGY_BATTERY_SAMPLES; i++)
+  {
+    sum += getBatteryValue();
+  }
+  return sum / ENERGY_BATTERY_SAMPLES;
+}
+
+bool EnergyGovernor::update(int batteryValue)
+{
+  if(smoothed < 0)
+  {
+    smoothed = (long) batteryValue << ENERGY_SMOOTHING_SHIFT;
+  }
+  else
+  {
+    smoothed += batteryValue - (smoothed >> ENERGY_SMOOTHING_SHIFT);
+  }
+
+  int battery = getSmoothedBattery();
+  if(battery > highestSeen)
+  {
+    highestSeen = battery;
+  }
+
+  short target = energy_normal;
+  for(short l = 1; l < ENERGY_LEVEL_COUNT; l++)
+  {
+    int t = threshold(l);
+    if(t > 0 && battery < t)
+    {
+      target = l;
+    }
+  }
+
+  short next = level;
+  if(target > level)
+  {
+    next = target;
+  }
+  else
+  {
+    // only step back up once the battery is clear of the threshold that was crossed
+    while(next > target && (threshold(next) == 0 || battery > threshold(next) + ENERGY_HYSTERESIS_COUNTS))
+    {
+      next--;
+    }
+  }
+
+  previousLevel = level;
+  level = (energy_level_type) next;
+  return level != previousLevel;
+}
+
+void EnergyGovernor::restoreLevel(energy_level_type level)
+{
+  if(level >= ENERGY_LEVEL_COUNT)
+  {
+    return;
+  }
+  this->level = level;
+  previousLevel = level;
+}
+
+energy_level_type EnergyGovernor::getLevel()
+{
+  return level;
+}
+
+energy_level_type EnergyGovernor::getPreviousLevel()
+{
+  return previousLevel;
+}
+
+int EnergyGovernor::getSmoothedBattery()
+{
+  return smoothed < 0 ? 0 : smoothed >> ENERGY_SMOOTHING_SHIFT;
+}
+
+// estimate between the last gasp threshold and the highest smoothed reading since boot
+int EnergyGovernor::getRemainingCapacityPercent()
+{
+  int empty = threshold(energy_last_gasp);
+  int full = highestSeen;
+  if(full <= empty)
+  {
+    return 0;
+  }
+  long percent = (long)(getSmoothedBattery() - empty) * 100 / (full - empty);
+  return constrain(percent, 0, 100);
+}
+
+unsigned short EnergyGovernor::getIntervalMultiplier()
+{
+  return level >= energy_long_interval ? ENERGY_INTERVAL_MULTIPLIER : 1;
+}
+
+bool EnergyGovernor::rawLoggingAllowed()
+{
+  return level < energy_no_raw;
+}
+
+bool EnergyGovernor::multipleBurstsAllowed()
+{
+  return level < energy_single_burst;
+}
+
+bool EnergyGovernor::nonEssentialSlotsAllowed()
+{
+  return level < energy_essential_only;
+}
+
+bool EnergyGovernor::inLastGasp()
+{
+  return level >= energy_last_gasp;
+}
+
+const char * energyLevelName(energy_level_type level)
+{
+  switch(level)
+  {
+  case energy_normal:
+    return "normal";
+  case energy_long_interval:
+    return "long_interval";
+  case energy_no_raw:
+    return "no_raw";
+  case energy_single_burst:
+    return "single_burst";
+  case energy_essential_only:
+    return "essential_only";
+  case energy_last_gasp:
+    return "last_gasp";
+  default:
+    return "unknown";
+  }
+}
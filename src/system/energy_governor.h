@@ -0,0 +1,81 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_ENERGY_GOVERNOR
+#define WATERBEAR_ENERGY_GOVERNOR
+
+#include <Arduino.h>
+
+// Steps the logging schedule down as the battery drains so core data keeps
+// being produced for as long as possible.  Levels are cumulative.
+typedef enum energy_level
+{
+  energy_normal,
+  energy_long_interval,   // interval multiplied by ENERGY_INTERVAL_MULTIPLIER
+  energy_no_raw,          // burst summaries only
+  energy_single_burst,    // one burst per cycle
+  energy_essential_only,  // slots marked non essential are not measured
+  energy_last_gasp        // flush, close files and enter standby
+} energy_level_type;
+
+#define ENERGY_LEVEL_COUNT 6
+#define ENERGY_THRESHOLD_COUNT (ENERGY_LEVEL_COUNT - 1)
+#define ENERGY_THRESHOLD_UNIT 16         // thresholds are stored as battery ADC counts / 16
+#define ENERGY_HYSTERESIS_COUNTS 40      // battery must recover this far above a threshold to step back up
+#define ENERGY_INTERVAL_MULTIPLIER 2
+#define ENERGY_SMOOTHING_SHIFT 2         // exponential moving average weight 1/4 per cycle
+#define ENERGY_BATTERY_SAMPLES 8
+#define ENERGY_LAST_GASP_RECHECK_SECONDS 3600
+
+class EnergyGovernor
+{
+public:
+  // thresholds[i] is the battery level (in ENERGY_THRESHOLD_UNIT counts) below which level i+1 applies,
+  // 0 or 0xFF disables that level
+  void configure(const byte * thresholds);
+
+  // feed one battery reading per cycle, returns true when the level changed
+  bool update(int batteryValue);
+  void restoreLevel(energy_level_type level); // the level before a restart, so hysteresis applies to the first reading
+  int readBattery(); // averaged raw battery reading
+
+  energy_level_type getLevel();
+  energy_level_type getPreviousLevel();
+  int getSmoothedBattery();
+  int getRemainingCapacityPercent();
+
+  unsigned short getIntervalMultiplier();
+  bool rawLoggingAllowed();
+  bool multipleBurstsAllowed();
+  bool nonEssentialSlotsAllowed();
+  bool inLastGasp();
+
+private:
+  int threshold(short level); // in counts, 0 if disabled
+
+  byte thresholds[ENERGY_THRESHOLD_COUNT] = {0};
+  long smoothed = -1; // counts << ENERGY_SMOOTHING_SHIFT, -1 before the first reading
+  int highestSeen = 0;
+  energy_level_type level = energy_normal;
+  energy_level_type previousLevel = energy_normal;
+};
+
+const char * energyLevelName(energy_level_type level);
+
+#endif
@@ -28,6 +28,8 @@ WaterBear_FileSystem::WaterBear_FileSystem(char * loggingFolder, int chipSelectP
 {
   strcpy(this->loggingFolder, loggingFolder);
   this->chipSelectPin = chipSelectPin;
+  summaryFile.fileSystem = this;
+  rawFile.fileSystem = this;
   this->initializeSDCard();
  
   this->setLoggingFolder(loggingFolder);
@@ -68,27 +70,35 @@ void WaterBear_FileSystem::initializeSDCard(){
   }
 }
 
-void WaterBear_FileSystem::writeString(const char * string)
+void LogFile::writeString(const char * string)
 {
   // notify("printing to log file");
   // notify((int)strlen(string));
   // notify(string);
-  this->logfile.print(string);
+  this->file.print(string);
 }
 
-void WaterBear_FileSystem::endOfLine()
+void WaterBear_FileSystem::setMetadataSource(FileMetadataSource * source)
 {
-  this->logfile.println();
-  this->logfile.flush();
+  metadataSource = source;
 }
 
+OutputDevice * WaterBear_FileSystem::getSummaryOutput()
+{
+  return &summaryFile;
+}
+
+OutputDevice * WaterBear_FileSystem::getRawOutput()
+{
+  return &rawFile;
+}
 
 void WaterBear_FileSystem::writeDebugMessage(const char* message)
 {
-  this->logfile.print("debug,");
-  this->logfile.print(message);
-  this->logfile.println();
-  this->logfile.flush();
+  this->summaryFile.file.print("debug,");
+  this->summaryFile.file.print(message);
+  this->summaryFile.file.println();
+  this->summaryFile.file.flush();
 }
 
 void WaterBear_FileSystem::dumpLoggedDataToStream(Stream * myStream, char * lastFileNameSent)
@@ -192,7 +202,7 @@ void WaterBear_FileSystem::setLoggingFolder(char *newLoggingFolder)
   strcpy(loggingFolder, newLoggingFolder);
 }
 
-bool WaterBear_FileSystem::openFile(char * filename)
+bool WaterBear_FileSystem::changeToLoggingFolder()
 {
   this->sd.chdir("/");
   printCurrentDirListing();
@@ -224,21 +234,27 @@ bool WaterBear_FileSystem::openFile(char * filename)
   {
     notify("failed:");
     notify(loggingFolder);
+    return false;
   }
   // else
   // {
   //   Serial2.print("cd:");
   //   notify(loggingFolder);
   // }
+  return true;
+}
 
+bool WaterBear_FileSystem::openFile(LogFile * logFile)
+{
+  changeToLoggingFolder();
 
   notify("Opening file");
-  notify(filename);
-  this->logfile = this->sd.open(filename, FILE_WRITE); //O_CREAT | O_WRITE | O_APPEND);
+  notify(logFile->filename);
+  logFile->file = this->sd.open(logFile->filename, FILE_WRITE); //O_CREAT | O_WRITE | O_APPEND);
   notify("Opened");
 
   //sd.chdir();
-  if(!logfile)
+  if(!logFile->file)
   {
     notify(F(">not found<"));
     return false;
@@ -250,12 +266,35 @@ bool WaterBear_FileSystem::openFile(char * filename)
 
 void WaterBear_FileSystem::setNewDataFile(long unixtime, char * header)
 {
+  if(circularSegments > 0)
+  {
+    strcpy(this->header, header);
+
+    // continue after the newest segment, in place of the oldest
+    unsigned char oldest = 0;
+    unsigned long oldestSequence = 0xFFFFFFFF;
+    unsigned long newestSequence = 0;
+    for(unsigned char i = 0; i < circularSegments; i++)
+    {
+      unsigned long sequence = readSegmentSequence(i); // 0 if not written yet
+      if(sequence < oldestSequence)
+      {
+        oldestSequence = sequence;
+        oldest = i;
+      }
+      if(sequence > newestSequence)
+      {
+        newestSequence = sequence;
+      }
+    }
+    startSegment(oldest, newestSequence + 1, unixtime);
+    return;
+  }
 
-  char uniquename[11];
-  sprintf(uniquename, "%lu", unixtime);
-  char suffix[5] = ".CSV";
-  strncpy(filename, uniquename, 10);
-  strncpy(&filename[10], suffix, 5);
+  summaryFile.capacity = 0;
+  rawFile.capacity = 0;
+  sprintf(summaryFile.filename, "%lu.CSV", unixtime);
+  sprintf(rawFile.filename, "%lu" RAW_FILE_SUFFIX ".CSV", unixtime);
 
   notify("cd");
   this->sd.chdir("/");
@@ -264,21 +303,33 @@ void WaterBear_FileSystem::setNewDataFile(long unixtime, char * header)
   notify(header);
   strcpy(this->header, header);
 
-  bool success = this->openFile(filename);
+  bool success = this->openFile(&summaryFile) && this->openFile(&rawFile);
   if( !success )
   {
     Serial2.print(F("filesystem open failure"));
     while(1);
   }
 
-  // TODO: add datalogger/slot settings as formatted header, prefaced with #
-
-  this->logfile.println(header); // write the headers to the new logfile
-  // this->logfile.flush();
+  writeFileHeader(&summaryFile, "raw", &rawFile);
+  writeFileHeader(&rawFile, "summary", &summaryFile);
   //Serial2.print("wrote:");
   //notify(ret);
 }
 
+void WaterBear_FileSystem::writeFileHeader(LogFile * logFile, const char * otherFileType, LogFile * otherFile)
+{
+  logFile->file.print("#");
+  logFile->file.print(otherFileType);
+  logFile->file.print("_file,");
+  logFile->file.println(otherFile->filename);
+  logFile->file.println(header); // write the headers to the new logfile
+  if (metadataSource != NULL)
+  {
+    metadataSource->writeFileMetadata(&logFile->file);
+  }
+  // logFile->file.flush();
+}
+
 void WaterBear_FileSystem::printCurrentDirListing()
 {
   debug("dir");
@@ -297,8 +348,14 @@ void WaterBear_FileSystem::printCurrentDirListing()
 void WaterBear_FileSystem::closeFileSystem()
 {
   Serial2.print(F("Close filesystem"));
-  //this->logfile.sync();
-  this->logfile.close(); // syncs then closes
+  if(summaryFile.capacity > 0)
+  {
+    summaryFile.writeSegmentHeader();
+    rawFile.writeSegmentHeader();
+  }
+  //this->summaryFile.file.sync();
+  this->summaryFile.file.close(); // syncs then closes
+  this->rawFile.file.close();
   //this->sd.end // doesn't exist
 }
 
@@ -306,7 +363,15 @@ void WaterBear_FileSystem::reopenFileSystem()
 {
 
   initializeSDCard();
-  bool success = this->openFile(filename);
+  bool success;
+  if(summaryFile.capacity > 0)
+  {
+    success = reopenSegmentFile(&summaryFile) && reopenSegmentFile(&rawFile);
+  }
+  else
+  {
+    success = this->openFile(&summaryFile) && this->openFile(&rawFile);
+  }
   if( !success )
   {
     debug(F("Reopen file failed"));
@@ -321,4 +386,217 @@ void WaterBear_FileSystem::reopenFileSystem()
     debug(F("Reopen file succeeded"));
   }
 
-}
\ No newline at end of file
+}
+void WaterBear_FileSystem::setCircularSegments(unsigned char segments)
+{
+  if(segments > MAX_CIRCULAR_SEGMENTS)
+  {
+    segments = MAX_CIRCULAR_SEGMENTS;
+  }
+  circularSegments = segments == 1 ? 2 : segments; // one segment would overwrite itself
+}
+
+void LogFile::beginBlock(unsigned int length)
+{
+  if(capacity == 0)
+  {
+    return;
+  }
+  lastTime = timestamp();
+  if(file.curPosition() + length > capacity)
+  {
+    fileSystem->nextSegment(lastTime);
+  }
+}
+
+void LogFile::writeSegmentHeader()
+{
+  unsigned long position = file.curPosition();
+  if(position < SEGMENT_HEADER_SIZE)
+  {
+    position = SEGMENT_HEADER_SIZE;
+  }
+
+  char line[SEGMENT_HEADER_SIZE + 1];
+  int length = sprintf(line, "#segment,%lu,%lu,%lu,%lu,%lu", sequence, firstTime, lastTime, position, capacity);
+  memset(&line[length], ' ', SEGMENT_HEADER_SIZE - 1 - length);
+  line[SEGMENT_HEADER_SIZE - 1] = '\n';
+  line[SEGMENT_HEADER_SIZE] = '\0';
+
+  file.seekSet(0);
+  file.print(line);
+  file.seekSet(position);
+}
+
+bool LogFile::readSegmentHeader(unsigned long * length)
+{
+  char line[SEGMENT_HEADER_SIZE + 1];
+  file.seekSet(0);
+  if(file.read(line, SEGMENT_HEADER_SIZE) != SEGMENT_HEADER_SIZE)
+  {
+    return false;
+  }
+  line[SEGMENT_HEADER_SIZE] = '\0';
+  return sscanf(line, "#segment,%lu,%lu,%lu,%lu,%lu", &sequence, &firstTime, &lastTime, length, &capacity) == 5;
+}
+
+unsigned long WaterBear_FileSystem::readSegmentSequence(unsigned char index)
+{
+  if(!changeToLoggingFolder())
+  {
+    return 0;
+  }
+
+  LogFile segment;
+  sprintf(segment.filename, SEGMENT_FILE_FORMAT ".CSV", index);
+  if(!this->sd.exists(segment.filename))
+  {
+    return 0;
+  }
+  segment.file = this->sd.open(segment.filename, O_READ);
+  unsigned long length;
+  bool valid = segment.file && segment.readSegmentHeader(&length);
+  segment.file.close();
+  return valid ? segment.sequence : 0;
+}
+
+unsigned long WaterBear_FileSystem::segmentPairCapacity()
+{
+  // share the free space between the segments not created yet, keeping a tenth of the card spare
+  unsigned char missing = 0;
+  for(unsigned char i = 0; i < circularSegments; i++)
+  {
+    char summaryFilename[20];
+    char rawFilename[20];
+    sprintf(summaryFilename, SEGMENT_FILE_FORMAT ".CSV", i);
+    sprintf(rawFilename, SEGMENT_FILE_FORMAT RAW_FILE_SUFFIX ".CSV", i);
+    if(!this->sd.exists(summaryFilename) || !this->sd.exists(rawFilename))
+    {
+      missing++;
+    }
+  }
+  if(missing == 0)
+  {
+    missing = 1;
+  }
+
+  notify(F("measuring free space"));
+  unsigned long long freeBytes = (unsigned long long) this->sd.vol()->freeClusterCount() * this->sd.vol()->blocksPerCluster() * 512;
+  unsigned long long capacity = freeBytes / 10 * 9 / missing;
+  if(capacity > 0xFFFFFFFE)
+  {
+    capacity = 0xFFFFFFFE; // FAT32 file size limit, for the pair
+  }
+  return (unsigned long) capacity;
+}
+
+// quarters is this file's share of the segment pair, pairCapacity is measured on first need
+bool WaterBear_FileSystem::openSegmentFile(LogFile * logFile, unsigned char quarters, unsigned long * pairCapacity, unsigned long sequence, unsigned long unixtime)
+{
+  if(!changeToLoggingFolder())
+  {
+    return false;
+  }
+
+  bool exists = this->sd.exists(logFile->filename);
+  logFile->file = this->sd.open(logFile->filename, O_RDWR | O_CREAT);
+  if(!logFile->file)
+  {
+    notify(F(">not found<"));
+    return false;
+  }
+
+  unsigned long length;
+  if(!exists || !logFile->readSegmentHeader(&length))
+  {
+    // new segment, allocate it contiguously once so writes never wait on the FAT
+    if(*pairCapacity == 0)
+    {
+      *pairCapacity = segmentPairCapacity();
+    }
+    logFile->file.truncate(0);
+    logFile->capacity = *pairCapacity / 4 * quarters;
+    if(!logFile->file.preAllocate(logFile->capacity))
+    {
+      notify(F("preallocate failed, segment will grow"));
+    }
+  }
+
+  logFile->sequence = sequence;
+  logFile->firstTime = unixtime;
+  logFile->lastTime = unixtime;
+  logFile->file.seekSet(0);
+  logFile->writeSegmentHeader();
+  return true;
+}
+
+bool WaterBear_FileSystem::reopenSegmentFile(LogFile * logFile)
+{
+  if(!changeToLoggingFolder())
+  {
+    return false;
+  }
+
+  logFile->file = this->sd.open(logFile->filename, O_RDWR);
+  unsigned long length;
+  if(!logFile->file || !logFile->readSegmentHeader(&length))
+  {
+    return false;
+  }
+  return logFile->file.seekSet(length);
+}
+
+void WaterBear_FileSystem::startSegment(unsigned char index, unsigned long sequence, unsigned long unixtime)
+{
+  currentSegment = index;
+  sprintf(summaryFile.filename, SEGMENT_FILE_FORMAT ".CSV", index);
+  sprintf(rawFile.filename, SEGMENT_FILE_FORMAT RAW_FILE_SUFFIX ".CSV", index);
+  notify(summaryFile.filename);
+
+  // raw rows are about three times the volume of summary rows
+  unsigned long pairCapacity = 0;
+  bool success = openSegmentFile(&summaryFile, 1, &pairCapacity, sequence, unixtime)
+    && openSegmentFile(&rawFile, 3, &pairCapacity, sequence, unixtime);
+  if( !success )
+  {
+    Serial2.print(F("filesystem open failure"));
+    while(1);
+  }
+
+  writeFileHeader(&summaryFile, "raw", &rawFile);
+  writeFileHeader(&rawFile, "summary", &summaryFile);
+}
+
+void WaterBear_FileSystem::nextSegment(unsigned long unixtime)
+{
+  unsigned long sequence = summaryFile.sequence + 1;
+  summaryFile.writeSegmentHeader();
+  rawFile.writeSegmentHeader();
+  summaryFile.file.close();
+  rawFile.file.close();
+  startSegment((currentSegment + 1) % circularSegments, sequence, unixtime);
+}
+
+bool WaterBear_FileSystem::openNextDataFile(FatFile * file, bool first)
+{
+  // the working directory is still the logging folder
+  if(first)
+  {
+    sd.vwd()->rewind();
+  }
+  while(file->openNext(sd.vwd(), O_READ))
+  {
+    if(!file->isDir())
+    {
+      return true;
+    }
+    file->close();
+  }
+  return false;
+}
+
+bool WaterBear_FileSystem::openDataFile(const char * filename, File * file)
+{
+  *file = sd.open(filename, FILE_READ);
+  return *file;
+}
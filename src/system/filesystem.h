@@ -23,20 +23,79 @@
 #include "DS3231.h"
 #include "write_cache.h"
 
-class WaterBear_FileSystem : public OutputDevice
+#define RAW_FILE_SUFFIX "_RAW"
+#define DATA_FILE_HEADER_SIZE 640 // column header line shared by the summary and raw files
+
+// circular logging, see setCircularSegments
+#define SEGMENT_FILE_FORMAT "SEG%02u"
+#define SEGMENT_HEADER_SIZE 80 // fixed width so the header can be rewritten in place
+#define MAX_CIRCULAR_SEGMENTS 64
+
+class WaterBear_FileSystem;
+
+// writes '#' comment lines between the column header and the first row of each new file or segment
+class FileMetadataSource
+{
+  public:
+    virtual void writeFileMetadata(Print * output) = 0;
+};
+
+// one output stream of the logger, summary or raw rows
+class LogFile : public OutputDevice
+{
+  public:
+    File file;
+    char filename[20];
+    WaterBear_FileSystem * fileSystem = NULL;
+
+    // circular segment state, capacity is 0 for an ordinary growing file
+    unsigned long capacity = 0;
+    unsigned long sequence = 0;
+    unsigned long firstTime = 0;
+    unsigned long lastTime = 0;
+
+    void writeString(const char * string);
+    void beginBlock(unsigned int length);
+    bool readSegmentHeader(unsigned long * length);
+    void writeSegmentHeader();
+};
+
+// Summary and raw rows go to separate files sharing a name stem and the column header:
+//   <unixtime>.CSV      summary rows, debug messages
+//   <unixtime>_RAW.CSV  raw rows
+// each file names the other in a comment above the header, the metadata source (if set) writes
+// its comment lines below the header.
+//
+// In circular mode the pair is instead one of a fixed set of preallocated segments
+//   SEG<nn>.CSV, SEG<nn>_RAW.CSV
+// written in turn, overwriting the oldest.  Each segment starts with a fixed width line
+//   #segment,<sequence>,<first unixtime>,<last unixtime>,<valid length>,<capacity>
+// bytes past the valid length are left over from earlier use of the segment.
+class WaterBear_FileSystem
 {
 
 private:
   // File system object.
   SdFat sd;
-  File logfile;
+  LogFile summaryFile;
+  LogFile rawFile;
   int chipSelectPin;
-  char filename[15];
   char loggingFolder[29];
-  char header[200];
+  char header[DATA_FILE_HEADER_SIZE];
+  unsigned char circularSegments = 0;
+  unsigned char currentSegment = 0;
+  FileMetadataSource * metadataSource = NULL;
 
   void printCurrentDirListing();
-  bool openFile(char * filename);
+  bool changeToLoggingFolder();
+  bool openFile(LogFile * logFile);
+  void writeFileHeader(LogFile * logFile, const char * otherFileType, LogFile * otherFile);
+
+  void startSegment(unsigned char index, unsigned long sequence, unsigned long unixtime);
+  bool openSegmentFile(LogFile * logFile, unsigned char quarters, unsigned long * pairCapacity, unsigned long sequence, unsigned long unixtime);
+  bool reopenSegmentFile(LogFile * logFile);
+  unsigned long readSegmentSequence(unsigned char index);
+  unsigned long segmentPairCapacity();
 
 
 public:
@@ -48,8 +107,16 @@ public:
   void dumpLoggedDataToStream(Stream * myStream, char * lastFileNameSent);
   void closeFileSystem(); // close filesystem when sleeping
   void reopenFileSystem(); // reopen filesystem after wakeup
-  void writeString(const char * string);
-  void endOfLine();
+  OutputDevice * getSummaryOutput();
+  OutputDevice * getRawOutput();
+
+  void setMetadataSource(FileMetadataSource * source);
+  void setCircularSegments(unsigned char segments); // 0 for ordinary files, applies from the next setNewDataFile
+  void nextSegment(unsigned long unixtime);
+
+  // read access to the logging folder for offloading, between closeFileSystem and reopenFileSystem
+  bool openNextDataFile(FatFile * file, bool first);
+  bool openDataFile(const char * filename, File * file);
 
 };
 
@@ -35,11 +35,12 @@ void gpioPinOn(uint8 pin)
 void startSerial2()
 {
   // Start up Serial2
-  // TODO: Need to do an if(Serial2) after an amount of time, just disable it
+  // bounded wait, a USART is ready immediately and boot must not stall without a console
   Serial2.begin(SERIAL_BAUD);
-  while (!Serial2)
+  uint32 start = millis();
+  while (!Serial2 && millis() - start < 100)
   {
-    delay(100);
+    delay(1);
   }
   notify(F("Begin Serial2"));
 }
@@ -82,6 +83,9 @@ void setupHardwarePins()
 
   pinMode(PC5, OUTPUT); // external ADC reset
   digitalWrite(PC5, HIGH);
+
+  pinMode(BLUEFRUIT_SPI_RST, OUTPUT); // Bluefruit radio held in reset outside offload sessions
+  digitalWrite(BLUEFRUIT_SPI_RST, LOW);
 }
 
 int getBatteryValue()
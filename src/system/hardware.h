@@ -64,7 +64,7 @@
 #define BLUEFRUIT_SPI_SCK   PB13
 #define BLUEFRUIT_SPI_MISO  PB14
 #define BLUEFRUIT_SPI_MOSI  PB15
-//#define BLUEFRUIT_SPI_CS    PB8  // Pullup
+#define BLUEFRUIT_SPI_CS    PB12 // SPI2 NSS, shared with GPIO_PIN_4
 #define BLUEFRUIT_SPI_IRQ   PB9
 #define BLUEFRUIT_SPI_RST   PC4
 
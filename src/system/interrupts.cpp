@@ -20,8 +20,27 @@
 #include <RTClock.h>
 #include "monitor.h"
 #include "system/logs.h"
+#include "clock.h"
+#include "interrupts.h"
+
+RingBuffer<wake_event_type, WAKE_EVENT_QUEUE_SIZE, true> wakeEvents[WAKE_SOURCE_COUNT];
+
+void queueWakeEvent(wake_source_type source)
+{
+  wake_event_type * event = wakeEvents[source].reserve();
+  event->source = source;
+  event->epochMilliseconds = internalRTCEpochMilliseconds();
+  wakeEvents[source].commit();
+}
+
+void clearWakeEvents()
+{
+  for (short i = 0; i < WAKE_SOURCE_COUNT; i++)
+  {
+    wakeEvents[i].clear();
+  }
+}
 
-bool awakenedByUser = false;
 void clearManualWakeInterrupt()
 {
   EXTI_BASE->PR = 0x00000080; // this clear the interrupt on exti line
@@ -42,7 +61,7 @@ void handleManualWakeInterrupt()
 {
   disableManualWakeInterrupt();
   clearManualWakeInterrupt();
-  awakenedByUser = true;
+  queueWakeEvent(wake_user);
 }
 
 
@@ -52,7 +71,7 @@ void setupManualWakeInterrupts()
   debug("setup manual wake int");
 
   // Set up interrupts
-  awakenedByUser = false;
+  clearWakeEvents();
 
   exti_attach_interrupt(EXTI7, EXTI_PC, handleManualWakeInterrupt, EXTI_FALLING);
 
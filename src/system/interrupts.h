@@ -19,6 +19,20 @@
 #ifndef WATERBEAR_INTERRUPTS
 #define WATERBEAR_INTERRUPTS
 
+#include "utilities/ring_buffer.h"
+
+// wake sources, queued with their time by the ISRs and drained by the main loop
+typedef enum wake_source { wake_user, wake_alarm } wake_source_type;
+#define WAKE_SOURCE_COUNT 2
+
+typedef struct wake_event
+{
+  wake_source_type source;
+  unsigned long long epochMilliseconds; // internal RTC time base
+} wake_event_type;
+
+#define WAKE_EVENT_QUEUE_SIZE 8
+
 void clearManualWakeInterrupt();
 void disableManualWakeInterrupt();
 void enableManualWakeInterrupt();
@@ -35,6 +49,12 @@ void clearAllPendingInterrupts();
 void storeAllInterrupts(int& iser1, int& iser2, int& iser3);
 void reenableAllInterrupts(int iser1, int iser2, int iser3);
 
-extern bool awakenedByUser;
+// RingBuffer has a single producer, so each source has its own queue and
+// queueWakeEvent(source) must only be called from that source's ISR:
+// wake_user from the EXTI7 button ISR, wake_alarm from the RTC alarm ISR
+void queueWakeEvent(wake_source_type source);
+void clearWakeEvents();
+
+extern RingBuffer<wake_event_type, WAKE_EVENT_QUEUE_SIZE, true> wakeEvents[WAKE_SOURCE_COUNT]; // keep the newest when full
 
 #endif
@@ -0,0 +1,221 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "journal.h"
+#include "eeprom.h"
+#include "crc.h"
+#include "logs.h"
+
+#define JOURNAL_CRC_LENGTH (JOURNAL_RECORD_SIZE - sizeof(unsigned short))
+
+static_assert(sizeof(journal_record_type) == JOURNAL_RECORD_SIZE, "journal records must fill one EEPROM page");
+
+typedef struct journal_entry
+{
+  journal_record_type record;
+  byte region;
+} journal_entry_type;
+
+static const byte regionAddresses[2] = { JOURNAL_REGION_A_I2C_ADDRESS, JOURNAL_REGION_B_I2C_ADDRESS };
+
+static journal_entry_type entries[JOURNAL_MAX_KEYS];
+static unsigned short entryCount = 0;
+static byte activeRegion = 0;
+static unsigned short nextRecord = 0; // index in the active region
+static unsigned short nextSequence = 0;
+static bool replayed = false;
+
+static bool sequenceAfter(unsigned short a, unsigned short b)
+{
+  return (short)(a - b) > 0;
+}
+
+static unsigned short recordCRC(const journal_record_type * record)
+{
+  return (unsigned short) hardwareCRC32(record, JOURNAL_CRC_LENGTH);
+}
+
+static bool recordValid(const journal_record_type * record)
+{
+  return record->key != 0xFF
+      && record->length <= JOURNAL_VALUE_SIZE
+      && record->crc == recordCRC(record);
+}
+
+static journal_entry_type * findEntry(byte key)
+{
+  for(unsigned short i = 0; i < entryCount; i++)
+  {
+    if(entries[i].record.key == key)
+    {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+static void appendRecord(journal_record_type * record)
+{
+  record->sequence = nextSequence++;
+  record->crc = recordCRC(record);
+  writeEEPROMPage(regionAddresses[activeRegion], nextRecord * JOURNAL_RECORD_SIZE, (byte *) record, JOURNAL_RECORD_SIZE);
+  nextRecord++;
+}
+
+// rewrite the latest value of every key at the start of the other region
+static void compactJournal()
+{
+  debug(F("compacting journal"));
+  activeRegion = 1 - activeRegion;
+  nextRecord = 0;
+  for(unsigned short i = 0; i < entryCount; i++)
+  {
+    appendRecord(&entries[i].record);
+    entries[i].region = activeRegion;
+  }
+}
+
+void replayJournal()
+{
+  entryCount = 0;
+  bool found = false;
+  unsigned short highestSequence = 0;
+  byte highestRegion = 0;
+  unsigned short highestIndex = 0;
+
+  for(byte region = 0; region < 2; region++)
+  {
+    journal_record_type records[JOURNAL_RECORDS_PER_REGION];
+    readEEPROMBlock(regionAddresses[region], 0, (byte *) records, JOURNAL_REGION_SIZE);
+
+    for(unsigned short i = 0; i < JOURNAL_RECORDS_PER_REGION; i++)
+    {
+      journal_record_type * record = &records[i];
+      if(!recordValid(record))
+      {
+        continue;
+      }
+
+      if(!found || sequenceAfter(record->sequence, highestSequence))
+      {
+        found = true;
+        highestSequence = record->sequence;
+        highestRegion = region;
+        highestIndex = i;
+      }
+
+      journal_entry_type * entry = findEntry(record->key);
+      if(entry == NULL)
+      {
+        if(entryCount >= JOURNAL_MAX_KEYS)
+        {
+          continue;
+        }
+        entry = &entries[entryCount++];
+      }
+      else if(!sequenceAfter(record->sequence, entry->record.sequence))
+      {
+        continue;
+      }
+      memcpy(&entry->record, record, sizeof(journal_record_type));
+      entry->region = region;
+    }
+  }
+
+  replayed = true;
+  if(!found)
+  {
+    activeRegion = 0;
+    nextRecord = 0;
+    nextSequence = 0;
+    return;
+  }
+
+  activeRegion = highestRegion;
+  nextRecord = highestIndex + 1;
+  nextSequence = highestSequence + 1;
+
+  // heal an interrupted compaction, every key must live in the active region
+  // before that region can be overwritten by the next compaction
+  for(unsigned short i = 0; i < entryCount; i++)
+  {
+    if(entries[i].region != activeRegion || nextRecord >= JOURNAL_RECORDS_PER_REGION)
+    {
+      compactJournal();
+      break;
+    }
+  }
+}
+
+bool readJournalValue(byte key, void * value, byte length)
+{
+  if(!replayed)
+  {
+    replayJournal();
+  }
+
+  journal_entry_type * entry = findEntry(key);
+  if(entry == NULL || entry->record.length != length)
+  {
+    return false;
+  }
+  memcpy(value, entry->record.value, length);
+  return true;
+}
+
+void writeJournalValue(byte key, const void * value, byte length)
+{
+  if(length > JOURNAL_VALUE_SIZE || key == 0xFF)
+  {
+    notify(F("invalid journal value"));
+    return;
+  }
+  if(!replayed)
+  {
+    replayJournal();
+  }
+
+  journal_entry_type * entry = findEntry(key);
+  if(entry != NULL && entry->record.length == length && memcmp(entry->record.value, value, length) == 0)
+  {
+    return;
+  }
+  if(entry == NULL)
+  {
+    if(entryCount >= JOURNAL_MAX_KEYS)
+    {
+      notify(F("journal full"));
+      return;
+    }
+    entry = &entries[entryCount++];
+  }
+
+  memset(&entry->record, 0, sizeof(journal_record_type));
+  entry->record.key = key;
+  entry->record.length = length;
+  memcpy(entry->record.value, value, length);
+
+  if(nextRecord >= JOURNAL_RECORDS_PER_REGION)
+  {
+    compactJournal(); // includes the new value
+    return;
+  }
+  appendRecord(&entry->record);
+  entry->region = activeRegion;
+}
@@ -0,0 +1,59 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_JOURNAL
+#define WATERBEAR_JOURNAL
+
+#include <Arduino.h>
+
+// Append only key/value journal for frequently updated runtime state.
+// Two EEPROM blocks are used as alternating regions of 16 byte records, one
+// record per EEPROM page, so an update is a single page write.  When the
+// active region fills, the latest value of every key is compacted into the
+// other region.  Boot replays both regions and keeps the highest sequence
+// number per key, so an interrupted append or compaction loses nothing.
+
+#define JOURNAL_REGION_A_I2C_ADDRESS 0x56
+#define JOURNAL_REGION_B_I2C_ADDRESS 0x57
+#define JOURNAL_REGION_SIZE 256
+#define JOURNAL_RECORD_SIZE 16 // EEPROM page size
+#define JOURNAL_RECORDS_PER_REGION (JOURNAL_REGION_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_VALUE_SIZE 10
+#define JOURNAL_MAX_KEYS 12 // leaves room to append after a compaction
+
+// keys, never reuse a retired key
+#define JOURNAL_KEY_MODE 1
+#define JOURNAL_KEY_DEPLOYMENT_TIMESTAMP 2
+#define JOURNAL_KEY_CONFIG_EPOCH 3
+#define JOURNAL_KEY_ENERGY_LEVEL 4
+
+typedef struct journal_record
+{
+  byte key; // 0xFF for an erased page
+  byte length;
+  unsigned short sequence;
+  byte value[JOURNAL_VALUE_SIZE];
+  unsigned short crc; // low 16 bits of the hardware CRC over the preceding bytes
+} journal_record_type;
+
+void replayJournal();
+bool readJournalValue(byte key, void * value, byte length); // false if the key was never written
+void writeJournalValue(byte key, const void * value, byte length); // no write if the value is unchanged
+
+#endif
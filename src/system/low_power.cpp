@@ -87,6 +87,39 @@ void enterSleepMode()
   rcc_switch_sysclk(RCC_CLKSRC_PLL);
 }
 
+void enterStandbyMode()
+{
+  // Clear wakeup flag and select standby for deep sleep
+  PWR_BASE->CR |= PWR_CR_CWUF;
+  PWR_BASE->CR |= PWR_CR_PDDS;
+
+  SCB_BASE->SCR |= SCB_SCR_SLEEPDEEP;
+  SCB_BASE->SCR &= ~SCB_SCR_SLEEPONEXIT;
+
+  __asm__ volatile( "dsb" );
+  systick_disable();
+  while(1)
+  {
+    __asm__ volatile( "wfi" );
+  }
+}
+
+void waitForInterrupt()
+{
+  __asm__ volatile( "dsb" );
+  __asm__ volatile( "wfi" );
+  __asm__ volatile( "isb" );
+}
+
+void idleDelay(uint32 milliseconds)
+{
+  uint32 start = millis();
+  while(millis() - start < milliseconds)
+  {
+    waitForInterrupt();
+  }
+}
+
 void componentsAlwaysOff()
 {
 
@@ -27,6 +27,9 @@
 // public:
   void enterStopMode();
   void enterSleepMode();
+  void enterStandbyMode(); // does not return, wake up (RTC alarm or reset) restarts the MCU
+  void waitForInterrupt(); // light sleep, systick and peripherals keep running
+  void idleDelay(uint32 milliseconds); // delay() that sleeps between systick interrupts
   void componentsAlwaysOff(); // turn off unused components during setup
   void hardwarePinsAlwaysOff(); // disable unused hardware pins during setup
   void componentsStopMode(); // for stop/sleep mode
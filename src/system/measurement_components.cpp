@@ -18,4 +18,4 @@
 #include "measurement_components.h"
 
 // Components
-AD7091R * externalADC;
\ No newline at end of file
+AD7091R * externalADC = NULL;
\ No newline at end of file
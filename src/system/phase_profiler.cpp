@@ -0,0 +1,94 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "phase_profiler.h"
+
+const char * powerPhaseNames[POWER_PHASE_COUNT] = {"power_up", "warm_up", "measure", "sd_flush", "sleep_entry"};
+
+const char * powerPhaseName(power_phase_type phase)
+{
+  return phase < POWER_PHASE_COUNT ? powerPhaseNames[phase] : "";
+}
+
+void PhaseProfiler::setMonitor(CurrentMonitor * monitor)
+{
+  this->monitor = monitor;
+}
+
+bool PhaseProfiler::active()
+{
+  return monitor != NULL;
+}
+
+void PhaseProfiler::sample(uint32 now)
+{
+  if (monitor == NULL)
+  {
+    return;
+  }
+
+  long microamps;
+  if (!monitor->readMicroamps(&microamps))
+  {
+    return; // the next good read integrates across the gap
+  }
+  if (sampled)
+  {
+    // trapezoid, microamps * milliseconds = nanocoulombs
+    charge[phase] += (long long) (lastMicroamps + microamps) * (uint32) (now - lastSampleTime) / 2;
+  }
+  lastMicroamps = microamps;
+  lastSampleTime = now;
+  sampled = true;
+}
+
+void PhaseProfiler::enterPhase(power_phase_type phase, uint32 now)
+{
+  sample(now); // close the previous phase
+  this->phase = phase;
+}
+
+void PhaseProfiler::endCycle(uint32 now)
+{
+  sample(now);
+  memcpy(completed, charge, sizeof(charge));
+  memset(charge, 0, sizeof(charge));
+  sampled = false; // nothing is integrated across STOP mode
+  phase = phase_power_up;
+}
+
+long PhaseProfiler::getLastMicroamps()
+{
+  return lastMicroamps;
+}
+
+long long PhaseProfiler::getCompletedCharge(power_phase_type phase)
+{
+  return completed[phase];
+}
+
+long long PhaseProfiler::getCompletedCycleCharge()
+{
+  long long total = 0;
+  for (short i = 0; i < POWER_PHASE_COUNT; i++)
+  {
+    total += completed[i];
+  }
+  return total;
+}
@@ -0,0 +1,60 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_PHASE_PROFILER
+#define WATERBEAR_PHASE_PROFILER
+
+#include <Arduino.h>
+#include "current_monitor.h"
+
+// Measured charge per firmware phase of a wake cycle, from a CurrentMonitor
+// sampled by the datalogger's power task.  A cycle runs from wake to the
+// moment before STOP mode; current drawn in STOP is not measured.
+
+#define PHASE_PROFILER_SAMPLE_MILLISECONDS 100 // the INA219 averages over 68 ms per result
+
+typedef enum power_phase { phase_power_up, phase_warm_up, phase_measure, phase_sd_flush, phase_sleep_entry, POWER_PHASE_COUNT } power_phase_type;
+
+class PhaseProfiler
+{
+public:
+  void setMonitor(CurrentMonitor * monitor); // NULL if none is fitted
+  bool active();
+
+  void enterPhase(power_phase_type phase, uint32 now); // now in milliseconds, any monotonic time base
+  void sample(uint32 now); // integrate the current since the last sample into the current phase
+  void endCycle(uint32 now); // the cycle's totals become the completed ones
+
+  long getLastMicroamps();
+  long long getCompletedCharge(power_phase_type phase); // nanocoulombs, last completed cycle
+  long long getCompletedCycleCharge();
+
+private:
+  CurrentMonitor * monitor = NULL;
+  power_phase_type phase = phase_power_up;
+  bool sampled = false; // lastSampleTime is valid
+  uint32 lastSampleTime = 0;
+  long lastMicroamps = 0;
+  long long charge[POWER_PHASE_COUNT] = {0}; // nanocoulombs, cycle in progress
+  long long completed[POWER_PHASE_COUNT] = {0};
+};
+
+const char * powerPhaseName(power_phase_type phase);
+
+#endif
@@ -0,0 +1,228 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "schedule.h"
+#include "eeprom.h"
+
+#define SECONDS_PER_DAY 86400
+
+static_assert(sizeof(schedule_window_type) == SCHEDULE_WINDOW_SIZE, "schedule windows are one EEPROM page each");
+static_assert(EEPROM_SCHEDULE_START + MAX_SCHEDULE_WINDOWS * SCHEDULE_WINDOW_SIZE <= 256, "schedule must fit the first EEPROM block");
+
+void SamplingSchedule::load()
+{
+  readObjectFromEEPROM(EEPROM_SCHEDULE_START, windows, sizeof(windows));
+}
+
+void SamplingSchedule::storeWindow(byte index)
+{
+  writeEEPROMPage(EEPROM_I2C_ADDRESS, EEPROM_SCHEDULE_START + index * SCHEDULE_WINDOW_SIZE, (const byte *) &windows[index], SCHEDULE_WINDOW_SIZE);
+}
+
+bool SamplingSchedule::setWindow(byte index, const schedule_window_type * window)
+{
+  if(index >= MAX_SCHEDULE_WINDOWS
+    || window->startMinute >= MINUTES_PER_DAY
+    || window->endMinute >= MINUTES_PER_DAY
+    || window->interval < 1 || window->interval > MAX_SCHEDULED_INTERVAL)
+  {
+    return false;
+  }
+  memcpy(&windows[index], window, sizeof(schedule_window_type));
+  storeWindow(index);
+  return true;
+}
+
+void SamplingSchedule::clearWindow(byte index)
+{
+  if(index >= MAX_SCHEDULE_WINDOWS)
+  {
+    return;
+  }
+  memset(&windows[index], 0xFF, sizeof(schedule_window_type));
+  storeWindow(index);
+}
+
+const schedule_window_type * SamplingSchedule::getWindow(byte index)
+{
+  return index < MAX_SCHEDULE_WINDOWS && windowUsed(index) ? &windows[index] : NULL;
+}
+
+bool SamplingSchedule::empty()
+{
+  for(byte i = 0; i < MAX_SCHEDULE_WINDOWS; i++)
+  {
+    if(windowUsed(i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SamplingSchedule::windowUsed(byte index)
+{
+  // erased EEPROM reads 0xFFFF
+  return windows[index].startMinute < MINUTES_PER_DAY
+    && windows[index].endMinute < MINUTES_PER_DAY
+    && windows[index].interval >= 1 && windows[index].interval <= MAX_SCHEDULED_INTERVAL;
+}
+
+bool SamplingSchedule::windowContains(byte index, time_t time)
+{
+  const schedule_window_type * window = &windows[index];
+  unsigned short minute = (time % SECONDS_PER_DAY) / 60;
+
+  // the part of a window after midnight belongs to the day it started on
+  time_t windowDay = time;
+  if(window->startMinute < window->endMinute)
+  {
+    if(minute < window->startMinute || minute >= window->endMinute)
+    {
+      return false;
+    }
+  }
+  else if(minute < window->startMinute)
+  {
+    if(minute >= window->endMinute)
+    {
+      return false;
+    }
+    windowDay = time - SECONDS_PER_DAY;
+  }
+
+  struct tm * day = gmtime(&windowDay);
+  if(window->weekdays != 0 && window->weekdays != 0xFF && !(window->weekdays & (1 << day->tm_wday)))
+  {
+    return false;
+  }
+  if(window->months != 0 && window->months != 0xFFFF && !(window->months & (1 << day->tm_mon)))
+  {
+    return false;
+  }
+  return true;
+}
+
+short SamplingSchedule::activeWindow(time_t time)
+{
+  for(byte i = 0; i < MAX_SCHEDULE_WINDOWS; i++)
+  {
+    if(windowUsed(i) && windowContains(i, time))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+sampling_parameters_type SamplingSchedule::parametersAt(time_t time, sampling_parameters_type defaults)
+{
+  short index = activeWindow(time);
+  if(index < 0)
+  {
+    return defaults;
+  }
+
+  sampling_parameters_type parameters = defaults;
+  parameters.interval = windows[index].interval;
+  if(windows[index].burstNumber != 0)
+  {
+    parameters.burstNumber = windows[index].burstNumber;
+  }
+  if(windows[index].interBurstDelay != SCHEDULE_INHERIT_BURST_DELAY)
+  {
+    parameters.interBurstDelay = windows[index].interBurstDelay;
+  }
+  return parameters;
+}
+
+time_t SamplingSchedule::nextBoundary(time_t from, time_t until)
+{
+  // activeWindow only changes at midnight or at a window start or end
+  short active = activeWindow(from);
+  time_t boundary = 0;
+  for(time_t day = from - from % SECONDS_PER_DAY; day <= until; day += SECONDS_PER_DAY)
+  {
+    if(day > from && day < until && activeWindow(day) != active)
+    {
+      boundary = day;
+    }
+    for(byte i = 0; i < MAX_SCHEDULE_WINDOWS; i++)
+    {
+      if(!windowUsed(i))
+      {
+        continue;
+      }
+      time_t edges[2] = { day + windows[i].startMinute * 60, day + windows[i].endMinute * 60 };
+      for(byte j = 0; j < 2; j++)
+      {
+        if(edges[j] > from && edges[j] < until && (boundary == 0 || edges[j] < boundary) && activeWindow(edges[j]) != active)
+        {
+          boundary = edges[j];
+        }
+      }
+    }
+    if(boundary != 0)
+    {
+      return boundary;
+    }
+  }
+  return 0;
+}
+
+time_t SamplingSchedule::nextWake(time_t now, sampling_parameters_type defaults, unsigned short intervalMultiplier)
+{
+  time_t from = now;
+  bool inclusive = false; // a window start may itself be a wake time
+  time_t tick = now + defaults.interval * 60;
+
+  // each pass moves to the next window boundary, a few are enough for any realistic table
+  for(byte pass = 0; pass < 2 * MAX_SCHEDULE_WINDOWS + 2; pass++)
+  {
+    short active = activeWindow(from);
+    unsigned long interval = (active < 0 ? defaults.interval : windows[active].interval) * intervalMultiplier;
+    if(interval < 1)
+    {
+      interval = 1;
+    }
+    if(interval > MAX_SCHEDULED_INTERVAL)
+    {
+      interval = MAX_SCHEDULED_INTERVAL;
+    }
+    long step = interval * 60;
+
+    // grid anchored at the window start, or at midnight outside windows
+    time_t anchor = from - from % SECONDS_PER_DAY + (active < 0 ? 0 : windows[active].startMinute * 60);
+    if(anchor > from)
+    {
+      anchor -= SECONDS_PER_DAY; // in the part of a window after midnight
+    }
+    long offset = (from - anchor) % step;
+    tick = (inclusive && offset == 0) ? from : from - offset + step;
+
+    time_t boundary = nextBoundary(from, tick);
+    if(boundary == 0)
+    {
+      return tick;
+    }
+    from = boundary;
+    inclusive = true;
+  }
+  return tick;
+}
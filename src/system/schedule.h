@@ -0,0 +1,84 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_SCHEDULE
+#define WATERBEAR_SCHEDULE
+
+#include <Arduino.h>
+#include "time.h"
+
+// Time of day windows with their own sampling parameters, so sampling effort
+// can be concentrated on daylight hours, tidal windows or a season.  Outside
+// every window the datalogger settings apply.  Times are UTC.
+
+#define MAX_SCHEDULE_WINDOWS 8
+#define SCHEDULE_WINDOW_SIZE 16 // one EEPROM page
+#define MINUTES_PER_DAY 1440
+#define MAX_SCHEDULED_INTERVAL 540 // minutes, the internal RTC alarm is set with a short count of seconds
+#define SCHEDULE_INHERIT_BURST_DELAY 0xFFFF
+
+typedef struct schedule_window
+{
+  unsigned short startMinute; // minute of the day, 0xFFFF for an unused window
+  unsigned short endMinute;   // exclusive, a window with end <= start runs past midnight
+  unsigned short interval;    // minutes
+  unsigned short burstNumber; // 0 uses the datalogger setting
+  unsigned short interBurstDelay; // minutes, SCHEDULE_INHERIT_BURST_DELAY uses the datalogger setting
+  byte weekdays; // bit 0 Sunday .. bit 6 Saturday, day the window starts on, 0 or 0xFF every day
+  byte reserved;
+  unsigned short months; // bit 0 January .. bit 11 December, 0 or 0xFFFF every month
+  byte reserved2[2];
+} schedule_window_type;
+
+typedef struct sampling_parameters
+{
+  unsigned short interval; // minutes
+  unsigned short burstNumber;
+  unsigned short interBurstDelay; // minutes
+} sampling_parameters_type;
+
+class SamplingSchedule
+{
+public:
+  void load(); // read the windows from EEPROM
+  bool setWindow(byte index, const schedule_window_type * window); // false if the window is invalid
+  void clearWindow(byte index);
+  const schedule_window_type * getWindow(byte index); // NULL if unused
+  bool empty();
+
+  // window in effect at time, -1 outside every window, the first listed wins on overlap
+  short activeWindow(time_t time);
+
+  // parameters in effect at time
+  sampling_parameters_type parametersAt(time_t time, sampling_parameters_type defaults);
+
+  // first wake after now: on the interval grid of the window in effect (from its start,
+  // or from midnight outside windows), and at the start of any window reached earlier
+  time_t nextWake(time_t now, sampling_parameters_type defaults, unsigned short intervalMultiplier = 1);
+
+private:
+  bool windowUsed(byte index);
+  bool windowContains(byte index, time_t time);
+  time_t nextBoundary(time_t from, time_t until); // first change of activeWindow in (from, until), 0 if none
+  void storeWindow(byte index);
+
+  schedule_window_type windows[MAX_SCHEDULE_WINDOWS];
+};
+
+#endif
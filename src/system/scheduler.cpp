@@ -0,0 +1,104 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "scheduler.h"
+#include "logs.h"
+
+bool Scheduler::addTask(Task * task, bool startSuspended)
+{
+  if(taskCount >= MAX_SCHEDULED_TASKS)
+  {
+    notify(F("Too many tasks"));
+    return false;
+  }
+  tasks[taskCount++] = task;
+  task->suspended = startSuspended;
+  task->nextRunTime = now();
+  return true;
+}
+
+void Scheduler::wake(Task * task, unsigned long delayMilliseconds)
+{
+  task->suspended = false;
+  task->rescheduled = true;
+  task->nextRunTime = now() + delayMilliseconds;
+}
+
+void Scheduler::suspend(Task * task)
+{
+  task->suspended = true;
+  task->rescheduled = true;
+}
+
+unsigned long Scheduler::runDueTasks()
+{
+  for(unsigned short i = 0; i < taskCount; i++)
+  {
+    Task * task = tasks[i];
+    if(task->suspended || (int32)(now() - task->nextRunTime) < 0)
+    {
+      continue;
+    }
+
+    // a task may wake or suspend itself while running, that takes precedence over its result
+    task->rescheduled = false;
+    unsigned long wait = task->run();
+    if(task->rescheduled)
+    {
+      continue;
+    }
+    if(wait == TASK_SUSPENDED)
+    {
+      task->suspended = true;
+    }
+    else
+    {
+      task->nextRunTime = now() + wait;
+    }
+  }
+
+  unsigned long untilNext = TASK_SUSPENDED;
+  for(unsigned short i = 0; i < taskCount; i++)
+  {
+    if(tasks[i]->suspended)
+    {
+      continue;
+    }
+    int32 remaining = (int32)(tasks[i]->nextRunTime - now());
+    if(remaining <= 0)
+    {
+      return 0;
+    }
+    if((unsigned long) remaining < untilNext)
+    {
+      untilNext = remaining;
+    }
+  }
+  return untilNext;
+}
+
+void Scheduler::advanceClock(uint32 milliseconds)
+{
+  sleptMilliseconds += milliseconds;
+}
+
+uint32 Scheduler::now()
+{
+  return millis() + sleptMilliseconds;
+}
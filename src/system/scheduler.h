@@ -0,0 +1,86 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_SCHEDULER
+#define WATERBEAR_SCHEDULER
+
+#include <Arduino.h>
+
+#define MAX_SCHEDULED_TASKS 8
+#define TASK_SUSPENDED 0xFFFFFFFF // returned by a task that should only run again when woken
+
+// A task is a resumable state machine.  run() does the work up to its next
+// wait point and returns the number of milliseconds until it wants to run
+// again, or TASK_SUSPENDED to wait until Scheduler::wake() is called.
+class Task
+{
+public:
+  virtual unsigned long run() = 0;
+
+  const char * name = NULL;
+  uint32 nextRunTime = 0;
+  bool suspended = true;
+  bool rescheduled = false; // set when woken or suspended while running
+};
+
+// Adapts a member function to a Task so state can stay in its owning class
+template <class T>
+class MemberTask : public Task
+{
+public:
+  MemberTask(const char * name, T * object, unsigned long (T::*method)())
+  {
+    this->name = name;
+    this->object = object;
+    this->method = method;
+  }
+
+  unsigned long run()
+  {
+    return (object->*method)();
+  }
+
+private:
+  T * object;
+  unsigned long (T::*method)();
+};
+
+// Cooperative, run to wait point scheduler.  Tasks never block, the caller
+// idles the MCU for the time returned by runDueTasks().
+class Scheduler
+{
+public:
+  bool addTask(Task * task, bool startSuspended = false);
+  void wake(Task * task, unsigned long delayMilliseconds = 0);
+  void suspend(Task * task);
+
+  // run every task that is due, returns milliseconds until the next task is due
+  unsigned long runDueTasks();
+
+  // account for time that passed while systick was stopped
+  void advanceClock(uint32 milliseconds);
+  uint32 now();
+
+private:
+  Task * tasks[MAX_SCHEDULED_TASKS];
+  unsigned short taskCount = 0;
+  uint32 sleptMilliseconds = 0;
+};
+
+#endif
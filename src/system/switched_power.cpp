@@ -20,6 +20,22 @@
 #include "hardware.h"
 #include "logs.h"
 
+#define SWITCHED_POWER_OFF_MILLISECONDS 500
+#define SWITCHED_POWER_SETTLE_MILLISECONDS 500
+#define BOOST_CONVERTER_SETTLE_MILLISECONDS 250
+
+static uint32 switchedPowerEnabledAt = 0;
+static uint32 boostConverterEnabledAt = 0;
+
+static void awaitElapsed(uint32 since, uint32 milliseconds)
+{
+  uint32 elapsed = millis() - since;
+  if(elapsed < milliseconds)
+  {
+    delay(milliseconds - elapsed);
+  }
+}
+
 void setupSwitchedPower()
 {
   // enable pin on switchable integrated 3v3 boost converter
@@ -31,6 +47,7 @@ void enableSwitchedPower()
 {
   debug(F("Enabling switched power"));
   digitalWrite(SWITCHED_POWER_ENABLE, HIGH);
+  switchedPowerEnabledAt = millis();
 }
 
 void disableSwitchedPower()
@@ -42,8 +59,37 @@ void disableSwitchedPower()
 void cycleSwitchablePower()
 {
   debug(F("Cycle switched power"));
+  startSwitchablePowerCycle(false);
+  awaitSwitchablePowerSettled();
+}
+
+void startSwitchablePowerCycle(bool railsDischarged)
+{
   disableSwitchedPower();
-  delay(500);
+  if(!railsDischarged)
+  {
+    delay(SWITCHED_POWER_OFF_MILLISECONDS);
+  }
   enableSwitchedPower();
-  delay(500);
+}
+
+void awaitSwitchablePowerSettled()
+{
+  awaitElapsed(switchedPowerEnabledAt, SWITCHED_POWER_SETTLE_MILLISECONDS);
+}
+
+void enableBoostConverter()
+{
+  pinMode(GPIO_PIN_3, OUTPUT);
+  if(digitalRead(GPIO_PIN_3) == HIGH)
+  {
+    return; // already on and settling
+  }
+  gpioPinOn(GPIO_PIN_3);
+  boostConverterEnabledAt = millis();
+}
+
+void awaitBoostConverterSettled()
+{
+  awaitElapsed(boostConverterEnabledAt, BOOST_CONVERTER_SETTLE_MILLISECONDS);
 }
\ No newline at end of file
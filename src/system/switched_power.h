@@ -24,4 +24,12 @@ void enableSwitchedPower();
 void disableSwitchedPower();
 void cycleSwitchablePower();
 
+// Split power cycle so rails can settle while other setup runs.
+// The off time is skipped when the rails are known to be discharged (power on reset).
+void startSwitchablePowerCycle(bool railsDischarged);
+void awaitSwitchablePowerSettled();
+
+void enableBoostConverter(); // 5v booster, external ADC reference
+void awaitBoostConverterSettled();
+
 #endif
\ No newline at end of file
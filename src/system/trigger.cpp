@@ -0,0 +1,126 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "trigger.h"
+#include "clock.h"
+#include "utilities/ring_buffer.h"
+
+extern short GPIO_PINS[7];
+
+static byte triggerPin = TRIGGER_DISABLED;
+
+// filled by the ISR, emptied by the main loop
+static RingBuffer<trigger_event_type, TRIGGER_QUEUE_SIZE> queue;
+static unsigned int droppedBefore = 0; // queue losses before the last clearTriggers
+static volatile unsigned long long lastEdgeMilliseconds = 0;
+
+static void handleTriggerInterrupt()
+{
+  unsigned long long now = internalRTCEpochMilliseconds();
+  if (lastEdgeMilliseconds != 0 && now - lastEdgeMilliseconds < TRIGGER_DEBOUNCE_MILLISECONDS)
+  {
+    return;
+  }
+  lastEdgeMilliseconds = now;
+
+  trigger_event_type * event = queue.reserve();
+  if (event != NULL)
+  {
+    event->epochMilliseconds = now;
+    queue.commit();
+  }
+}
+
+static byte triggerEXTILine()
+{
+  // maple numbers pins PA0..PA15, PB0..PB15, PC0.., the EXTI line is the bit within the port
+  return GPIO_PINS[triggerPin] % 16;
+}
+
+bool setupTriggerInput(byte gpioIndex)
+{
+  if (triggerPin != TRIGGER_DISABLED)
+  {
+    detachInterrupt(GPIO_PINS[triggerPin]);
+    triggerPin = TRIGGER_DISABLED;
+  }
+  if (gpioIndex == TRIGGER_DISABLED)
+  {
+    return true;
+  }
+  if (gpioIndex >= sizeof(GPIO_PINS) / sizeof(GPIO_PINS[0]))
+  {
+    return false;
+  }
+
+  byte line = GPIO_PINS[gpioIndex] % 16;
+  if (line >= 5 && line <= 9)
+  {
+    return false; // EXTI 9-5 is shared with the manual wake button, which masks it
+  }
+
+  triggerPin = gpioIndex;
+  clearTriggers();
+  pinMode(GPIO_PINS[triggerPin], INPUT_PULLUP); // contact closure or open drain output pulls low
+  attachInterrupt(GPIO_PINS[triggerPin], handleTriggerInterrupt, FALLING);
+  return true;
+}
+
+bool triggerConfigured()
+{
+  return triggerPin != TRIGGER_DISABLED;
+}
+
+void enableTriggerInterrupt()
+{
+  if (!triggerConfigured())
+  {
+    return;
+  }
+  byte line = triggerEXTILine();
+  if (line <= 4)
+  {
+    nvic_irq_enable((nvic_irq_num) (NVIC_EXTI0 + line));
+  }
+  else
+  {
+    nvic_irq_enable(NVIC_EXTI_15_10);
+  }
+}
+
+bool triggerPending()
+{
+  return !queue.empty();
+}
+
+bool nextTrigger(trigger_event_type * event)
+{
+  return queue.pop(event);
+}
+
+void clearTriggers()
+{
+  queue.clear();
+  droppedBefore = queue.lost();
+}
+
+unsigned int droppedTriggerCount()
+{
+  return queue.lost() - droppedBefore;
+}
@@ -0,0 +1,49 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_TRIGGER
+#define WATERBEAR_TRIGGER
+
+#include <Arduino.h>
+
+// External trigger input, for sampling in step with another instrument.
+// A falling edge on the configured GPIO_PINS input wakes the MCU from STOP
+// through its EXTI line and is queued with a timestamp taken in the ISR from
+// the internal RTC time base.  Edges within TRIGGER_DEBOUNCE_MILLISECONDS of
+// an accepted edge are contact bounce and ignored.
+
+#define TRIGGER_DISABLED 0xFF
+#define TRIGGER_QUEUE_SIZE 8
+#define TRIGGER_DEBOUNCE_MILLISECONDS 50
+
+typedef struct trigger_event
+{
+  unsigned long long epochMilliseconds;
+} trigger_event_type;
+
+bool setupTriggerInput(byte gpioIndex); // index into GPIO_PINS, TRIGGER_DISABLED to detach; false if the pin can't be used
+bool triggerConfigured();
+void enableTriggerInterrupt(); // NVIC line, for STOP mode where only wake sources are enabled
+
+bool triggerPending();
+bool nextTrigger(trigger_event_type * event); // oldest queued trigger, false if none
+void clearTriggers();
+unsigned int droppedTriggerCount(); // arrived with the queue full
+
+#endif
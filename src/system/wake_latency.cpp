@@ -0,0 +1,90 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "wake_latency.h"
+
+WakeLatencyModel::WakeLatencyModel()
+{
+  for (short i = 0; i < WAKE_LATENCY_MODELS; i++)
+  {
+    models[i].configuration = 0;
+    models[i].smoothed = -1;
+    models[i].samples = 0;
+    models[i].age = 0xFFFF;
+  }
+  current = &models[0];
+}
+
+void WakeLatencyModel::select(unsigned long configuration)
+{
+  wake_latency_model_type * selected = NULL;
+  wake_latency_model_type * oldest = &models[0];
+  for (short i = 0; i < WAKE_LATENCY_MODELS; i++)
+  {
+    if (models[i].age != 0xFFFF && models[i].configuration == configuration)
+    {
+      selected = &models[i];
+    }
+    if (models[i].age > oldest->age)
+    {
+      oldest = &models[i];
+    }
+    if (models[i].age < 0xFFFF)
+    {
+      models[i].age++;
+    }
+  }
+
+  if (selected == NULL)
+  {
+    selected = oldest;
+    selected->configuration = configuration;
+    selected->smoothed = -1;
+    selected->samples = 0;
+  }
+  selected->age = 0;
+  current = selected;
+}
+
+unsigned long WakeLatencyModel::predictedLatency()
+{
+  return current->smoothed < 0 ? 0 : current->smoothed >> WAKE_LATENCY_SMOOTHING_SHIFT;
+}
+
+void WakeLatencyModel::addSample(unsigned long latency)
+{
+  if (latency > WAKE_LATENCY_MAX_MILLISECONDS)
+  {
+    return;
+  }
+  if (current->smoothed < 0)
+  {
+    current->smoothed = (long) latency << WAKE_LATENCY_SMOOTHING_SHIFT;
+  }
+  else
+  {
+    current->smoothed += (long) latency - (current->smoothed >> WAKE_LATENCY_SMOOTHING_SHIFT);
+  }
+  current->samples++;
+}
+
+unsigned int WakeLatencyModel::sampleCount()
+{
+  return current->samples;
+}
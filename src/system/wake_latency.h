@@ -0,0 +1,57 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_WAKE_LATENCY
+#define WATERBEAR_WAKE_LATENCY
+
+#include <Arduino.h>
+
+// Time from the RTC alarm to the first reading of a cycle: clock relock, driver
+// setup, switched power, SD reopen, start up delay and sensor warm up.  A model
+// is kept per configuration so the alarm can be set early by the predicted
+// latency and the first reading lands on the sampling grid.
+
+#define WAKE_LATENCY_MODELS 4
+#define WAKE_LATENCY_SMOOTHING_SHIFT 3 // exponential moving average weight 1/8 per cycle
+#define WAKE_LATENCY_MAX_MILLISECONDS 600000UL // longer samples are not learned, and no lead beyond this
+
+typedef struct wake_latency_model
+{
+  unsigned long configuration;
+  long smoothed; // milliseconds << WAKE_LATENCY_SMOOTHING_SHIFT, -1 before the first sample
+  unsigned int samples;
+  unsigned int age; // selections since last used, 0xFFFF unused, the oldest model is replaced
+} wake_latency_model_type;
+
+class WakeLatencyModel
+{
+public:
+  WakeLatencyModel();
+
+  void select(unsigned long configuration); // the model used by the calls below
+  unsigned long predictedLatency(); // milliseconds, 0 until a sample under this configuration
+  void addSample(unsigned long latency);
+  unsigned int sampleCount();
+
+private:
+  wake_latency_model_type models[WAKE_LATENCY_MODELS];
+  wake_latency_model_type * current;
+};
+
+#endif
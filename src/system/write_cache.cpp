@@ -20,23 +20,61 @@
 #include "string.h"
 #include "Arduino.h"
 #include "monitor.h"
+#include "crc.h"
 
-WriteCache::WriteCache(OutputDevice * outputDevice)
+WriteCache::WriteCache(OutputDevice * outputDevice, char * storage, unsigned int cacheSize)
 {
   this->outputDevice = outputDevice;
+  this->cacheSize = cacheSize;
+  this->cache = storage;
   initCache();
 }
 
+void WriteCache::reset(OutputDevice * outputDevice)
+{
+  this->outputDevice = outputDevice;
+  initCache();
+}
 
-void WriteCache::writeString(const char * string)
+
+void WriteCache::makeRoom(unsigned int length)
 {
-  if(nextPosition + strlen(string) > cacheSize - 1)
+  if(nextPosition + length > cacheSize - 1)
   {
     flushCache();
   }
+  if(nextPosition + length > cacheSize - 1)
+  {
+    // the carried partial line leaves no room, give up on keeping it whole
+    writeBlock(nextPosition);
+    initCache();
+  }
+}
 
-  strcpy(&cache[nextPosition], string);
-  nextPosition = nextPosition + strlen(string);
+void WriteCache::writeString(const char * string)
+{
+  unsigned int length = strlen(string);
+  makeRoom(length);
+  if(length > cacheSize - 1)
+  {
+    length = cacheSize - 1;
+  }
+
+  memcpy(&cache[nextPosition], string, length);
+  nextPosition = nextPosition + length;
+}
+
+// Drivers format their values straight into the cache instead of through
+// an intermediate string. Anything past the end of the span is truncated.
+OutputSpan WriteCache::reserve(unsigned int length)
+{
+  makeRoom(length);
+  return OutputSpan(&cache[nextPosition], cacheSize - nextPosition);
+}
+
+void WriteCache::commit(const OutputSpan & span)
+{
+  nextPosition = nextPosition + span.length();
 }
 
 void WriteCache::endOfLine()
@@ -49,9 +87,44 @@ void WriteCache::endOfLine()
   nextPosition++;
 }
 
+// Only complete lines are flushed, each block followed by a trailer comment
+//   #crc32,<block length>,<crc32 hex>
+// so a torn or corrupted block can be found by tools/verify_log_crc.py.
+// A trailing partial line stays in the cache and starts the next block.
 void WriteCache::flushCache()
 {
   // notify("flushing cache");
+  unsigned int blockLength = nextPosition;
+  while(blockLength > 0 && cache[blockLength - 1] != '\n')
+  {
+    blockLength--;
+  }
+  if(blockLength == 0)
+  {
+    // a single line longer than the cache, flush it without a trailer
+    blockLength = nextPosition;
+  }
+
+  writeBlock(blockLength);
+
+  unsigned int remaining = nextPosition - blockLength;
+  memmove(cache, &cache[blockLength], remaining);
+  memset(&cache[remaining], 0, cacheSize - remaining);
+  nextPosition = remaining;
+}
+
+void WriteCache::writeBlock(unsigned int length)
+{
+  if(length == 0)
+  {
+    return;
+  }
+
+  char saved = cache[length];
+  cache[length] = '\0';
+
+  outputDevice->beginBlock(length + CRC_TRAILER_SIZE);
+
   char hello[100] = "\0";
   outputDevice->writeString(hello); // why is this required??
   outputDevice->writeString(cache);
@@ -59,12 +132,26 @@ void WriteCache::flushCache()
   {
     Serial2.print(cache);
   }
-  initCache();
+
+  if(cache[length - 1] == '\n')
+  {
+    lastBlockCRC = hardwareCRC32(cache, length);
+    char trailer[CRC_TRAILER_SIZE];
+    sprintf(trailer, "#crc32,%u,%08lx\n", length, lastBlockCRC);
+    outputDevice->writeString(trailer);
+  }
+
+  cache[length] = saved;
+}
+
+unsigned long WriteCache::getLastBlockCRC()
+{
+  return lastBlockCRC;
 }
 
 void WriteCache::initCache()
 {
-  memset( cache, 0, MAX_CACHE_SIZE );
+  memset( cache, 0, cacheSize );
   nextPosition = 0;
 }
 
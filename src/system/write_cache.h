@@ -19,12 +19,17 @@
 #ifndef WATERBEAR_WRITE_CACHE
 #define WATERBEAR_WRITE_CACHE
 
-#define MAX_CACHE_SIZE 1000
+#include "utilities/output_span.h"
+
+#define SUMMARY_CACHE_SIZE 512 // flushed after every measurement cycle
+#define RAW_CACHE_SIZE 1536    // flushed when full, raw bursts are written in large blocks
+#define CRC_TRAILER_SIZE 32
 
 class OutputDevice
 {
   public:
-    virtual void writeString(const char * string);
+    virtual void writeString(const char * string) = 0;
+    virtual void beginBlock(unsigned int length) {} // called before each block of at most length bytes
 
 
 };
@@ -34,23 +39,31 @@ class WriteCache
 
   public:
   // methods
-  WriteCache(OutputDevice * outputDevice);
+  WriteCache(OutputDevice * outputDevice, char * storage, unsigned int cacheSize); // storage lives as long as the cache, word aligned for the CRC unit
+  void reset(OutputDevice * outputDevice); // start over on a new output, after a flush
   void writeString(const char * string);
+  OutputSpan reserve(unsigned int length); // span over the free cache, at least length bytes when the cache allows
+  void commit(const OutputSpan & span);    // keeps what was formatted into the last reserved span
   void endOfLine();
   void flushCache();
   void setOutputToSerial(bool);
+  unsigned long getLastBlockCRC();
 
   // variables
-  unsigned int cacheSize = MAX_CACHE_SIZE; // must be MAX_CACHE_SIZE or less
+  unsigned int cacheSize;
 
   private:
   // methods
   void initCache();
+  void makeRoom(unsigned int length);
+
+  void writeBlock(unsigned int length);
 
   // variables
   OutputDevice * outputDevice;
-  char cache[MAX_CACHE_SIZE];
+  char * cache;
   unsigned int nextPosition = 0;
+  unsigned long lastBlockCRC = 0;
 
   bool outputToSerial = false;
 
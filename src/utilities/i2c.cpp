@@ -130,14 +130,10 @@ void enableI2C1()
   // i2c_bus_reset(I2C1); // hangs here if this is called
   // debug(F("Reset I2C1"));
 
+  // switched power must have settled before the bus is used, see awaitSwitchablePowerSettled()
   WireOne.begin();
-  delay(250);
 
   debug(F("Began TwoWire 1"));
-  
-  debug(F("Scanning 1"));
-
-  scanIC2(&Wire);
 }
 
 void enableI2C2()
@@ -148,11 +144,42 @@ void enableI2C2()
 
   //i2c_bus_reset(I2C2); // hang if this is called
   WireTwo.begin();
-  delay(250);
 
   debug(F("Began TwoWire 2"));
+}
+
+bool i2cDevicePresent(TwoWire *wire, byte address)
+{
+  wire->beginTransmission(address);
+  return wire->endTransmission() == 0;
+}
 
-  debug(F("Scanning 2"));
+bool i2cWriteCommand(TwoWire *wire, byte address, const byte * command, byte length)
+{
+  wire->beginTransmission(address);
+  wire->write(command, length);
+  return wire->endTransmission() == 0;
+}
 
-  scanIC2(&WireTwo);
-}
\ No newline at end of file
+bool i2cReadBlock(TwoWire *wire, byte address, short registerAddress, byte * buffer, byte length)
+{
+  if (registerAddress >= 0)
+  {
+    wire->beginTransmission(address);
+    wire->write((byte) registerAddress);
+    if (wire->endTransmission() != 0)
+    {
+      return false;
+    }
+  }
+  // the whole block in one read, the device auto increments its register pointer
+  if (wire->requestFrom(address, length) != length)
+  {
+    return false;
+  }
+  for (byte i = 0; i < length; i++)
+  {
+    buffer[i] = wire->read();
+  }
+  return true;
+}
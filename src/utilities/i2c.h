@@ -23,6 +23,9 @@ void i2cSendTransmission(byte i2cAddress, byte registerAddress, const void * dat
 void i2cError(int transmissionCode);
 void scanIC2(TwoWire *wire);
 bool scanIC2(TwoWire *wire, int searchAddress);
+bool i2cDevicePresent(TwoWire *wire, byte address); // probe a single address without scanning the bus
+bool i2cWriteCommand(TwoWire *wire, byte address, const byte * command, byte length); // one write transaction
+bool i2cReadBlock(TwoWire *wire, byte address, short registerAddress, byte * buffer, byte length); // registerAddress < 0 reads without setting the pointer
 void enableI2C1();
 void enableI2C2();
 
@@ -0,0 +1,77 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "output_span.h"
+
+OutputSpan::OutputSpan(char * buffer, unsigned int capacity)
+{
+  this->buffer = buffer;
+  this->capacity = capacity;
+  if (capacity > 0)
+  {
+    buffer[0] = '\0';
+  }
+}
+
+unsigned int OutputSpan::appendv(const char * format, va_list args)
+{
+  if (capacity == 0 || full)
+  {
+    return 0;
+  }
+  unsigned int available = capacity - used;
+  int written = vsnprintf(&buffer[used], available, format, args);
+  if (written < 0)
+  {
+    buffer[used] = '\0';
+    return 0;
+  }
+  if ((unsigned int) written >= available)
+  {
+    full = true;
+    written = available - 1;
+  }
+  used += written;
+  return written;
+}
+
+unsigned int OutputSpan::append(const char * format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  unsigned int written = appendv(format, args);
+  va_end(args);
+  return written;
+}
+
+unsigned int OutputSpan::appendString(const char * string)
+{
+  if (capacity == 0 || full)
+  {
+    return 0;
+  }
+  unsigned int start = used;
+  while (*string != '\0' && used < capacity - 1)
+  {
+    buffer[used++] = *string++;
+  }
+  buffer[used] = '\0';
+  full = *string != '\0';
+  return used - start;
+}
@@ -0,0 +1,50 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_OUTPUT_SPAN
+#define WATERBEAR_OUTPUT_SPAN
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+/*
+ * Bounded region of an output buffer that values are formatted straight into.
+ * Appends past the end are truncated, and the contents stay null terminated.
+ */
+class OutputSpan
+{
+public:
+  OutputSpan(char * buffer, unsigned int capacity); // capacity includes the terminator
+
+  unsigned int append(const char * format, ...);
+  unsigned int appendv(const char * format, va_list args);
+  unsigned int appendString(const char * string);
+
+  unsigned int length() const { return used; }
+  bool truncated() const { return full; }
+  const char * data() const { return buffer; }
+
+private:
+  char * buffer;
+  unsigned int capacity;
+  unsigned int used = 0;
+  bool full = false;
+};
+
+#endif
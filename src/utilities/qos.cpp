@@ -19,6 +19,7 @@
 #include "qos.h"
 #include <Arduino.h>
 #include <libmaple/libmaple.h>
+#include <malloc.h>
 #include "system/logs.h"
 #include "utilities/utilities.h"
 
@@ -60,4 +61,41 @@ void printFreeMemory()
   int freeMemoryAmount = freeMemory();
   sprintf(freeMemoryMessage, reinterpretCharPtr(F("Free Memory: %d")), freeMemoryAmount);
   notify(freeMemoryAmount);
-}
\ No newline at end of file
+}
+#define MEMORY_PAINT_BYTE 0xA5
+#define MEMORY_PAINT_STACK_MARGIN 64
+
+void paintFreeMemory()
+{
+  // no calls inside the loop, the region just below our frame must stay free
+  char top;
+  char * heapEnd = reinterpret_cast<char*>(_sbrk(0));
+  for(char * p = heapEnd; p < &top - MEMORY_PAINT_STACK_MARGIN; p++)
+  {
+    *p = MEMORY_PAINT_BYTE;
+  }
+}
+
+int untouchedMemory()
+{
+  // scan up from the current heap end until the deepest point the stack has reached
+  char top;
+  char * p = reinterpret_cast<char*>(_sbrk(0));
+  int untouched = 0;
+  while(p < &top && *p == (char) MEMORY_PAINT_BYTE)
+  {
+    p++;
+    untouched++;
+  }
+  return untouched;
+}
+
+void printMemoryStatus()
+{
+  // arena is the heap size so far, free within the arena is what fragmentation holds on to
+  struct mallinfo heapInfo = mallinfo();
+  char message[100];
+  sprintf(message, reinterpretCharPtr(F("heap:%d used:%d free-in-heap:%d free:%d untouched:%d")),
+    heapInfo.arena, heapInfo.uordblks, heapInfo.fordblks, freeMemory(), untouchedMemory());
+  notify(message);
+}
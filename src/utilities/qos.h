@@ -24,4 +24,11 @@ void intentionalMemoryLeak();
 void checkMemory();
 void printFreeMemory();
 
+// stack and heap high water marks
+// paintFreeMemory() fills the gap between heap and stack with a pattern at boot,
+// untouchedMemory() reports how much of the gap has never been used since
+void paintFreeMemory();
+int untouchedMemory();
+void printMemoryStatus();
+
 #endif
@@ -0,0 +1,128 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "register_shadow.h"
+#include "utilities/i2c.h"
+
+RegisterShadow::RegisterShadow(TwoWire * wire, byte deviceAddress)
+{
+  this->wire = wire;
+  this->deviceAddress = deviceAddress;
+}
+
+void RegisterShadow::addRegister(byte registerAddress, byte length)
+{
+  if (registerCount >= MAX_SHADOWED_REGISTERS)
+  {
+    return;
+  }
+  shadowed_register * shadowed = &registers[registerCount++];
+  shadowed->address = registerAddress;
+  shadowed->length = length;
+  shadowed->valid = false;
+  shadowed->value = 0;
+}
+
+shadowed_register * RegisterShadow::find(byte registerAddress)
+{
+  for (short i = 0; i < registerCount; i++)
+  {
+    if (registers[i].address == registerAddress)
+    {
+      return &registers[i];
+    }
+  }
+  return NULL;
+}
+
+bool RegisterShadow::read(byte registerAddress, unsigned short * value)
+{
+  shadowed_register * shadowed = find(registerAddress);
+  if (shadowed == NULL)
+  {
+    return false;
+  }
+  if (!shadowed->valid)
+  {
+    byte buffer[2];
+    if (!i2cReadBlock(wire, deviceAddress, registerAddress, buffer, shadowed->length))
+    {
+      return false;
+    }
+    shadowed->value = shadowed->length == 2 ? (buffer[0] << 8) | buffer[1] : buffer[0];
+    shadowed->valid = true;
+  }
+  *value = shadowed->value;
+  return true;
+}
+
+bool RegisterShadow::write(byte registerAddress, unsigned short value, bool force)
+{
+  shadowed_register * shadowed = find(registerAddress);
+  if (shadowed == NULL)
+  {
+    return false;
+  }
+  if (shadowed->valid && shadowed->value == value && !force)
+  {
+    return true;
+  }
+
+  byte buffer[3] = {registerAddress, 0, 0};
+  if (shadowed->length == 2)
+  {
+    buffer[1] = value >> 8;
+    buffer[2] = value & 0xFF;
+  }
+  else
+  {
+    buffer[1] = value & 0xFF;
+  }
+  // a failed write leaves the device state unknown
+  shadowed->valid = i2cWriteCommand(wire, deviceAddress, buffer, 1 + shadowed->length);
+  shadowed->value = value;
+  return shadowed->valid;
+}
+
+bool RegisterShadow::update(byte registerAddress, unsigned short mask, unsigned short bits, bool force)
+{
+  unsigned short value;
+  if (!read(registerAddress, &value))
+  {
+    return false;
+  }
+  return write(registerAddress, (value & ~mask) | (bits & mask), force);
+}
+
+void RegisterShadow::invalidate()
+{
+  for (short i = 0; i < registerCount; i++)
+  {
+    registers[i].valid = false;
+  }
+}
+
+void RegisterShadow::invalidate(byte registerAddress)
+{
+  shadowed_register * shadowed = find(registerAddress);
+  if (shadowed != NULL)
+  {
+    shadowed->valid = false;
+  }
+}
@@ -0,0 +1,65 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_REGISTER_SHADOW
+#define WATERBEAR_REGISTER_SHADOW
+
+#include <Arduino.h>
+#include <Wire_slave.h>
+
+#define MAX_SHADOWED_REGISTERS 4
+
+typedef struct shadowed_register_type
+{
+  byte address;
+  byte length; // 1 or 2 bytes, most significant byte first on the bus
+  bool valid;
+  unsigned short value;
+} shadowed_register;
+
+/*
+ * Copy of the registers of an I2C device that only change when the firmware
+ * writes them. Reads of a valid register don't touch the bus, writes of the
+ * value the device already holds are skipped, and a read-modify-write
+ * becomes a plain write. Registers the hardware changes (results, status
+ * flags, time) must not be added.
+ */
+class RegisterShadow
+{
+public:
+  RegisterShadow(TwoWire * wire, byte deviceAddress);
+  void addRegister(byte registerAddress, byte length);
+
+  bool read(byte registerAddress, unsigned short * value);
+  bool write(byte registerAddress, unsigned short value, bool force = false); // force for writes with side effects
+  bool update(byte registerAddress, unsigned short mask, unsigned short bits, bool force = false);
+
+  void invalidate(); // after a device reset or power down
+  void invalidate(byte registerAddress); // register changed outside the shadow
+
+private:
+  TwoWire * wire;
+  byte deviceAddress;
+  shadowed_register registers[MAX_SHADOWED_REGISTERS];
+  short registerCount = 0;
+
+  shadowed_register * find(byte registerAddress);
+};
+
+#endif
@@ -0,0 +1,166 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#ifndef WATERBEAR_RING_BUFFER
+#define WATERBEAR_RING_BUFFER
+
+#include <Arduino.h>
+
+// Orders the index updates against the item copies, for the compiler and the core.
+// A DMB is not strictly needed on the single Cortex-M3 core but costs one cycle.
+#if defined(__arm__)
+#define RING_BUFFER_BARRIER() __asm__ volatile("dmb" ::: "memory")
+#else
+#define RING_BUFFER_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+/*
+ * Lock free queue from one producer, usually an ISR, to one consumer, the main loop.
+ *
+ * The indices run freely and are masked into the item array, so CAPACITY must be a
+ * power of two.  Only the producer writes tail and the consumer writes head.
+ *
+ * When full the producer drops the new item, or with OVERWRITE the oldest one.  An
+ * overwritten item is never handed out torn: the producer announces the index it is
+ * writing before touching the slot, and the consumer checks the announcement after
+ * its copy and retries from the oldest intact item.
+ *
+ * Producer: push(item), or reserve() to fill the slot in place and commit().
+ * Consumer: pop(&item), or peek(items, count) a batch and release(count) it.
+ */
+template <typename T, unsigned int CAPACITY, bool OVERWRITE = false>
+class RingBuffer
+{
+  static_assert(CAPACITY > 1 && (CAPACITY & (CAPACITY - 1)) == 0, "ring buffer capacity must be a power of two");
+
+public:
+  // producer
+
+  T * reserve() // NULL when full and not overwriting
+  {
+    unsigned int index = tail;
+    if (OVERWRITE)
+    {
+      writing = index + 1;
+    }
+    else if (index - head == CAPACITY)
+    {
+      dropped = dropped + 1;
+      return NULL;
+    }
+    RING_BUFFER_BARRIER();
+    return &items[index & MASK];
+  }
+
+  void commit()
+  {
+    RING_BUFFER_BARRIER();
+    tail = tail + 1;
+  }
+
+  bool push(const T & item) // false if the item was dropped
+  {
+    T * slot = reserve();
+    if (slot == NULL)
+    {
+      return false;
+    }
+    *slot = item;
+    commit();
+    return true;
+  }
+
+  // consumer
+
+  bool pop(T * item)
+  {
+    if (peek(item, 1) == 0)
+    {
+      return false;
+    }
+    release(1);
+    return true;
+  }
+
+  // copies up to maxCount of the oldest items without removing them
+  unsigned int peek(T * destination, unsigned int maxCount)
+  {
+    while (true)
+    {
+      skipOverwritten();
+      unsigned int first = head;
+      unsigned int available = tail - first;
+      RING_BUFFER_BARRIER();
+      unsigned int count = available < maxCount ? available : maxCount;
+      for (unsigned int i = 0; i < count; i++)
+      {
+        destination[i] = items[(first + i) & MASK];
+      }
+      RING_BUFFER_BARRIER();
+      if (!OVERWRITE || writing - first <= CAPACITY)
+      {
+        return count;
+      }
+      // the producer lapped the copy
+    }
+  }
+
+  void release(unsigned int count)
+  {
+    RING_BUFFER_BARRIER();
+    head = head + count;
+  }
+
+  void clear()
+  {
+    head = tail;
+  }
+
+  // either side
+
+  bool empty() const { return head == tail; }
+  unsigned int size() const { return tail - head; } // may include overwritten items until the next peek
+  unsigned int lost() const { return dropped + overwritten; } // since start up, overwrites count once the consumer passes them
+
+private:
+  static const unsigned int MASK = CAPACITY - 1;
+
+  T items[CAPACITY];
+  volatile unsigned int head = 0; // next to read, written by the consumer
+  volatile unsigned int tail = 0; // next to write, written by the producer
+  volatile unsigned int writing = 0; // one past the index being written, OVERWRITE only
+  volatile unsigned int dropped = 0; // producer
+  volatile unsigned int overwritten = 0; // consumer
+
+  void skipOverwritten()
+  {
+    if (!OVERWRITE)
+    {
+      return;
+    }
+    unsigned int announced = writing;
+    if (announced - head > CAPACITY)
+    {
+      overwritten = overwritten + (announced - CAPACITY - head);
+      head = announced - CAPACITY;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,107 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// A sensor driver for the host tests whose readings are set by the test.
+// Each measurement adds the current values to the burst summary, and the
+// summary columns are the burst means at the sample exponent.
+
+#ifndef WATERBEAR_HOST_FIXED_VALUE_DRIVER
+#define WATERBEAR_HOST_FIXED_VALUE_DRIVER
+
+#include "sensors/sensor.h"
+
+#define FIXED_VALUE_TYPE_STRING "fixed_value"
+#define FIXED_VALUE_COLUMNS 2
+
+class FixedValueDriver : public SensorDriver
+{
+public:
+  sample_type values[FIXED_VALUE_COLUMNS];
+  unsigned long setups = 0;
+  unsigned long stops = 0;
+
+  FixedValueDriver()
+  {
+    for (short i = 0; i < FIXED_VALUE_COLUMNS; i++)
+    {
+      values[i] = makeSample(0, -2, unit_counts);
+    }
+  }
+
+  protocol_type getProtocol() { return drivertemplate; }
+  const char * getSensorTypeString() { return FIXED_VALUE_TYPE_STRING; }
+  const char * getBaseColumnHeaders() { return "a,b"; }
+
+  void setup() { setups++; }
+  void stop() { stops++; }
+
+  bool takeMeasurement()
+  {
+    for (short i = 0; i < FIXED_VALUE_COLUMNS; i++)
+    {
+      addSampleToBurstSummary(i, values[i]);
+    }
+    return true;
+  }
+
+  unsigned int appendRawData(OutputSpan * span)
+  {
+    unsigned int start = span->length();
+    for (short i = 0; i < FIXED_VALUE_COLUMNS; i++)
+    {
+      appendColumn(span, i, values[i]);
+    }
+    return span->length() - start;
+  }
+
+  unsigned int appendSummaryData(OutputSpan * span)
+  {
+    unsigned int start = span->length();
+    for (short i = 0; i < FIXED_VALUE_COLUMNS; i++)
+    {
+      appendColumn(span, i, getBurstSummaryMean(i, values[i].exponent));
+    }
+    return span->length() - start;
+  }
+
+  bool getSummaryValue(short column, sample_type * value)
+  {
+    if (column < 0 || column >= FIXED_VALUE_COLUMNS)
+    {
+      return false;
+    }
+    *value = values[column];
+    return true;
+  }
+
+  void initCalibration() {}
+  void calibrationStep(char * step, int arg_cnt, char ** args) {}
+
+protected:
+  configuration_bytes_partition getDriverSpecificConfigurationBytes()
+  {
+    configuration_bytes_partition partition;
+    memset(&partition, 0, sizeof(partition));
+    return partition;
+  }
+  void appendDriverSpecificConfigurationJSON(cJSON * json) {}
+  void setDriverDefaults() {}
+};
+
+#endif
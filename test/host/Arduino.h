@@ -0,0 +1,135 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Host stand-in for the maple core's Arduino.h, enough to build firmware
+// modules for the host tests.  Time is simulated, see host.h.
+// uint32 is 32 bit as on the target so counters wrap the same way, but it is
+// unsigned int rather than unsigned long, and unsigned long is 64 bit.
+
+#ifndef WATERBEAR_HOST_ARDUINO
+#define WATERBEAR_HOST_ARDUINO
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+
+typedef uint8_t byte;
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define BIN 2
+#define OCT 8
+#define DEC 10
+#define HEX 16
+
+#define __IO volatile
+
+enum WiringPinMode { OUTPUT, OUTPUT_OPEN_DRAIN, INPUT, INPUT_ANALOG, INPUT_PULLUP, INPUT_PULLDOWN, INPUT_FLOATING, PWM, PWM_OPEN_DRAIN };
+
+enum
+{
+  PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+  PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15,
+  PC0, PC1, PC2, PC3, PC4, PC5, PC6, PC7, PC8, PC9, PC10, PC11, PC12, PC13, PC14, PC15,
+  HOST_PIN_COUNT
+};
+
+void pinMode(uint8 pin, WiringPinMode mode);
+void digitalWrite(uint8 pin, uint8 value);
+uint32 digitalRead(uint8 pin);
+uint16 analogRead(uint8 pin);
+
+uint32 millis();
+uint32 micros();
+void delay(unsigned long milliseconds);
+void delayMicroseconds(uint32 microseconds);
+
+void noInterrupts();
+void interrupts();
+
+template <class A, class B> inline auto min(A a, B b) -> decltype(a < b ? a : b) { return a < b ? a : b; }
+template <class A, class B> inline auto max(A a, B b) -> decltype(a < b ? a : b) { return a > b ? a : b; }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class Print
+{
+public:
+  virtual size_t write(uint8 c) = 0;
+  virtual size_t write(const uint8 * buffer, uint32 size);
+  size_t write(const char * string);
+
+  size_t print(const char * string);
+  size_t print(const __FlashStringHelper * string);
+  size_t print(char c);
+  size_t print(int number, int base = DEC);
+  size_t print(unsigned int number, int base = DEC);
+  size_t print(long number, int base = DEC);
+  size_t print(unsigned long number, int base = DEC);
+  size_t print(double number, int digits = 2);
+
+  size_t println();
+  template <typename T> size_t println(T value) { return print(value) + println(); }
+  template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+// console stand in, output is discarded unless echoed
+class HardwareSerial : public Stream
+{
+public:
+  bool echo = false;
+  void begin(uint32 baud) {}
+  void end() {}
+  operator bool() { return true; }
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8 c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif
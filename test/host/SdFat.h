@@ -0,0 +1,73 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+// Host stand-in for SdFat, an in-memory card with a single directory that
+// the tests fill through host.h.  Only what the firmware modules built for
+// the host tests use.
+
+#ifndef WATERBEAR_HOST_SDFAT
+#define WATERBEAR_HOST_SDFAT
+
+#include <Arduino.h>
+
+#define O_READ 0x01
+#define O_RDONLY O_READ
+#define O_WRITE 0x02
+#define O_CREAT 0x10
+#define FILE_READ O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT)
+
+class FatFile
+{
+public:
+  bool openNext(FatFile * directory, uint8 flags = O_READ);
+  bool isOpen() { return entry >= 0; }
+  bool isDir();
+  bool close();
+  bool getName(char * name, size_t size);
+  uint32 fileSize();
+  uint32 size() { return fileSize(); }
+  bool seek(uint32 position);
+  int read(void * buffer, size_t count);
+  size_t write(const void * data, size_t count);
+  void rewind() { position = 0; }
+  operator bool() { return isOpen(); }
+
+protected:
+  friend class SdFat;
+  int entry = -1; // index on the card, or the directory's next entry
+  uint32 position = 0;
+};
+
+class File : public FatFile
+{
+};
+
+class SdFat
+{
+public:
+  FatFile * vwd() { return &workingDirectory; }
+  File open(const char * path, uint8 mode = FILE_READ);
+
+private:
+  FatFile workingDirectory;
+};
+
+#endif
@@ -0,0 +1,54 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Host stand-in for the maple core's Wire library, no devices answer.
+
+#ifndef WATERBEAR_HOST_WIRE_SLAVE
+#define WATERBEAR_HOST_WIRE_SLAVE
+
+#include <Arduino.h>
+
+#define SUCCESS 0
+#define EDATA 1
+#define ENACKADDR 2
+#define ENACKTRNS 3
+#define EOTHER 4
+
+class TwoWire : public Stream
+{
+public:
+  void begin() {}
+  void beginTransmission(uint8 address) {}
+  uint8 endTransmission() { return ENACKADDR; }
+  uint8 endTransmission(bool stop) { return ENACKADDR; }
+  uint8 requestFrom(uint8 address, uint8 quantity) { return 0; }
+  uint8 requestFrom(int address, int quantity) { return 0; }
+  void setClock(uint32 frequency) {}
+  size_t write(uint8 value) { return 1; }
+  size_t write(const uint8 * data, size_t quantity) { return quantity; }
+  using Print::write;
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+};
+
+extern TwoWire Wire;  // I2C1, WireOne in system/hardware.h
+extern TwoWire Wire1; // I2C2, WireTwo
+
+#endif
@@ -0,0 +1,194 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include "host.h"
+#include <Wire_slave.h>
+
+static uint64 simulatedMicros = 0;
+static uint16 analogValues[HOST_PIN_COUNT];
+static uint8 pinValues[HOST_PIN_COUNT];
+static uint32 pinWrites[HOST_PIN_COUNT];
+
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+TwoWire Wire;
+TwoWire Wire1;
+
+void hostSetMicros(uint64 microseconds)
+{
+  simulatedMicros = microseconds;
+}
+
+void hostAdvanceMillis(uint32 milliseconds)
+{
+  simulatedMicros += (uint64) milliseconds * 1000;
+}
+
+void hostAdvanceMicros(uint64 microseconds)
+{
+  simulatedMicros += microseconds;
+}
+
+void hostSetAnalogValue(uint8 pin, uint16 value)
+{
+  if (pin < HOST_PIN_COUNT)
+  {
+    analogValues[pin] = value;
+  }
+}
+
+uint32 hostPinWrites(uint8 pin)
+{
+  return pin < HOST_PIN_COUNT ? pinWrites[pin] : 0;
+}
+
+void pinMode(uint8 pin, WiringPinMode mode)
+{
+}
+
+void digitalWrite(uint8 pin, uint8 value)
+{
+  if (pin < HOST_PIN_COUNT)
+  {
+    pinValues[pin] = value;
+    pinWrites[pin]++;
+  }
+}
+
+uint32 digitalRead(uint8 pin)
+{
+  return pin < HOST_PIN_COUNT ? pinValues[pin] : LOW;
+}
+
+uint16 analogRead(uint8 pin)
+{
+  return pin < HOST_PIN_COUNT ? analogValues[pin] : 0;
+}
+
+uint32 millis()
+{
+  return (uint32) ((simulatedMicros / 1000) & 0xFFFFFFFF);
+}
+
+uint32 micros()
+{
+  return (uint32) (simulatedMicros & 0xFFFFFFFF);
+}
+
+void delay(unsigned long milliseconds)
+{
+  hostAdvanceMillis(milliseconds);
+}
+
+void delayMicroseconds(uint32 microseconds)
+{
+  hostAdvanceMicros(microseconds);
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+size_t Print::write(const uint8 * buffer, uint32 size)
+{
+  size_t written = 0;
+  for (uint32 i = 0; i < size; i++)
+  {
+    written += write(buffer[i]);
+  }
+  return written;
+}
+
+size_t Print::write(const char * string)
+{
+  return write((const uint8 *) string, strlen(string));
+}
+
+size_t Print::print(const char * string)
+{
+  return write(string);
+}
+
+size_t Print::print(const __FlashStringHelper * string)
+{
+  return write(reinterpret_cast<const char *>(string));
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8) c);
+}
+
+size_t Print::print(int number, int base)
+{
+  return print((long) number, base);
+}
+
+size_t Print::print(unsigned int number, int base)
+{
+  return print((unsigned long) number, base);
+}
+
+size_t Print::print(long number, int base)
+{
+  if (number < 0 && base == DEC)
+  {
+    return print('-') + print((unsigned long) -number, base);
+  }
+  return print((unsigned long) number, base);
+}
+
+size_t Print::print(unsigned long number, int base)
+{
+  char buffer[8 * sizeof(long) + 1];
+  char * digit = &buffer[sizeof(buffer) - 1];
+  *digit = '\0';
+  do
+  {
+    unsigned long remainder = number % base;
+    *--digit = remainder < 10 ? '0' + remainder : 'A' + remainder - 10;
+    number /= base;
+  } while (number > 0);
+  return write(digit);
+}
+
+size_t Print::print(double number, int digits)
+{
+  char buffer[40];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, number);
+  return write(buffer);
+}
+
+size_t Print::println()
+{
+  return write("\r\n");
+}
+
+size_t HardwareSerial::write(uint8 c)
+{
+  if (echo)
+  {
+    putchar(c);
+  }
+  return 1;
+}
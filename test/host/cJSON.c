@@ -0,0 +1,284 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Flat objects of numbers, strings and booleans, which is all the
+// configuration JSON holds.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+static char * duplicate(const char * string, size_t length)
+{
+  char * copy = (char *) malloc(length + 1);
+  memcpy(copy, string, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+static cJSON * createItem(int type)
+{
+  cJSON * item = (cJSON *) calloc(1, sizeof(cJSON));
+  item->type = type;
+  return item;
+}
+
+static void addItem(cJSON * object, const char * name, cJSON * item)
+{
+  item->string = duplicate(name, strlen(name));
+  if (object->child == NULL)
+  {
+    object->child = item;
+    return;
+  }
+  cJSON * last = object->child;
+  while (last->next != NULL)
+  {
+    last = last->next;
+  }
+  last->next = item;
+  item->prev = last;
+}
+
+void cJSON_Delete(cJSON * item)
+{
+  while (item != NULL)
+  {
+    cJSON * next = item->next;
+    cJSON_Delete(item->child);
+    free(item->valuestring);
+    free(item->string);
+    free(item);
+    item = next;
+  }
+}
+
+void cJSON_free(void * object)
+{
+  free(object);
+}
+
+cJSON * cJSON_CreateObject(void)
+{
+  return createItem(cJSON_Object);
+}
+
+cJSON * cJSON_AddNumberToObject(cJSON * object, const char * name, double number)
+{
+  cJSON * item = createItem(cJSON_Number);
+  item->valuedouble = number;
+  item->valueint = number >= 2147483647.0 ? 2147483647 : number <= -2147483648.0 ? (-2147483647 - 1) : (int) number;
+  addItem(object, name, item);
+  return item;
+}
+
+cJSON * cJSON_AddStringToObject(cJSON * object, const char * name, const char * string)
+{
+  cJSON * item = createItem(cJSON_String);
+  item->valuestring = duplicate(string, strlen(string));
+  addItem(object, name, item);
+  return item;
+}
+
+cJSON * cJSON_AddBoolToObject(cJSON * object, const char * name, cJSON_bool boolean)
+{
+  cJSON * item = createItem(boolean ? cJSON_True : cJSON_False);
+  addItem(object, name, item);
+  return item;
+}
+
+cJSON * cJSON_GetObjectItemCaseSensitive(const cJSON * object, const char * name)
+{
+  if (object == NULL || name == NULL)
+  {
+    return NULL;
+  }
+  for (cJSON * item = object->child; item != NULL; item = item->next)
+  {
+    if (item->string != NULL && strcmp(item->string, name) == 0)
+    {
+      return item;
+    }
+  }
+  return NULL;
+}
+
+cJSON_bool cJSON_IsNumber(const cJSON * item)
+{
+  return item != NULL && item->type == cJSON_Number;
+}
+
+cJSON_bool cJSON_IsString(const cJSON * item)
+{
+  return item != NULL && item->type == cJSON_String;
+}
+
+cJSON_bool cJSON_IsBool(const cJSON * item)
+{
+  return item != NULL && (item->type == cJSON_True || item->type == cJSON_False);
+}
+
+cJSON_bool cJSON_IsTrue(const cJSON * item)
+{
+  return item != NULL && item->type == cJSON_True;
+}
+
+cJSON_bool cJSON_IsFalse(const cJSON * item)
+{
+  return item != NULL && item->type == cJSON_False;
+}
+
+cJSON_bool cJSON_IsObject(const cJSON * item)
+{
+  return item != NULL && item->type == cJSON_Object;
+}
+
+static const char * skipSpaces(const char * cursor)
+{
+  while (*cursor != '\0' && isspace((unsigned char) *cursor))
+  {
+    cursor++;
+  }
+  return cursor;
+}
+
+static const char * parseString(const char * cursor, char ** string)
+{
+  if (*cursor != '"')
+  {
+    return NULL;
+  }
+  const char * end = strchr(cursor + 1, '"'); // no escapes in configuration values
+  if (end == NULL)
+  {
+    return NULL;
+  }
+  *string = duplicate(cursor + 1, end - cursor - 1);
+  return end + 1;
+}
+
+cJSON * cJSON_Parse(const char * value)
+{
+  const char * cursor = skipSpaces(value);
+  if (*cursor++ != '{')
+  {
+    return NULL;
+  }
+  cJSON * object = cJSON_CreateObject();
+  cursor = skipSpaces(cursor);
+  while (*cursor != '}')
+  {
+    char * name = NULL;
+    cursor = parseString(cursor, &name);
+    if (cursor == NULL || *(cursor = skipSpaces(cursor)) != ':')
+    {
+      free(name);
+      cJSON_Delete(object);
+      return NULL;
+    }
+    cursor = skipSpaces(cursor + 1);
+    if (*cursor == '"')
+    {
+      char * string = NULL;
+      cursor = parseString(cursor, &string);
+      if (cursor != NULL)
+      {
+        cJSON_AddStringToObject(object, name, string);
+      }
+      free(string);
+    }
+    else if (strncmp(cursor, "true", 4) == 0 || strncmp(cursor, "false", 5) == 0)
+    {
+      cJSON_AddBoolToObject(object, name, *cursor == 't');
+      cursor += *cursor == 't' ? 4 : 5;
+    }
+    else
+    {
+      char * end;
+      double number = strtod(cursor, &end);
+      cJSON_AddNumberToObject(object, name, number);
+      cursor = end == cursor ? NULL : end;
+    }
+    free(name);
+    if (cursor == NULL)
+    {
+      cJSON_Delete(object);
+      return NULL;
+    }
+    cursor = skipSpaces(cursor);
+    if (*cursor == ',')
+    {
+      cursor = skipSpaces(cursor + 1);
+    }
+    else if (*cursor != '}')
+    {
+      cJSON_Delete(object);
+      return NULL;
+    }
+  }
+  return object;
+}
+
+static size_t printItem(const cJSON * item, char * buffer)
+{
+  switch (item->type)
+  {
+  case cJSON_Number:
+    if (item->valuedouble == (double) item->valueint)
+    {
+      return sprintf(buffer, "%d", item->valueint);
+    }
+    return sprintf(buffer, "%g", item->valuedouble);
+  case cJSON_String:
+    return sprintf(buffer, "\"%s\"", item->valuestring);
+  case cJSON_True:
+    return sprintf(buffer, "true");
+  case cJSON_False:
+    return sprintf(buffer, "false");
+  default:
+    return sprintf(buffer, "null");
+  }
+}
+
+char * cJSON_PrintUnformatted(const cJSON * item)
+{
+  size_t size = 3;
+  for (const cJSON * child = item->child; child != NULL; child = child->next)
+  {
+    size += strlen(child->string) + (child->valuestring != NULL ? strlen(child->valuestring) : 0) + 40;
+  }
+  char * buffer = (char *) malloc(size);
+  char * cursor = buffer;
+  *cursor++ = '{';
+  for (const cJSON * child = item->child; child != NULL; child = child->next)
+  {
+    cursor += sprintf(cursor, "%s\"%s\":", child == item->child ? "" : ",", child->string);
+    cursor += printItem(child, cursor);
+  }
+  *cursor++ = '}';
+  *cursor = '\0';
+  return buffer;
+}
+
+char * cJSON_Print(const cJSON * item)
+{
+  return cJSON_PrintUnformatted(item);
+}
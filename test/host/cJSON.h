@@ -0,0 +1,77 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Host stand-in for the subset of cJSON the firmware uses, the firmware
+// builds against the real library (lib_deps in platformio.ini).
+
+#ifndef WATERBEAR_HOST_CJSON
+#define WATERBEAR_HOST_CJSON
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define cJSON_Invalid 0
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_NULL (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef int cJSON_bool;
+
+typedef struct cJSON
+{
+  struct cJSON * next;
+  struct cJSON * prev;
+  struct cJSON * child;
+  int type;
+  char * valuestring;
+  int valueint;
+  double valuedouble;
+  char * string;
+} cJSON;
+
+cJSON * cJSON_Parse(const char * value);
+char * cJSON_Print(const cJSON * item);
+char * cJSON_PrintUnformatted(const cJSON * item);
+void cJSON_Delete(cJSON * item);
+void cJSON_free(void * object);
+
+cJSON * cJSON_CreateObject(void);
+cJSON * cJSON_AddNumberToObject(cJSON * object, const char * name, double number);
+cJSON * cJSON_AddStringToObject(cJSON * object, const char * name, const char * string);
+cJSON * cJSON_AddBoolToObject(cJSON * object, const char * name, cJSON_bool boolean);
+cJSON * cJSON_GetObjectItemCaseSensitive(const cJSON * object, const char * name);
+
+cJSON_bool cJSON_IsNumber(const cJSON * item);
+cJSON_bool cJSON_IsString(const cJSON * item);
+cJSON_bool cJSON_IsBool(const cJSON * item);
+cJSON_bool cJSON_IsTrue(const cJSON * item);
+cJSON_bool cJSON_IsFalse(const cJSON * item);
+cJSON_bool cJSON_IsObject(const cJSON * item);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Minimal assertions for the host tests, each test is a program that
+// returns non zero when a check failed.
+
+#ifndef WATERBEAR_HOST_CHECK
+#define WATERBEAR_HOST_CHECK
+
+#include <stdio.h>
+#include <math.h>
+
+static unsigned long checksRun = 0;
+static unsigned long checksFailed = 0;
+
+static inline bool checkResult(bool passed, const char * file, int line, const char * expression)
+{
+  checksRun++;
+  if (!passed)
+  {
+    checksFailed++;
+    if (checksFailed <= 20)
+    {
+      fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+  }
+  return passed;
+}
+
+#define CHECK(condition) checkResult((condition), __FILE__, __LINE__, #condition)
+#define CHECK_EQUAL(expected, actual) checkResult((expected) == (actual), __FILE__, __LINE__, #expected " == " #actual)
+#define CHECK_CLOSE(expected, actual, tolerance) checkResult(fabs((double) (expected) - (double) (actual)) <= (tolerance), __FILE__, __LINE__, #expected " ~ " #actual)
+
+static inline int checkSummary(const char * name)
+{
+  printf("%s: %lu checks, %lu failed\n", name, checksRun, checksFailed);
+  return checksFailed == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Host stand-in for the STM32 CRC unit, the same algorithm in software.
+
+#include "system/crc.h"
+
+void enableHardwareCRC()
+{
+}
+
+static uint32_t crcWord(uint32_t crc, uint32_t word)
+{
+  crc ^= word;
+  for (short bit = 0; bit < 32; bit++)
+  {
+    crc = crc & 0x80000000 ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+  }
+  return crc;
+}
+
+uint32 hardwareCRC32(const void * data, unsigned int length)
+{
+  const uint8 * bytes = (const uint8 *) data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (unsigned int i = 0; i < length; i += 4)
+  {
+    uint32_t word = 0;
+    memcpy(&word, &bytes[i], length - i < 4 ? length - i : 4); // little endian words, zero padded
+    crc = crcWord(crc, word);
+  }
+  return crc;
+}
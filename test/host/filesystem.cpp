@@ -0,0 +1,64 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Host stand-in for the file system module over the in-memory card: the
+// read access used for offloading, and log files that write straight to
+// the card.  Nothing is initialised and the logging folder is the card.
+
+#include "system/filesystem.h"
+
+WaterBear_FileSystem::WaterBear_FileSystem(char * loggingFolder, int chipSelectPin)
+{
+  strcpy(this->loggingFolder, loggingFolder);
+  this->chipSelectPin = chipSelectPin;
+  summaryFile.fileSystem = this;
+  rawFile.fileSystem = this;
+}
+
+void LogFile::writeString(const char * string)
+{
+  file.write(string, strlen(string));
+}
+
+void LogFile::beginBlock(unsigned int length)
+{
+}
+
+bool WaterBear_FileSystem::openNextDataFile(FatFile * file, bool first)
+{
+  if (first)
+  {
+    sd.vwd()->rewind();
+  }
+  while (file->openNext(sd.vwd(), O_READ))
+  {
+    if (!file->isDir())
+    {
+      return true;
+    }
+    file->close();
+  }
+  return false;
+}
+
+bool WaterBear_FileSystem::openDataFile(const char * filename, File * file)
+{
+  *file = sd.open(filename, FILE_READ);
+  return *file;
+}
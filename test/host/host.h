@@ -0,0 +1,41 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Controls for the host stand-ins, used by the tests.
+
+#ifndef WATERBEAR_HOST
+#define WATERBEAR_HOST
+
+#include <Arduino.h>
+
+// millis() and micros() only move when the test advances them, delay() advances
+// them too.  millis() wraps at 2^32 as on the target.
+void hostSetMicros(uint64 microseconds);
+void hostAdvanceMillis(uint32 milliseconds);
+void hostAdvanceMicros(uint64 microseconds);
+
+void hostSetAnalogValue(uint8 pin, uint16 value);
+uint32 hostPinWrites(uint8 pin); // digitalWrite calls on the pin
+
+// the in-memory SD card, a single directory listed in the order written
+void hostSdClear();
+void hostSdWriteFile(const char * name, const char * data, uint32 length);
+void hostSdMakeDirectory(const char * name);
+
+#endif
@@ -0,0 +1,117 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// debug() and notify() for the host tests, printed when RRIV_HOST_VERBOSE is set.
+
+#include "system/logs.h"
+
+static bool verbose()
+{
+  static int enabled = -1;
+  if (enabled < 0)
+  {
+    enabled = getenv("RRIV_HOST_VERBOSE") != NULL;
+  }
+  return enabled;
+}
+
+void debug(const char * message)
+{
+  if (verbose())
+  {
+    printf("debug: %s\n", message);
+  }
+}
+
+void debug(const __FlashStringHelper * message)
+{
+  debug(reinterpret_cast<const char *>(message));
+}
+
+void debug(short number)
+{
+  debug((int) number);
+}
+
+void debug(int number)
+{
+  char buffer[16];
+  sprintf(buffer, "%d", number);
+  debug(buffer);
+}
+
+void debug(uint32 number)
+{
+  char buffer[24];
+  sprintf(buffer, "%u", number);
+  debug(buffer);
+}
+
+void debug(float number)
+{
+  debug((double) number);
+}
+
+void debug(double number)
+{
+  char buffer[32];
+  sprintf(buffer, "%f", number);
+  debug(buffer);
+}
+
+void notify(const char * message)
+{
+  if (verbose())
+  {
+    printf("%s\n", message);
+  }
+}
+
+void notify(const __FlashStringHelper * message)
+{
+  notify(reinterpret_cast<const char *>(message));
+}
+
+void notify(short number)
+{
+  notify((int) number);
+}
+
+void notify(int number)
+{
+  char buffer[16];
+  sprintf(buffer, "%d", number);
+  notify(buffer);
+}
+
+void notify(unsigned int number)
+{
+  char buffer[16];
+  sprintf(buffer, "%u", number);
+  notify(buffer);
+}
+
+// notify(uint32) is notify(unsigned int) on the host
+
+void notify(double number)
+{
+  char buffer[32];
+  sprintf(buffer, "%f", number);
+  notify(buffer);
+}
@@ -0,0 +1,143 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+#include <string>
+#include <vector>
+#include "host.h"
+#include "SdFat.h"
+
+typedef struct sd_entry
+{
+  std::string name;
+  std::string data;
+  bool directory;
+} sd_entry;
+
+static std::vector<sd_entry> card;
+
+void hostSdClear()
+{
+  card.clear();
+}
+
+void hostSdWriteFile(const char * name, const char * data, uint32 length)
+{
+  sd_entry entry = {name, std::string(data, length), false};
+  card.push_back(entry);
+}
+
+void hostSdMakeDirectory(const char * name)
+{
+  sd_entry entry = {name, "", true};
+  card.push_back(entry);
+}
+
+bool FatFile::openNext(FatFile * directory, uint8 flags)
+{
+  if (directory->position >= card.size())
+  {
+    return false;
+  }
+  entry = directory->position++;
+  position = 0;
+  return true;
+}
+
+bool FatFile::isDir()
+{
+  return isOpen() && card[entry].directory;
+}
+
+bool FatFile::close()
+{
+  entry = -1;
+  position = 0;
+  return true;
+}
+
+bool FatFile::getName(char * name, size_t size)
+{
+  if (!isOpen() || card[entry].name.length() >= size)
+  {
+    return false;
+  }
+  strcpy(name, card[entry].name.c_str());
+  return true;
+}
+
+uint32 FatFile::fileSize()
+{
+  return isOpen() ? card[entry].data.length() : 0;
+}
+
+bool FatFile::seek(uint32 position)
+{
+  if (!isOpen() || position > fileSize())
+  {
+    return false;
+  }
+  this->position = position;
+  return true;
+}
+
+int FatFile::read(void * buffer, size_t count)
+{
+  if (!isOpen())
+  {
+    return -1;
+  }
+  size_t available = fileSize() - position;
+  if (count > available)
+  {
+    count = available;
+  }
+  memcpy(buffer, card[entry].data.data() + position, count);
+  position += count;
+  return count;
+}
+
+size_t FatFile::write(const void * data, size_t count)
+{
+  if (!isOpen())
+  {
+    return 0;
+  }
+  card[entry].data.replace(position, count, (const char *) data, count);
+  position += count;
+  return count;
+}
+
+File SdFat::open(const char * path, uint8 mode)
+{
+  File file;
+  for (unsigned int i = 0; i < card.size(); i++)
+  {
+    if (card[i].name == path && !card[i].directory)
+    {
+      file.entry = i;
+      return file;
+    }
+  }
+  if (mode & O_CREAT)
+  {
+    hostSdWriteFile(path, "", 0);
+    file.entry = card.size() - 1;
+  }
+  return file;
+}
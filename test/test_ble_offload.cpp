@@ -0,0 +1,426 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+// BLE offload against a simulated central on a lossy link: listing, whole
+// downloads with dropped and refused frames, resuming after a disconnect
+// and from an offset, and the connect timeout.  Files are on the in-memory
+// card and time only moves with the link.
+
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "system/ble_offload.h"
+#include "system/crc.h"
+#include "check.h"
+
+#define LINK_MICROSECONDS_PER_BYTE 100 // 10 kB/s
+#define CENTRAL_STALL_MILLISECONDS 10000 // asks for the file again
+
+static std::mt19937 generator(20207);
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(generator);
+}
+
+// bytewise, as tools/verify_log_crc.py, independent of the stand-in for the CRC unit
+static uint32_t referenceCRC32(const byte * data, unsigned int length)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  for (unsigned int i = 0; i < length; i += 4)
+  {
+    for (int j = 3; j >= 0; j--)
+    {
+      byte b = i + j < length ? data[i + j] : 0;
+      crc ^= (uint32_t) b << 24;
+      for (short bit = 0; bit < 8; bit++)
+      {
+        crc = crc & 0x80000000 ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+      }
+    }
+  }
+  return crc;
+}
+
+struct test_file
+{
+  std::string name;
+  std::string data;
+};
+
+static std::vector<test_file> files;
+
+class SimulatedCentral : public OffloadLink
+{
+public:
+  double dropRate = 0; // frames lost on the air
+  double busyRate = 0; // writes refused by a full module FIFO
+  bool linkConnected = true;
+  uint32 disconnectAfter = 0; // bytes of the current file, 0 never
+  uint32 ackLatency = 30;
+
+  std::vector<std::string> lines; // text from the logger
+  std::vector<std::string> downloads; // names left to get, then bye
+  std::string current;
+  std::string received;
+  uint32 fileOffset = 0; // from the file line
+  uint32 lastDeliveredAck = 0;
+  bool complete = false;
+
+  unsigned long frames = 0;
+  unsigned long dropped = 0;
+  unsigned long duplicates = 0;
+  unsigned long gaps = 0;
+  unsigned long badFrames = 0;
+  unsigned long stalls = 0;
+
+  void send(const std::string & text, uint32 delay = 0)
+  {
+    for (unsigned int i = 0; i < text.length(); i++)
+    {
+      pending.push_back(std::make_pair(millis() + delay, text[i]));
+    }
+  }
+
+  void getNext()
+  {
+    if (downloads.empty())
+    {
+      send("bye\n");
+      return;
+    }
+    received.clear();
+    get(downloads.front());
+    downloads.erase(downloads.begin());
+  }
+
+  // from the resume cursor unless an offset is given
+  void get(const std::string & name, const char * offset = NULL)
+  {
+    current = name;
+    complete = false;
+    send("get " + name + (offset != NULL ? std::string(" ") + offset : "") + "\n");
+    lastProgress = millis();
+  }
+
+  bool connected()
+  {
+    hostAdvanceMillis(1);
+    if (!current.empty() && !complete && millis() - lastProgress > CENTRAL_STALL_MILLISECONDS)
+    {
+      stalls++;
+      get(current);
+    }
+    return linkConnected;
+  }
+
+  unsigned int read(byte * buffer, unsigned int length)
+  {
+    unsigned int copied = 0;
+    while (copied < length && !pending.empty() && pending.front().first <= millis())
+    {
+      buffer[copied++] = pending.front().second;
+      acknowledgement += pending.front().second;
+      pending.pop_front();
+      if (buffer[copied - 1] == '\n')
+      {
+        if (acknowledgement.compare(0, 4, "ack ") == 0)
+        {
+          lastDeliveredAck = strtoul(acknowledgement.c_str() + 4, NULL, 10);
+        }
+        acknowledgement.clear();
+      }
+    }
+    return copied;
+  }
+
+  unsigned int write(const byte * data, unsigned int length)
+  {
+    hostAdvanceMicros(length * LINK_MICROSECONDS_PER_BYTE);
+    if (!linkConnected)
+    {
+      return length; // into the void
+    }
+    if (uniform(0, 1) < busyRate)
+    {
+      return 0;
+    }
+    if (data[0] == BLE_OFFLOAD_FRAME_MARKER)
+    {
+      if (uniform(0, 1) < dropRate)
+      {
+        dropped++;
+      }
+      else
+      {
+        receiveFrame(data, length);
+      }
+      return length;
+    }
+
+    std::string text((const char *) data, length);
+    CHECK(text[length - 1] == '\n');
+    text.erase(length - 1);
+    lines.push_back(text);
+    if (text.compare(0, 5, "file,") == 0)
+    {
+      // file,<name>,<size>,<offset>
+      fileOffset = strtoul(text.c_str() + text.rfind(',') + 1, NULL, 10);
+      CHECK(fileOffset <= received.length());
+      received.resize(fileOffset);
+    }
+    return length;
+  }
+
+private:
+  std::deque<std::pair<uint32, char> > pending;
+  std::string acknowledgement;
+  uint32 lastProgress = 0;
+
+  void receiveFrame(const byte * frame, unsigned int length)
+  {
+    frames++;
+    unsigned int payload = frame[2];
+    uint32_t offset = 0;
+    uint32_t crc = 0;
+    for (byte i = 0; i < 4; i++)
+    {
+      offset |= (uint32_t) frame[3 + i] << (8 * i);
+      crc |= (uint32_t) frame[7 + payload + i] << (8 * i);
+    }
+    if (!CHECK_EQUAL(BLE_OFFLOAD_FRAME_OVERHEAD + payload, length) || !CHECK_EQUAL(referenceCRC32(frame, 7 + payload), crc))
+    {
+      badFrames++;
+      return;
+    }
+    CHECK(payload <= BLE_OFFLOAD_PAYLOAD_SIZE);
+    CHECK(length <= BLE_OFFLOAD_FRAME_SIZE);
+
+    if (frame[1] == 'E')
+    {
+      CHECK_EQUAL(received.length(), offset);
+      complete = true;
+      getNext();
+      return;
+    }
+    CHECK_EQUAL('D', frame[1]);
+    if (offset < received.length())
+    {
+      duplicates++;
+      return;
+    }
+    if (offset > received.length())
+    {
+      gaps++; // go back n, wait for the resend
+      return;
+    }
+    received.append((const char *) &frame[7], payload);
+    lastProgress = millis();
+    if (disconnectAfter > 0 && received.length() >= disconnectAfter)
+    {
+      linkConnected = false;
+      return;
+    }
+    char ack[20];
+    sprintf(ack, "ack %lu\n", (unsigned long) received.length());
+    send(ack, ackLatency);
+  }
+};
+
+static WaterBear_FileSystem fileSystem("logs", 0);
+
+static void writeFiles()
+{
+  hostSdClear();
+  files.clear();
+  unsigned long sizes[] = {0, 1, BLE_OFFLOAD_PAYLOAD_SIZE, BLE_OFFLOAD_PAYLOAD_SIZE + 1, BLE_OFFLOAD_WINDOW * BLE_OFFLOAD_PAYLOAD_SIZE, 50000, 200000};
+  for (unsigned short i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    test_file file;
+    char name[20];
+    sprintf(name, "%lu.CSV", 1600000000UL + i * 3600);
+    file.name = name;
+    for (unsigned long j = 0; j < sizes[i]; j++)
+    {
+      file.data += (char) generator();
+    }
+    files.push_back(file);
+    hostSdWriteFile(file.name.c_str(), file.data.data(), file.data.length());
+    if (i == 2)
+    {
+      hostSdMakeDirectory("OLD");
+    }
+  }
+}
+
+void crcStandIn()
+{
+  // values from tools/verify_log_crc.py
+  CHECK_EQUAL(0xAFF19057UL, hardwareCRC32("123456789", 9));
+  CHECK_EQUAL(0xFFFFFFFFUL, hardwareCRC32("", 0));
+  CHECK_EQUAL(0x6F60065BUL, hardwareCRC32("a", 1));
+  CHECK_EQUAL(0xC2091428UL, hardwareCRC32("1234", 4));
+
+  byte data[64];
+  for (int trial = 0; trial < 10000; trial++)
+  {
+    unsigned int length = generator() % sizeof(data);
+    for (unsigned int i = 0; i < length; i++)
+    {
+      data[i] = generator();
+    }
+    CHECK_EQUAL(referenceCRC32(data, length), hardwareCRC32(data, length));
+  }
+}
+
+void commands()
+{
+  SimulatedCentral central;
+  central.send("list\n");
+  central.send("frob\r\n");
+  central.send("get NOTHERE.CSV\n");
+  central.send("get " + std::string(BLE_OFFLOAD_FILENAME_LENGTH, 'X') + "\n");
+  central.send("ack 10\n"); // nothing in transfer
+  central.send("bye\n");
+  central.send("list\n"); // after the session ended
+  BleOffload offload(&fileSystem);
+  offload.run(&central, 1000);
+
+  std::vector<std::string> expected;
+  for (unsigned short i = 0; i < files.size(); i++)
+  {
+    char line[40];
+    sprintf(line, "%s,%lu", files[i].name.c_str(), (unsigned long) files[i].data.length());
+    expected.push_back(line);
+  }
+  expected.push_back(".");
+  expected.push_back("error,command");
+  expected.push_back("error,file");
+  expected.push_back("error,file");
+  expected.push_back("bye");
+  CHECK(central.lines == expected);
+  CHECK_EQUAL(0UL, central.frames);
+}
+
+static void downloadAll(double dropRate, double busyRate)
+{
+  BleOffload offload(&fileSystem);
+  unsigned long dropped = 0;
+  for (unsigned short i = 0; i < files.size(); i++)
+  {
+    SimulatedCentral central;
+    central.dropRate = dropRate;
+    central.busyRate = busyRate;
+    central.downloads.push_back(files[i].name);
+    central.getNext();
+    uint32 started = millis();
+    offload.run(&central, 1000);
+    if (!CHECK(central.complete && central.received == files[i].data))
+    {
+      fprintf(stderr, "%s: %lu of %lu bytes, drop rate %.2f\n", files[i].name.c_str(), (unsigned long) central.received.length(), (unsigned long) files[i].data.length(), dropRate);
+    }
+    CHECK_EQUAL(0UL, central.badFrames);
+    if (dropRate == 0)
+    {
+      // the window keeps the link busy, nothing is sent twice
+      CHECK_EQUAL(0UL, central.duplicates + central.gaps + central.stalls);
+      double seconds = (millis() - started) / 1000.0;
+      CHECK(seconds < 0.1 + files[i].data.length() * LINK_MICROSECONDS_PER_BYTE / 1e6 * 1.2 / (1 - busyRate));
+    }
+    dropped += central.dropped;
+  }
+  CHECK(dropRate == 0 || dropped > 0);
+}
+
+void downloads()
+{
+  downloadAll(0, 0);
+  downloadAll(0, 0.3);
+  downloadAll(0.05, 0);
+  downloadAll(0.3, 0.3);
+}
+
+void resume()
+{
+  const test_file & file = files.back();
+  BleOffload offload(&fileSystem);
+
+  // the link drops mid file, the session ends on the idle timeout
+  SimulatedCentral central;
+  central.disconnectAfter = file.data.length() / 3;
+  central.get(file.name, "0"); // downloaded before, the cursor is at the end
+  uint32 started = millis();
+  offload.run(&central, 1000);
+  CHECK(!central.complete);
+  CHECK(millis() - started >= BLE_OFFLOAD_IDLE_TIMEOUT_MILLISECONDS);
+  uint32 acknowledged = central.lastDeliveredAck;
+  CHECK(acknowledged > 0 && acknowledged < central.received.length());
+
+  // a new session continues from the last acknowledged byte
+  std::string partial = central.received.substr(0, acknowledged);
+  SimulatedCentral reconnected;
+  reconnected.received = partial;
+  reconnected.get(file.name);
+  offload.run(&reconnected, 1000);
+  CHECK_EQUAL(acknowledged, reconnected.fileOffset);
+  CHECK(reconnected.complete && reconnected.received == file.data);
+  CHECK_EQUAL(0UL, reconnected.duplicates);
+
+  // or from an explicit offset
+  SimulatedCentral fromOffset;
+  fromOffset.received = file.data.substr(0, 1000);
+  fromOffset.get(file.name, "1000");
+  offload.run(&fromOffset, 1000);
+  CHECK_EQUAL(1000UL, fromOffset.fileOffset);
+  CHECK(fromOffset.complete && fromOffset.received == file.data);
+
+  // a whole file only has its end frame
+  SimulatedCentral again;
+  again.received = file.data;
+  again.get(file.name);
+  offload.run(&again, 1000);
+  CHECK_EQUAL(file.data.length(), again.fileOffset);
+  CHECK(again.complete);
+  CHECK_EQUAL(1UL, again.frames);
+}
+
+void connectTimeout()
+{
+  SimulatedCentral central;
+  central.linkConnected = false;
+  BleOffload offload(&fileSystem);
+  uint32 started = millis();
+  offload.run(&central, 5000);
+  uint32 elapsed = millis() - started;
+  CHECK(elapsed > 5000 && elapsed < 5100);
+}
+
+int main()
+{
+  writeFiles();
+  crcStandIn();
+  commands();
+  downloads();
+  resume();
+  connectTimeout();
+  return checkSummary("ble_offload");
+}
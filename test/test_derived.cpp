@@ -0,0 +1,357 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+// Derived column bytecode against double precision references: random
+// expressions over two fixed value slots are compiled and evaluated, and
+// the compiler's size and stack limits are checked against the expected
+// encoding of each expression.
+
+#include <random>
+#include <string>
+#include "sensors/drivers/derived.h"
+#include "fixed_value_driver.h"
+#include "check.h"
+
+#define FLOAT_EPSILON 1.2e-7
+
+static std::mt19937 generator(20203);
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(generator);
+}
+
+static int integer(int low, int high)
+{
+  return std::uniform_int_distribution<int>(low, high)(generator);
+}
+
+static FixedValueDriver ec;
+static FixedValueDriver dht;
+static DerivedDriver derived;
+static SensorDriver * drivers[] = {&ec, &dht, &derived};
+
+static bool configure(SensorDriver * driver, const char * json)
+{
+  cJSON * configuration = cJSON_Parse(json);
+  bool configured = driver->configureFromJSON(configuration);
+  cJSON_Delete(configuration);
+  return configured;
+}
+
+static bool configureExpression(DerivedDriver * driver, short slot, const char * tag, const char * expression)
+{
+  cJSON * configuration = cJSON_CreateObject();
+  cJSON_AddNumberToObject(configuration, "slot", slot);
+  cJSON_AddStringToObject(configuration, "tag", tag);
+  cJSON_AddNumberToObject(configuration, "burst_size", 1);
+  cJSON_AddStringToObject(configuration, "expression", expression);
+  bool configured = driver->configureFromJSON(configuration);
+  cJSON_Delete(configuration);
+  return configured;
+}
+
+// an expression with its double value, the float rounding error it may
+// accumulate, and the bytecode size and peak stack depth it compiles to
+struct expression_type
+{
+  std::string text;
+  double value;
+  double error;
+  int size;
+  int peak;
+  bool valid; // false when the reference is too ill conditioned to compare
+};
+
+static expression_type leaf()
+{
+  expression_type e;
+  char text[24];
+  e.peak = 1;
+  e.valid = true;
+  switch (integer(0, 3))
+  {
+  case 0:
+  case 1:
+  {
+    FixedValueDriver * driver = integer(0, 1) ? &ec : &dht;
+    short column = integer(0, 1);
+    sprintf(text, "%s_%s", driver == &ec ? "ec" : "dht", column ? "b" : "a");
+    e.value = sampleToFloat(driver->values[column]);
+    e.size = 2;
+    break;
+  }
+  case 2:
+    if (integer(0, 1))
+    {
+      int constant = integer(0, 127);
+      sprintf(text, "%d", constant);
+      e.size = 2;
+    }
+    else
+    {
+      int milli = integer(0, 7) ? integer(1, 32767) : 32767; // and the edge of the range
+      if (milli % 1000 == 0)
+      {
+        milli++;
+      }
+      sprintf(text, "%d.%03d", milli / 1000, milli % 1000);
+      e.size = 3;
+    }
+    e.value = strtod(text, NULL);
+    break;
+  default:
+    // beyond the int16 milli range, stored as a float
+    sprintf(text, "%.4f", floor(uniform(33, 999)) + 0.0001 * integer(1, 9999));
+    e.value = strtod(text, NULL);
+    e.size = 5;
+  }
+  e.text = text;
+  e.error = fabs(e.value) * FLOAT_EPSILON;
+  return e;
+}
+
+static expression_type expression(int depth)
+{
+  if (depth == 0 || integer(0, 3) == 0)
+  {
+    return leaf();
+  }
+  if (integer(0, 7) == 0)
+  {
+    expression_type e = expression(depth - 1);
+    e.text = "-(" + e.text + ")";
+    e.value = -e.value;
+    e.size += 1;
+    return e;
+  }
+
+  expression_type a = expression(depth - 1);
+  expression_type b = expression(depth - 1);
+  expression_type e;
+  char op = "+-*/"[integer(0, 3)];
+  e.text = "(" + a.text + " " + op + " " + b.text + ")";
+  e.size = a.size + b.size + 1;
+  e.peak = std::max(a.peak, 1 + b.peak);
+  e.valid = a.valid && b.valid;
+  switch (op)
+  {
+  case '+':
+    e.value = a.value + b.value;
+    e.error = a.error + b.error;
+    break;
+  case '-':
+    e.value = a.value - b.value;
+    e.error = a.error + b.error;
+    break;
+  case '*':
+    e.value = a.value * b.value;
+    e.error = fabs(a.value) * b.error + fabs(b.value) * a.error + a.error * b.error;
+    break;
+  default:
+    e.valid = e.valid && fabs(b.value) > 0.5 && b.error < fabs(b.value) / 2;
+    e.value = a.value / b.value;
+    e.error = e.valid ? (a.error + fabs(e.value) * b.error) / (fabs(b.value) - b.error) : 0;
+  }
+  e.error += fabs(e.value) * FLOAT_EPSILON;
+  e.valid = e.valid && fabs(e.value) < 1e6;
+  return e;
+}
+
+static void randomizeSlots()
+{
+  for (short i = 0; i < FIXED_VALUE_COLUMNS; i++)
+  {
+    ec.values[i] = makeSample(integer(-10000, 10000), -2, unit_counts);
+    dht.values[i] = makeSample(integer(-10000, 10000), -2, unit_counts);
+  }
+}
+
+void randomExpressions()
+{
+  int compared = 0;
+  int rejected = 0;
+  for (int trial = 0; trial < 200000; trial++)
+  {
+    randomizeSlots();
+    expression_type e = expression(1 + trial % 6);
+    bool fits = e.size <= DERIVED_BYTECODE_SIZE && e.peak <= DERIVED_STACK_DEPTH;
+    bool compiled = configureExpression(&derived, 3, "sc", e.text.c_str());
+    if (!CHECK_EQUAL(fits, compiled))
+    {
+      fprintf(stderr, "%s: %d bytes, depth %d\n", e.text.c_str(), e.size, e.peak);
+      continue;
+    }
+    if (!compiled)
+    {
+      rejected++;
+      continue;
+    }
+
+    cJSON * json = derived.getConfigurationJSON();
+    if (!CHECK_EQUAL(e.size, cJSON_GetObjectItemCaseSensitive(json, "bytecode_size")->valueint))
+    {
+      fprintf(stderr, "%s: %d bytes, compiled to %d\n", e.text.c_str(), e.size, cJSON_GetObjectItemCaseSensitive(json, "bytecode_size")->valueint);
+    }
+    cJSON_Delete(json);
+
+    if (!e.valid)
+    {
+      continue;
+    }
+    compared++;
+    sample_type value;
+    CHECK(derived.getSummaryValue(0, &value));
+    CHECK_EQUAL(-3, value.exponent);
+    double tolerance = 0.0005 + 4 * e.error + fabs(e.value) * FLOAT_EPSILON;
+    if (!CHECK_CLOSE(e.value, value.value / 1000.0, tolerance))
+    {
+      fprintf(stderr, "%s = %f, evaluated %ld e-3\n", e.text.c_str(), e.value, value.value);
+    }
+  }
+  // both sides of the limits were exercised
+  CHECK(compared > 50000);
+  CHECK(rejected > 1000);
+}
+
+void storedBytecode()
+{
+  // the stored configuration evaluates as the compiled one
+  for (int trial = 0; trial < 10000; trial++)
+  {
+    randomizeSlots();
+    expression_type e = expression(4);
+    if (!configureExpression(&derived, 3, "sc", e.text.c_str()))
+    {
+      continue;
+    }
+    DerivedDriver restored;
+    restored.configureFromBytes(derived.getConfigurationBytes());
+    sample_type expected;
+    sample_type value;
+    bool evaluated = derived.getSummaryValue(0, &expected);
+    CHECK_EQUAL(evaluated, restored.getSummaryValue(0, &value));
+    CHECK(!evaluated || value.value == expected.value);
+  }
+
+  // corrupt lengths evaluate to an empty column
+  configuration_bytes bytes = derived.getConfigurationBytes();
+  bytes.specific[0] = DERIVED_BYTECODE_SIZE + 1;
+  DerivedDriver restored;
+  restored.configureFromBytes(bytes);
+  sample_type value;
+  CHECK(!restored.getSummaryValue(0, &value));
+}
+
+void examples()
+{
+  // the README example: ec compensated to 25 C
+  ec.values[0] = makeSample(141300, -2, unit_counts);
+  dht.values[0] = makeSample(1850, -2, unit_counts);
+  CHECK(configureExpression(&derived, 3, "sc", "ec_a / (1 + 0.02 * (dht_a - 25))"));
+  sample_type value;
+  CHECK(derived.getSummaryValue(0, &value));
+  CHECK_CLOSE(1413.0 / (1 + 0.02 * (18.5 - 25)), value.value / 1000.0, 0.001);
+
+  cJSON * json = derived.getConfigurationJSON();
+  CHECK(strcmp("ec_a 1 0.020 dht_a 25 - * + /", cJSON_GetObjectItemCaseSensitive(json, "rpn")->valuestring) == 0);
+  CHECK_EQUAL(15, cJSON_GetObjectItemCaseSensitive(json, "bytecode_size")->valueint);
+  cJSON_Delete(json);
+
+  // precedence, associativity and unary minus
+  ec.values[0] = makeSample(700, -2, unit_counts);
+  ec.values[1] = makeSample(200, -2, unit_counts);
+  const char * expressions[] = {"ec_a - ec_b - 1", "ec_a / ec_b / 2", "-ec_a * ec_b + 3", "2 * (ec_a + ec_b) - -ec_b", " ( ec_a ) "};
+  double expected[] = {4, 1.75, -11, 20, 7};
+  for (short i = 0; i < 5; i++)
+  {
+    CHECK(configureExpression(&derived, 3, "sc", expressions[i]));
+    CHECK(derived.getSummaryValue(0, &value));
+    if (!CHECK_EQUAL(lround(expected[i] * 1000), value.value))
+    {
+      fprintf(stderr, "%s evaluated %ld e-3\n", expressions[i], value.value);
+    }
+  }
+
+  // no value when a reference or the result is missing
+  CHECK(configureExpression(&derived, 3, "sc", "ec_a / (ec_b - 2)"));
+  CHECK(!derived.getSummaryValue(0, &value));
+  ec.values[1] = makeSample(SAMPLE_MISSING, -2, unit_counts);
+  CHECK(configureExpression(&derived, 3, "sc", "ec_a + ec_b"));
+  CHECK(!derived.getSummaryValue(0, &value));
+  CHECK(!derived.getSummaryValue(1, &value));
+}
+
+void compileErrors()
+{
+  const char * invalid[] = {
+    "", "ec_a +", "(ec_a", "ec_a)", "ec_a ec_b", "ec_c", "xx_a", "sc_value", "ec_a % 2", "*ec_a",
+    "1+1+1+1+1+1+1+1+1+1+1", // 22 bytes of constants and 10 adds
+    "1+(1+(1+(1+(1+(1+(1+(1+1)))))))", // nine deep
+  };
+  for (unsigned short i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+  {
+    if (!CHECK(!configureExpression(&derived, 3, "sc", invalid[i])))
+    {
+      fprintf(stderr, "compiled %s\n", invalid[i]);
+    }
+  }
+  CHECK(!configure(&derived, "{\"slot\":3,\"tag\":\"sc\",\"burst_size\":1}"));
+  CHECK(!configure(&derived, "{\"slot\":3,\"tag\":\"sc\",\"burst_size\":1,\"expression\":7}"));
+
+  // at the limits
+  CHECK(configureExpression(&derived, 3, "sc", "1+1+1+1+1+1+1+1+1+1"));
+  CHECK(configureExpression(&derived, 3, "sc", "1+(1+(1+(1+(1+(1+(1+1))))))"));
+}
+
+void referenceCycles()
+{
+  // derived slots referencing each other evaluate to nothing instead of recursing
+  DerivedDriver other;
+  SensorDriver * cycle[] = {&ec, &dht, &derived, &other};
+  DerivedDriver::setSlotDrivers(cycle, 4);
+  CHECK(configureExpression(&derived, 3, "sc", "ec_a"));
+  CHECK(configureExpression(&other, 4, "o", "sc_value + 1"));
+  CHECK(configureExpression(&derived, 3, "sc", "o_value * 2"));
+  sample_type value;
+  CHECK(!derived.getSummaryValue(0, &value));
+  CHECK(!other.getSummaryValue(0, &value));
+
+  // a chain without a cycle evaluates
+  ec.values[0] = makeSample(150, -2, unit_counts);
+  CHECK(configureExpression(&derived, 3, "sc", "ec_a * 2"));
+  CHECK(other.getSummaryValue(0, &value));
+  CHECK_EQUAL(4000L, value.value);
+  DerivedDriver::setSlotDrivers(drivers, 3);
+}
+
+int main()
+{
+  CHECK(configure(&ec, "{\"slot\":1,\"tag\":\"ec\",\"burst_size\":1}"));
+  CHECK(configure(&dht, "{\"slot\":2,\"tag\":\"dht\",\"burst_size\":1}"));
+  DerivedDriver::setSlotDrivers(drivers, 3);
+
+  examples();
+  compileErrors();
+  referenceCycles();
+  storedBytecode();
+  randomExpressions();
+  return checkSummary("derived");
+}
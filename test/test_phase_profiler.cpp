@@ -0,0 +1,278 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+// Phase profiler against analytic charges: a simulated current monitor
+// follows a current that ramps linearly within each phase and steps between
+// them, with failed reads, over cycles that cross the millis() wrap.
+
+#include <random>
+#include "system/phase_profiler.h"
+#include "check.h"
+
+static std::mt19937 generator(20209);
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(generator);
+}
+
+static int integer(int low, int high)
+{
+  return std::uniform_int_distribution<int>(low, high)(generator);
+}
+
+// reports the current the test sets, rounded as the INA219 result is
+class SimulatedMonitor : public CurrentMonitor
+{
+public:
+  double microamps = 0;
+  bool failing = false;
+  unsigned long reads = 0;
+
+  bool begin() { return true; }
+
+  bool readMicroamps(long * microamps)
+  {
+    reads++;
+    if (failing)
+    {
+      return false;
+    }
+    *microamps = lround(this->microamps);
+    return true;
+  }
+};
+
+struct phase_plan_type
+{
+  uint64 start;
+  uint32 duration;
+  double microamps; // at the start of the phase
+  double slope; // microamps per millisecond
+
+  double at(uint64 time) { return microamps + slope * (time - start); }
+};
+
+static uint32 clock32(uint64 time)
+{
+  return (uint32) (time & 0xFFFFFFFF); // scheduler.now() wraps at 2^32
+}
+
+void randomCycles()
+{
+  SimulatedMonitor monitor;
+  PhaseProfiler profiler;
+  profiler.setMonitor(&monitor);
+  CHECK(profiler.active());
+
+  // the first cycle runs across the millis() wrap
+  uint64 time = 0x100000000ULL - 2000;
+  for (int cycle = 0; cycle < 20000; cycle++)
+  {
+    phase_plan_type plan[POWER_PHASE_COUNT];
+    uint64 start = time;
+    for (short p = 0; p < POWER_PHASE_COUNT; p++)
+    {
+      plan[p].start = start;
+      plan[p].duration = integer(0, 3) == 0 ? integer(1, 120) : integer(120, 5000);
+      plan[p].microamps = uniform(100, 80000);
+      double end = uniform(100, 80000);
+      plan[p].slope = (end - plan[p].microamps) / plan[p].duration;
+      start += plan[p].duration;
+    }
+
+    double failureRate = cycle % 3 == 0 ? 0 : uniform(0, 0.5);
+    double expected[POWER_PHASE_COUNT];
+    double tolerance[POWER_PHASE_COUNT];
+
+    // the wake, the first read only starts the integration
+    monitor.microamps = plan[0].microamps;
+    monitor.failing = false;
+    profiler.enterPhase(phase_power_up, clock32(time));
+
+    for (short p = 0; p < POWER_PHASE_COUNT; p++)
+    {
+      uint64 end = plan[p].start + plan[p].duration;
+      expected[p] = plan[p].duration * (plan[p].microamps + plan[p].at(end)) / 2;
+      tolerance[p] = 0.5 * plan[p].duration + 1; // read rounding, and the integer halving
+
+      // the first interval of a phase starts from the last read of the one before
+      uint64 firstRead = 0;
+      uint64 next = time + integer(50, 150);
+      while (next < end)
+      {
+        monitor.microamps = plan[p].at(next);
+        monitor.failing = uniform(0, 1) < failureRate;
+        profiler.sample(clock32(next));
+        if (!monitor.failing)
+        {
+          if (firstRead == 0)
+          {
+            firstRead = next;
+          }
+          tolerance[p] += 1;
+        }
+        next += integer(50, 150);
+      }
+      if (firstRead == 0)
+      {
+        firstRead = end;
+      }
+      if (p > 0)
+      {
+        double step = plan[p - 1].at(plan[p].start) - plan[p].microamps;
+        expected[p] += step * (firstRead - plan[p].start) / 2;
+      }
+
+      // the boundary read still sees this phase's current
+      monitor.microamps = plan[p].at(end);
+      monitor.failing = false;
+      if (p + 1 < POWER_PHASE_COUNT)
+      {
+        profiler.enterPhase((power_phase_type) (p + 1), clock32(end));
+      }
+      else
+      {
+        profiler.endCycle(clock32(end));
+      }
+      time = end;
+    }
+
+    double total = 0;
+    for (short p = 0; p < POWER_PHASE_COUNT; p++)
+    {
+      if (!CHECK_CLOSE(expected[p], profiler.getCompletedCharge((power_phase_type) p), tolerance[p]))
+      {
+        fprintf(stderr, "cycle %d %s: %lld nC, expected %.1f\n", cycle, powerPhaseName((power_phase_type) p), profiler.getCompletedCharge((power_phase_type) p), expected[p]);
+      }
+      total += profiler.getCompletedCharge((power_phase_type) p);
+    }
+    CHECK_EQUAL((long long) total, profiler.getCompletedCycleCharge());
+    CHECK_EQUAL(lround(monitor.microamps), profiler.getLastMicroamps());
+
+    // nothing is integrated across STOP mode
+    time += integer(1000, 900000);
+  }
+  CHECK(time > 0x100000000ULL * 2); // wrapped at least twice
+}
+
+void failedReads()
+{
+  SimulatedMonitor monitor;
+  PhaseProfiler profiler;
+  profiler.setMonitor(&monitor);
+
+  // a failed boundary read moves the gap into the next phase, the cycle total is kept
+  monitor.microamps = 1000;
+  profiler.enterPhase(phase_warm_up, 0);
+  profiler.sample(100);
+  monitor.failing = true;
+  profiler.enterPhase(phase_measure, 200);
+  monitor.failing = false;
+  profiler.sample(300);
+  profiler.endCycle(400);
+  CHECK_EQUAL(100000LL, profiler.getCompletedCharge(phase_warm_up));
+  CHECK_EQUAL(300000LL, profiler.getCompletedCharge(phase_measure));
+  CHECK_EQUAL(400000LL, profiler.getCompletedCycleCharge());
+
+  // a cycle without a good read has no charge
+  monitor.failing = true;
+  profiler.enterPhase(phase_warm_up, 1000);
+  profiler.sample(1100);
+  profiler.endCycle(1200);
+  CHECK_EQUAL(0LL, profiler.getCompletedCycleCharge());
+
+  // the first good read of the next cycle only starts the integration
+  monitor.failing = false;
+  profiler.sample(5000);
+  profiler.endCycle(5100);
+  CHECK_EQUAL(100000LL, profiler.getCompletedCharge(phase_power_up));
+}
+
+void withoutMonitor()
+{
+  PhaseProfiler profiler;
+  CHECK(!profiler.active());
+  profiler.enterPhase(phase_measure, 0);
+  profiler.sample(100);
+  profiler.endCycle(200);
+  CHECK_EQUAL(0LL, profiler.getCompletedCycleCharge());
+  CHECK(strcmp(powerPhaseName(phase_sd_flush), "sd_flush") == 0);
+  CHECK(strcmp(powerPhaseName(POWER_PHASE_COUNT), "") == 0);
+}
+
+// the datalogger's calls over a cycle, constant current so every phase is exact
+void dataloggerSequence()
+{
+  SimulatedMonitor monitor;
+  PhaseProfiler profiler;
+  profiler.setMonitor(&monitor);
+  monitor.microamps = 2000;
+
+  uint32 now = 0xFFFFFF00; // across the wrap
+  for (int cycle = 0; cycle < 3; cycle++)
+  {
+    // stopAndAwaitTrigger(), after powerUpSwitchableComponents()
+    profiler.sample(now);
+    now += 300; // reopen the file system, energy policy
+    // startMeasurementCycle()
+    profiler.enterPhase(phase_warm_up, now);
+    for (int i = 0; i < 10; i++)
+    {
+      now += PHASE_PROFILER_SAMPLE_MILLISECONDS; // runPowerTask()
+      profiler.sample(now);
+    }
+    // runMeasurementCycleTask(), first burst
+    profiler.enterPhase(phase_measure, now);
+    for (int i = 0; i < 20; i++)
+    {
+      now += PHASE_PROFILER_SAMPLE_MILLISECONDS;
+      profiler.sample(now);
+    }
+    // runMeasurementCycleTask(), cycle complete
+    profiler.enterPhase(phase_sd_flush, now);
+    now += 120; // runFlushTask()
+    profiler.sample(now);
+    // awaitNextMeasurementCycle(), the summary flush again
+    profiler.enterPhase(phase_sd_flush, now);
+    now += 30; // stopAndAwaitTrigger(), closeFileSystem()
+    profiler.enterPhase(phase_sleep_entry, now);
+    now += 50; // alarm, drivers stopped
+    profiler.endCycle(now);
+
+    CHECK_EQUAL(600000LL, profiler.getCompletedCharge(phase_power_up));
+    CHECK_EQUAL(2000000LL, profiler.getCompletedCharge(phase_warm_up));
+    CHECK_EQUAL(4000000LL, profiler.getCompletedCharge(phase_measure));
+    CHECK_EQUAL(300000LL, profiler.getCompletedCharge(phase_sd_flush));
+    CHECK_EQUAL(100000LL, profiler.getCompletedCharge(phase_sleep_entry));
+    CHECK_EQUAL(7000000LL, profiler.getCompletedCycleCharge());
+
+    now += 900000; // STOP mode
+  }
+}
+
+int main()
+{
+  withoutMonitor();
+  dataloggerSequence();
+  failedReads();
+  randomCycles();
+  return checkSummary("phase_profiler");
+}
@@ -0,0 +1,148 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Ring buffer stress: a producer thread stands in for the ISR and pushes
+// sequence numbered items as fast as it can while the main thread consumes in
+// batches.  Every item must arrive whole and in order, and with either full
+// policy received + lost must account for every item pushed.
+
+#include <thread>
+#include <atomic>
+#include "utilities/ring_buffer.h"
+#include "check.h"
+
+#define STRESS_ITEMS 5000000
+#define ITEM_CHECK_WORDS 7
+
+typedef struct
+{
+  unsigned int sequence;
+  unsigned int check[ITEM_CHECK_WORDS]; // derived from sequence, a torn copy won't match
+} stress_item;
+
+template <bool OVERWRITE>
+void stress(const char * policy)
+{
+  static RingBuffer<stress_item, 16, OVERWRITE> ring;
+  std::atomic<bool> produced(false);
+
+  std::thread producer([&]
+  {
+    for (unsigned int sequence = 1; sequence <= STRESS_ITEMS; sequence++)
+    {
+      stress_item item;
+      item.sequence = sequence;
+      for (int k = 0; k < ITEM_CHECK_WORDS; k++)
+      {
+        item.check[k] = sequence * 31 + k;
+      }
+      if (sequence % 3 == 0)
+      {
+        stress_item * slot = ring.reserve(); // both producer paths
+        if (slot != NULL)
+        {
+          *slot = item;
+          ring.commit();
+        }
+      }
+      else
+      {
+        ring.push(item);
+      }
+      if (sequence % 1000 == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+    produced = true;
+  });
+
+  unsigned long received = 0;
+  unsigned long torn = 0;
+  unsigned long outOfOrder = 0;
+  unsigned int last = 0;
+  stress_item batch[5];
+  while (true)
+  {
+    bool finished = produced.load();
+    unsigned int count = ring.peek(batch, 5);
+    for (unsigned int i = 0; i < count; i++)
+    {
+      for (int k = 0; k < ITEM_CHECK_WORDS; k++)
+      {
+        if (batch[i].check[k] != batch[i].sequence * 31 + k)
+        {
+          torn++;
+          break;
+        }
+      }
+      if (batch[i].sequence <= last)
+      {
+        outOfOrder++;
+      }
+      last = batch[i].sequence;
+      received++;
+    }
+    ring.release(count);
+    if (finished && count == 0 && ring.empty())
+    {
+      break;
+    }
+  }
+  producer.join();
+
+  printf("%s: received %lu lost %lu\n", policy, received, (unsigned long) ring.lost());
+  CHECK_EQUAL(0UL, torn);
+  CHECK_EQUAL(0UL, outOfOrder);
+  CHECK_EQUAL((unsigned long) STRESS_ITEMS, received + ring.lost());
+}
+
+void singleThreaded()
+{
+  RingBuffer<int, 4> drop;
+  for (int i = 0; i < 6; i++)
+  {
+    drop.push(i);
+  }
+  CHECK_EQUAL(4U, drop.size());
+  CHECK_EQUAL(2U, (unsigned int) drop.lost());
+  int value;
+  CHECK(drop.pop(&value) && value == 0); // the newest were dropped
+
+  RingBuffer<int, 4, true> overwrite;
+  for (int i = 0; i < 6; i++)
+  {
+    overwrite.push(i);
+  }
+  CHECK(overwrite.pop(&value) && value == 2); // the oldest were overwritten
+  CHECK_EQUAL(2U, (unsigned int) overwrite.lost()); // counted once the consumer passed them
+  CHECK_EQUAL(3U, overwrite.size());
+
+  overwrite.clear();
+  CHECK(overwrite.empty());
+  CHECK(!overwrite.pop(&value));
+}
+
+int main()
+{
+  singleThreaded();
+  stress<false>("drop newest");
+  stress<true>("overwrite oldest");
+  return checkSummary("ring_buffer");
+}
@@ -0,0 +1,335 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// Fixed point samples against double precision references: formatting,
+// rescaling, float conversion, calibration transforms and burst means.
+// Sample values are int32_t on the host as on the target, so the overflow
+// edges of rescaling, transforms and burst sums are checked at 32 bits.
+
+#include <random>
+#include "sensors/sample.h"
+#include "sensors/sensor.h"
+#include "fixed_value_driver.h"
+#include "check.h"
+
+static std::mt19937 generator(20201);
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(generator);
+}
+
+static bool formatsAs(int32_t value, signed char exponent, const char * expected)
+{
+  char buffer[24];
+  formatSample(buffer, makeSample(value, exponent, unit_none));
+  if (strcmp(buffer, expected) != 0)
+  {
+    fprintf(stderr, "%ld e%d formatted as %s, expected %s\n", (long) value, exponent, buffer, expected);
+    return false;
+  }
+  return true;
+}
+
+void formatting()
+{
+  CHECK(formatsAs(12345, -3, "12.345"));
+  CHECK(formatsAs(-5, -2, "-0.05"));
+  CHECK(formatsAs(0, -1, "0.0"));
+  CHECK(formatsAs(7, 2, "700"));
+  CHECK(formatsAs(-42, 0, "-42"));
+  CHECK(formatsAs(SAMPLE_MISSING, -2, "nan"));
+  CHECK(formatsAs(INT32_MAX, -9, "2.147483647"));
+  CHECK(formatsAs(-INT32_MAX, -9, "-2.147483647")); // the magnitude as uint32_t
+  CHECK(formatsAs(INT32_MAX, 0, "2147483647"));
+
+  // against printf of the double value
+  for (int i = 0; i < 10000; i++)
+  {
+    int32_t value = (int32_t) uniform(-2e9, 2e9);
+    signed char exponent = -(i % 7);
+    char expected[40];
+    sprintf(expected, "%.*f", -exponent, value / (double) powerOfTen(-exponent));
+    CHECK(formatsAs(value, exponent, expected));
+  }
+}
+
+void rescaling()
+{
+  // half away from zero
+  CHECK_EQUAL(13L, rescaleSample(makeSample(125, -2, unit_none), -1).value);
+  CHECK_EQUAL(-13L, rescaleSample(makeSample(-125, -2, unit_none), -1).value);
+  CHECK_EQUAL(12L, rescaleSample(makeSample(124, -2, unit_none), -1).value);
+  CHECK_EQUAL(1250L, rescaleSample(makeSample(125, -2, unit_none), -3).value);
+  CHECK(sampleMissing(rescaleSample(makeSample(SAMPLE_MISSING, -2, unit_none), 0)));
+
+  for (int i = 0; i < 100000; i++)
+  {
+    int32_t value = (int32_t) uniform(-1e9, 1e9);
+    signed char from = -(i % 6);
+    signed char to = -(i / 6 % 6);
+    double reference = value * pow(10.0, from - to);
+    sample_type rescaled = rescaleSample(makeSample(value, from, unit_none), to);
+    if (fabs(reference) > INT32_MAX - 0.5)
+    {
+      CHECK(sampleMissing(rescaled)); // out of the 32 bit range
+      continue;
+    }
+    int32_t expected = reference < 0 ? -(int32_t) floor(-reference + 0.5) : (int32_t) floor(reference + 0.5);
+    CHECK_EQUAL(expected, rescaled.value);
+  }
+}
+
+void rescalingRange()
+{
+  // the largest values that still fit, and the first that don't
+  CHECK_EQUAL(2147483640, rescaleSample(makeSample(214748364, -1, unit_none), -2).value);
+  CHECK(sampleMissing(rescaleSample(makeSample(214748365, -1, unit_none), -2)));
+  CHECK_EQUAL(-2147483640, rescaleSample(makeSample(-214748364, -1, unit_none), -2).value);
+  CHECK(sampleMissing(rescaleSample(makeSample(-214748365, -1, unit_none), -2)));
+  CHECK(sampleMissing(rescaleSample(makeSample(INT32_MAX, 0, unit_none), -1)));
+  CHECK(sampleMissing(rescaleSample(makeSample(1, 0, unit_none), -10))); // 10^10 is past 32 bits
+
+  // coarser exponents always fit, and round half away from zero at the ends
+  CHECK_EQUAL(214748365, rescaleSample(makeSample(INT32_MAX, 0, unit_none), 1).value);
+  CHECK_EQUAL(-214748365, rescaleSample(makeSample(-INT32_MAX, 0, unit_none), 1).value);
+  CHECK_EQUAL(0, rescaleSample(makeSample(INT32_MAX, 0, unit_none), 10).value);
+
+  // SAMPLE_MISSING is INT32_MIN, so -2^31 is never a value
+  CHECK(sampleMissing(rescaleSample(makeSample(-1073741824, 0, unit_none), -1)));
+  CHECK_EQUAL((int32_t) SAMPLE_MISSING, (int32_t) INT32_MIN);
+
+  for (int i = 0; i < 100000; i++)
+  {
+    // values around the 32 bit edge, scaled up one to three decimals
+    short digits = 1 + i % 3;
+    int32_t limit = (int32_t) (INT32_MAX / powerOfTen(digits));
+    int32_t value = limit + (int32_t) uniform(-1000, 1000);
+    value = i % 2 ? value : -value;
+    int64_t reference = (int64_t) value * powerOfTen(digits);
+    sample_type rescaled = rescaleSample(makeSample(value, 0, unit_none), -digits);
+    if (reference > INT32_MAX || reference <= INT32_MIN)
+    {
+      CHECK(sampleMissing(rescaled));
+    }
+    else
+    {
+      CHECK_EQUAL((int32_t) reference, rescaled.value);
+    }
+  }
+}
+
+void floatConversion()
+{
+  CHECK(sampleMissing(sampleFromFloat(NAN, -2, unit_celsius)));
+  CHECK_EQUAL(2151L, sampleFromFloat(21.51f, -2, unit_celsius).value);
+  CHECK_EQUAL(-1L, sampleFromFloat(-0.5f, 0, unit_celsius).value);
+
+  for (int i = 0; i < 100000; i++)
+  {
+    float value = (float) uniform(-1000, 1000);
+    signed char exponent = -(i % 4);
+    sample_type sample = sampleFromFloat(value, exponent, unit_calibrated);
+    CHECK_CLOSE(value * pow(10.0, -exponent), (double) sample.value, 0.5 + fabs(value) * pow(10.0, -exponent) * 1e-6);
+    CHECK_CLOSE(sample.value * pow(10.0, exponent), sampleToFloat(sample), fabs(value) * 1e-6);
+  }
+}
+
+void linearTransforms()
+{
+  for (int i = 0; i < 2000; i++)
+  {
+    // calibration fits of 12 bit ADC counts to engineering units
+    float slope = (float) (uniform(0.0005, 5) * (i % 2 ? 1 : -1));
+    float intercept = (float) uniform(-2000, 2000);
+    signed char outputExponent = -(i % 4);
+    linear_transform_type transform;
+    setupLinearTransform(&transform, slope, intercept, 0, outputExponent);
+
+    for (long counts = 0; counts < 4096; counts += 97)
+    {
+      sample_type y = applyLinearTransform(&transform, makeSample(counts, 0, unit_counts), unit_calibrated);
+      double reference = ((double) slope * counts + intercept) * pow(10.0, -outputExponent);
+      CHECK_EQUAL(outputExponent, y.exponent);
+      CHECK_CLOSE(reference, (double) y.value, 1 + fabs(reference) * 1e-6);
+    }
+  }
+
+  // inputs at a finer exponent than the transform are rescaled first
+  linear_transform_type transform;
+  setupLinearTransform(&transform, 2, 1, -1, -2);
+  CHECK_EQUAL(2700L, applyLinearTransform(&transform, makeSample(1300, -2, unit_none), unit_none).value); // (13.0 * 2 + 1) * 100
+  CHECK(sampleMissing(applyLinearTransform(&transform, makeSample(SAMPLE_MISSING, 0, unit_none), unit_none)));
+}
+
+void linearTransformRange()
+{
+  // y = 2x + 1 in whole units: the last x that fits, and the first that doesn't
+  linear_transform_type transform;
+  setupLinearTransform(&transform, 2, 1, 0, 0);
+  CHECK_EQUAL(INT32_MAX, applyLinearTransform(&transform, makeSample(1073741823, 0, unit_none), unit_none).value);
+  CHECK(sampleMissing(applyLinearTransform(&transform, makeSample(1073741824, 0, unit_none), unit_none)));
+  CHECK_EQUAL(-2147483647, applyLinearTransform(&transform, makeSample(-1073741824, 0, unit_none), unit_none).value);
+  CHECK(sampleMissing(applyLinearTransform(&transform, makeSample(-1073741825, 0, unit_none), unit_none)));
+
+  // the full input range through slopes near 1, the 64 bit product can't overflow
+  for (int i = 0; i < 20000; i++)
+  {
+    float slope = (float) uniform(0.5, 2) * (i % 2 ? 1 : -1);
+    float intercept = (float) uniform(-1000, 1000);
+    setupLinearTransform(&transform, slope, intercept, 0, 0);
+    int32_t x = (int32_t) uniform(-INT32_MAX, INT32_MAX);
+    double reference = (double) slope * x + intercept;
+    sample_type y = applyLinearTransform(&transform, makeSample(x, 0, unit_none), unit_calibrated);
+    if (fabs(reference) > INT32_MAX + 1.0)
+    {
+      CHECK(sampleMissing(y));
+    }
+    else if (fabs(reference) < INT32_MAX - 1000.0)
+    {
+      CHECK_CLOSE(reference, (double) y.value, 1 + fabs(reference) * 1e-6);
+    }
+  }
+
+  // an input rescaled past 32 bits is missing, not wrapped
+  setupLinearTransform(&transform, 1, 0, -3, -3);
+  CHECK(sampleMissing(applyLinearTransform(&transform, makeSample(3000000, 0, unit_none), unit_none)));
+}
+
+static void configure(SensorDriver * driver, const char * json)
+{
+  cJSON * configuration = cJSON_Parse(json);
+  CHECK(driver->configureFromJSON(configuration));
+  cJSON_Delete(configuration);
+}
+
+void burstMeans()
+{
+  FixedValueDriver driver;
+  configure(&driver, "{\"slot\":1,\"tag\":\"t\",\"burst_size\":10}");
+
+  for (int trial = 0; trial < 2000; trial++)
+  {
+    driver.initializeBurst();
+    double sum = 0;
+    int count = 1 + trial % 50;
+    for (int i = 0; i < count; i++)
+    {
+      // mixed exponents are rescaled to the first sample's
+      signed char exponent = i == 0 ? -2 : -(i % 4);
+      int32_t value = (int32_t) uniform(-1e6, 1e6);
+      driver.addSampleToBurstSummary(0, makeSample(value, exponent, unit_counts));
+      sum += rescaleSample(makeSample(value, exponent, unit_counts), -2).value;
+    }
+    for (signed char exponent = -4; exponent <= 0; exponent++)
+    {
+      double reference = sum / count * pow(10.0, -2 - exponent);
+      sample_type mean = driver.getBurstSummaryMean(0, exponent);
+      if (fabs(reference) > INT32_MAX)
+      {
+        CHECK(sampleMissing(mean));
+        continue;
+      }
+      CHECK_CLOSE(reference, (double) mean.value, 0.5 + 1e-9 * fabs(reference));
+    }
+  }
+  driver.initializeBurst();
+  CHECK(sampleMissing(driver.getBurstSummaryMean(0, -2)));
+}
+
+void burstSumRange()
+{
+  FixedValueDriver driver;
+  configure(&driver, "{\"slot\":1,\"tag\":\"t\",\"burst_size\":10}");
+
+  // sums of values at the 32 bit edge don't wrap, the mean is the value
+  for (int count = 1; count <= 1000; count *= 10)
+  {
+    driver.initializeBurst();
+    for (int i = 0; i < count; i++)
+    {
+      driver.addSampleToBurstSummary(0, makeSample(INT32_MAX, 0, unit_counts));
+      driver.addSampleToBurstSummary(1, makeSample(-INT32_MAX, 0, unit_counts));
+    }
+    CHECK_EQUAL(INT32_MAX, driver.getBurstSummaryMean(0, 0).value);
+    CHECK_EQUAL(-INT32_MAX, driver.getBurstSummaryMean(1, 0).value);
+    CHECK_EQUAL(214748365, driver.getBurstSummaryMean(0, 1).value);
+    CHECK(sampleMissing(driver.getBurstSummaryMean(0, -1))); // a finer mean is past 32 bits
+    CHECK(sampleMissing(driver.getBurstSummaryMean(1, -1)));
+  }
+
+  // alternating edges cancel exactly
+  driver.initializeBurst();
+  for (int i = 0; i < 10000; i++)
+  {
+    driver.addSampleToBurstSummary(0, makeSample(i % 2 ? INT32_MAX : -INT32_MAX, 0, unit_counts));
+  }
+  CHECK_EQUAL(0, driver.getBurstSummaryMean(0, -9).value);
+
+  // a sample rescaled past 32 bits to the column's exponent is left out of the mean
+  FixedValueDriver fine;
+  configure(&fine, "{\"slot\":1,\"tag\":\"t\",\"burst_size\":10}");
+  fine.initializeBurst();
+  fine.addSampleToBurstSummary(0, makeSample(100, -3, unit_counts));
+  fine.addSampleToBurstSummary(0, makeSample(3000000, 0, unit_counts));
+  CHECK_EQUAL(100, fine.getBurstSummaryMean(0, -3).value);
+}
+
+void deadband()
+{
+  FixedValueDriver driver;
+  configure(&driver, "{\"slot\":1,\"tag\":\"t\",\"burst_size\":1,\"deadband\":0.5}");
+
+  // value -2 exponent: 10.00, deadband 0.5
+  driver.values[0] = makeSample(1000, -2, unit_counts);
+  driver.values[1] = makeSample(0, -2, unit_counts);
+  driver.initializeBurst();
+  driver.takeMeasurement();
+  CHECK(driver.summaryMovedBeyondDeadband()); // nothing written yet
+  driver.markSummaryWritten();
+
+  driver.values[0] = makeSample(1049, -2, unit_counts);
+  driver.initializeBurst();
+  driver.takeMeasurement();
+  CHECK(!driver.summaryMovedBeyondDeadband());
+
+  driver.values[0] = makeSample(1051, -2, unit_counts);
+  driver.initializeBurst();
+  driver.takeMeasurement();
+  CHECK(driver.summaryMovedBeyondDeadband());
+
+  driver.values[0] = makeSample(949, -2, unit_counts); // either direction
+  driver.initializeBurst();
+  driver.takeMeasurement();
+  CHECK(driver.summaryMovedBeyondDeadband());
+}
+
+int main()
+{
+  formatting();
+  rescaling();
+  rescalingRange();
+  floatConversion();
+  linearTransforms();
+  linearTransformRange();
+  burstMeans();
+  burstSumRange();
+  deadband();
+  return checkSummary("sample");
+}
@@ -0,0 +1,184 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+// The per sample path of a calibrated analog slot before and after fixed
+// point samples: the burst mean tables of doubles with a double calibration
+// and %f formatting, against sample_type sums, the binary scaled transform
+// and integer formatting. Both paths must write the same row.
+//
+// The Cortex-M3 has no FPU, so every double operation below is a software
+// float call on the target. The soft float counts are what the comparison
+// rests on; the host times come from a machine with a hardware FPU and only
+// show that the integer path is no slower.
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "sensors/sample.h"
+#include "fixed_value_driver.h"
+#include "check.h"
+
+#define BURST_SIZE 10
+#define ROWS 100000
+
+static std::mt19937 generator(20204);
+
+// a double that counts the operations the target would make soft float calls for
+struct CountedDouble
+{
+  static unsigned long long calls;
+  double value;
+
+  CountedDouble(double value = 0) : value(value) {}
+  static CountedDouble fromInteger(long value) { calls++; return CountedDouble(value); }
+
+  CountedDouble operator+(CountedDouble other) const { calls++; return value + other.value; }
+  CountedDouble operator*(CountedDouble other) const { calls++; return value * other.value; }
+  CountedDouble operator/(CountedDouble other) const { calls++; return value / other.value; }
+  CountedDouble & operator+=(CountedDouble other) { calls++; value += other.value; return *this; }
+};
+
+unsigned long long CountedDouble::calls = 0;
+
+// the burst summary and calibration before fixed point samples
+class DoublePath
+{
+public:
+  double m;
+  double b;
+
+  void initializeBurst()
+  {
+    for (std::map<std::string, CountedDouble>::iterator it = sums.begin(); it != sums.end(); ++it)
+    {
+      it->second = 0;
+      counts[it->first] = 0;
+    }
+  }
+
+  void addValueToBurstSummaryMean(std::string tag, CountedDouble value)
+  {
+    if (sums.count(tag) == 0)
+    {
+      sums[tag] = 0;
+      counts[tag] = 0;
+    }
+    sums[tag] += value;
+    counts[tag] += 1;
+  }
+
+  CountedDouble getBurstSummaryMean(std::string tag)
+  {
+    return sums[tag] / CountedDouble::fromInteger(counts[tag]);
+  }
+
+  CountedDouble getCalibratedValue(CountedDouble value)
+  {
+    return CountedDouble(m) * value + CountedDouble(b);
+  }
+
+  void summaryDataString(char * buffer)
+  {
+    CountedDouble mean = getBurstSummaryMean("value");
+    CountedDouble::calls += 2; // each %f conversion is at least one soft float call
+    sprintf(buffer, "%0.3f,%0.3f", mean.value, getCalibratedValue(mean).value);
+  }
+
+private:
+  std::map<std::string, CountedDouble> sums;
+  std::map<std::string, int> counts;
+};
+
+static void samplePathRow(FixedValueDriver * driver, const linear_transform_type * calibration, char * buffer)
+{
+  char mean[16];
+  char calibrated[16];
+  sample_type summary = driver->getBurstSummaryMean(0, -3);
+  formatSample(mean, summary);
+  formatSample(calibrated, applyLinearTransform(calibration, summary, unit_calibrated));
+  sprintf(buffer, "%s,%s", mean, calibrated);
+}
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start, long rows)
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rows;
+}
+
+int main()
+{
+  std::vector<long> counts(ROWS * BURST_SIZE);
+  for (size_t i = 0; i < counts.size(); i++)
+  {
+    counts[i] = std::uniform_int_distribution<long>(0, 4095)(generator);
+  }
+
+  DoublePath doublePath;
+  doublePath.m = 0.0123;
+  doublePath.b = -4.5;
+
+  FixedValueDriver driver;
+  linear_transform_type calibration;
+  setupLinearTransform(&calibration, doublePath.m, doublePath.b, -3, -3);
+
+  static char doubleRows[ROWS][32];
+  static char sampleRows[ROWS][32];
+
+  CountedDouble::calls = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long row = 0; row < ROWS; row++)
+  {
+    doublePath.initializeBurst();
+    for (int i = 0; i < BURST_SIZE; i++)
+    {
+      doublePath.addValueToBurstSummaryMean("value", CountedDouble::fromInteger(counts[row * BURST_SIZE + i]));
+    }
+    doublePath.summaryDataString(doubleRows[row]);
+  }
+  double doubleNanoseconds = nanosecondsSince(start, ROWS);
+  double doubleCalls = (double) CountedDouble::calls / ROWS;
+
+  start = std::chrono::steady_clock::now();
+  for (long row = 0; row < ROWS; row++)
+  {
+    driver.initializeBurst();
+    for (int i = 0; i < BURST_SIZE; i++)
+    {
+      driver.addSampleToBurstSummary(0, makeSample(counts[row * BURST_SIZE + i], 0, unit_counts));
+    }
+    samplePathRow(&driver, &calibration, sampleRows[row]);
+  }
+  double sampleNanoseconds = nanosecondsSince(start, ROWS);
+
+  // the same row to the last digit, give or take the rounding of a half
+  for (long row = 0; row < ROWS; row++)
+  {
+    double doubleMean, doubleCalibrated, sampleMean, sampleCalibrated;
+    CHECK(sscanf(doubleRows[row], "%lf,%lf", &doubleMean, &doubleCalibrated) == 2);
+    CHECK(sscanf(sampleRows[row], "%lf,%lf", &sampleMean, &sampleCalibrated) == 2);
+    CHECK_CLOSE(doubleMean, sampleMean, 0.0011);
+    CHECK_CLOSE(doubleCalibrated, sampleCalibrated, 0.0011);
+  }
+
+  printf("per row of a %d sample burst:\n", BURST_SIZE);
+  printf("  soft float calls on the target  double %.1f, sample_type 0\n", doubleCalls);
+  printf("  host ns (hardware FPU)          double %.0f, sample_type %.0f\n", doubleNanoseconds, sampleNanoseconds);
+  return checkSummary("sample_benchmark");
+}
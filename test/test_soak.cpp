@@ -0,0 +1,615 @@
+/* 
+ *  RRIV - Open Source Environmental Data Logging Platform
+ *  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+
+
+// A year of logging cycles in simulated time, with random slot configuration
+// changes, through the scheduler, the write caches, the slot driver table and
+// the driver lifecycle of the firmware.  The cycle follows the datalogger's:
+// drivers set up after waking, warm up, bursts of raw rows, a summary row,
+// a flush and the drivers stopped before sleeping until the next interval.
+//
+// Weekly samples of the heap and of the stack high water must not trend up
+// after the first quarter, and every row timestamp must increase and trail
+// the simulated real time by less than a second, across the millis() wrap.
+// A run with a driver that leaks in setup() checks that growth is caught.
+
+#include <malloc.h>
+#include <pthread.h>
+#include <random>
+#include "host.h"
+#include "system/scheduler.h"
+#include "system/write_cache.h"
+#include "sensors/sensor_map.h"
+#include "sensors/slot_drivers.h"
+#include "sensors/drivers/derived.h"
+#include "system/crc.h"
+#include "system/eeprom.h"
+#include "fixed_value_driver.h"
+#include "check.h"
+
+#define SOAK_INTERVAL_SECONDS 900
+#define SOAK_CYCLES_PER_WEEK (7 * 24 * 3600 / SOAK_INTERVAL_SECONDS)
+#define SOAK_WEEKS 52
+#define SOAK_LEAK_WEEKS 8
+#define SOAK_EPOCH 1600000000UL
+#define SOAK_STACK_SIZE (256 * 1024)
+#define SOAK_STACK_PAINT 0xA5
+#define SOAK_CONFIGURATION_CHANGE_RATE 0.05 // per cycle
+#define SOAK_MAX_ROW 200
+
+#define HEAP_SLACK 256 // bytes, allocator rounding
+#define EXTENT_SLACK 4096 // a page
+
+// type codes for the soak, the registry pulls in every driver
+#define FIXED_VALUE_SENSOR 0x0100
+#define LEAKY_SENSOR 0x0101
+#define SOAK_DERIVED_SENSOR 0x0102
+
+static std::mt19937 generator(20211);
+
+static double uniform(double low, double high)
+{
+  return std::uniform_real_distribution<double>(low, high)(generator);
+}
+
+static int integer(int low, int high)
+{
+  return std::uniform_int_distribution<int>(low, high)(generator);
+}
+
+// as drivers that allocate on every wake once did
+class LeakyDriver : public FixedValueDriver
+{
+public:
+  void setup()
+  {
+    FixedValueDriver::setup();
+    buffer = new byte[24];
+  }
+
+private:
+  byte * buffer = NULL;
+};
+
+typedef struct memory_sample
+{
+  size_t inUse;
+  size_t freeInside; // free bytes below the heap extent, fragmentation
+  size_t extent;
+  size_t largestFree;
+  size_t scatteredFree; // free inside the heap but outside its largest free block
+  size_t stackHighWater;
+} memory_sample;
+
+static byte * stack;
+
+static size_t stackHighWater()
+{
+  size_t untouched = 0;
+  while (untouched < SOAK_STACK_SIZE && stack[untouched] == SOAK_STACK_PAINT)
+  {
+    untouched++;
+  }
+  return SOAK_STACK_SIZE - untouched;
+}
+
+static size_t largestFreeBlock()
+{
+  // the largest allocation the heap serves without growing
+  size_t extent = mallinfo2().arena;
+  size_t low = 0;
+  size_t high = mallinfo2().fordblks;
+  while (low < high)
+  {
+    size_t size = (low + high + 1) / 2;
+    void * block = malloc(size);
+    bool fits = block != NULL && mallinfo2().arena == extent;
+    free(block);
+    malloc_trim(0);
+    if (fits)
+    {
+      low = size;
+    }
+    else
+    {
+      high = size - 1;
+    }
+  }
+  return low;
+}
+
+static memory_sample sampleMemory()
+{
+  malloc_trim(0); // the extent ends at the highest block in use, as the break does on the target
+  struct mallinfo2 info = mallinfo2();
+  memory_sample sample;
+  sample.inUse = info.uordblks;
+  sample.freeInside = info.fordblks;
+  sample.extent = info.arena;
+  sample.largestFree = largestFreeBlock();
+  sample.scatteredFree = sample.freeInside - std::min(sample.freeInside, sample.largestFree);
+  sample.stackHighWater = stackHighWater();
+  return sample;
+}
+
+// checks the blocks the caches write, and counts their rows
+class SoakOutput : public OutputDevice
+{
+public:
+  unsigned long rows = 0;
+  unsigned long blocks = 0;
+  unsigned long badBlocks = 0;
+
+  void beginBlock(unsigned int length)
+  {
+    blockLength = 0;
+  }
+
+  void writeString(const char * string)
+  {
+    unsigned int length = strlen(string);
+    if (strncmp(string, "#crc32,", 7) == 0)
+    {
+      unsigned int trailerLength = 0;
+      unsigned long crc = 0;
+      sscanf(string, "#crc32,%u,%lx", &trailerLength, &crc);
+      blocks++;
+      if (trailerLength != blockLength || crc != hardwareCRC32(block, blockLength))
+      {
+        badBlocks++;
+      }
+      return;
+    }
+    for (unsigned int i = 0; i < length; i++)
+    {
+      rows += string[i] == '\n';
+    }
+    if (blockLength + length <= sizeof(block))
+    {
+      memcpy(&block[blockLength], string, length);
+    }
+    blockLength += length;
+  }
+
+private:
+  char block[RAW_CACHE_SIZE];
+  unsigned int blockLength = 0;
+};
+
+typedef enum soak_cycle_state { soak_idle, soak_warm_up, soak_reading, soak_complete } soak_cycle_state_type;
+
+class Soak
+{
+public:
+  unsigned long rowsWritten = 0;
+  unsigned long timestampErrors = 0;
+  unsigned long configurationChanges = 0;
+  unsigned long millisWraps = 0;
+  SoakOutput summaryOutput;
+  SoakOutput rawOutput;
+  memory_sample samples[SOAK_WEEKS];
+  unsigned short sampleCount = 0;
+
+  Soak(bool leaky)
+  {
+    this->leaky = leaky;
+    scheduler.addTask(&cliTask, true);
+    scheduler.addTask(&measurementCycleTask, true);
+    scheduler.addTask(&flushTask, true);
+  }
+
+  ~Soak()
+  {
+    while (sensorCount > 0)
+    {
+      removeSlotDriver(&drivers, &sensorCount, drivers[0]->getSlot());
+    }
+    free(drivers);
+  }
+
+  void run(unsigned short weeks)
+  {
+    hostSetMicros((0x100000000ULL - 3600000) * 1000); // millis() wraps after an hour awake
+    for (unsigned long cycle = 0; cycle < (unsigned long) weeks * SOAK_CYCLES_PER_WEEK; cycle++)
+    {
+      uint32 wakeMillis = millis();
+      runCycle();
+      if (millis() < wakeMillis)
+      {
+        millisWraps++;
+      }
+      if ((cycle + 1) % SOAK_CYCLES_PER_WEEK == 0)
+      {
+        samples[sampleCount++] = sampleMemory();
+      }
+
+      // STOP mode until the next interval boundary, systick and millis() stop
+      uint64 next = (realMillis / 1000 / SOAK_INTERVAL_SECONDS + 1) * SOAK_INTERVAL_SECONDS * 1000;
+      realMillis = next + integer(0, 999); // the alarm fires within the second
+      for (unsigned short i = 0; i < sensorCount; i++)
+      {
+        drivers[i]->setup();
+      }
+    }
+  }
+
+  unsigned long rowsReceived()
+  {
+    return summaryOutput.rows + rawOutput.rows;
+  }
+
+private:
+  bool leaky;
+  Scheduler scheduler;
+  MemberTask<Soak> cliTask{"cli", this, &Soak::runCLITask};
+  MemberTask<Soak> measurementCycleTask{"measure", this, &Soak::runMeasurementCycleTask};
+  MemberTask<Soak> flushTask{"flush", this, &Soak::runFlushTask};
+
+  SensorDriver ** drivers = NULL;
+  unsigned short sensorCount = 0;
+
+  char summaryCacheStorage[SUMMARY_CACHE_SIZE] __attribute__((aligned(4)));
+  char rawCacheStorage[RAW_CACHE_SIZE] __attribute__((aligned(4)));
+  WriteCache summaryWriteCache{&summaryOutput, summaryCacheStorage, SUMMARY_CACHE_SIZE};
+  WriteCache rawWriteCache{&rawOutput, rawCacheStorage, RAW_CACHE_SIZE};
+
+  soak_cycle_state_type measurementCycleState = soak_idle;
+  unsigned short burstsRemaining = 0;
+  unsigned short measurementsRemaining = 0;
+
+  uint64 realMillis = SOAK_EPOCH * 1000ULL; // the RTC
+  uint32 currentEpoch = 0;
+  uint32 offsetMillis = 0;
+  uint64 lastRowMillis[2] = {0, 0}; // raw and summary rows
+
+  void awake(uint32 milliseconds)
+  {
+    hostAdvanceMillis(milliseconds);
+    realMillis += milliseconds;
+  }
+
+  // as Datalogger::idle, STOP mode in a cycle for 5 ms or more
+  void idle(unsigned long milliseconds)
+  {
+    if (milliseconds >= 5)
+    {
+      realMillis += milliseconds;
+      offsetMillis -= milliseconds;
+      scheduler.advanceClock(milliseconds);
+    }
+    else
+    {
+      awake(milliseconds);
+    }
+  }
+
+  void runCycle()
+  {
+    // as Datalogger::initializeMeasurementCycle
+    currentEpoch = realMillis / 1000;
+    offsetMillis = millis();
+    burstsRemaining = integer(1, 3);
+    initializeBurst();
+    measurementCycleState = soak_warm_up;
+    scheduler.wake(&cliTask);
+    scheduler.wake(&measurementCycleTask);
+
+    while (measurementCycleState != soak_idle)
+    {
+      awake(1);
+      unsigned long wait = scheduler.runDueTasks();
+      if (wait > 0 && measurementCycleState != soak_idle)
+      {
+        idle(wait == TASK_SUSPENDED ? 1 : wait);
+      }
+    }
+
+    for (unsigned short i = 0; i < sensorCount; i++)
+    {
+      drivers[i]->stop();
+    }
+  }
+
+  void initializeBurst()
+  {
+    measurementsRemaining = 1;
+    for (unsigned short i = 0; i < sensorCount; i++)
+    {
+      drivers[i]->initializeBurst();
+      measurementsRemaining = std::max(measurementsRemaining, (unsigned short) drivers[i]->getCommonConfigurations()->burst_size);
+    }
+  }
+
+  unsigned long runMeasurementCycleTask()
+  {
+    switch (measurementCycleState)
+    {
+    case soak_warm_up:
+      measurementCycleState = soak_reading;
+      return integer(0, 3) == 0 ? integer(100, 3000) : 0;
+
+    case soak_reading:
+      awake(integer(1, 40)); // the reads
+      for (unsigned short i = 0; i < sensorCount; i++)
+      {
+        FixedValueDriver * driver = dynamic_cast<FixedValueDriver *>(drivers[i]);
+        if (driver != NULL)
+        {
+          driver->values[0] = makeSample(integer(-100000, 100000), -2, unit_counts);
+          driver->values[1] = makeSample(integer(0, 5000), -1, unit_counts);
+        }
+        drivers[i]->takeMeasurement();
+      }
+      writeRow(&rawWriteCache, false);
+      if (--measurementsRemaining > 0)
+      {
+        return integer(5, 500);
+      }
+
+      writeRow(&summaryWriteCache, true);
+      if (--burstsRemaining > 0)
+      {
+        initializeBurst();
+        return integer(0, 1) ? integer(1000, 60000) : 0;
+      }
+      measurementCycleState = soak_complete;
+      scheduler.wake(&flushTask);
+      return TASK_SUSPENDED;
+
+    default:
+      return TASK_SUSPENDED;
+    }
+  }
+
+  unsigned long runFlushTask()
+  {
+    awake(integer(5, 50)); // the SD card
+    summaryWriteCache.flushCache();
+    measurementCycleState = soak_idle;
+    return TASK_SUSPENDED;
+  }
+
+  void writeRow(WriteCache * cache, bool summary)
+  {
+    // as Datalogger::writeStatusFieldsToLogFile
+    char buffer[24];
+    uint32 elapsedMillis = millis() - offsetMillis;
+    sprintf(buffer, "%10lu.%03u,", (unsigned long) (currentEpoch + elapsedMillis / 1000), (unsigned int) (elapsedMillis % 1000));
+    cache->writeString(buffer);
+
+    uint64 rowMillis = (uint64) (currentEpoch + elapsedMillis / 1000) * 1000 + elapsedMillis % 1000;
+    if (rowMillis <= lastRowMillis[summary] || rowMillis > realMillis || realMillis - rowMillis >= 1000)
+    {
+      if (timestampErrors++ < 10)
+      {
+        fprintf(stderr, "row at %llu ms, real time %llu ms, previous row %llu ms\n", (unsigned long long) rowMillis, (unsigned long long) realMillis, (unsigned long long) lastRowMillis[summary]);
+      }
+    }
+    lastRowMillis[summary] = rowMillis;
+
+    for (unsigned short i = 0; i < sensorCount; i++)
+    {
+      OutputSpan span = cache->reserve(SOAK_MAX_ROW);
+      if (summary)
+      {
+        drivers[i]->appendSummaryData(&span);
+      }
+      else
+      {
+        drivers[i]->appendRawData(&span);
+      }
+      cache->commit(span);
+      if (i < sensorCount - 1)
+      {
+        cache->writeString(",");
+      }
+    }
+    cache->endOfLine();
+    rowsWritten++;
+  }
+
+  unsigned long runCLITask()
+  {
+    if (uniform(0, 1) < SOAK_CONFIGURATION_CHANGE_RATE)
+    {
+      configurationChanges++;
+      changeConfiguration();
+    }
+    return TASK_SUSPENDED;
+  }
+
+  const char * randomTag()
+  {
+    static const char * tags[] = {"a", "b", "ec", "dht", "t"};
+    return tags[integer(0, 4)];
+  }
+
+  void changeConfiguration()
+  {
+    char command[160];
+    int slot = integer(1, EEPROM_TOTAL_SENSOR_SLOTS);
+    switch (integer(0, 9))
+    {
+    case 0:
+    case 1:
+    case 2:
+      sprintf(command, "{\"slot\":%d,\"tag\":\"%s\",\"burst_size\":%d,\"deadband\":%d}", slot, randomTag(), integer(1, 10), integer(0, 2));
+      setSensorConfiguration(leaky && integer(0, 1) ? "leaky" : "fixed_value", command);
+      break;
+    case 3:
+      sprintf(command, "{\"slot\":%d,\"tag\":\"%s\",\"burst_size\":1,\"expression\":\"%s_a / (1 + 0.02 * (%s_b - 25))\"}", slot, randomTag(), randomTag(), randomTag());
+      setSensorConfiguration("derived", command);
+      break;
+    case 4:
+      // rejected by the driver
+      sprintf(command, "{\"slot\":%d,\"tag\":\"toolongtag\",\"burst_size\":1}", slot);
+      setSensorConfiguration("fixed_value", command);
+      break;
+    case 5:
+    {
+      // mistyped, every one different
+      char type[20];
+      sprintf(type, "fixed_valeu%d", integer(0, 1000000));
+      sprintf(command, "{\"slot\":%d,\"tag\":\"x\",\"burst_size\":1}", slot);
+      setSensorConfiguration(type, command);
+      break;
+    }
+    case 6:
+    case 7:
+      // as Datalogger::clearSlot
+      if (removeSlotDriver(&drivers, &sensorCount, slot - 1))
+      {
+        DerivedDriver::setSlotDrivers(drivers, sensorCount);
+      }
+      break;
+    default:
+      // get-config
+      for (unsigned short i = 0; i < sensorCount; i++)
+      {
+        cJSON * json = drivers[i]->getConfigurationJSON();
+        char * string = cJSON_Print(json);
+        cJSON_free(string);
+        cJSON_Delete(json);
+      }
+    }
+  }
+
+  // as Datalogger::setSensorConfiguration
+  void setSensorConfiguration(const char * type, const char * command)
+  {
+    cJSON * json = cJSON_Parse(command);
+    SensorDriver * driver = driverForSensorTypeCode(typeCodeForSensorTypeString(type));
+    if (driver != NULL)
+    {
+      DerivedDriver::setSlotDrivers(drivers, sensorCount);
+      if (driver->configureFromJSON(json))
+      {
+        driver->setup();
+        putSlotDriver(&drivers, &sensorCount, driver);
+        DerivedDriver::setSlotDrivers(drivers, sensorCount);
+      }
+      else
+      {
+        delete (driver);
+      }
+    }
+    cJSON_Delete(json);
+  }
+};
+
+// the largest value of a sample field over a range of weeks
+static size_t peak(Soak * soak, size_t memory_sample::*field, unsigned short from, unsigned short to)
+{
+  size_t largest = 0;
+  for (unsigned short i = from; i < to && i < soak->sampleCount; i++)
+  {
+    largest = std::max(largest, soak->samples[i].*field);
+  }
+  return largest;
+}
+
+// true if the heap or stack grew after the first quarter
+static bool memoryGrew(Soak * soak, bool report)
+{
+  unsigned short quarter = soak->sampleCount / 4;
+  bool grew = false;
+  struct
+  {
+    const char * name;
+    size_t memory_sample::*field;
+    size_t slack;
+  } trends[] = {
+    {"heap in use", &memory_sample::inUse, HEAP_SLACK},
+    {"free inside the heap", &memory_sample::freeInside, EXTENT_SLACK},
+    {"free outside the largest free block", &memory_sample::scatteredFree, EXTENT_SLACK},
+    {"heap extent", &memory_sample::extent, EXTENT_SLACK},
+    {"stack high water", &memory_sample::stackHighWater, HEAP_SLACK},
+  };
+  for (unsigned short i = 0; i < sizeof(trends) / sizeof(trends[0]); i++)
+  {
+    size_t first = peak(soak, trends[i].field, 0, quarter);
+    size_t rest = peak(soak, trends[i].field, quarter, soak->sampleCount);
+    if (rest > first + trends[i].slack)
+    {
+      grew = true;
+      if (report)
+      {
+        fprintf(stderr, "%s grew from %zu to %zu bytes\n", trends[i].name, first, rest);
+      }
+    }
+  }
+  return grew;
+}
+
+static void * soakYear(void * argument)
+{
+  Soak * soak = new Soak(false);
+  soak->run(SOAK_WEEKS);
+
+  CHECK_EQUAL(SOAK_WEEKS, soak->sampleCount);
+  CHECK(!memoryGrew(soak, true));
+  CHECK(peak(soak, &memory_sample::stackHighWater, 0, SOAK_WEEKS) < 32 * 1024);
+
+  CHECK_EQUAL(0UL, soak->timestampErrors);
+  CHECK(soak->millisWraps > 0);
+  CHECK(soak->configurationChanges > 1000);
+  CHECK(soak->rowsWritten > SOAK_WEEKS * SOAK_CYCLES_PER_WEEK);
+
+  // the raw cache only flushes when full
+  CHECK(soak->rowsReceived() <= soak->rowsWritten);
+  CHECK(soak->rowsWritten - soak->rowsReceived() < RAW_CACHE_SIZE);
+  CHECK(soak->summaryOutput.blocks > 0 && soak->rawOutput.blocks > 0);
+  CHECK_EQUAL(0UL, soak->summaryOutput.badBlocks + soak->rawOutput.badBlocks);
+
+  const memory_sample & last = soak->samples[SOAK_WEEKS - 1];
+  printf("soak: %lu rows, %lu configuration changes, heap %zu bytes in use, %zu free inside, largest free block %zu, stack %zu bytes\n",
+         soak->rowsWritten, soak->configurationChanges, last.inUse, last.freeInside, last.largestFree, last.stackHighWater);
+  delete soak;
+
+  // and the checks catch a leak
+  Soak * leaking = new Soak(true);
+  leaking->run(SOAK_LEAK_WEEKS);
+  CHECK(memoryGrew(leaking, false));
+  delete leaking;
+  return NULL;
+}
+
+int main()
+{
+  // one arena for every thread, no mmap, and the heap top is only returned when asked
+  mallopt(M_ARENA_MAX, 1);
+  mallopt(M_MMAP_MAX, 0);
+  mallopt(M_TRIM_THRESHOLD, INT_MAX);
+  mallopt(M_TOP_PAD, 0);
+
+  setupSensorMaps<FixedValueDriver>(FIXED_VALUE_SENSOR, F(FIXED_VALUE_TYPE_STRING));
+  setupSensorMaps<LeakyDriver>(LEAKY_SENSOR, F("leaky"));
+  setupSensorMaps<DerivedDriver>(SOAK_DERIVED_SENSOR, F(DERIVED_TYPE_STRING));
+
+  // in a thread on a painted stack, for its high water
+  stack = (byte *) aligned_alloc(4096, SOAK_STACK_SIZE);
+  memset(stack, SOAK_STACK_PAINT, SOAK_STACK_SIZE);
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstack(&attributes, stack, SOAK_STACK_SIZE);
+  pthread_t thread;
+  CHECK_EQUAL(0, pthread_create(&thread, &attributes, soakYear, NULL));
+  pthread_join(thread, NULL);
+  return checkSummary("soak");
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+#  RRIV - Open Source Environmental Data Logging Platform
+#  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+
+"""
+Central side of the logger's offload protocol (src/system/ble_offload.h),
+run against the serial stand in ('ble-offload serial' on the console) to
+test the framing, acknowledgement and resume logic and to measure
+throughput without a radio.
+
+  ble_offload.py PORT list                  list the files in the logging folder
+  ble_offload.py PORT get OUT_DIR [NAME...]  download files, all when no names
+                                            are given; partial files in OUT_DIR
+                                            are resumed from their length
+  --drop-every N   ignore every Nth data frame to exercise the resend path
+
+Needs pyserial.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+import serial
+
+from verify_log_crc import stm32_crc32
+
+FRAME_MARKER = 0xA5
+HEADER = struct.Struct('<BBBI')  # marker, type, length, offset
+MAX_PAYLOAD = 12 * 20 - 11  # BLE_OFFLOAD_PAYLOAD_SIZE
+TIMEOUT = 10
+
+
+class Session:
+    def __init__(self, port, baud, drop_every):
+        self.port = serial.Serial(port, baud, timeout=0.1)
+        self.drop_every = drop_every
+        self.frames = 0
+        self.buffer = b''
+
+    def send(self, text):
+        self.port.write(text.encode() + b'\n')
+
+    def fill(self):
+        data = self.port.read(4096)
+        if not data:
+            if time.time() - self.last_data > TIMEOUT:
+                raise RuntimeError('logger stopped answering')
+        else:
+            self.last_data = time.time()
+        self.buffer += data
+
+    def read_line(self):
+        self.last_data = time.time()
+        while b'\n' not in self.buffer:
+            self.fill()
+        line, self.buffer = self.buffer.split(b'\n', 1)
+        return line.strip().decode(errors='replace')
+
+    def start(self):
+        self.send('ble-offload serial')
+        while 'offload over serial' not in self.read_line():
+            pass
+
+    def close(self):
+        self.send('bye')
+        while self.read_line() != 'bye':
+            pass
+
+    def list(self):
+        self.send('list')
+        files = []
+        while True:
+            line = self.read_line()
+            if line == '.':
+                return files
+            name, _, size = line.rpartition(',')
+            if name and size.isdigit():  # skip debug output
+                files.append((name, int(size)))
+
+    def read_frame(self):
+        self.last_data = time.time()
+        while True:
+            start = self.buffer.find(bytes([FRAME_MARKER]))
+            if start < 0:
+                self.buffer = b''
+            else:
+                self.buffer = self.buffer[start:]
+                if len(self.buffer) >= HEADER.size:
+                    _, kind, length, offset = HEADER.unpack_from(self.buffer)
+                    end = HEADER.size + length
+                    if kind not in (ord('D'), ord('E')) or length > MAX_PAYLOAD:
+                        self.buffer = self.buffer[1:]  # not a frame, resync
+                        continue
+                    if len(self.buffer) >= end + 4:
+                        crc, = struct.unpack_from('<I', self.buffer, end)
+                        if crc == stm32_crc32(self.buffer[:end]):
+                            payload = self.buffer[HEADER.size:end]
+                            self.buffer = self.buffer[end + 4:]
+                            return chr(kind), offset, payload
+                        self.buffer = self.buffer[1:]  # not a frame, resync
+                        continue
+            self.fill()
+
+    def get(self, name, path):
+        offset = os.path.getsize(path) if os.path.exists(path) else 0
+        self.send('get %s %d' % (name, offset))
+        line = self.read_line()
+        while not line.startswith('file,') and not line.startswith('error,'):
+            line = self.read_line()
+        if line.startswith('error,'):
+            raise RuntimeError('%s: %s' % (name, line))
+        size, start = (int(v) for v in line.split(',')[-2:])
+
+        expected = start
+        started = time.time()
+        with open(path, 'r+b' if start else 'wb') as out:
+            out.seek(start)
+            out.truncate()
+            while True:
+                kind, frame_offset, payload = self.read_frame()
+                if kind == 'E' and frame_offset == expected:
+                    break
+                self.frames += 1
+                if self.drop_every and self.frames % self.drop_every == 0:
+                    continue
+                if kind == 'D' and frame_offset == expected:
+                    out.write(payload)
+                    expected += len(payload)
+                self.send('ack %d' % expected)  # also repeats the position after a gap
+        elapsed = time.time() - started
+        rate = (size - start) / elapsed if elapsed > 0 else 0
+        print('%s: %d bytes from offset %d in %.2f s, %.0f B/s' % (name, size - start, start, elapsed, rate))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--drop-every', type=int, default=0, metavar='N')
+    parser.add_argument('command', choices=('list', 'get'))
+    parser.add_argument('out_dir', nargs='?')
+    parser.add_argument('names', nargs='*')
+    args = parser.parse_args()
+
+    session = Session(args.port, args.baud, args.drop_every)
+    session.start()
+    try:
+        files = session.list()
+        if args.command == 'list':
+            for name, size in files:
+                print('%s %d' % (name, size))
+            return 0
+
+        if not args.out_dir:
+            parser.error('get needs OUT_DIR')
+        os.makedirs(args.out_dir, exist_ok=True)
+        for name, _ in files:
+            if not args.names or name in args.names:
+                session.get(name, os.path.join(args.out_dir, name))
+    finally:
+        session.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
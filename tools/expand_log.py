@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+#  RRIV - Open Source Environmental Data Logging Platform
+#  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+
+
+"""
+Re-expand data files written with configuration epochs to the legacy wide
+format, with the site, logger, deployment, deployed_at and uuid columns in
+every row.
+
+  expand_log.py OUT_DIR FILE...
+
+Each row's config_epoch column is looked up in the '#config,<epoch>,logger,<json>'
+lines of the file, or of an earlier file on the command line when a circular
+segment starts with rows of an older epoch.  The '#config' lines, the
+'#crc32' trailers and '#segment' headers (which no longer match) are left out
+of the copies, run verify_log_crc.py on the originals.  Files without a config_epoch column are
+copied unchanged.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+from verify_log_crc import valid_contents
+
+LEGACY_COLUMNS = ['site', 'logger', 'deployment', 'deployed_at', 'uuid']
+
+
+def legacy_values(logger):
+    identifier = logger.get('deployment_identifier', '')
+    uuid = logger.get('device_uuid', '')
+    deployed_at = int(logger.get('deployed_at', 0))
+    if identifier:
+        deployment = '%s-%s-%d' % (identifier, uuid, deployed_at)
+    else:
+        deployment = '%s-%d' % (uuid, deployed_at)
+    return {
+        'site': logger.get('site_name', ''),
+        'logger': logger.get('logger_name', ''),
+        'deployment': deployment,
+        'deployed_at': '%d' % deployed_at,
+        'uuid': uuid,
+    }
+
+
+def expand(lines, configs, latest):
+    """Yield the output lines, configs maps epoch to legacy values and collects the file's #config lines."""
+    epoch_column = None
+    missing = []
+    insert_at = 0
+    unresolved = 0
+    for line in lines:
+        body = line.rstrip('\r\n')
+        ending = line[len(body):]
+        if body.startswith('#config,'):
+            _, epoch, kind, config = body.split(',', 3)
+            if kind == 'logger':
+                try:
+                    configs[epoch] = legacy_values(json.loads(config))
+                    latest[0] = epoch
+                except ValueError:
+                    print('unreadable logger configuration for epoch %s' % epoch, file=sys.stderr)
+            continue
+        if body.startswith('#crc32,') or body.startswith('#segment,'):
+            continue
+        if body.startswith('#') or (epoch_column is not None and body.startswith('debug,')):
+            yield line
+            continue
+
+        columns = body.split(',')
+        if epoch_column is None:
+            # the column header
+            if 'config_epoch' not in columns:
+                epoch_column = -1
+                yield line
+                continue
+            epoch_column = columns.index('config_epoch')
+            missing = [name for name in LEGACY_COLUMNS if name not in columns]
+            insert_at = columns.index('type') + 1 if 'type' in columns else 0
+            values = missing
+        elif epoch_column < 0 or len(columns) <= epoch_column:
+            yield line
+            continue
+        else:
+            legacy = configs.get(columns[epoch_column])
+            if legacy is None:
+                legacy = configs.get(latest[0])
+                unresolved += 1
+            values = [legacy[name] if legacy else '' for name in missing]
+
+        del columns[epoch_column]
+        columns[insert_at:insert_at] = values
+        yield ','.join(columns) + ending
+
+    if unresolved:
+        print('%d rows without #config lines for their epoch, used the latest' % unresolved, file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('out_dir')
+    parser.add_argument('files', nargs='+')
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    configs = {}
+    latest = [None]
+    for path in args.files:
+        with open(path, 'rb') as f:
+            contents = valid_contents(f.read()).decode('utf-8', errors='replace')
+        with open(os.path.join(args.out_dir, os.path.basename(path)), 'w', newline='') as out:
+            out.writelines(expand(contents.splitlines(keepends=True), configs, latest))
+        print('%s: expanded' % path)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
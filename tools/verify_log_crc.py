@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+#  RRIV - Open Source Environmental Data Logging Platform
+#  Copyright (C) 20202  Zaven Arra  zaven.arra@gmail.com
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+
+"""
+Check the '#crc32,<length>,<crc>' trailers the logger writes after each
+flushed block of a data file.
+
+  verify_log_crc.py FILE...                 report good, corrupt and unverified regions
+  verify_log_crc.py --repair OUT_DIR FILE...  also write a copy of each file that
+                                            keeps only lines from verified blocks
+                                            (and the header lines)
+
+Circular log segments (SEG<nn>.CSV) are checked up to the valid length
+recorded in their '#segment' header, the rest is left over from earlier use.
+
+The CRC matches the STM32F1 hardware CRC unit: CRC-32/MPEG-2 fed with
+little endian 32 bit words, last partial word padded with zero bytes.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+TRAILER = re.compile(rb'^#crc32,(\d+),([0-9a-fA-F]{8})$')
+SEGMENT = re.compile(rb'^#segment,(\d+),(\d+),(\d+),(\d+),(\d+)')
+
+_TABLE = []
+for _i in range(256):
+    _c = _i << 24
+    for _ in range(8):
+        _c = ((_c << 1) ^ 0x04C11DB7) if _c & 0x80000000 else (_c << 1)
+    _TABLE.append(_c & 0xFFFFFFFF)
+
+
+def stm32_crc32(data):
+    padding = (-len(data)) % 4
+    data = data + b'\0' * padding
+    crc = 0xFFFFFFFF
+    for i in range(0, len(data), 4):
+        # the peripheral shifts each word in most significant byte first
+        for b in reversed(data[i:i + 4]):
+            crc = ((crc << 8) & 0xFFFFFFFF) ^ _TABLE[(crc >> 24) ^ b]
+    return crc
+
+
+def scan(contents):
+    """Yield (kind, start, end) regions; kind is 'header', 'ok', 'corrupt' or 'unverified'."""
+    lines = contents.splitlines(keepends=True)
+    offset = 0
+    covered_to = 0
+    header_done = False
+    header_end = None  # set until the #config lines below the column header are accounted for
+    metadata_end = None
+    for line in lines:
+        start = offset
+        offset += len(line)
+        match = TRAILER.match(line.rstrip(b'\r\n'))
+        if not header_done:
+            if line.startswith(b'#') and not match:
+                continue  # metadata comments written with the column header
+            header_done = True
+            if not line.startswith(b'#'):
+                header_end = metadata_end = offset
+                continue
+        if header_end is not None:
+            if line.startswith(b'#config,') and metadata_end == start:
+                metadata_end = offset
+                continue
+            if not match:
+                continue
+            # the first block may start with the #config lines of a change made before it
+            end = min(max(start - int(match.group(1)), header_end), metadata_end)
+            yield ('header', 0, end)
+            covered_to = end
+            header_end = None
+        if not match:
+            continue
+        length = int(match.group(1))
+        expected = int(match.group(2), 16)
+        block_start = start - length
+        if block_start < covered_to:
+            # the block claims bytes that belong to an earlier block, it is torn
+            yield ('corrupt', covered_to, offset)
+        else:
+            if block_start > covered_to:
+                yield ('unverified', covered_to, block_start)
+            good = stm32_crc32(contents[block_start:start]) == expected
+            yield ('ok' if good else 'corrupt', block_start, offset)
+        covered_to = offset
+    if header_end is not None:
+        yield ('header', 0, metadata_end)
+        covered_to = metadata_end
+    if covered_to < len(contents):
+        yield ('unverified', covered_to, len(contents))
+
+
+def valid_contents(contents):
+    """Drop the stale tail of a circular log segment."""
+    match = SEGMENT.match(contents)
+    if match:
+        return contents[:int(match.group(4))]
+    return contents
+
+
+def line_number(contents, offset):
+    return contents.count(b'\n', 0, offset) + 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--repair', metavar='OUT_DIR', help='write repaired copies into OUT_DIR')
+    parser.add_argument('files', nargs='+')
+    args = parser.parse_args()
+
+    failures = 0
+    for path in args.files:
+        with open(path, 'rb') as f:
+            contents = valid_contents(f.read())
+        regions = list(scan(contents))
+        counts = {'ok': 0, 'corrupt': 0, 'unverified': 0, 'header': 0}
+        for kind, start, end in regions:
+            counts[kind] += 1
+            if kind in ('corrupt', 'unverified'):
+                print('%s: %s bytes %d-%d (lines %d-%d)' % (
+                    path, kind, start, end, line_number(contents, start), line_number(contents, end - 1)))
+        print('%s: %d good blocks, %d corrupt, %d unverified regions' % (
+            path, counts['ok'], counts['corrupt'], counts['unverified']))
+        if counts['corrupt']:
+            failures += 1
+
+        if args.repair:
+            os.makedirs(args.repair, exist_ok=True)
+            with open(os.path.join(args.repair, os.path.basename(path)), 'wb') as out:
+                for kind, start, end in regions:
+                    if kind in ('header', 'ok'):
+                        out.write(contents[start:end])
+
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())